@@ -31,6 +31,9 @@ DBG_DEFAULT_CHANNEL(HWDETECT);
 #define FIRST_BIOS_DISK 0x80
 #define FIRST_PARTITION 1
 
+/* Reads up to this size go through the disk cache */
+#define DISK_CACHE_MAX_READ (32 * 1024)
+
 typedef struct tagDISKCONTEXT
 {
     UCHAR DriveNumber;
@@ -173,6 +176,25 @@ DiskRead(ULONG FileId, VOID* Buffer, ULONG N, ULONG* Count)
     // In release builds assertions are disabled, however we also have sanity checks in DiskOpen()
     ASSERT(MaxSectors > 0);
 
+    /*
+     * The file systems read metadata and small files a few sectors at a time.
+     * Let the cache serve these, it reads ahead of sequential reads and turns
+     * runs of misses into single BIOS calls. Only one hard disk is cached at
+     * a time, large reads are already done in buffer sized chunks below.
+     */
+    if (N <= DISK_CACHE_MAX_READ &&
+        (N % Context->SectorSize) == 0 &&
+        Context->DriveNumber >= FIRST_BIOS_DISK &&
+        (!CacheManagerInitialized || CacheManagerDrive.DriveNumber == Context->DriveNumber) &&
+        CacheInitializeDrive(Context->DriveNumber) &&
+        CacheManagerDrive.BytesPerSector == Context->SectorSize &&
+        CacheReadDiskSectors(Context->DriveNumber, SectorOffset, TotalSectors, Buffer))
+    {
+        *Count = N;
+        Context->SectorNumber += TotalSectors;
+        return ESUCCESS;
+    }
+
     ret = TRUE;
 
     while (TotalSectors)
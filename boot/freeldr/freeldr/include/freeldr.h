@@ -86,6 +86,7 @@
 #include <peloader.h>
 
 /* File system headers */
+#include <fs/bundle.h>
 #include <fs/ext2.h>
 #include <fs/fat.h>
 #include <fs/ntfs.h>
@@ -0,0 +1,16 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Header file for boot bundle support.
+ */
+
+#pragma once
+
+ARC_STATUS
+BundleInitialize(
+    _In_opt_ PCSTR FileName,
+    _In_ PCSTR DefaultPath);
+
+const DEVVTBL*
+BundleLookupFile(
+    _In_ PCSTR Path);
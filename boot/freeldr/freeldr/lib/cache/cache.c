@@ -38,6 +38,7 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
 {
     PCACHE_BLOCK    NextCacheBlock;
     GEOMETRY    DriveGeometry;
+    ULONG        Idx;
 
     // If we already have a cache for this drive then
     // by all means lets keep it, unless it is a removable
@@ -80,26 +81,52 @@ BOOLEAN CacheInitializeDrive(UCHAR DriveNumber)
     // Initialize the structure
     RtlZeroMemory(&CacheManagerDrive, sizeof(CACHE_DRIVE));
     InitializeListHead(&CacheManagerDrive.CacheBlockHead);
+    for (Idx = 0; Idx < CACHE_HASH_SIZE; Idx++)
+    {
+        InitializeListHead(&CacheManagerDrive.HashTable[Idx]);
+    }
     CacheManagerDrive.DriveNumber = DriveNumber;
+    CacheManagerDrive.NextBlock = MAXULONG;
     if (!MachDiskGetDriveGeometry(DriveNumber, &DriveGeometry))
     {
         return FALSE;
     }
     CacheManagerDrive.BytesPerSector = DriveGeometry.BytesPerSector;
+    if (CacheManagerDrive.BytesPerSector == 0)
+    {
+        return FALSE;
+    }
 
-    // Get the number of sectors in each cache block
+    // Get the number of sectors in each cache block. Small blocks keep
+    // scattered metadata reads from pulling in whole tracks, since runs
+    // of blocks are read together this doesn't make the reads smaller.
     CacheManagerDrive.BlockSize = MachDiskGetCacheableBlockCount(DriveNumber);
+    CacheManagerDrive.BlockSize = min(CacheManagerDrive.BlockSize, CACHE_BLOCK_BYTES / CacheManagerDrive.BytesPerSector);
+    CacheManagerDrive.BlockSize = max(CacheManagerDrive.BlockSize, 1);
+
+    // Get the number of blocks that fit in one disk read
+#if defined(_M_ARM)
+    CacheManagerDrive.MaxReadBlocks = 1;
+#else
+    CacheManagerDrive.MaxReadBlocks = (ULONG)(DiskReadBufferSize / (CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector));
+#endif
+    if (CacheManagerDrive.MaxReadBlocks == 0)
+    {
+        return FALSE;
+    }
 
+    // Leave most of the temporary heap to the file systems
     CacheBlockCount = 0;
     CacheSizeCurrent = 0;
     CacheSizeLimit = TotalPagesInLookupTable / 8 * MM_PAGE_SIZE;
-    CacheSizeLimit = min(CacheSizeLimit, TEMP_HEAP_SIZE - (128 * 1024));
+    CacheSizeLimit = min(CacheSizeLimit, TEMP_HEAP_SIZE / 4);
 
     CacheManagerInitialized = TRUE;
 
     TRACE("Initializing BIOS drive 0x%x.\n", DriveNumber);
     TRACE("BytesPerSector: %d.\n", CacheManagerDrive.BytesPerSector);
     TRACE("BlockSize: %d.\n", CacheManagerDrive.BlockSize);
+    TRACE("MaxReadBlocks: %d.\n", CacheManagerDrive.MaxReadBlocks);
     TRACE("CacheSizeLimit: %d.\n", CacheSizeLimit);
 
     return TRUE;
@@ -114,11 +141,10 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
 {
     PCACHE_BLOCK    CacheBlock;
     ULONG                StartBlock;
-    ULONG                SectorOffsetInStartBlock;
-    ULONG                CopyLengthInStartBlock;
+    ULONG                SectorOffsetInBlock;
+    ULONG                CopyLengthInBlock;
     ULONG                EndBlock;
-    ULONG                SectorOffsetInEndBlock;
-    ULONG                BlockCount;
+    ULONG                ReadAheadCount;
     ULONG                Idx;
 
     TRACE("CacheReadDiskSectors() DiskNumber: 0x%x StartSector: %I64d SectorCount: %d Buffer: 0x%x\n", DiskNumber, StartSector, SectorCount, Buffer);
@@ -129,92 +155,39 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
         return FALSE;
     }
 
+    if (SectorCount == 0)
+    {
+        return TRUE;
+    }
+
     //
     // Calculate which blocks we must cache
     //
     StartBlock = (ULONG)(StartSector / CacheManagerDrive.BlockSize);
-    SectorOffsetInStartBlock = (ULONG)(StartSector % CacheManagerDrive.BlockSize);
-    CopyLengthInStartBlock = (ULONG)((SectorCount > (CacheManagerDrive.BlockSize - SectorOffsetInStartBlock)) ? (CacheManagerDrive.BlockSize - SectorOffsetInStartBlock) : SectorCount);
+    SectorOffsetInBlock = (ULONG)(StartSector % CacheManagerDrive.BlockSize);
     EndBlock = (ULONG)((StartSector + (SectorCount - 1)) / CacheManagerDrive.BlockSize);
-    SectorOffsetInEndBlock = (ULONG)(1 + (StartSector + (SectorCount - 1)) % CacheManagerDrive.BlockSize);
-    BlockCount = (EndBlock - StartBlock) + 1;
-    TRACE("StartBlock: %d SectorOffsetInStartBlock: %d CopyLengthInStartBlock: %d EndBlock: %d SectorOffsetInEndBlock: %d BlockCount: %d\n", StartBlock, SectorOffsetInStartBlock, CopyLengthInStartBlock, EndBlock, SectorOffsetInEndBlock, BlockCount);
 
     //
-    // Read the first block into the buffer
+    // If this read picks up where the last one stopped then a file
+    // is being read sequentially, so read ahead of it on a miss
     //
-    if (BlockCount > 0)
+    if (StartBlock == CacheManagerDrive.NextBlock || StartBlock + 1 == CacheManagerDrive.NextBlock)
     {
-        //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
-        //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, StartBlock);
-        if (CacheBlock == NULL)
-        {
-            return FALSE;
-        }
-
-        //
-        // Copy the portion requested into the buffer
-        //
-        RtlCopyMemory(Buffer,
-            (PVOID)((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInStartBlock * CacheManagerDrive.BytesPerSector)),
-            (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
-        TRACE("1 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, ((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInStartBlock * CacheManagerDrive.BytesPerSector)), (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (CopyLengthInStartBlock * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the block count
-        //
-        BlockCount--;
+        ReadAheadCount = CACHE_MAX_READ_AHEAD;
     }
-
-    //
-    // Loop through the middle blocks and read them into the buffer
-    //
-    for (Idx=StartBlock+1; BlockCount>1; Idx++)
+    else
     {
-        //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
-        //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
-        if (CacheBlock == NULL)
-        {
-            return FALSE;
-        }
-
-        //
-        // Copy the portion requested into the buffer
-        //
-        RtlCopyMemory(Buffer,
-            CacheBlock->BlockData,
-            CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector);
-        TRACE("2 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, CacheBlock->BlockData, CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector);
-
-        //
-        // Update the buffer address
-        //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (CacheManagerDrive.BlockSize * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the block count
-        //
-        BlockCount--;
+        ReadAheadCount = 0;
     }
+    TRACE("StartBlock: %d SectorOffsetInBlock: %d EndBlock: %d ReadAheadCount: %d\n", StartBlock, SectorOffsetInBlock, EndBlock, ReadAheadCount);
 
-    //
-    // Read the last block into the buffer
-    //
-    if (BlockCount > 0)
+    for (Idx = StartBlock; Idx <= EndBlock; Idx++)
     {
         //
-        // Get cache block pointer (this forces the disk sectors into the cache memory)
+        // Get cache block pointer (this forces the disk sectors into the cache memory,
+        // together with the rest of the request and the read-ahead if they are missing)
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, EndBlock);
+        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx, (EndBlock - Idx) + 1 + ReadAheadCount);
         if (CacheBlock == NULL)
         {
             return FALSE;
@@ -223,22 +196,21 @@ BOOLEAN CacheReadDiskSectors(UCHAR DiskNumber, ULONGLONG StartSector, ULONG Sect
         //
         // Copy the portion requested into the buffer
         //
+        CopyLengthInBlock = min(CacheManagerDrive.BlockSize - SectorOffsetInBlock, SectorCount);
         RtlCopyMemory(Buffer,
-            CacheBlock->BlockData,
-            SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector);
-        TRACE("3 - RtlCopyMemory(0x%x, 0x%x, %d)\n", Buffer, CacheBlock->BlockData, SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector);
+            (PVOID)((ULONG_PTR)CacheBlock->BlockData + (SectorOffsetInBlock * CacheManagerDrive.BytesPerSector)),
+            (CopyLengthInBlock * CacheManagerDrive.BytesPerSector));
 
         //
-        // Update the buffer address
+        // Update the buffer address and the sectors left
         //
-        Buffer = (PVOID)((ULONG_PTR)Buffer + (SectorOffsetInEndBlock * CacheManagerDrive.BytesPerSector));
-
-        //
-        // Update the block count
-        //
-        BlockCount--;
+        Buffer = (PVOID)((ULONG_PTR)Buffer + (CopyLengthInBlock * CacheManagerDrive.BytesPerSector));
+        SectorCount -= CopyLengthInBlock;
+        SectorOffsetInBlock = 0;
     }
 
+    CacheManagerDrive.NextBlock = EndBlock + 1;
+
     return TRUE;
 }
 
@@ -274,7 +246,7 @@ BOOLEAN CacheForceDiskSectorsIntoCache(UCHAR DiskNumber, ULONGLONG StartSector,
         //
         // Get cache block pointer (this forces the disk sectors into the cache memory)
         //
-        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx);
+        CacheBlock = CacheInternalGetBlockPointer(&CacheManagerDrive, Idx, (StartBlock + BlockCount) - Idx);
         if (CacheBlock == NULL)
         {
             return FALSE;
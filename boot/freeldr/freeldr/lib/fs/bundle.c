@@ -0,0 +1,368 @@
+/*
+ * PROJECT:     FreeLoader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Serves the files of a boot bundle from memory.
+ *
+ * A boot bundle (see bootbundle.h) packs the kernel, the HAL, the
+ * hives and the boot drivers into one file. It is read with one sequential
+ * read and decompressed in memory, after which ArcOpen() hands out the files
+ * it holds instead of reading them one by one from the boot media.
+ */
+
+/* INCLUDES *******************************************************************/
+
+#include <freeldr.h>
+#include <bootbundle.h>
+
+#include <debug.h>
+DBG_DEFAULT_CHANNEL(FILESYSTEM);
+
+/* GLOBALS ********************************************************************/
+
+#define TAG_BUNDLE_ENTRIES 'EdnB'
+#define TAG_BUNDLE_PATH 'PdnB'
+#define TAG_BUNDLE_FILE 'FdnB'
+
+#define IS_PATH_SEPARATOR(c) ((c) == '\\' || (c) == '/')
+
+typedef struct _BUNDLE_FILE
+{
+    PUCHAR Data;
+    ULONG Size;
+    ULONG Position;
+} BUNDLE_FILE, *PBUNDLE_FILE;
+
+static PUCHAR BundleData;                  // The uncompressed files
+static PBOOT_BUNDLE_ENTRY BundleEntries;   // Their names, offsets into BundleData and sizes
+static ULONG BundleEntryCount;
+static PSTR BundleBasePath;                // Path the file names are relative to
+
+/* FUNCTIONS ******************************************************************/
+
+/*
+ * Compares Path with Prefix, ignoring the case and repeated path separators.
+ * Returns where Path continues after the prefix, or NULL if it doesn't match.
+ */
+static PCSTR
+BundleMatchPath(
+    _In_ PCSTR Path,
+    _In_ PCSTR Prefix)
+{
+    while (*Prefix)
+    {
+        if (IS_PATH_SEPARATOR(*Prefix))
+        {
+            if (!IS_PATH_SEPARATOR(*Path))
+                return NULL;
+            while (IS_PATH_SEPARATOR(*Prefix))
+                ++Prefix;
+            while (IS_PATH_SEPARATOR(*Path))
+                ++Path;
+            continue;
+        }
+
+        if (toupper(*Path) != toupper(*Prefix))
+            return NULL;
+        ++Path;
+        ++Prefix;
+    }
+
+    return Path;
+}
+
+static PBOOT_BUNDLE_ENTRY
+BundleFindEntry(
+    _In_ PCSTR Path)
+{
+    PCSTR Name, End;
+    ULONG i;
+
+    if (!BundleBasePath)
+        return NULL;
+
+    Name = BundleMatchPath(Path, BundleBasePath);
+    if (!Name || !*Name)
+        return NULL;
+
+    for (i = 0; i < BundleEntryCount; ++i)
+    {
+        End = BundleMatchPath(Name, BundleEntries[i].Name);
+        if (End && !*End)
+            return &BundleEntries[i];
+    }
+
+    return NULL;
+}
+
+static ARC_STATUS BundleClose(ULONG FileId)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+
+    FrLdrTempFree(FileHandle, TAG_BUNDLE_FILE);
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleGetFileInformation(ULONG FileId, FILEINFORMATION* Information)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+
+    RtlZeroMemory(Information, sizeof(*Information));
+    Information->EndingAddress.LowPart = FileHandle->Size;
+    Information->CurrentAddress.LowPart = FileHandle->Position;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
+{
+    PBOOT_BUNDLE_ENTRY Entry;
+    PBUNDLE_FILE FileHandle;
+
+    if (OpenMode != OpenReadOnly)
+        return EACCES;
+
+    Entry = BundleFindEntry(Path);
+    if (!Entry)
+        return ENOENT;
+
+    FileHandle = FrLdrTempAlloc(sizeof(BUNDLE_FILE), TAG_BUNDLE_FILE);
+    if (!FileHandle)
+        return ENOMEM;
+
+    FileHandle->Data = BundleData + Entry->Offset;
+    FileHandle->Size = Entry->Size;
+    FileHandle->Position = 0;
+    FsSetDeviceSpecific(*FileId, FileHandle);
+
+    TRACE("Opened '%s' from the boot bundle\n", Path);
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleRead(ULONG FileId, VOID* Buffer, ULONG N, ULONG* Count)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+
+    /* Like the file systems, return what is left if reading past the end */
+    N = min(N, FileHandle->Size - FileHandle->Position);
+
+    RtlCopyMemory(Buffer, FileHandle->Data + FileHandle->Position, N);
+    FileHandle->Position += N;
+    *Count = N;
+
+    return ESUCCESS;
+}
+
+static ARC_STATUS BundleSeek(ULONG FileId, LARGE_INTEGER* Position, SEEKMODE SeekMode)
+{
+    PBUNDLE_FILE FileHandle = FsGetDeviceSpecific(FileId);
+    LARGE_INTEGER NewPosition = *Position;
+
+    switch (SeekMode)
+    {
+        case SeekAbsolute:
+            break;
+        case SeekRelative:
+            NewPosition.QuadPart += FileHandle->Position;
+            break;
+        default:
+            ASSERT(FALSE);
+            return EINVAL;
+    }
+
+    if (NewPosition.HighPart != 0 || NewPosition.LowPart > FileHandle->Size)
+        return EINVAL;
+
+    FileHandle->Position = NewPosition.LowPart;
+    return ESUCCESS;
+}
+
+/* The service name is the one of the file system the bundle was read from,
+ * as the boot file system driver gets picked from the SYSTEM hive file */
+static DEVVTBL BundleFuncTable =
+{
+    BundleClose,
+    BundleGetFileInformation,
+    BundleOpen,
+    BundleRead,
+    BundleSeek,
+    NULL,
+};
+
+const DEVVTBL*
+BundleLookupFile(
+    _In_ PCSTR Path)
+{
+    return (BundleFindEntry(Path) ? &BundleFuncTable : NULL);
+}
+
+static VOID
+BundleRelease(VOID)
+{
+    if (BundleData)
+        MmFreeMemory(BundleData);
+    if (BundleEntries)
+        FrLdrTempFree(BundleEntries, TAG_BUNDLE_ENTRIES);
+    if (BundleBasePath)
+        FrLdrTempFree(BundleBasePath, TAG_BUNDLE_PATH);
+
+    BundleData = NULL;
+    BundleEntries = NULL;
+    BundleEntryCount = 0;
+    BundleBasePath = NULL;
+}
+
+/*
+ * Checks the entries and unpacks the files into BundleData,
+ * each at the next BOOT_BUNDLE_ALIGNMENT boundary.
+ */
+static ARC_STATUS
+BundleUnpack(
+    _In_ PUCHAR Stored,
+    _In_ PBOOT_BUNDLE_HEADER Header)
+{
+    PBOOT_BUNDLE_ENTRY Entry;
+    NTSTATUS Status;
+    ULONG i, Offset, Size;
+
+    Offset = 0;
+    for (i = 0; i < Header->EntryCount; ++i)
+    {
+        Entry = &BundleEntries[i];
+        Size = ALIGN_UP_BY(Entry->Size, BOOT_BUNDLE_ALIGNMENT);
+
+        if (Entry->Name[BOOT_BUNDLE_MAX_NAME - 1] != ANSI_NULL ||
+            Entry->Offset < Header->HeaderSize ||
+            Entry->Offset > Header->StoredSize ||
+            Entry->StoredSize > Header->StoredSize - Entry->Offset ||
+            Size < Entry->Size ||
+            Size > Header->TotalSize - Offset)
+        {
+            ERR("Boot bundle entry %lu is corrupted\n", i);
+            return EINVAL;
+        }
+
+        switch (Entry->Compression)
+        {
+            case BOOT_BUNDLE_COMPRESSION_NONE:
+                if (Entry->StoredSize != Entry->Size)
+                    return EINVAL;
+                RtlCopyMemory(BundleData + Offset, Stored + Entry->Offset, Entry->Size);
+                break;
+
+            case BOOT_BUNDLE_COMPRESSION_LZNT1:
+                Status = RtlDecompressBuffer(COMPRESSION_FORMAT_LZNT1,
+                                             BundleData + Offset,
+                                             Entry->Size,
+                                             Stored + Entry->Offset,
+                                             Entry->StoredSize,
+                                             &Size);
+                if (!NT_SUCCESS(Status) || Size != Entry->Size)
+                {
+                    ERR("Failed to decompress '%s' from the boot bundle\n", Entry->Name);
+                    return EIO;
+                }
+                break;
+
+            default:
+                ERR("Unknown compression %lu for '%s'\n", Entry->Compression, Entry->Name);
+                return EINVAL;
+        }
+
+        /* From now on the entry describes the unpacked file */
+        Entry->Offset = Offset;
+        Entry->StoredSize = Entry->Size;
+        Entry->Compression = BOOT_BUNDLE_COMPRESSION_NONE;
+        Offset += ALIGN_UP_BY(Entry->Size, BOOT_BUNDLE_ALIGNMENT);
+    }
+
+    return ESUCCESS;
+}
+
+ARC_STATUS
+BundleInitialize(
+    _In_opt_ PCSTR FileName,
+    _In_ PCSTR DefaultPath)
+{
+    ARC_STATUS Status;
+    BOOT_BUNDLE_HEADER Header;
+    LARGE_INTEGER Position;
+    PUCHAR Stored = NULL;
+    SIZE_T Length;
+    ULONG FileId, Count;
+
+    /* Drop the bundle of a previous boot attempt */
+    BundleRelease();
+
+    if (!FileName || !*FileName)
+        return ESUCCESS;
+
+    Status = FsOpenFile(FileName, DefaultPath, OpenReadOnly, &FileId);
+    if (Status != ESUCCESS)
+        return Status;
+
+    Status = ArcRead(FileId, &Header, sizeof(Header), &Count);
+    if (Status != ESUCCESS || Count != sizeof(Header))
+    {
+        Status = EIO;
+        goto Quit;
+    }
+
+    if (Header.Signature != BOOT_BUNDLE_SIGNATURE ||
+        Header.Version != BOOT_BUNDLE_VERSION ||
+        Header.EntryCount > (MAXULONG - sizeof(Header)) / sizeof(BOOT_BUNDLE_ENTRY) ||
+        Header.HeaderSize != sizeof(Header) + Header.EntryCount * sizeof(BOOT_BUNDLE_ENTRY) ||
+        Header.StoredSize < Header.HeaderSize)
+    {
+        ERR("'%s' is not a valid boot bundle\n", FileName);
+        Status = EINVAL;
+        goto Quit;
+    }
+
+    /* Read the whole bundle in one go */
+    Stored = MmAllocateMemoryWithType(Header.StoredSize, LoaderFirmwareTemporary);
+    BundleEntries = FrLdrTempAlloc(Header.HeaderSize - sizeof(Header), TAG_BUNDLE_ENTRIES);
+    BundleData = MmAllocateMemoryWithType(max(Header.TotalSize, 1), LoaderFirmwareTemporary);
+    if (!Stored || !BundleEntries || !BundleData)
+    {
+        Status = ENOMEM;
+        goto Quit;
+    }
+
+    Position.QuadPart = 0;
+    Status = ArcSeek(FileId, &Position, SeekAbsolute);
+    if (Status == ESUCCESS)
+        Status = ArcRead(FileId, Stored, Header.StoredSize, &Count);
+    if (Status != ESUCCESS || Count != Header.StoredSize)
+    {
+        Status = EIO;
+        goto Quit;
+    }
+
+    RtlCopyMemory(BundleEntries, Stored + sizeof(Header), Header.HeaderSize - sizeof(Header));
+    Status = BundleUnpack(Stored, &Header);
+    if (Status != ESUCCESS)
+        goto Quit;
+
+    /* The file names are relative to the directory the bundle was given for */
+    Length = strlen(DefaultPath) + 1;
+    BundleBasePath = FrLdrTempAlloc(Length, TAG_BUNDLE_PATH);
+    if (!BundleBasePath)
+    {
+        Status = ENOMEM;
+        goto Quit;
+    }
+    RtlCopyMemory(BundleBasePath, DefaultPath, Length);
+    BundleEntryCount = Header.EntryCount;
+    BundleFuncTable.ServiceName = FsGetServiceName(FileId);
+
+    TRACE("Boot bundle '%s': %lu files, %lu bytes read, %lu bytes unpacked\n",
+          FileName, Header.EntryCount, Header.StoredSize, Header.TotalSize);
+
+Quit:
+    if (Stored)
+        MmFreeMemory(Stored);
+    if (Status != ESUCCESS)
+        BundleRelease();
+    ArcClose(FileId);
+    return Status;
+}
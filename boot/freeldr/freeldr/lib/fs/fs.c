@@ -227,12 +227,45 @@ ARC_STATUS ArcOpen(CHAR* Path, OPENMODE OpenMode, ULONG* FileId)
     SIZE_T Length;
     OPENMODE DeviceOpenMode;
     ULONG DeviceId;
+    const DEVVTBL* FuncTable;
 
     /* Print status message */
     TRACE("Opening file '%s'...\n", Path);
 
     *FileId = INVALID_FILE_ID;
 
+    /* Files preloaded with the boot bundle are served from memory */
+    FuncTable = (OpenMode == OpenReadOnly) ? BundleLookupFile(Path) : NULL;
+    if (FuncTable)
+    {
+        /* Find some room for the file */
+        for (i = 0; ; ++i)
+        {
+            if (i >= _countof(FileData))
+                return EMFILE;
+            if (!FileData[i].FuncTable)
+                break;
+        }
+
+        /* It doesn't reference any device */
+        FileData[i].DeviceId = INVALID_FILE_ID;
+        FileData[i].ReferenceCount = 0;
+        FileData[i].FuncTable = FuncTable;
+        *FileId = i;
+        Status = FuncTable->Open(Path, OpenMode, FileId);
+        if (Status != ESUCCESS)
+        {
+            FileData[i].FuncTable = NULL;
+            FileData[i].Specific = NULL;
+            *FileId = INVALID_FILE_ID;
+        }
+        else
+        {
+            FileData[i].ReferenceCount++;
+        }
+        return Status;
+    }
+
     /* Search last ')', which delimits device and path */
     FileName = strrchr(Path, ')');
     if (!FileName)
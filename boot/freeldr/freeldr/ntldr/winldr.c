@@ -1124,6 +1124,20 @@ LoadAndBootWindows(
         }
     }
 
+    /*
+     * Load the boot bundle if one was given. The kernel, HAL, hives and boot
+     * drivers it holds are then read from memory rather than from the media.
+     */
+    ArgValue = GetArgumentValue(Argc, Argv, "BootBundle");
+    if (ArgValue && *ArgValue)
+        UiUpdateProgressBar(5, "Loading boot bundle...");
+    Status = BundleInitialize(ArgValue, BootPath);
+    if (Status != ESUCCESS)
+    {
+        /* Not fatal, the files are still read one by one */
+        WARN("Failed to load boot bundle '%s', Status: %u\n", ArgValue, Status);
+    }
+
     /* Handle the SOS option */
     SosEnabled = !!NtLdrGetOption(BootOptions, "SOS");
     if (SosEnabled)
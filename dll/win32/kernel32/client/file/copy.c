@@ -22,6 +22,165 @@ DEBUG_CHANNEL(kernel32file);
 /* FUNCTIONS ****************************************************************/
 
 
+/* Copies are pipelined through a few buffers, so that the next chunks are
+   read while the current one is being written. Chunks are multiples of
+   64 KB, which keeps them aligned for unbuffered I/O on any volume */
+#define COPY_BUFFER_COUNT   3
+#define COPY_MIN_CHUNK_SIZE 0x10000
+#define COPY_MAX_CHUNK_SIZE 0x100000
+
+#ifndef FSCTL_DUPLICATE_EXTENTS_TO_FILE
+#define FSCTL_DUPLICATE_EXTENTS_TO_FILE CTL_CODE(FILE_DEVICE_FILE_SYSTEM, 209, METHOD_BUFFERED, FILE_WRITE_ACCESS)
+
+typedef struct _DUPLICATE_EXTENTS_DATA
+{
+    HANDLE FileHandle;
+    LARGE_INTEGER SourceFileOffset;
+    LARGE_INTEGER TargetFileOffset;
+    LARGE_INTEGER ByteCount;
+} DUPLICATE_EXTENTS_DATA, *PDUPLICATE_EXTENTS_DATA;
+#endif
+
+typedef struct _COPY_BUFFER
+{
+    PUCHAR Buffer;
+    HANDLE Event;
+    IO_STATUS_BLOCK IoStatusBlock;
+    LARGE_INTEGER Offset;
+    NTSTATUS ReadStatus;
+    BOOL ReadPending;
+} COPY_BUFFER, *PCOPY_BUFFER;
+
+static NTSTATUS
+CopyWaitForIo(
+    NTSTATUS Status,
+    PCOPY_BUFFER CopyBuffer
+)
+{
+    /* The handles are asynchronous, wait for the I/O if it is still going */
+    if (Status == STATUS_PENDING)
+    {
+        NtWaitForSingleObject(CopyBuffer->Event, FALSE, NULL);
+        Status = CopyBuffer->IoStatusBlock.Status;
+    }
+
+    return Status;
+}
+
+static VOID
+CopyStartRead(
+    HANDLE FileHandleSource,
+    PCOPY_BUFFER CopyBuffer,
+    ULONG ChunkSize,
+    LARGE_INTEGER *ReadOffset
+)
+{
+    NTSTATUS errCode;
+
+    CopyBuffer->Offset.QuadPart = ReadOffset->QuadPart;
+    errCode = NtReadFile(FileHandleSource,
+                         CopyBuffer->Event,
+                         NULL,
+                         NULL,
+                         &CopyBuffer->IoStatusBlock,
+                         CopyBuffer->Buffer,
+                         ChunkSize,
+                         &CopyBuffer->Offset,
+                         NULL);
+
+    /* Keep the status around for when this buffer's turn comes */
+    CopyBuffer->ReadStatus = errCode;
+    CopyBuffer->ReadPending = TRUE;
+    ReadOffset->QuadPart += ChunkSize;
+}
+
+static NTSTATUS
+CopyFileExtents(
+    HANDLE FileHandleSource,
+    HANDLE FileHandleDest,
+    LARGE_INTEGER SourceFileSize,
+    PCOPY_BUFFER CopyBuffer
+)
+{
+    NTSTATUS errCode;
+    struct
+    {
+        FILE_FS_ATTRIBUTE_INFORMATION AttributeInfo;
+        WCHAR Name[MAX_PATH];
+    } FileFsAttribute;
+    FILE_FS_SIZE_INFORMATION FileFsSize;
+    FILE_END_OF_FILE_INFORMATION EndOfFile;
+    DUPLICATE_EXTENTS_DATA DuplicateExtents;
+    IO_STATUS_BLOCK IoStatusBlock;
+
+    /* Only file systems that can share blocks between files can do this */
+    errCode = NtQueryVolumeInformationFile(FileHandleDest,
+                                           &IoStatusBlock,
+                                           &FileFsAttribute,
+                                           sizeof(FileFsAttribute),
+                                           FileFsAttributeInformation);
+    if (!NT_SUCCESS(errCode) ||
+        !(FileFsAttribute.AttributeInfo.FileSystemAttributes & FILE_SUPPORTS_BLOCK_REFCOUNTING))
+    {
+        return STATUS_NOT_SUPPORTED;
+    }
+
+    errCode = NtQueryVolumeInformationFile(FileHandleDest,
+                                           &IoStatusBlock,
+                                           &FileFsSize,
+                                           sizeof(FileFsSize),
+                                           FileFsSizeInformation);
+    if (!NT_SUCCESS(errCode))
+    {
+        return errCode;
+    }
+
+    /* The target has to be large enough to take the extents */
+    EndOfFile.EndOfFile.QuadPart = SourceFileSize.QuadPart;
+    errCode = NtSetInformationFile(FileHandleDest,
+                                   &IoStatusBlock,
+                                   &EndOfFile,
+                                   sizeof(EndOfFile),
+                                   FileEndOfFileInformation);
+    if (!NT_SUCCESS(errCode))
+    {
+        return errCode;
+    }
+
+    /* Extents are shared in whole sectors, the file size trims the last one.
+       This fails if the files are on different volumes */
+    DuplicateExtents.FileHandle = FileHandleSource;
+    DuplicateExtents.SourceFileOffset.QuadPart = 0;
+    DuplicateExtents.TargetFileOffset.QuadPart = 0;
+    DuplicateExtents.ByteCount.QuadPart = (SourceFileSize.QuadPart + FileFsSize.BytesPerSector - 1) &
+                                          ~((LONGLONG)FileFsSize.BytesPerSector - 1);
+    errCode = NtFsControlFile(FileHandleDest,
+                              CopyBuffer->Event,
+                              NULL,
+                              NULL,
+                              &CopyBuffer->IoStatusBlock,
+                              FSCTL_DUPLICATE_EXTENTS_TO_FILE,
+                              &DuplicateExtents,
+                              sizeof(DuplicateExtents),
+                              NULL,
+                              0);
+    errCode = CopyWaitForIo(errCode, CopyBuffer);
+    if (!NT_SUCCESS(errCode))
+    {
+        TRACE("Error 0x%08x duplicating extents, copying the data instead\n", errCode);
+
+        /* Leave the target as we found it */
+        EndOfFile.EndOfFile.QuadPart = 0;
+        NtSetInformationFile(FileHandleDest,
+                             &IoStatusBlock,
+                             &EndOfFile,
+                             sizeof(EndOfFile),
+                             FileEndOfFileInformation);
+    }
+
+    return errCode;
+}
+
 static NTSTATUS
 CopyLoop (
     HANDLE			FileHandleSource,
@@ -30,134 +189,274 @@ CopyLoop (
     LPPROGRESS_ROUTINE	lpProgressRoutine,
     LPVOID			lpData,
     BOOL			*pbCancel,
-    BOOL                 *KeepDest
+    BOOL                 *KeepDest,
+    BOOL                 NoBuffering
 )
 {
     NTSTATUS errCode;
     IO_STATUS_BLOCK IoStatusBlock;
+    COPY_BUFFER CopyBuffers[COPY_BUFFER_COUNT];
+    PCOPY_BUFFER CopyBuffer;
     UCHAR *lpBuffer = NULL;
-    SIZE_T RegionSize = 0x10000;
-    LARGE_INTEGER BytesCopied;
+    SIZE_T RegionSize;
+    ULONG ChunkSize, BufferCount, Index, Length, WriteLength, SectorSize = 1;
+    LARGE_INTEGER BytesCopied, ReadOffset;
+    FILE_ALLOCATION_INFORMATION FileAllocation;
+    FILE_END_OF_FILE_INFORMATION EndOfFile;
+    FILE_FS_SIZE_INFORMATION FileFsSize;
     DWORD CallbackReason;
     DWORD ProgressResult;
-    BOOL EndOfFileFound;
+    BOOL EndOfFileFound, Offloaded = FALSE;
 
     *KeepDest = FALSE;
+
+    /* Use bigger chunks for bigger files, and a single buffer for files
+       that fit in one chunk */
+    if (SourceFileSize.QuadPart >= (LONGLONG)COPY_MAX_CHUNK_SIZE * COPY_BUFFER_COUNT)
+    {
+        ChunkSize = COPY_MAX_CHUNK_SIZE;
+    }
+    else
+    {
+        ChunkSize = (ULONG)(SourceFileSize.QuadPart / COPY_BUFFER_COUNT);
+        ChunkSize = (ChunkSize + COPY_MIN_CHUNK_SIZE - 1) & ~(COPY_MIN_CHUNK_SIZE - 1);
+        ChunkSize = max(ChunkSize, COPY_MIN_CHUNK_SIZE);
+    }
+    BufferCount = (SourceFileSize.QuadPart > ChunkSize) ? COPY_BUFFER_COUNT : 1;
+
+    RtlZeroMemory(CopyBuffers, sizeof(CopyBuffers));
+    for (Index = 0; Index < BufferCount; Index++)
+    {
+        errCode = NtCreateEvent(&CopyBuffers[Index].Event,
+                                EVENT_ALL_ACCESS,
+                                NULL,
+                                NotificationEvent,
+                                FALSE);
+        if (!NT_SUCCESS(errCode))
+        {
+            TRACE("Error 0x%08x creating an event\n", errCode);
+            goto Cleanup;
+        }
+    }
+
+    RegionSize = (SIZE_T)ChunkSize * BufferCount;
     errCode = NtAllocateVirtualMemory(NtCurrentProcess(),
                                       (PVOID *)&lpBuffer,
                                       0,
                                       &RegionSize,
                                       MEM_RESERVE | MEM_COMMIT,
                                       PAGE_READWRITE);
+    if (!NT_SUCCESS(errCode))
+    {
+        TRACE("Error 0x%08x allocating buffer of %lu bytes\n", errCode, RegionSize);
+        goto Cleanup;
+    }
+
+    for (Index = 0; Index < BufferCount; Index++)
+    {
+        CopyBuffers[Index].Buffer = lpBuffer + Index * ChunkSize;
+    }
 
-    if (NT_SUCCESS(errCode))
+    /* Unbuffered writes have to be whole sectors, the end of file is set
+       once everything is written */
+    if (NoBuffering)
     {
-        BytesCopied.QuadPart = 0;
-        EndOfFileFound = FALSE;
-        CallbackReason = CALLBACK_STREAM_SWITCH;
-        while (! EndOfFileFound &&
-                NT_SUCCESS(errCode) &&
-                (NULL == pbCancel || ! *pbCancel))
+        errCode = NtQueryVolumeInformationFile(FileHandleDest,
+                                               &IoStatusBlock,
+                                               &FileFsSize,
+                                               sizeof(FileFsSize),
+                                               FileFsSizeInformation);
+        if (!NT_SUCCESS(errCode))
         {
-            if (NULL != lpProgressRoutine)
-            {
-                ProgressResult = (*lpProgressRoutine)(SourceFileSize,
-                                                      BytesCopied,
-                                                      SourceFileSize,
-                                                      BytesCopied,
-                                                      0,
-                                                      CallbackReason,
-                                                      FileHandleSource,
-                                                      FileHandleDest,
-                                                      lpData);
-                switch (ProgressResult)
-                {
-                case PROGRESS_CANCEL:
-                    TRACE("Progress callback requested cancel\n");
-                    errCode = STATUS_REQUEST_ABORTED;
-                    break;
-                case PROGRESS_STOP:
-                    TRACE("Progress callback requested stop\n");
-                    errCode = STATUS_REQUEST_ABORTED;
-                    *KeepDest = TRUE;
-                    break;
-                case PROGRESS_QUIET:
-                    lpProgressRoutine = NULL;
-                    break;
-                case PROGRESS_CONTINUE:
-                default:
-                    break;
-                }
-                CallbackReason = CALLBACK_CHUNK_FINISHED;
-            }
-            if (NT_SUCCESS(errCode))
+            WARN("Error 0x%08x obtaining FileFsSizeInformation for dest\n", errCode);
+            goto Cleanup;
+        }
+        SectorSize = FileFsSize.BytesPerSector;
+    }
+
+    BytesCopied.QuadPart = 0;
+    ReadOffset.QuadPart = 0;
+    EndOfFileFound = FALSE;
+    CallbackReason = CALLBACK_STREAM_SWITCH;
+
+    /* Let the file system share the data if it can, otherwise reserve the
+       space for the copy up front so that it is not grown chunk by chunk */
+    if (SourceFileSize.QuadPart &&
+        NT_SUCCESS(CopyFileExtents(FileHandleSource, FileHandleDest, SourceFileSize, &CopyBuffers[0])))
+    {
+        Offloaded = TRUE;
+    }
+    else if (SourceFileSize.QuadPart)
+    {
+        FileAllocation.AllocationSize.QuadPart = SourceFileSize.QuadPart;
+        NtSetInformationFile(FileHandleDest,
+                             &IoStatusBlock,
+                             &FileAllocation,
+                             sizeof(FileAllocation),
+                             FileAllocationInformation);
+
+        for (Index = 0; Index < BufferCount; Index++)
+        {
+            CopyStartRead(FileHandleSource, &CopyBuffers[Index], ChunkSize, &ReadOffset);
+        }
+    }
+
+    errCode = STATUS_SUCCESS;
+    Index = 0;
+    for (;;)
+    {
+        if (NULL != lpProgressRoutine)
+        {
+            ProgressResult = (*lpProgressRoutine)(SourceFileSize,
+                                                  BytesCopied,
+                                                  SourceFileSize,
+                                                  BytesCopied,
+                                                  0,
+                                                  CallbackReason,
+                                                  FileHandleSource,
+                                                  FileHandleDest,
+                                                  lpData);
+            switch (ProgressResult)
             {
-                errCode = NtReadFile(FileHandleSource,
-                                     NULL,
-                                     NULL,
-                                     NULL,
-                                     (PIO_STATUS_BLOCK)&IoStatusBlock,
-                                     lpBuffer,
-                                     RegionSize,
-                                     NULL,
-                                     NULL);
-                /* With sync read, 0 length + status success mean EOF:
-                 * https://msdn.microsoft.com/en-us/library/windows/desktop/aa365467(v=vs.85).aspx
-                 */
-                if (NT_SUCCESS(errCode) && IoStatusBlock.Information == 0)
-                {
-                    errCode = STATUS_END_OF_FILE;
-                }
-                if (NT_SUCCESS(errCode) && (NULL == pbCancel || ! *pbCancel))
-                {
-                    errCode = NtWriteFile(FileHandleDest,
-                                          NULL,
-                                          NULL,
-                                          NULL,
-                                          (PIO_STATUS_BLOCK)&IoStatusBlock,
-                                          lpBuffer,
-                                          IoStatusBlock.Information,
-                                          NULL,
-                                          NULL);
-                    if (NT_SUCCESS(errCode))
-                    {
-                        BytesCopied.QuadPart += IoStatusBlock.Information;
-                    }
-                    else
-                    {
-                        WARN("Error 0x%08x reading writing to dest\n", errCode);
-                    }
-                }
-                else if (!NT_SUCCESS(errCode))
-                {
-                    if (STATUS_END_OF_FILE == errCode)
-                    {
-                        EndOfFileFound = TRUE;
-                        errCode = STATUS_SUCCESS;
-                    }
-                    else
-                    {
-                        WARN("Error 0x%08x reading from source\n", errCode);
-                    }
-                }
+            case PROGRESS_CANCEL:
+                TRACE("Progress callback requested cancel\n");
+                errCode = STATUS_REQUEST_ABORTED;
+                break;
+            case PROGRESS_STOP:
+                TRACE("Progress callback requested stop\n");
+                errCode = STATUS_REQUEST_ABORTED;
+                *KeepDest = TRUE;
+                break;
+            case PROGRESS_QUIET:
+                lpProgressRoutine = NULL;
+                break;
+            case PROGRESS_CONTINUE:
+            default:
+                break;
             }
+            CallbackReason = CALLBACK_CHUNK_FINISHED;
+        }
+
+        if (!NT_SUCCESS(errCode) || EndOfFileFound)
+        {
+            break;
         }
 
-        if (! EndOfFileFound && (NULL != pbCancel && *pbCancel))
+        if (NULL != pbCancel && *pbCancel)
         {
             TRACE("User requested cancel\n");
             errCode = STATUS_REQUEST_ABORTED;
+            break;
+        }
+
+        if (Offloaded)
+        {
+            /* The file system did the copy */
+            BytesCopied.QuadPart = SourceFileSize.QuadPart;
+            EndOfFileFound = TRUE;
+            continue;
+        }
+
+        /* Get the next chunk in file order, there is none for empty files */
+        CopyBuffer = &CopyBuffers[Index];
+        if (!CopyBuffer->ReadPending)
+        {
+            EndOfFileFound = TRUE;
+            break;
+        }
+        errCode = CopyWaitForIo(CopyBuffer->ReadStatus, CopyBuffer);
+        CopyBuffer->ReadPending = FALSE;
+        if (!NT_SUCCESS(errCode))
+        {
+            if (STATUS_END_OF_FILE == errCode)
+            {
+                EndOfFileFound = TRUE;
+                errCode = STATUS_SUCCESS;
+            }
+            else
+            {
+                WARN("Error 0x%08x reading from source\n", errCode);
+            }
+            break;
         }
 
+        /* A short read is the end of the file, don't bother with the chunks
+           that were read ahead */
+        Length = (ULONG)CopyBuffer->IoStatusBlock.Information;
+        if (Length < ChunkSize)
+        {
+            EndOfFileFound = TRUE;
+        }
+        if (Length == 0)
+        {
+            break;
+        }
+
+        WriteLength = Length;
+        if (WriteLength % SectorSize)
+        {
+            WriteLength += SectorSize - WriteLength % SectorSize;
+            RtlZeroMemory(CopyBuffer->Buffer + Length, WriteLength - Length);
+        }
+
+        errCode = NtWriteFile(FileHandleDest,
+                              CopyBuffer->Event,
+                              NULL,
+                              NULL,
+                              &CopyBuffer->IoStatusBlock,
+                              CopyBuffer->Buffer,
+                              WriteLength,
+                              &CopyBuffer->Offset,
+                              NULL);
+        errCode = CopyWaitForIo(errCode, CopyBuffer);
+        if (!NT_SUCCESS(errCode))
+        {
+            WARN("Error 0x%08x reading writing to dest\n", errCode);
+            break;
+        }
+        BytesCopied.QuadPart += Length;
+
+        /* The buffer is free again, read ahead into it */
+        if (!EndOfFileFound)
+        {
+            CopyStartRead(FileHandleSource, CopyBuffer, ChunkSize, &ReadOffset);
+        }
+        Index = (Index + 1) % BufferCount;
+    }
+
+    /* Trim the padding of the last unbuffered write */
+    if (NT_SUCCESS(errCode) && (BytesCopied.QuadPart % SectorSize))
+    {
+        EndOfFile.EndOfFile.QuadPart = BytesCopied.QuadPart;
+        errCode = NtSetInformationFile(FileHandleDest,
+                                       &IoStatusBlock,
+                                       &EndOfFile,
+                                       sizeof(EndOfFile),
+                                       FileEndOfFileInformation);
+    }
+
+Cleanup:
+    /* Don't free buffers that are still being read into */
+    for (Index = 0; Index < BufferCount; Index++)
+    {
+        if (CopyBuffers[Index].ReadPending)
+        {
+            CopyWaitForIo(CopyBuffers[Index].ReadStatus, &CopyBuffers[Index]);
+        }
+        if (CopyBuffers[Index].Event)
+        {
+            NtClose(CopyBuffers[Index].Event);
+        }
+    }
+
+    if (lpBuffer)
+    {
+        RegionSize = 0;
         NtFreeVirtualMemory(NtCurrentProcess(),
                             (PVOID *)&lpBuffer,
                             &RegionSize,
                             MEM_RELEASE);
     }
-    else
-    {
-        TRACE("Error 0x%08x allocating buffer of %lu bytes\n", errCode, RegionSize);
-    }
 
     return errCode;
 }
@@ -223,7 +522,8 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
                                    FILE_SHARE_READ | FILE_SHARE_WRITE,
                                    NULL,
                                    OPEN_EXISTING,
-                                   FILE_ATTRIBUTE_NORMAL|FILE_FLAG_NO_BUFFERING,
+                                   FILE_ATTRIBUTE_NORMAL|FILE_FLAG_NO_BUFFERING|
+                                   FILE_FLAG_SEQUENTIAL_SCAN|FILE_FLAG_OVERLAPPED,
                                    NULL);
     if (INVALID_HANDLE_VALUE != FileHandleSource)
     {
@@ -254,8 +554,9 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
                                              GENERIC_WRITE,
                                              FILE_SHARE_WRITE,
                                              NULL,
-                                             dwCopyFlags ? CREATE_NEW : CREATE_ALWAYS,
-                                             FileBasic.FileAttributes,
+                                             (dwCopyFlags & COPY_FILE_FAIL_IF_EXISTS) ? CREATE_NEW : CREATE_ALWAYS,
+                                             FileBasic.FileAttributes|FILE_FLAG_OVERLAPPED|
+                                             ((dwCopyFlags & COPY_FILE_NO_BUFFERING) ? FILE_FLAG_NO_BUFFERING : 0),
                                              NULL);
                 if (INVALID_HANDLE_VALUE != FileHandleDest)
                 {
@@ -265,7 +566,8 @@ BasepCopyFileExW(IN LPCWSTR lpExistingFileName,
                                        lpProgressRoutine,
                                        lpData,
                                        pbCancel,
-                                       &KeepDestOnError);
+                                       &KeepDestOnError,
+                                       (dwCopyFlags & COPY_FILE_NO_BUFFERING) != 0);
                     if (!NT_SUCCESS(errCode))
                     {
                         BaseSetLastNTError(errCode);
@@ -21,6 +21,7 @@ DEBUG_CHANNEL(kernel32file);
 /* TYPES **********************************************************************/
 
 #define FIND_DATA_SIZE      0x4000
+#define FIND_DATA_MAX_SIZE  0x40000
 #define FIND_DEVICE_HANDLE  ((HANDLE)0x1)
 
 typedef enum _FIND_DATA_TYPE
@@ -83,7 +84,15 @@ typedef struct _FIND_FILE_DATA
      */
     DIR_INFORMATION NextDirInfo;
 
-    BYTE Buffer[FIND_DATA_SIZE];
+    /*
+     * The buffer is allocated by the first FindNextFile call. It starts at
+     * FIND_DATA_SIZE bytes, or FIND_DATA_MAX_SIZE for FIND_FIRST_EX_LARGE_FETCH,
+     * and doubles each time the file system fills most of it, up to
+     * FIND_DATA_MAX_SIZE, so that large directories need fewer calls.
+     */
+    ULONG BufferSize;
+    ULONG BufferUsed;
+    PBYTE Buffer;
 } FIND_FILE_DATA, *PFIND_FILE_DATA;
 
 typedef struct _FIND_STREAM_DATA
@@ -411,11 +420,35 @@ FindNextFileW(IN HANDLE hFindFile,
         {
             if (FindFileData->NextDirInfo.DirInfo == NULL)
             {
+                /* Get a bigger buffer if the last query filled most of it */
+                if (FindFileData->Buffer == NULL ||
+                    (FindFileData->BufferUsed > FindFileData->BufferSize / 2 &&
+                     FindFileData->BufferSize < FIND_DATA_MAX_SIZE))
+                {
+                    ULONG NewSize = (FindFileData->Buffer == NULL
+                                        ? FindFileData->BufferSize
+                                        : FindFileData->BufferSize * 2);
+                    PBYTE NewBuffer = RtlAllocateHeap(RtlGetProcessHeap(), 0, NewSize);
+
+                    if (NewBuffer != NULL)
+                    {
+                        if (FindFileData->Buffer != NULL)
+                            RtlFreeHeap(RtlGetProcessHeap(), 0, FindFileData->Buffer);
+                        FindFileData->Buffer = NewBuffer;
+                        FindFileData->BufferSize = NewSize;
+                    }
+                    else if (FindFileData->Buffer == NULL)
+                    {
+                        Status = STATUS_NO_MEMORY;
+                        break;
+                    }
+                }
+
                 Status = NtQueryDirectoryFile(FindFileData->Handle,
                                               NULL, NULL, NULL,
                                               &IoStatusBlock,
-                                              &FindFileData->Buffer,
-                                              sizeof(FindFileData->Buffer),
+                                              FindFileData->Buffer,
+                                              FindFileData->BufferSize,
                                               (InfoLevel == FindExInfoStandard
                                                           ? FileBothDirectoryInformation
                                                           : FileFullDirectoryInformation),
@@ -433,14 +466,15 @@ FindNextFileW(IN HANDLE hFindFile,
                     FindFileData->HasMoreData = FALSE;
                 }
 
-                FindFileData->NextDirInfo.DirInfo = &FindFileData->Buffer;
+                FindFileData->BufferUsed = (ULONG)IoStatusBlock.Information;
+                FindFileData->NextDirInfo.DirInfo = FindFileData->Buffer;
             }
 
             DirInfo = FindFileData->NextDirInfo;
 
             if (DirInfo.FullDirInfo->NextEntryOffset != 0)
             {
-                ULONG_PTR BufferEnd = (ULONG_PTR)&FindFileData->Buffer + sizeof(FindFileData->Buffer);
+                ULONG_PTR BufferEnd = (ULONG_PTR)FindFileData->Buffer + FindFileData->BufferSize;
                 PWSTR pFileName;
 
                 NextDirInfo.DirInfo = FindFileData->NextDirInfo.DirInfo =
@@ -523,6 +557,11 @@ FindClose(HANDLE hFindFile)
             {
                 RtlEnterCriticalSection(&FindDataHandle->Lock);
                 NtClose(FindDataHandle->u.FindFileData->Handle);
+                if (FindDataHandle->u.FindFileData->Buffer != NULL)
+                {
+                    RtlFreeHeap(RtlGetProcessHeap(), 0,
+                                FindDataHandle->u.FindFileData->Buffer);
+                }
                 RtlLeaveCriticalSection(&FindDataHandle->Lock);
                 RtlDeleteCriticalSection(&FindDataHandle->Lock);
                 break;
@@ -583,7 +622,7 @@ FindFirstFileExA(IN LPCSTR lpFileName,
 
     if ((fInfoLevelId != FindExInfoStandard && fInfoLevelId != FindExInfoBasic) ||
         fSearchOp == FindExSearchLimitToDevices ||
-        dwAdditionalFlags & ~FIND_FIRST_EX_CASE_SENSITIVE /* only supported flag for now */)
+        dwAdditionalFlags & ~(FIND_FIRST_EX_CASE_SENSITIVE | FIND_FIRST_EX_LARGE_FETCH))
     {
         SetLastError(fSearchOp == FindExSearchLimitToDevices
                                 ? ERROR_NOT_SUPPORTED
@@ -659,7 +698,7 @@ FindFirstFileExW(IN LPCWSTR lpFileName,
 
     if ((fInfoLevelId != FindExInfoStandard && fInfoLevelId != FindExInfoBasic) ||
         fSearchOp == FindExSearchLimitToDevices ||
-        dwAdditionalFlags & ~FIND_FIRST_EX_CASE_SENSITIVE /* only supported flag for now */)
+        dwAdditionalFlags & ~(FIND_FIRST_EX_CASE_SENSITIVE | FIND_FIRST_EX_LARGE_FETCH))
     {
         SetLastError(fSearchOp == FindExSearchLimitToDevices
                                 ? ERROR_NOT_SUPPORTED
@@ -927,6 +966,9 @@ FindFirstFileExW(IN LPCWSTR lpFileName,
         FindFileData->SearchOp = fSearchOp;
         FindFileData->HasMoreData = FALSE;
         FindFileData->NextDirInfo.DirInfo = NULL;
+        FindFileData->BufferSize = (dwAdditionalFlags & FIND_FIRST_EX_LARGE_FETCH)
+                                       ? FIND_DATA_MAX_SIZE : FIND_DATA_SIZE;
+        FindFileData->Buffer = NULL;
 
         /* The critical section must always be initialized */
         Status = RtlInitializeCriticalSection(&FindDataHandle->Lock);
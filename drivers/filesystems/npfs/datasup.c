@@ -15,6 +15,89 @@
 
 /* FUNCTIONS ******************************************************************/
 
+/* Locks the user buffer of a read or write IRP that has to wait and maps it */
+static
+PVOID
+NpLockIrpBuffer(IN PIRP Irp,
+                IN ULONG Length,
+                IN LOCK_OPERATION Operation)
+{
+    PMDL Mdl;
+    PVOID SystemBuffer;
+
+    if (Irp->MdlAddress || !Irp->UserBuffer) return NULL;
+
+    Mdl = IoAllocateMdl(Irp->UserBuffer, Length, FALSE, FALSE, Irp);
+    if (!Mdl) return NULL;
+
+    _SEH2_TRY
+    {
+        MmProbeAndLockPages(Mdl, Irp->RequestorMode, Operation);
+    }
+    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+    {
+        Irp->MdlAddress = NULL;
+        IoFreeMdl(Mdl);
+        _SEH2_YIELD(return NULL);
+    }
+    _SEH2_END;
+
+    /* Completing the IRP unlocks and frees the MDL */
+    SystemBuffer = MmGetSystemAddressForMdlSafe(Mdl, NormalPagePriority);
+    if (!SystemBuffer)
+    {
+        MmUnlockPages(Mdl);
+        Irp->MdlAddress = NULL;
+        IoFreeMdl(Mdl);
+    }
+
+    return SystemBuffer;
+}
+
+/*
+ * A write whose data is still in its IRP's buffer gets all the quota it needs
+ * and can complete. Copy what the reader has not consumed yet out of it.
+ */
+static
+BOOLEAN
+NpCopyMappedWrite(IN PNP_DATA_QUEUE_ENTRY DataEntry,
+                  IN ULONG Offset)
+{
+    PVOID Buffer;
+
+    ASSERT(DataEntry->DataInIrp);
+    ASSERT(Offset < DataEntry->DataSize);
+
+    Buffer = ExAllocatePoolWithQuotaTag(NonPagedPool | POOL_QUOTA_FAIL_INSTEAD_OF_RAISE,
+                                        DataEntry->DataSize - Offset,
+                                        NPFS_DATA_ENTRY_TAG);
+    if (!Buffer) return FALSE;
+
+    RtlCopyMemory(Buffer,
+                  NpGetDataEntryBuffer(DataEntry, Offset),
+                  DataEntry->DataSize - Offset);
+
+    DataEntry->DataBuffer = Buffer;
+    DataEntry->DataOffset = Offset;
+    DataEntry->DataInIrp = FALSE;
+    return TRUE;
+}
+
+static
+VOID
+NpFreeDataQueueEntry(IN PNP_DATA_QUEUE_ENTRY DataEntry)
+{
+    /* Free the copy NpCopyMappedWrite made, if any */
+    if (DataEntry->DataBuffer &&
+        !DataEntry->DataInIrp &&
+        DataEntry->DataBuffer != DataEntry + 1)
+    {
+        ExFreePool(DataEntry->DataBuffer);
+    }
+
+    ExFreePool(DataEntry);
+}
+
 NTSTATUS
 NTAPI
 NpUninitializeDataQueue(IN PNP_DATA_QUEUE DataQueue)
@@ -80,7 +163,11 @@ NpCompleteStalledWrites(IN PNP_DATA_QUEUE DataQueue,
                 QuotaLeft -= NewQuotaLeft;
                 DataQueueEntry->QuotaInEntry += NewQuotaLeft;
 
+                /* If the rest of a mapped write cannot be copied out, it
+                   simply stays pending until the reader has consumed it */
                 if (DataQueueEntry->QuotaInEntry == DataLeft &&
+                    (!DataQueueEntry->DataInIrp ||
+                     NpCopyMappedWrite(DataQueueEntry, DataQueueEntry->DataSize - DataLeft)) &&
                     IoSetCancelRoutine(Irp, NULL))
                 {
                     DataQueueEntry->Irp = NULL;
@@ -152,7 +239,7 @@ NpRemoveDataQueueEntry(IN PNP_DATA_QUEUE DataQueue,
             Irp = NULL;
         }
 
-        ExFreePool(QueueEntry);
+        NpFreeDataQueueEntry(QueueEntry);
 
         if (Flag)
         {
@@ -281,7 +368,7 @@ NpCancelDataQueueIrp(IN PDEVICE_OBJECT DeviceObject,
         FsRtlExitFileSystem();
     }
 
-    if (DataEntry) ExFreePool(DataEntry);
+    if (DataEntry) NpFreeDataQueueEntry(DataEntry);
 
     NpFreeClientSecurityContext(ClientSecurityContext);
     Irp->IoStatus.Status = STATUS_CANCELLED;
@@ -304,6 +391,7 @@ NpAddDataQueueEntry(IN ULONG NamedPipeEnd,
 {
     NTSTATUS Status;
     PNP_DATA_QUEUE_ENTRY DataEntry;
+    PVOID DataBuffer;
     SIZE_T EntrySize;
     ULONG QuotaInEntry;
     PSECURITY_CLIENT_CONTEXT ClientContext;
@@ -348,23 +436,15 @@ NpAddDataQueueEntry(IN ULONG NamedPipeEnd,
             DataEntry->Irp = Irp;
             DataEntry->DataSize = DataSize;
             DataEntry->ClientSecurityContext = ClientContext;
+            DataEntry->DataBuffer = NULL;
+            DataEntry->DataOffset = 0;
+            DataEntry->DataInIrp = FALSE;
             ASSERT((DataQueue->QueueState == Empty) || (DataQueue->QueueState == Who));
             Status = STATUS_PENDING;
             break;
 
         case Buffered:
 
-            EntrySize = sizeof(*DataEntry);
-            if (Who != ReadEntries)
-            {
-                EntrySize += DataSize;
-                if (EntrySize < DataSize)
-                {
-                    NpFreeClientSecurityContext(ClientContext);
-                    return STATUS_INVALID_PARAMETER;
-                }
-            }
-
             QuotaInEntry = DataSize - ByteOffset;
             if (DataQueue->Quota - DataQueue->QuotaUsed < QuotaInEntry)
             {
@@ -376,6 +456,31 @@ NpAddDataQueueEntry(IN ULONG NamedPipeEnd,
                 HasSpace = FALSE;
             }
 
+            DataBuffer = NULL;
+            if (Irp && Who == ReadEntries && DataSize >= NP_DIRECT_READ_SIZE)
+            {
+                /* Let the writers copy straight into the reader's buffer */
+                DataBuffer = NpLockIrpBuffer(Irp, DataSize, IoWriteAccess);
+            }
+            else if (Irp && Who == WriteEntries && HasSpace &&
+                     DataSize - ByteOffset >= NP_MAPPED_WRITE_SIZE)
+            {
+                /* The write has to wait for the reader anyway, so rather
+                   than copying it, leave the data in the writer's buffer */
+                DataBuffer = NpLockIrpBuffer(Irp, DataSize, IoReadAccess);
+            }
+
+            EntrySize = sizeof(*DataEntry);
+            if (Who != ReadEntries && !DataBuffer)
+            {
+                EntrySize += DataSize;
+                if (EntrySize < DataSize)
+                {
+                    NpFreeClientSecurityContext(ClientContext);
+                    return STATUS_INVALID_PARAMETER;
+                }
+            }
+
             DataEntry = ExAllocatePoolWithQuotaTag(NonPagedPool | POOL_QUOTA_FAIL_INSTEAD_OF_RAISE,
                                                    EntrySize,
                                                    NPFS_DATA_ENTRY_TAG);
@@ -390,6 +495,9 @@ NpAddDataQueueEntry(IN ULONG NamedPipeEnd,
             DataEntry->DataEntryType = Buffered;
             DataEntry->ClientSecurityContext = ClientContext;
             DataEntry->DataSize = DataSize;
+            DataEntry->DataBuffer = DataBuffer;
+            DataEntry->DataOffset = 0;
+            DataEntry->DataInIrp = (DataBuffer != NULL);
 
             if (Who == ReadEntries)
             {
@@ -401,18 +509,24 @@ NpAddDataQueueEntry(IN ULONG NamedPipeEnd,
             }
             else
             {
-                _SEH2_TRY
+                if (!DataEntry->DataInIrp)
                 {
-                    RtlCopyMemory(DataEntry + 1,
-                                  Irp ? Irp->UserBuffer: Buffer,
-                                  DataSize);
-                }
-                _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
-                {
-                    NpFreeClientSecurityContext(ClientContext);
-                    _SEH2_YIELD(return _SEH2_GetExceptionCode());
+                    DataEntry->DataBuffer = DataEntry + 1;
+
+                    _SEH2_TRY
+                    {
+                        RtlCopyMemory(DataEntry + 1,
+                                      Irp ? Irp->UserBuffer: Buffer,
+                                      DataSize);
+                    }
+                    _SEH2_EXCEPT(EXCEPTION_EXECUTE_HANDLER)
+                    {
+                        ExFreePool(DataEntry);
+                        NpFreeClientSecurityContext(ClientContext);
+                        _SEH2_YIELD(return _SEH2_GetExceptionCode());
+                    }
+                    _SEH2_END;
                 }
-                _SEH2_END;
 
                 if (HasSpace && Irp)
                 {
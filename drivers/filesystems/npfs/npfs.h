@@ -153,8 +153,21 @@ typedef struct _NP_DATA_QUEUE_ENTRY
     ULONG QuotaInEntry;
     PSECURITY_CLIENT_CONTEXT ClientSecurityContext;
     ULONG DataSize;
+    PVOID DataBuffer;   /* Buffered entries: system address of the data from DataOffset on */
+    ULONG DataOffset;
+    BOOLEAN DataInIrp;  /* DataBuffer maps the locked buffer of the entry's IRP */
 } NP_DATA_QUEUE_ENTRY, *PNP_DATA_QUEUE_ENTRY;
 
+/*
+ * Reads at least this large lock their buffer when they have to wait, so that
+ * writers copy straight into it. The pages and system PTEs stay in use for as
+ * long as the read waits, so this is kept well above the size of the reads
+ * idle servers leave pending. Writes at least this large that have to wait
+ * for quota keep their data in the writer's locked buffer instead of pool.
+ */
+#define NP_DIRECT_READ_SIZE     (16 * PAGE_SIZE)
+#define NP_MAPPED_WRITE_SIZE    (16 * PAGE_SIZE)
+
 /* A Wait Queue. Only the VCB has one of these. */
 typedef struct _NP_WAIT_QUEUE
 {
@@ -374,6 +387,23 @@ NpCompleteDeferredIrps(IN PLIST_ENTRY DeferredList)
     }
 }
 
+//
+// Returns the data of a data queue entry at the given offset in the message
+//
+FORCEINLINE
+PVOID
+NpGetDataEntryBuffer(IN PNP_DATA_QUEUE_ENTRY DataEntry,
+                     IN ULONG Offset)
+{
+    if (DataEntry->DataEntryType == Unbuffered)
+    {
+        return (PVOID)((ULONG_PTR)DataEntry->Irp->AssociatedIrp.SystemBuffer + Offset);
+    }
+
+    ASSERT(Offset >= DataEntry->DataOffset);
+    return (PVOID)((ULONG_PTR)DataEntry->DataBuffer + Offset - DataEntry->DataOffset);
+}
+
 LONG
 NTAPI
 NpCompareAliasNames(
@@ -33,6 +33,9 @@ typedef struct _ETH_HEADER {
 
 C_ASSERT(sizeof(ETH_HEADER) == 14);
 
+/* PayloadType of IPv4 frames, in network byte order */
+#define ETH_TYPE_IPV4   0x0008
+
 
 typedef enum _E1000_RCVBUF_SIZE
 {
@@ -57,10 +60,15 @@ typedef enum _E1000_RCVBUF_SIZE
 /* 3.2.3 Receive Descriptor Format */
 
 #define E1000_RDESC_STATUS_PIF          (1 << 7)    /* Passed in-exact filter */
+#define E1000_RDESC_STATUS_IPCS         (1 << 6)    /* IP Checksum Calculated on Packet */
+#define E1000_RDESC_STATUS_TCPCS        (1 << 5)    /* TCP/UDP Checksum Calculated on Packet */
 #define E1000_RDESC_STATUS_IXSM         (1 << 2)    /* Ignore Checksum Indication */
 #define E1000_RDESC_STATUS_EOP          (1 << 1)    /* End of Packet */
 #define E1000_RDESC_STATUS_DD           (1 << 0)    /* Descriptor Done */
 
+#define E1000_RDESC_ERROR_IPE           (1 << 6)    /* IP Checksum Error */
+#define E1000_RDESC_ERROR_TCPE          (1 << 5)    /* TCP/UDP Checksum Error */
+
 typedef struct _E1000_RECEIVE_DESCRIPTOR
 {
     UINT64 Address;
@@ -78,6 +86,7 @@ typedef struct _E1000_RECEIVE_DESCRIPTOR
 
 #define E1000_TDESC_CMD_IDE             (1 << 7)    /* Interrupt Delay Enable */
 #define E1000_TDESC_CMD_RS              (1 << 3)    /* Report Status */
+#define E1000_TDESC_CMD_IC              (1 << 2)    /* Insert Checksum */
 #define E1000_TDESC_CMD_IFCS            (1 << 1)    /* Insert FCS */
 #define E1000_TDESC_CMD_EOP             (1 << 0)    /* End Of Packet */
 
@@ -104,9 +113,14 @@ C_ASSERT(sizeof(E1000_TRANSMIT_DESCRIPTOR) == 16);
 
 
 /* Valid Range: 80-256 for 82542 and 82543 gigabit ethernet controllers
-   Valid Range: 80-4096 for 82544 and newer */
-#define NUM_TRANSMIT_DESCRIPTORS        128
-#define NUM_RECEIVE_DESCRIPTORS         128
+   Valid Range: 80-4096 for 82544 and newer
+   The ring length must be a multiple of 128 bytes (8 descriptors) */
+#define DEFAULT_TRANSMIT_DESCRIPTORS    128
+#define DEFAULT_RECEIVE_DESCRIPTORS     128
+#define MIN_DESCRIPTORS                 80
+#define MAX_DESCRIPTORS_82543           256
+#define MAX_DESCRIPTORS                 4096
+#define DESCRIPTOR_COUNT_ALIGNMENT      8
 
 
 
@@ -143,6 +157,8 @@ C_ASSERT(sizeof(E1000_TRANSMIT_DESCRIPTOR) == 16);
 #define E1000_REG_TADV              0x382C      /* Transmit Absolute Delay Timer, R/W */
 
 
+#define E1000_REG_RXCSUM            0x5000      /* Receive Checksum Control, R/W */
+
 #define E1000_REG_RAL               0x5400      /* Receive Address Low, R/W */
 #define E1000_REG_RAH               0x5404      /* Receive Address High, R/W */
 
@@ -189,8 +205,15 @@ C_ASSERT(sizeof(E1000_TRANSMIT_DESCRIPTOR) == 16);
 
 
 /* E1000_REG_ITR */
-#define MAX_INTS_PER_SEC        2000
-#define DEFAULT_ITR             1000000000/(MAX_INTS_PER_SEC * 256)
+#define DEFAULT_INTS_PER_SEC        8000
+#define MAX_INTS_PER_SEC            100000
+#define E1000_ITR_FROM_RATE(Rate)   (1000000000 / ((Rate) * 256))   /* Interval in 256 ns increments */
+
+
+/* E1000_REG_RDTR, E1000_REG_RADV (in 1.024 usec units) */
+#define DEFAULT_RX_INT_DELAY        16
+#define DEFAULT_RX_ABS_INT_DELAY    96
+#define MAX_RX_INT_DELAY            0xFFFF
 
 
 /* E1000_REG_RCTL */
@@ -217,6 +240,11 @@ C_ASSERT(sizeof(E1000_TRANSMIT_DESCRIPTOR) == 16);
 #define E1000_TIPG_IPGR2_DEF        (10 << 20)  /* IPG Receive Time 2 */
 
 
+/* E1000_REG_RXCSUM */
+#define E1000_RXCSUM_IPOFL          (1 << 8)    /* IP Checksum Off-load Enable */
+#define E1000_RXCSUM_TUOFL          (1 << 9)    /* TCP/UDP Checksum Off-load Enable */
+
+
 /* E1000_REG_RAH */
 #define E1000_RAH_AV                (1 << 31)   /* Address Valid */
 
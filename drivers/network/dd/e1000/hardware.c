@@ -227,6 +227,28 @@ NICRecognizeHardware(
     {
         if (SupportedDevices[n] == Adapter->DeviceID)
         {
+            switch (Adapter->DeviceID)
+            {
+                case 0x1000:    // 82542
+                    break;
+                case 0x1001:    // 82543
+                case 0x1004:
+                    Adapter->HasChecksumOffload = TRUE;
+                    break;
+                case 0x1008:    // 82544
+                case 0x1009:
+                case 0x100C:
+                case 0x100D:
+                    Adapter->HasChecksumOffload = TRUE;
+                    Adapter->HasLargeRings = TRUE;
+                    break;
+                default:
+                    Adapter->HasChecksumOffload = TRUE;
+                    Adapter->HasLargeRings = TRUE;
+                    Adapter->HasInterruptThrottling = TRUE;
+                    break;
+            }
+
             return TRUE;
         }
     }
@@ -304,6 +326,120 @@ NICInitializeAdapterResources(
     return NDIS_STATUS_SUCCESS;
 }
 
+static
+NDIS_STATUS
+NICAllocateReceivePackets(
+    IN PE1000_ADAPTER Adapter)
+{
+    NDIS_STATUS Status;
+    UINT n;
+
+    Status = NdisAllocateMemoryWithTag((PVOID*)&Adapter->RxBuffers,
+                                       sizeof(E1000_RECEIVE_BUFFER) * Adapter->RxBufferCount,
+                                       E1000_TAG);
+    if (Status != NDIS_STATUS_SUCCESS)
+        return Status;
+    NdisZeroMemory(Adapter->RxBuffers, sizeof(E1000_RECEIVE_BUFFER) * Adapter->RxBufferCount);
+
+    Status = NdisAllocateMemoryWithTag((PVOID*)&Adapter->RxDescBuffer,
+                                       sizeof(ULONG) * Adapter->RxDescCount,
+                                       E1000_TAG);
+    if (Status != NDIS_STATUS_SUCCESS)
+        return Status;
+
+    Status = NdisAllocateMemoryWithTag((PVOID*)&Adapter->RxFreeBuffers,
+                                       sizeof(ULONG) * Adapter->RxBufferCount,
+                                       E1000_TAG);
+    if (Status != NDIS_STATUS_SUCCESS)
+        return Status;
+
+    NdisAllocatePacketPool(&Status,
+                           &Adapter->RxPacketPool,
+                           Adapter->RxBufferCount,
+                           PROTOCOL_RESERVED_SIZE_IN_PACKET);
+    if (Status != NDIS_STATUS_SUCCESS)
+        return Status;
+
+    NdisAllocateBufferPool(&Status,
+                           &Adapter->RxBufferPool,
+                           Adapter->RxBufferCount);
+    if (Status != NDIS_STATUS_SUCCESS)
+        return Status;
+
+    for (n = 0; n < Adapter->RxBufferCount; ++n)
+    {
+        PE1000_RECEIVE_BUFFER RxBuffer = Adapter->RxBuffers + n;
+
+        NdisAllocatePacket(&Status, &RxBuffer->Packet, Adapter->RxPacketPool);
+        if (Status != NDIS_STATUS_SUCCESS)
+            return Status;
+
+        NdisAllocateBuffer(&Status,
+                           &RxBuffer->Buffer,
+                           Adapter->RxBufferPool,
+                           Adapter->ReceiveBuffer + n * Adapter->ReceiveBufferEntrySize,
+                           Adapter->ReceiveBufferEntrySize);
+        if (Status != NDIS_STATUS_SUCCESS)
+            return Status;
+
+        NdisChainBufferAtFront(RxBuffer->Packet, RxBuffer->Buffer);
+        NDIS_SET_PACKET_HEADER_SIZE(RxBuffer->Packet, sizeof(ETH_HEADER));
+
+        /* Remember which buffer the packet belongs to for MiniportReturnPacket */
+        *(PULONG)RxBuffer->Packet->MiniportReserved = n;
+    }
+
+    return NDIS_STATUS_SUCCESS;
+}
+
+static
+VOID
+NICFreeReceivePackets(
+    IN PE1000_ADAPTER Adapter)
+{
+    UINT n;
+
+    if (Adapter->RxBuffers != NULL)
+    {
+        for (n = 0; n < Adapter->RxBufferCount; ++n)
+        {
+            PE1000_RECEIVE_BUFFER RxBuffer = Adapter->RxBuffers + n;
+
+            if (RxBuffer->Buffer != NULL)
+                NdisFreeBuffer(RxBuffer->Buffer);
+            if (RxBuffer->Packet != NULL)
+                NdisFreePacket(RxBuffer->Packet);
+        }
+
+        NdisFreeMemory(Adapter->RxBuffers, sizeof(E1000_RECEIVE_BUFFER) * Adapter->RxBufferCount, 0);
+        Adapter->RxBuffers = NULL;
+    }
+
+    if (Adapter->RxBufferPool != NULL)
+    {
+        NdisFreeBufferPool(Adapter->RxBufferPool);
+        Adapter->RxBufferPool = NULL;
+    }
+
+    if (Adapter->RxPacketPool != NULL)
+    {
+        NdisFreePacketPool(Adapter->RxPacketPool);
+        Adapter->RxPacketPool = NULL;
+    }
+
+    if (Adapter->RxDescBuffer != NULL)
+    {
+        NdisFreeMemory(Adapter->RxDescBuffer, sizeof(ULONG) * Adapter->RxDescCount, 0);
+        Adapter->RxDescBuffer = NULL;
+    }
+
+    if (Adapter->RxFreeBuffers != NULL)
+    {
+        NdisFreeMemory(Adapter->RxFreeBuffers, sizeof(ULONG) * Adapter->RxBufferCount, 0);
+        Adapter->RxFreeBuffers = NULL;
+    }
+}
+
 NDIS_STATUS
 NTAPI
 NICAllocateIoResources(
@@ -332,7 +468,7 @@ NICAllocateIoResources(
 
 
     NdisMAllocateSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * NUM_TRANSMIT_DESCRIPTORS,
+                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * Adapter->TxDescCount,
                               FALSE,
                               (PVOID*)&Adapter->TransmitDescriptors,
                               &Adapter->TransmitDescriptorsPa);
@@ -342,15 +478,25 @@ NICAllocateIoResources(
         return NDIS_STATUS_RESOURCES;
     }
 
-    for (n = 0; n < NUM_TRANSMIT_DESCRIPTORS; ++n)
+    for (n = 0; n < Adapter->TxDescCount; ++n)
     {
         PE1000_TRANSMIT_DESCRIPTOR Descriptor = Adapter->TransmitDescriptors + n;
         Descriptor->Address = 0;
         Descriptor->Length = 0;
     }
 
+    Status = NdisAllocateMemoryWithTag((PVOID*)&Adapter->TransmitPackets,
+                                       sizeof(PNDIS_PACKET) * Adapter->TxDescCount,
+                                       E1000_TAG);
+    if (Status != NDIS_STATUS_SUCCESS)
+    {
+        NDIS_DbgPrint(MIN_TRACE, ("Unable to allocate transmit packet list\n"));
+        return NDIS_STATUS_RESOURCES;
+    }
+    NdisZeroMemory(Adapter->TransmitPackets, sizeof(PNDIS_PACKET) * Adapter->TxDescCount);
+
     NdisMAllocateSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_RECEIVE_DESCRIPTOR) * NUM_RECEIVE_DESCRIPTORS,
+                              sizeof(E1000_RECEIVE_DESCRIPTOR) * Adapter->RxDescCount,
                               FALSE,
                               (PVOID*)&Adapter->ReceiveDescriptors,
                               &Adapter->ReceiveDescriptorsPa);
@@ -365,7 +511,7 @@ NICAllocateIoResources(
     Adapter->ReceiveBufferEntrySize = AllocationSize;
 
     NdisMAllocateSharedMemory(Adapter->AdapterHandle,
-                              Adapter->ReceiveBufferEntrySize * NUM_RECEIVE_DESCRIPTORS,
+                              Adapter->ReceiveBufferEntrySize * Adapter->RxBufferCount,
                               FALSE,
                               (PVOID*)&Adapter->ReceiveBuffer,
                               &Adapter->ReceiveBufferPa);
@@ -376,12 +522,27 @@ NICAllocateIoResources(
         return NDIS_STATUS_RESOURCES;
     }
 
-    for (n = 0; n < NUM_RECEIVE_DESCRIPTORS; ++n)
+    Status = NICAllocateReceivePackets(Adapter);
+    if (Status != NDIS_STATUS_SUCCESS)
+    {
+        NDIS_DbgPrint(MIN_TRACE, ("Unable to allocate receive packets\n"));
+        return NDIS_STATUS_RESOURCES;
+    }
+
+    /* The first buffers go to the descriptors, the rest is kept for refilling */
+    for (n = 0; n < Adapter->RxDescCount; ++n)
     {
         PE1000_RECEIVE_DESCRIPTOR Descriptor = Adapter->ReceiveDescriptors + n;
 
         RtlZeroMemory(Descriptor, sizeof(*Descriptor));
         Descriptor->Address = Adapter->ReceiveBufferPa.QuadPart + n * Adapter->ReceiveBufferEntrySize;
+        Adapter->RxDescBuffer[n] = n;
+    }
+
+    Adapter->RxFreeBufferCount = 0;
+    for (n = Adapter->RxDescCount; n < Adapter->RxBufferCount; ++n)
+    {
+        Adapter->RxFreeBuffers[Adapter->RxFreeBufferCount++] = n;
     }
 
     return NDIS_STATUS_SUCCESS;
@@ -445,7 +606,7 @@ NICReleaseIoResources(
         }
 
         NdisMFreeSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_RECEIVE_DESCRIPTOR) * NUM_RECEIVE_DESCRIPTORS,
+                              sizeof(E1000_RECEIVE_DESCRIPTOR) * Adapter->RxDescCount,
                               FALSE,
                               Adapter->ReceiveDescriptors,
                               Adapter->ReceiveDescriptorsPa);
@@ -453,10 +614,12 @@ NICReleaseIoResources(
         Adapter->ReceiveDescriptors = NULL;
     }
 
+    NICFreeReceivePackets(Adapter);
+
     if (Adapter->ReceiveBuffer != NULL)
     {
         NdisMFreeSharedMemory(Adapter->AdapterHandle,
-                              Adapter->ReceiveBufferEntrySize * NUM_RECEIVE_DESCRIPTORS,
+                              Adapter->ReceiveBufferEntrySize * Adapter->RxBufferCount,
                               FALSE,
                               Adapter->ReceiveBuffer,
                               Adapter->ReceiveBufferPa);
@@ -476,7 +639,7 @@ NICReleaseIoResources(
         }
 
         NdisMFreeSharedMemory(Adapter->AdapterHandle,
-                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * NUM_TRANSMIT_DESCRIPTORS,
+                              sizeof(E1000_TRANSMIT_DESCRIPTOR) * Adapter->TxDescCount,
                               FALSE,
                               Adapter->TransmitDescriptors,
                               Adapter->TransmitDescriptorsPa);
@@ -484,6 +647,12 @@ NICReleaseIoResources(
         Adapter->TransmitDescriptors = NULL;
     }
 
+    if (Adapter->TransmitPackets != NULL)
+    {
+        NdisFreeMemory(Adapter->TransmitPackets, sizeof(PNDIS_PACKET) * Adapter->TxDescCount, 0);
+        Adapter->TransmitPackets = NULL;
+    }
+
 
 
     if (Adapter->IoPort)
@@ -587,12 +756,16 @@ NICEnableTxRx(
     E1000WriteUlong(Adapter, E1000_REG_TDBAL, Adapter->TransmitDescriptorsPa.LowPart);
 
     /* Transmit descriptor buffer size */
-    E1000WriteUlong(Adapter, E1000_REG_TDLEN, sizeof(E1000_TRANSMIT_DESCRIPTOR) * NUM_TRANSMIT_DESCRIPTORS);
+    E1000WriteUlong(Adapter, E1000_REG_TDLEN, sizeof(E1000_TRANSMIT_DESCRIPTOR) * Adapter->TxDescCount);
 
     /* Transmit descriptor tail / head */
     E1000WriteUlong(Adapter, E1000_REG_TDH, 0);
     E1000WriteUlong(Adapter, E1000_REG_TDT, 0);
     Adapter->CurrentTxDesc = 0;
+    Adapter->LastTxDesc = 0;
+
+    /* One descriptor always stays unused, otherwise a full ring would look empty (TDH == TDT) */
+    Adapter->TxFreeDescriptors = Adapter->TxDescCount - 1;
 
     /* Set up interrupt timers */
     E1000WriteUlong(Adapter, E1000_REG_TADV, 96); // value is in 1.024 of usec
@@ -612,15 +785,25 @@ NICEnableTxRx(
     E1000WriteUlong(Adapter, E1000_REG_RDBAL, Adapter->ReceiveDescriptorsPa.LowPart);
 
     /* Receive descriptor buffer size */
-    E1000WriteUlong(Adapter, E1000_REG_RDLEN, sizeof(E1000_RECEIVE_DESCRIPTOR) * NUM_RECEIVE_DESCRIPTORS);
+    E1000WriteUlong(Adapter, E1000_REG_RDLEN, sizeof(E1000_RECEIVE_DESCRIPTOR) * Adapter->RxDescCount);
 
     /* Receive descriptor tail / head */
     E1000WriteUlong(Adapter, E1000_REG_RDH, 0);
-    E1000WriteUlong(Adapter, E1000_REG_RDT, NUM_RECEIVE_DESCRIPTORS - 1);
+    E1000WriteUlong(Adapter, E1000_REG_RDT, Adapter->RxDescCount - 1);
 
     /* Set up interrupt timers */
-    E1000WriteUlong(Adapter, E1000_REG_RADV, 96);
-    E1000WriteUlong(Adapter, E1000_REG_RDTR, 16);
+    E1000WriteUlong(Adapter, E1000_REG_RADV, Adapter->RxAbsIntDelay);
+    E1000WriteUlong(Adapter, E1000_REG_RDTR, Adapter->RxIntDelay);
+
+    /* Limit the overall interrupt rate, the delay timers above only batch packets of one burst */
+    if (Adapter->HasInterruptThrottling)
+    {
+        E1000WriteUlong(Adapter,
+                        E1000_REG_ITR,
+                        Adapter->InterruptThrottleRate ? E1000_ITR_FROM_RATE(Adapter->InterruptThrottleRate) : 0);
+    }
+
+    NICApplyChecksumOffload(Adapter);
 
     /* Some defaults */
     Value = E1000_RCTL_SECRC | E1000_RCTL_EN;
@@ -735,6 +918,26 @@ NICApplyPacketFilter(
     return NDIS_STATUS_SUCCESS;
 }
 
+VOID
+NTAPI
+NICApplyChecksumOffload(
+    IN PE1000_ADAPTER Adapter)
+{
+    ULONG Value = 0;
+
+    NDIS_DbgPrint(MAX_TRACE, ("Called.\n"));
+
+    if (!Adapter->HasChecksumOffload)
+        return;
+
+    if (Adapter->Offload.ReceiveIpChecksum)
+        Value |= E1000_RXCSUM_IPOFL;
+    if (Adapter->Offload.ReceiveTcpChecksum || Adapter->Offload.ReceiveUdpChecksum)
+        Value |= E1000_RXCSUM_TUOFL;
+
+    E1000WriteUlong(Adapter, E1000_REG_RXCSUM, Value);
+}
+
 VOID
 NTAPI
 NICUpdateLinkStatus(
@@ -37,6 +37,7 @@ static NDIS_OID SupportedOidList[] =
     OID_802_3_PERMANENT_ADDRESS,
     OID_802_3_CURRENT_ADDRESS,
     OID_802_3_MAXIMUM_LIST_SIZE,
+    OID_TCP_TASK_OFFLOAD,
 
     /* Statistics */
     OID_GEN_XMIT_OK,
@@ -68,6 +69,135 @@ NICFillPowerManagementCapabilities(
     return NDIS_STATUS_NOT_SUPPORTED;
 }
 
+static
+NDIS_STATUS
+NICGetTcpTaskOffload(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ PNDIS_TASK_OFFLOAD_HEADER TaskOffloadHeader,
+    _In_ ULONG InformationBufferLength,
+    _Out_ PULONG BytesWritten,
+    _Out_ PULONG BytesNeeded)
+{
+    ULONG InfoLength;
+    PNDIS_TASK_OFFLOAD TaskOffload;
+    PNDIS_TASK_TCP_IP_CHECKSUM ChecksumTask;
+
+    *BytesWritten = 0;
+    *BytesNeeded = 0;
+
+    if (!Adapter->ChecksumOffloadEnabled)
+    {
+        return NDIS_STATUS_NOT_SUPPORTED;
+    }
+
+    InfoLength = sizeof(NDIS_TASK_OFFLOAD_HEADER) +
+                 FIELD_OFFSET(NDIS_TASK_OFFLOAD, TaskBuffer) +
+                 sizeof(NDIS_TASK_TCP_IP_CHECKSUM);
+
+    if (InformationBufferLength < InfoLength)
+    {
+        *BytesNeeded = InfoLength;
+        return NDIS_STATUS_BUFFER_TOO_SHORT;
+    }
+
+    if ((TaskOffloadHeader->EncapsulationFormat.Encapsulation != IEEE_802_3_Encapsulation) &&
+        (TaskOffloadHeader->EncapsulationFormat.Encapsulation != UNSPECIFIED_Encapsulation ||
+         TaskOffloadHeader->EncapsulationFormat.EncapsulationHeaderSize != sizeof(ETH_HEADER)))
+    {
+        return NDIS_STATUS_NOT_SUPPORTED;
+    }
+
+    if (TaskOffloadHeader->Version != NDIS_TASK_OFFLOAD_VERSION)
+    {
+        return NDIS_STATUS_NOT_SUPPORTED;
+    }
+
+    TaskOffloadHeader->OffsetFirstTask = sizeof(NDIS_TASK_OFFLOAD_HEADER);
+
+    TaskOffload = (PNDIS_TASK_OFFLOAD)(TaskOffloadHeader + 1);
+    TaskOffload->Size = sizeof(NDIS_TASK_OFFLOAD);
+    TaskOffload->Version = NDIS_TASK_OFFLOAD_VERSION;
+    TaskOffload->Task = TcpIpChecksumNdisTask;
+    TaskOffload->TaskBufferLength = sizeof(NDIS_TASK_TCP_IP_CHECKSUM);
+    TaskOffload->OffsetNextTask = 0;
+
+    ChecksumTask = (PNDIS_TASK_TCP_IP_CHECKSUM)TaskOffload->TaskBuffer;
+    NdisZeroMemory(ChecksumTask, sizeof(*ChecksumTask));
+
+    /* The legacy descriptors can insert only one checksum per packet,
+     * so the IP header checksum is left to the stack on transmit */
+    ChecksumTask->V4Transmit.IpOptionsSupported = 1;
+    ChecksumTask->V4Transmit.TcpOptionsSupported = 1;
+    ChecksumTask->V4Transmit.TcpChecksum = 1;
+    ChecksumTask->V4Transmit.UdpChecksum = 1;
+
+    ChecksumTask->V4Receive.IpOptionsSupported = 1;
+    ChecksumTask->V4Receive.TcpOptionsSupported = 1;
+    ChecksumTask->V4Receive.TcpChecksum = 1;
+    ChecksumTask->V4Receive.UdpChecksum = 1;
+    ChecksumTask->V4Receive.IpChecksum = 1;
+
+    *BytesWritten = InfoLength;
+
+    return NDIS_STATUS_SUCCESS;
+}
+
+static
+NDIS_STATUS
+NICSetTcpTaskOffload(
+    _Inout_ PE1000_ADAPTER Adapter,
+    _In_ PNDIS_TASK_OFFLOAD_HEADER TaskOffloadHeader,
+    _In_ ULONG InformationBufferLength)
+{
+    ULONG Offset;
+    PNDIS_TASK_OFFLOAD TaskOffload;
+    PNDIS_TASK_TCP_IP_CHECKSUM Task;
+
+    if (TaskOffloadHeader->Version != NDIS_TASK_OFFLOAD_VERSION)
+    {
+        return NDIS_STATUS_NOT_SUPPORTED;
+    }
+
+    /* An empty list turns everything off */
+    NdisZeroMemory(&Adapter->Offload, sizeof(Adapter->Offload));
+
+    TaskOffload = (PNDIS_TASK_OFFLOAD)TaskOffloadHeader;
+    Offset = TaskOffloadHeader->OffsetFirstTask;
+
+    while (Offset)
+    {
+        TaskOffload = (PNDIS_TASK_OFFLOAD)((PUCHAR)TaskOffload + Offset);
+
+        if ((ULONG_PTR)TaskOffload->TaskBuffer - (ULONG_PTR)TaskOffloadHeader > InformationBufferLength)
+        {
+            return NDIS_STATUS_INVALID_LENGTH;
+        }
+
+        if (TaskOffload->Task == TcpIpChecksumNdisTask)
+        {
+            if (!Adapter->ChecksumOffloadEnabled)
+            {
+                return NDIS_STATUS_NOT_SUPPORTED;
+            }
+
+            Task = (PNDIS_TASK_TCP_IP_CHECKSUM)TaskOffload->TaskBuffer;
+
+            Adapter->Offload.SendTcpChecksum = Task->V4Transmit.TcpChecksum;
+            Adapter->Offload.SendUdpChecksum = Task->V4Transmit.UdpChecksum;
+
+            Adapter->Offload.ReceiveTcpChecksum = Task->V4Receive.TcpChecksum;
+            Adapter->Offload.ReceiveUdpChecksum = Task->V4Receive.UdpChecksum;
+            Adapter->Offload.ReceiveIpChecksum = Task->V4Receive.IpChecksum;
+        }
+
+        Offset = TaskOffload->OffsetNextTask;
+    }
+
+    NICApplyChecksumOffload(Adapter);
+
+    return NDIS_STATUS_SUCCESS;
+}
+
 NDIS_STATUS
 NTAPI
 MiniportQueryInformation(
@@ -180,9 +310,23 @@ MiniportQueryInformation(
         break;
 
     case OID_GEN_MAXIMUM_SEND_PACKETS:
-        GenericInfo.Ulong = 1;
+        GenericInfo.Ulong = Adapter->TxDescCount - 1;
         break;
 
+    case OID_TCP_TASK_OFFLOAD:
+        if (InformationBufferLength < sizeof(NDIS_TASK_OFFLOAD_HEADER))
+        {
+            *BytesWritten = 0;
+            *BytesNeeded = sizeof(NDIS_TASK_OFFLOAD_HEADER);
+            return NDIS_STATUS_BUFFER_TOO_SHORT;
+        }
+
+        return NICGetTcpTaskOffload(Adapter,
+                                    InformationBuffer,
+                                    InformationBufferLength,
+                                    BytesWritten,
+                                    BytesNeeded);
+
     case OID_GEN_MAC_OPTIONS:
         GenericInfo.Ulong = NDIS_MAC_OPTION_RECEIVE_SERIALIZED |
             NDIS_MAC_OPTION_COPY_LOOKAHEAD_DATA |
@@ -376,6 +520,23 @@ MiniportSetInformation(
         NICUpdateMulticastList(Adapter);
         break;
 
+    case OID_TCP_TASK_OFFLOAD:
+        if (InformationBufferLength < sizeof(NDIS_TASK_OFFLOAD_HEADER))
+        {
+            *BytesRead = 0;
+            *BytesNeeded = sizeof(NDIS_TASK_OFFLOAD_HEADER);
+            status = NDIS_STATUS_INVALID_LENGTH;
+            break;
+        }
+
+        status = NICSetTcpTaskOffload(Adapter, InformationBuffer, InformationBufferLength);
+        if (status != NDIS_STATUS_SUCCESS)
+        {
+            *BytesRead = 0;
+            *BytesNeeded = 0;
+        }
+        break;
+
     default:
         NDIS_DbgPrint(MIN_TRACE, ("Unknown OID 0x%x(%s)\n", Oid, Oid2Str(Oid)));
         status = NDIS_STATUS_NOT_SUPPORTED;
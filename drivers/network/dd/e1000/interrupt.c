@@ -41,6 +41,166 @@ MiniportISR(
     }
 }
 
+static
+VOID
+NICSetReceiveChecksumInfo(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ PNDIS_PACKET Packet,
+    _In_ volatile PE1000_RECEIVE_DESCRIPTOR ReceiveDescriptor,
+    _In_ PUCHAR Frame)
+{
+    NDIS_TCP_IP_CHECKSUM_PACKET_INFO ChecksumInfo;
+    UCHAR Status = ReceiveDescriptor->Status;
+    UCHAR Errors = ReceiveDescriptor->Errors;
+    BOOLEAN IsTcp;
+
+    ChecksumInfo.Value = 0;
+
+    /* Only report checksums of untagged IPv4 frames, the protocol field is read
+     * at a fixed offset below. VLAN tagged frames are left to the stack. */
+    if (!(Status & E1000_RDESC_STATUS_IXSM) &&
+        ReceiveDescriptor->Length >= sizeof(ETH_HEADER) + 20 &&
+        ((PETH_HEADER)Frame)->PayloadType == ETH_TYPE_IPV4)
+    {
+        if ((Status & E1000_RDESC_STATUS_IPCS) && Adapter->Offload.ReceiveIpChecksum)
+        {
+            if (Errors & E1000_RDESC_ERROR_IPE)
+                ChecksumInfo.Receive.NdisPacketIpChecksumFailed = 1;
+            else
+                ChecksumInfo.Receive.NdisPacketIpChecksumSucceeded = 1;
+        }
+
+        if (Status & E1000_RDESC_STATUS_TCPCS)
+        {
+            /* The MAC does not tell us which one it was, look at the IPv4 protocol field */
+            IsTcp = (Frame[sizeof(ETH_HEADER) + 9] == 6);
+
+            if (IsTcp && Adapter->Offload.ReceiveTcpChecksum)
+            {
+                if (Errors & E1000_RDESC_ERROR_TCPE)
+                    ChecksumInfo.Receive.NdisPacketTcpChecksumFailed = 1;
+                else
+                    ChecksumInfo.Receive.NdisPacketTcpChecksumSucceeded = 1;
+            }
+            else if (!IsTcp && Adapter->Offload.ReceiveUdpChecksum)
+            {
+                if (Errors & E1000_RDESC_ERROR_TCPE)
+                    ChecksumInfo.Receive.NdisPacketUdpChecksumFailed = 1;
+                else
+                    ChecksumInfo.Receive.NdisPacketUdpChecksumSucceeded = 1;
+            }
+        }
+    }
+
+    NDIS_PER_PACKET_INFO_FROM_PACKET(Packet, TcpIpChecksumPacketInfo) = UlongToPtr(ChecksumInfo.Value);
+}
+
+static
+PNDIS_PACKET
+NICPrepareReceivePacket(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ ULONG Descriptor,
+    _In_ volatile PE1000_RECEIVE_DESCRIPTOR ReceiveDescriptor)
+{
+    PE1000_RECEIVE_BUFFER RxBuffer;
+    ULONG BufferIndex, NewBufferIndex;
+    PUCHAR Frame;
+
+    BufferIndex = Adapter->RxDescBuffer[Descriptor];
+    RxBuffer = Adapter->RxBuffers + BufferIndex;
+    Frame = Adapter->ReceiveBuffer + BufferIndex * Adapter->ReceiveBufferEntrySize;
+
+    NdisAdjustBufferLength(RxBuffer->Buffer, ReceiveDescriptor->Length);
+    NdisRecalculatePacketCounts(RxBuffer->Packet);
+    NICSetReceiveChecksumInfo(Adapter, RxBuffer->Packet, ReceiveDescriptor, Frame);
+
+    /* Hand the buffer up and refill the descriptor with a spare one.
+     * When we run out of spares, the protocol has to copy the data right away. */
+    NdisDprAcquireSpinLock(&Adapter->RxFreeLock);
+    if (Adapter->RxFreeBufferCount)
+    {
+        NewBufferIndex = Adapter->RxFreeBuffers[--Adapter->RxFreeBufferCount];
+        NdisDprReleaseSpinLock(&Adapter->RxFreeLock);
+
+        Adapter->RxDescBuffer[Descriptor] = NewBufferIndex;
+        ReceiveDescriptor->Address = Adapter->ReceiveBufferPa.QuadPart +
+                                     NewBufferIndex * Adapter->ReceiveBufferEntrySize;
+
+        NDIS_SET_PACKET_STATUS(RxBuffer->Packet, NDIS_STATUS_SUCCESS);
+    }
+    else
+    {
+        NdisDprReleaseSpinLock(&Adapter->RxFreeLock);
+
+        NDIS_SET_PACKET_STATUS(RxBuffer->Packet, NDIS_STATUS_RESOURCES);
+    }
+
+    return RxBuffer->Packet;
+}
+
+static
+VOID
+NICReleaseReceiveBuffer(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ PNDIS_PACKET Packet)
+{
+    ULONG BufferIndex = *(PULONG)Packet->MiniportReserved;
+
+    ASSERT(BufferIndex < Adapter->RxBufferCount);
+
+    NdisAdjustBufferLength(Adapter->RxBuffers[BufferIndex].Buffer, Adapter->ReceiveBufferEntrySize);
+
+    NdisDprAcquireSpinLock(&Adapter->RxFreeLock);
+    ASSERT(Adapter->RxFreeBufferCount < Adapter->RxBufferCount);
+    Adapter->RxFreeBuffers[Adapter->RxFreeBufferCount++] = BufferIndex;
+    NdisDprReleaseSpinLock(&Adapter->RxFreeLock);
+}
+
+static
+VOID
+NICIndicateReceivePackets(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ PNDIS_PACKET *Packets,
+    _In_ PULONG Descriptors,
+    _In_ ULONG NumPackets)
+{
+    ULONG i;
+    NDIS_STATUS Status;
+
+    NdisMIndicateReceivePacket(Adapter->AdapterHandle, Packets, NumPackets);
+
+    for (i = 0; i < NumPackets; ++i)
+    {
+        Status = NDIS_GET_PACKET_STATUS(Packets[i]);
+
+        if (Status == NDIS_STATUS_RESOURCES)
+        {
+            /* The buffer never left its descriptor */
+            ASSERT(Adapter->RxBuffers[Adapter->RxDescBuffer[Descriptors[i]]].Packet == Packets[i]);
+        }
+        else if (Status != NDIS_STATUS_PENDING)
+        {
+            /* Nobody kept it, the buffer becomes a spare one again */
+            NICReleaseReceiveBuffer(Adapter, Packets[i]);
+        }
+
+        /* Otherwise MiniportReturnPacket will give it back */
+    }
+}
+
+VOID
+NTAPI
+MiniportReturnPacket(
+    _In_ NDIS_HANDLE MiniportAdapterContext,
+    _In_ PNDIS_PACKET Packet)
+{
+    PE1000_ADAPTER Adapter = (PE1000_ADAPTER)MiniportAdapterContext;
+
+    NDIS_DbgPrint(MAX_TRACE, ("Called.\n"));
+
+    NICReleaseReceiveBuffer(Adapter, Packet);
+}
+
 VOID
 NTAPI
 MiniportHandleInterrupt(
@@ -75,8 +235,9 @@ MiniportHandleInterrupt(
     if (InterruptPending & (E1000_IMS_RXDMT0 | E1000_IMS_RXT0))
     {
         volatile PE1000_RECEIVE_DESCRIPTOR ReceiveDescriptor;
-        PETH_HEADER EthHeader;
-        ULONG BufferOffset;
+        PNDIS_PACKET Packets[RECEIVE_INDICATION_BATCH];
+        ULONG Descriptors[RECEIVE_INDICATION_BATCH];
+        ULONG NumPackets = 0;
         BOOLEAN bGotAny = FALSE;
         ULONG RxDescHead, RxDescTail, CurrRxDesc;
 
@@ -86,10 +247,9 @@ MiniportHandleInterrupt(
         E1000ReadUlong(Adapter, E1000_REG_RDH, &RxDescHead);
         E1000ReadUlong(Adapter, E1000_REG_RDT, &RxDescTail);
 
-        while (((RxDescTail + 1) % NUM_RECEIVE_DESCRIPTORS) != RxDescHead)
+        while (((RxDescTail + 1) % Adapter->RxDescCount) != RxDescHead)
         {
-            CurrRxDesc = (RxDescTail + 1) % NUM_RECEIVE_DESCRIPTORS;
-            BufferOffset = CurrRxDesc * Adapter->ReceiveBufferEntrySize;
+            CurrRxDesc = (RxDescTail + 1) % Adapter->RxDescCount;
             ReceiveDescriptor = Adapter->ReceiveDescriptors + CurrRxDesc;
 
             /* Check if the hardware have released this descriptor (DD - Descriptor Done) */
@@ -99,10 +259,7 @@ MiniportHandleInterrupt(
                 break;
             }
 
-            /* Ignoring these flags for now */
-            ReceiveDescriptor->Status &= ~(E1000_RDESC_STATUS_IXSM | E1000_RDESC_STATUS_PIF);
-
-            if (ReceiveDescriptor->Status != (E1000_RDESC_STATUS_EOP | E1000_RDESC_STATUS_DD))
+            if (!(ReceiveDescriptor->Status & E1000_RDESC_STATUS_EOP))
             {
                 NDIS_DbgPrint(MIN_TRACE, ("Unrecognized ReceiveDescriptor status flag: %u\n", ReceiveDescriptor->Status));
             }
@@ -115,15 +272,9 @@ MiniportHandleInterrupt(
 
             if (ReceiveDescriptor->Length != 0 && ReceiveDescriptor->Address != 0)
             {
-                EthHeader = (PETH_HEADER)(Adapter->ReceiveBuffer + BufferOffset);
-
-                NdisMEthIndicateReceive(Adapter->AdapterHandle,
-                                        NULL,
-                                        (PCHAR)EthHeader,
-                                        sizeof(ETH_HEADER),
-                                        (PCHAR)(EthHeader + 1),
-                                        ReceiveDescriptor->Length - sizeof(ETH_HEADER),
-                                        ReceiveDescriptor->Length - sizeof(ETH_HEADER));
+                Packets[NumPackets] = NICPrepareReceivePacket(Adapter, CurrRxDesc, ReceiveDescriptor);
+                Descriptors[NumPackets] = CurrRxDesc;
+                NumPackets++;
 
                 bGotAny = TRUE;
             }
@@ -133,10 +284,21 @@ MiniportHandleInterrupt(
             }
 
 NextReceiveDescriptor:
-            /* Give the descriptor back */
+            /* The descriptor is given back with the tail update below */
             ReceiveDescriptor->Status = 0;
 
             RxDescTail = CurrRxDesc;
+
+            if (NumPackets == RECEIVE_INDICATION_BATCH)
+            {
+                NICIndicateReceivePackets(Adapter, Packets, Descriptors, NumPackets);
+                NumPackets = 0;
+            }
+        }
+
+        if (NumPackets)
+        {
+            NICIndicateReceivePackets(Adapter, Packets, Descriptors, NumPackets);
         }
 
         if (bGotAny)
@@ -159,21 +321,22 @@ NextReceiveDescriptor:
         /* Clear out these interrupts */
         InterruptPending &= ~(E1000_IMS_TXD_LOW | E1000_IMS_TXDW | E1000_IMS_TXQE);
 
-        while ((Adapter->TxFull || Adapter->LastTxDesc != Adapter->CurrentTxDesc) && NumPackets < ARRAYSIZE(AckPackets))
+        while (Adapter->TxFreeDescriptors < Adapter->TxDescCount - 1 && NumPackets < ARRAYSIZE(AckPackets))
         {
             TransmitDescriptor = Adapter->TransmitDescriptors + Adapter->LastTxDesc;
 
             if (TransmitDescriptor->Status & E1000_TDESC_STATUS_DD)
             {
+                /* Only the last descriptor of a packet holds the packet pointer */
                 if (Adapter->TransmitPackets[Adapter->LastTxDesc])
                 {
                     AckPackets[NumPackets++] = Adapter->TransmitPackets[Adapter->LastTxDesc];
                     Adapter->TransmitPackets[Adapter->LastTxDesc] = NULL;
-                    TransmitDescriptor->Status = 0;
                 }
+                TransmitDescriptor->Status = 0;
 
-                Adapter->LastTxDesc = (Adapter->LastTxDesc + 1) % NUM_TRANSMIT_DESCRIPTORS;
-                Adapter->TxFull = FALSE;
+                Adapter->LastTxDesc = (Adapter->LastTxDesc + 1) % Adapter->TxDescCount;
+                Adapter->TxFreeDescriptors++;
             }
             else
             {
@@ -191,6 +354,9 @@ NextReceiveDescriptor:
                 NdisMSendComplete(Adapter->AdapterHandle, AckPackets[i], NDIS_STATUS_SUCCESS);
             }
         }
+
+        /* Refill the ring from the packets that did not fit earlier */
+        NICSendHeldPackets(Adapter);
     }
 
     ASSERT(InterruptPending == 0);
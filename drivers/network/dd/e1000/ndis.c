@@ -12,6 +12,117 @@
 
 ULONG DebugTraceLevel = MIN_TRACE;
 
+static
+ULONG
+NICReadInteger(
+    _In_ NDIS_HANDLE ConfigurationHandle,
+    _In_ PCWSTR EntryName,
+    _In_ ULONG DefaultValue,
+    _In_ ULONG Minimum,
+    _In_ ULONG Maximum)
+{
+    NDIS_STATUS Status;
+    NDIS_STRING Keyword;
+    PNDIS_CONFIGURATION_PARAMETER ConfigurationParameter;
+    ULONG Value = DefaultValue;
+
+    NdisInitUnicodeString(&Keyword, EntryName);
+    NdisReadConfiguration(&Status,
+                          &ConfigurationParameter,
+                          ConfigurationHandle,
+                          &Keyword,
+                          NdisParameterInteger);
+    if (Status == NDIS_STATUS_SUCCESS)
+    {
+        if (ConfigurationParameter->ParameterData.IntegerData >= Minimum &&
+            ConfigurationParameter->ParameterData.IntegerData <= Maximum)
+        {
+            Value = ConfigurationParameter->ParameterData.IntegerData;
+        }
+        else
+        {
+            NDIS_DbgPrint(MIN_TRACE, ("'%S' value out of range\n", EntryName));
+        }
+    }
+
+    NDIS_DbgPrint(MAX_TRACE, ("'%S' is %lu\n", EntryName, Value));
+    return Value;
+}
+
+static
+VOID
+NICReadConfiguration(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ NDIS_HANDLE WrapperConfigurationContext)
+{
+    NDIS_STATUS Status;
+    NDIS_HANDLE ConfigurationHandle;
+    ULONG MaxDescriptors;
+
+    /* Defaults, in case there is no configuration at all */
+    Adapter->TxDescCount = DEFAULT_TRANSMIT_DESCRIPTORS;
+    Adapter->RxDescCount = DEFAULT_RECEIVE_DESCRIPTORS;
+    Adapter->InterruptThrottleRate = DEFAULT_INTS_PER_SEC;
+    Adapter->RxIntDelay = DEFAULT_RX_INT_DELAY;
+    Adapter->RxAbsIntDelay = DEFAULT_RX_ABS_INT_DELAY;
+    Adapter->ChecksumOffloadEnabled = Adapter->HasChecksumOffload;
+
+    NdisOpenConfiguration(&Status, &ConfigurationHandle, WrapperConfigurationContext);
+    if (Status == NDIS_STATUS_SUCCESS)
+    {
+        MaxDescriptors = Adapter->HasLargeRings ? MAX_DESCRIPTORS : MAX_DESCRIPTORS_82543;
+
+        Adapter->TxDescCount = NICReadInteger(ConfigurationHandle,
+                                              L"NumTxDescriptors",
+                                              DEFAULT_TRANSMIT_DESCRIPTORS,
+                                              MIN_DESCRIPTORS,
+                                              MaxDescriptors);
+        Adapter->RxDescCount = NICReadInteger(ConfigurationHandle,
+                                              L"NumRxDescriptors",
+                                              DEFAULT_RECEIVE_DESCRIPTORS,
+                                              MIN_DESCRIPTORS,
+                                              MaxDescriptors);
+        Adapter->InterruptThrottleRate = NICReadInteger(ConfigurationHandle,
+                                                        L"InterruptThrottleRate",
+                                                        DEFAULT_INTS_PER_SEC,
+                                                        0,
+                                                        MAX_INTS_PER_SEC);
+        Adapter->RxIntDelay = NICReadInteger(ConfigurationHandle,
+                                             L"RxIntDelay",
+                                             DEFAULT_RX_INT_DELAY,
+                                             0,
+                                             MAX_RX_INT_DELAY);
+        Adapter->RxAbsIntDelay = NICReadInteger(ConfigurationHandle,
+                                                L"RxAbsIntDelay",
+                                                DEFAULT_RX_ABS_INT_DELAY,
+                                                0,
+                                                MAX_RX_INT_DELAY);
+        if (Adapter->HasChecksumOffload)
+        {
+            Adapter->ChecksumOffloadEnabled = !!NICReadInteger(ConfigurationHandle,
+                                                               L"ChecksumOffload",
+                                                               1,
+                                                               0,
+                                                               1);
+        }
+
+        NdisCloseConfiguration(ConfigurationHandle);
+    }
+
+    /* The ring length has to be a multiple of 128 bytes */
+    Adapter->TxDescCount &= ~(DESCRIPTOR_COUNT_ALIGNMENT - 1);
+    Adapter->RxDescCount &= ~(DESCRIPTOR_COUNT_ALIGNMENT - 1);
+
+    /* Spare receive buffers replace the ones held by the protocols */
+    if (Adapter->RxDescCount * 2 > MAXIMUM_RECEIVE_BUFFERS)
+    {
+        NDIS_DbgPrint(MIN_TRACE, ("Limiting the receive ring to %lu descriptors\n",
+                                  MAXIMUM_RECEIVE_BUFFERS / 2));
+        Adapter->RxDescCount = MAXIMUM_RECEIVE_BUFFERS / 2;
+    }
+    Adapter->RxBufferCount = Adapter->RxDescCount * 2;
+}
+
 NDIS_STATUS
 NTAPI
 MiniportReset(
@@ -35,12 +146,17 @@ MiniportHalt(
     /* First disable sending / receiving */
     NICDisableTxRx(Adapter);
 
+    /* Packets still waiting for the ring will not be sent anymore */
+    NICFailHeldPackets(Adapter);
+
     /* Then unregister interrupts */
     NICUnregisterInterrupts(Adapter);
 
     /* Finally, free other resources (Ports, IO ranges,...) */
     NICReleaseIoResources(Adapter);
 
+    NdisFreeSpinLock(&Adapter->RxFreeLock);
+
     /* Destroy the adapter context */
     NdisFreeMemory(Adapter, sizeof(*Adapter), 0);
 }
@@ -93,6 +209,7 @@ MiniportInitialize(
 
     RtlZeroMemory(Adapter, sizeof(*Adapter));
     Adapter->AdapterHandle = MiniportAdapterHandle;
+    NdisAllocateSpinLock(&Adapter->RxFreeLock);
 
     /* Notify NDIS of some characteristics of our NIC */
     NdisMSetAttributesEx(MiniportAdapterHandle,
@@ -120,6 +237,8 @@ MiniportInitialize(
         goto Cleanup;
     }
 
+    NICReadConfiguration(Adapter, WrapperConfigurationContext);
+
     /* Get our resources for IRQ and IO base information */
     NdisMQueryAdapterResources(&Status,
                                WrapperConfigurationContext,
@@ -271,11 +390,11 @@ DriverEntry(
     Characteristics.QueryInformationHandler = MiniportQueryInformation;
     Characteristics.ReconfigureHandler = NULL;
     Characteristics.ResetHandler = MiniportReset;
-    Characteristics.SendHandler = MiniportSend;
+    Characteristics.SendHandler = NULL;
     Characteristics.SetInformationHandler = MiniportSetInformation;
     Characteristics.TransferDataHandler = NULL;
-    Characteristics.ReturnPacketHandler = NULL;
-    Characteristics.SendPacketsHandler = NULL;
+    Characteristics.ReturnPacketHandler = MiniportReturnPacket;
+    Characteristics.SendPacketsHandler = MiniportSendPackets;
     Characteristics.AllocateCompleteHandler = NULL;
 
     NdisMInitializeWrapper(&WrapperHandle, DriverObject, RegistryPath, NULL);
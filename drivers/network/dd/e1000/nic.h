@@ -19,10 +19,34 @@
 #define MAXIMUM_FRAME_SIZE   1522
 #define RECEIVE_BUFFER_SIZE  2048
 
+/* All receive buffers are one physically contiguous allocation, 4 MB at most */
+#define MAXIMUM_RECEIVE_BUFFERS ((4 * 1024 * 1024) / RECEIVE_BUFFER_SIZE)
+
 #define DRIVER_VERSION 1
 
 #define DEFAULT_INTERRUPT_MASK  (E1000_IMS_LSC | E1000_IMS_TXDW | E1000_IMS_TXQE | E1000_IMS_RXDMT0 | E1000_IMS_RXT0 | E1000_IMS_TXD_LOW)
 
+/* Number of packets handed to NDIS in one receive indication */
+#define RECEIVE_INDICATION_BATCH    32
+
+/* Headers we have to look at for checksum offload: Ethernet + IPv4 with options */
+#define MAXIMUM_OFFLOAD_HEADER_SIZE (sizeof(ETH_HEADER) + 60)
+
+typedef struct _E1000_OFFLOAD
+{
+    BOOLEAN SendTcpChecksum;
+    BOOLEAN SendUdpChecksum;
+    BOOLEAN ReceiveTcpChecksum;
+    BOOLEAN ReceiveUdpChecksum;
+    BOOLEAN ReceiveIpChecksum;
+} E1000_OFFLOAD, *PE1000_OFFLOAD;
+
+typedef struct _E1000_RECEIVE_BUFFER
+{
+    PNDIS_PACKET Packet;
+    PNDIS_BUFFER Buffer;
+} E1000_RECEIVE_BUFFER, *PE1000_RECEIVE_BUFFER;
+
 
 typedef struct _E1000_ADAPTER
 {
@@ -39,6 +63,11 @@ typedef struct _E1000_ADAPTER
     USHORT SubsystemID;
     USHORT SubsystemVendorID;
 
+    /* Features of this MAC generation */
+    BOOLEAN HasInterruptThrottling;
+    BOOLEAN HasChecksumOffload;
+    BOOLEAN HasLargeRings;
+
     UCHAR PermanentMacAddress[IEEE_802_ADDR_LENGTH];
 
     struct {
@@ -66,6 +95,15 @@ typedef struct _E1000_ADAPTER
 
     LONG InterruptMask;
 
+    /* Interrupt moderation, read from the registry */
+    ULONG InterruptThrottleRate;
+    ULONG RxIntDelay;
+    ULONG RxAbsIntDelay;
+
+    /* Checksum offload */
+    BOOLEAN ChecksumOffloadEnabled;
+    E1000_OFFLOAD Offload;
+
     _Interlocked_
     volatile LONG InterruptPending;
 
@@ -73,23 +111,42 @@ typedef struct _E1000_ADAPTER
     /* Transmit */
     PE1000_TRANSMIT_DESCRIPTOR TransmitDescriptors;
     NDIS_PHYSICAL_ADDRESS TransmitDescriptorsPa;
+    ULONG TxDescCount;
 
-    PNDIS_PACKET TransmitPackets[NUM_TRANSMIT_DESCRIPTORS];
+    /* Indexed by the descriptor holding the end of the packet */
+    PNDIS_PACKET *TransmitPackets;
 
     ULONG CurrentTxDesc;
     ULONG LastTxDesc;
-    BOOLEAN TxFull;
+    ULONG TxFreeDescriptors;
+
+    /* Packets that did not fit in the ring, linked through MiniportReserved */
+    PNDIS_PACKET TxHeldHead;
+    PNDIS_PACKET TxHeldTail;
 
 
     /* Receive */
     PE1000_RECEIVE_DESCRIPTOR ReceiveDescriptors;
     NDIS_PHYSICAL_ADDRESS ReceiveDescriptorsPa;
+    ULONG RxDescCount;
 
     E1000_RCVBUF_SIZE ReceiveBufferType;
     volatile PUCHAR ReceiveBuffer;
     NDIS_PHYSICAL_ADDRESS ReceiveBufferPa;
     ULONG ReceiveBufferEntrySize;
 
+    /* There are more buffers than descriptors, so that a descriptor can be refilled
+     * while the protocol still holds the packet indicated from its previous buffer */
+    ULONG RxBufferCount;
+    PE1000_RECEIVE_BUFFER RxBuffers;
+    NDIS_HANDLE RxPacketPool;
+    NDIS_HANDLE RxBufferPool;
+    PULONG RxDescBuffer;
+
+    NDIS_SPIN_LOCK RxFreeLock;
+    PULONG RxFreeBuffers;
+    ULONG RxFreeBufferCount;
+
 } E1000_ADAPTER, *PE1000_ADAPTER;
 
 
@@ -150,6 +207,16 @@ NICGetPermanentMacAddress(
     IN PE1000_ADAPTER Adapter,
     OUT PUCHAR MacAddress);
 
+VOID
+NTAPI
+NICSendHeldPackets(
+    IN PE1000_ADAPTER Adapter);
+
+VOID
+NTAPI
+NICFailHeldPackets(
+    IN PE1000_ADAPTER Adapter);
+
 NDIS_STATUS
 NTAPI
 NICUpdateMulticastList(
@@ -160,17 +227,28 @@ NTAPI
 NICApplyPacketFilter(
     IN PE1000_ADAPTER Adapter);
 
+VOID
+NTAPI
+NICApplyChecksumOffload(
+    IN PE1000_ADAPTER Adapter);
+
 VOID
 NTAPI
 NICUpdateLinkStatus(
     IN PE1000_ADAPTER Adapter);
 
-NDIS_STATUS
+VOID
+NTAPI
+MiniportSendPackets(
+    _In_ NDIS_HANDLE MiniportAdapterContext,
+    _In_ PPNDIS_PACKET PacketArray,
+    _In_ UINT NumberOfPackets);
+
+VOID
 NTAPI
-MiniportSend(
+MiniportReturnPacket(
     _In_ NDIS_HANDLE MiniportAdapterContext,
-    _In_ PNDIS_PACKET Packet,
-    _In_ UINT Flags);
+    _In_ PNDIS_PACKET Packet);
 
 NDIS_STATUS
 NTAPI
@@ -11,75 +11,240 @@
 #include <debug.h>
 
 static
-NDIS_STATUS
+ULONG
+NICCopyPacketHeaders(
+    _In_ PNDIS_PACKET Packet,
+    _Out_writes_bytes_(MAXIMUM_OFFLOAD_HEADER_SIZE) PUCHAR Headers)
+{
+    PNDIS_BUFFER Buffer;
+    PVOID Data;
+    UINT Length, Copied = 0;
+
+    NdisQueryPacket(Packet, NULL, NULL, &Buffer, NULL);
+
+    while (Buffer && Copied < MAXIMUM_OFFLOAD_HEADER_SIZE)
+    {
+        NdisQueryBufferSafe(Buffer, &Data, &Length, HighPagePriority);
+        if (!Data)
+            break;
+
+        Length = min(Length, MAXIMUM_OFFLOAD_HEADER_SIZE - Copied);
+        NdisMoveMemory(Headers + Copied, Data, Length);
+        Copied += Length;
+
+        NdisGetNextBuffer(Buffer, &Buffer);
+    }
+
+    return Copied;
+}
+
+/* Fill in the legacy descriptor checksum fields. The stack already stored the
+ * pseudo-header checksum in the TCP/UDP header, the MAC sums up the rest. */
+static
+VOID
+NICGetChecksumInfo(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ PNDIS_PACKET Packet,
+    _Out_ PUCHAR ChecksumStart,
+    _Out_ PUCHAR ChecksumOffset)
+{
+    NDIS_TCP_IP_CHECKSUM_PACKET_INFO ChecksumInfo;
+    UCHAR Headers[MAXIMUM_OFFLOAD_HEADER_SIZE];
+    ULONG Length, IpHeaderLength;
+
+    *ChecksumStart = 0;
+    *ChecksumOffset = 0;
+
+    if (!Adapter->Offload.SendTcpChecksum && !Adapter->Offload.SendUdpChecksum)
+        return;
+
+    if (NDIS_GET_PACKET_PROTOCOL_TYPE(Packet) != NDIS_PROTOCOL_ID_TCP_IP)
+        return;
+
+    ChecksumInfo.Value = PtrToUlong(NDIS_PER_PACKET_INFO_FROM_PACKET(Packet, TcpIpChecksumPacketInfo));
+    if (!ChecksumInfo.Transmit.NdisPacketChecksumV4)
+        return;
+
+    Length = NICCopyPacketHeaders(Packet, Headers);
+    if (Length < sizeof(ETH_HEADER) + 20)
+        return;
+
+    IpHeaderLength = (Headers[sizeof(ETH_HEADER)] & 0x0F) * 4;
+
+    if (ChecksumInfo.Transmit.NdisPacketTcpChecksum && Adapter->Offload.SendTcpChecksum)
+    {
+        *ChecksumStart = (UCHAR)(sizeof(ETH_HEADER) + IpHeaderLength);
+        *ChecksumOffset = *ChecksumStart + 16;
+    }
+    else if (ChecksumInfo.Transmit.NdisPacketUdpChecksum && Adapter->Offload.SendUdpChecksum)
+    {
+        *ChecksumStart = (UCHAR)(sizeof(ETH_HEADER) + IpHeaderLength);
+        *ChecksumOffset = *ChecksumStart + 6;
+    }
+}
+
+static
+VOID
 NICTransmitPacket(
     _In_ PE1000_ADAPTER Adapter,
-    _In_ PHYSICAL_ADDRESS PhysicalAddress,
-    _In_ ULONG Length)
+    _In_ PNDIS_PACKET Packet,
+    _In_ PSCATTER_GATHER_LIST SgList)
 {
     volatile PE1000_TRANSMIT_DESCRIPTOR TransmitDescriptor;
+    UCHAR ChecksumStart, ChecksumOffset;
+    UCHAR Command;
+    ULONG n;
 
     NDIS_DbgPrint(MAX_TRACE, ("Called.\n"));
 
-    TransmitDescriptor = Adapter->TransmitDescriptors + Adapter->CurrentTxDesc;
-    TransmitDescriptor->Address = PhysicalAddress.QuadPart;
-    TransmitDescriptor->Length = Length;
-    TransmitDescriptor->ChecksumOffset = 0;
-    TransmitDescriptor->Command = E1000_TDESC_CMD_RS | E1000_TDESC_CMD_IFCS |
-                                  E1000_TDESC_CMD_EOP | E1000_TDESC_CMD_IDE;
-    TransmitDescriptor->Status = 0;
-    TransmitDescriptor->ChecksumStartField = 0;
-    TransmitDescriptor->Special = 0;
+    NICGetChecksumInfo(Adapter, Packet, &ChecksumStart, &ChecksumOffset);
 
-    Adapter->CurrentTxDesc = (Adapter->CurrentTxDesc + 1) % NUM_TRANSMIT_DESCRIPTORS;
+    Command = E1000_TDESC_CMD_RS | E1000_TDESC_CMD_IFCS | E1000_TDESC_CMD_IDE;
+    if (ChecksumOffset)
+        Command |= E1000_TDESC_CMD_IC;
 
-    E1000WriteUlong(Adapter, E1000_REG_TDT, Adapter->CurrentTxDesc);
-
-    if (Adapter->CurrentTxDesc == Adapter->LastTxDesc)
+    /* One descriptor per fragment, the last one closes the packet */
+    for (n = 0; n < SgList->NumberOfElements; ++n)
     {
-        NDIS_DbgPrint(MID_TRACE, ("All TX descriptors are full now\n"));
-        Adapter->TxFull = TRUE;
+        TransmitDescriptor = Adapter->TransmitDescriptors + Adapter->CurrentTxDesc;
+        TransmitDescriptor->Address = SgList->Elements[n].Address.QuadPart;
+        TransmitDescriptor->Length = (USHORT)SgList->Elements[n].Length;
+        TransmitDescriptor->ChecksumOffset = ChecksumOffset;
+        TransmitDescriptor->Command = Command;
+        TransmitDescriptor->Status = 0;
+        TransmitDescriptor->ChecksumStartField = ChecksumStart;
+        TransmitDescriptor->Special = 0;
+
+        if (n == SgList->NumberOfElements - 1)
+        {
+            TransmitDescriptor->Command |= E1000_TDESC_CMD_EOP;
+            Adapter->TransmitPackets[Adapter->CurrentTxDesc] = Packet;
+        }
+
+        Adapter->CurrentTxDesc = (Adapter->CurrentTxDesc + 1) % Adapter->TxDescCount;
     }
 
-    return NDIS_STATUS_SUCCESS;
+    Adapter->TxFreeDescriptors -= SgList->NumberOfElements;
 }
 
-NDIS_STATUS
+#define HELD_PACKET_NEXT(Packet) (*(PNDIS_PACKET*)(Packet)->MiniportReserved)
+
+static
+VOID
+NICHoldPacket(
+    _In_ PE1000_ADAPTER Adapter,
+    _In_ PNDIS_PACKET Packet)
+{
+    HELD_PACKET_NEXT(Packet) = NULL;
+
+    if (Adapter->TxHeldTail)
+        HELD_PACKET_NEXT(Adapter->TxHeldTail) = Packet;
+    else
+        Adapter->TxHeldHead = Packet;
+
+    Adapter->TxHeldTail = Packet;
+}
+
+/* Move held packets to the ring, in order, as long as they fit */
+VOID
 NTAPI
-MiniportSend(
-    _In_ NDIS_HANDLE MiniportAdapterContext,
-    _In_ PNDIS_PACKET Packet,
-    _In_ UINT Flags)
+NICSendHeldPackets(
+    IN PE1000_ADAPTER Adapter)
 {
-    PE1000_ADAPTER Adapter = (PE1000_ADAPTER)MiniportAdapterContext;
-    PSCATTER_GATHER_LIST sgList;
-    ULONG TransmitLength;
-    PHYSICAL_ADDRESS TransmitBuffer;
-    NDIS_STATUS Status;
+    PNDIS_PACKET Packet;
+    PSCATTER_GATHER_LIST SgList;
+    BOOLEAN Queued = FALSE;
+
+    while ((Packet = Adapter->TxHeldHead) != NULL)
+    {
+        SgList = NDIS_PER_PACKET_INFO_FROM_PACKET(Packet, ScatterGatherListPacketInfo);
+        if (SgList->NumberOfElements > Adapter->TxFreeDescriptors)
+            break;
+
+        Adapter->TxHeldHead = HELD_PACKET_NEXT(Packet);
+        if (!Adapter->TxHeldHead)
+            Adapter->TxHeldTail = NULL;
 
-    sgList = NDIS_PER_PACKET_INFO_FROM_PACKET(Packet, ScatterGatherListPacketInfo);
+        NICTransmitPacket(Adapter, Packet, SgList);
+        Queued = TRUE;
+    }
+
+    if (Queued)
+    {
+        E1000WriteUlong(Adapter, E1000_REG_TDT, Adapter->CurrentTxDesc);
+    }
+}
 
-    ASSERT(sgList != NULL);
-    ASSERT(sgList->NumberOfElements == 1);
-    ASSERT((sgList->Elements[0].Address.LowPart & 3) == 0);
-    ASSERT(sgList->Elements[0].Length <= MAXIMUM_FRAME_SIZE);
+VOID
+NTAPI
+NICFailHeldPackets(
+    IN PE1000_ADAPTER Adapter)
+{
+    PNDIS_PACKET Packet;
 
-    if (Adapter->TxFull)
+    while ((Packet = Adapter->TxHeldHead) != NULL)
     {
-        NDIS_DbgPrint(MIN_TRACE, ("All TX descriptors are full\n"));
-        return NDIS_STATUS_RESOURCES;
+        Adapter->TxHeldHead = HELD_PACKET_NEXT(Packet);
+        NdisMSendComplete(Adapter->AdapterHandle, Packet, NDIS_STATUS_FAILURE);
     }
 
-    TransmitLength = sgList->Elements[0].Length;
-    TransmitBuffer = sgList->Elements[0].Address;
-    Adapter->TransmitPackets[Adapter->CurrentTxDesc] = Packet;
+    Adapter->TxHeldTail = NULL;
+}
 
-    Status = NICTransmitPacket(Adapter, TransmitBuffer, TransmitLength);
-    if (Status != NDIS_STATUS_SUCCESS)
+VOID
+NTAPI
+MiniportSendPackets(
+    _In_ NDIS_HANDLE MiniportAdapterContext,
+    _In_ PPNDIS_PACKET PacketArray,
+    _In_ UINT NumberOfPackets)
+{
+    PE1000_ADAPTER Adapter = (PE1000_ADAPTER)MiniportAdapterContext;
+    PSCATTER_GATHER_LIST SgList;
+    UINT i;
+    BOOLEAN Queued = FALSE;
+
+    for (i = 0; i < NumberOfPackets; ++i)
     {
-        NDIS_DbgPrint(MIN_TRACE, ("Transmit packet failed\n"));
-        return Status;
+        PNDIS_PACKET Packet = PacketArray[i];
+
+        SgList = NDIS_PER_PACKET_INFO_FROM_PACKET(Packet, ScatterGatherListPacketInfo);
+
+        ASSERT(SgList != NULL);
+        ASSERT(SgList->NumberOfElements != 0);
+
+        /* A packet that does not fit in the empty ring would block the ones behind it forever */
+        if (SgList->NumberOfElements > Adapter->TxDescCount - 1)
+        {
+            NDIS_DbgPrint(MIN_TRACE, ("Packet has %lu fragments, the ring only takes %lu\n",
+                                      SgList->NumberOfElements, Adapter->TxDescCount - 1));
+            NDIS_SET_PACKET_STATUS(Packet, NDIS_STATUS_FAILURE);
+            continue;
+        }
+
+        /*
+         * NDIS completes packets returned with NDIS_STATUS_RESOURCES from a
+         * serialized SendPackets handler instead of queueing them again, so
+         * keep the ones that do not fit until the transmit interrupt frees
+         * enough descriptors. Once a packet is held, the following ones are
+         * held too to keep the order.
+         */
+        if (Adapter->TxHeldHead || SgList->NumberOfElements > Adapter->TxFreeDescriptors)
+        {
+            NDIS_DbgPrint(MID_TRACE, ("All TX descriptors are full\n"));
+            NICHoldPacket(Adapter, Packet);
+        }
+        else
+        {
+            NICTransmitPacket(Adapter, Packet, SgList);
+            Queued = TRUE;
+        }
+
+        NDIS_SET_PACKET_STATUS(Packet, NDIS_STATUS_PENDING);
     }
 
-    return NDIS_STATUS_PENDING;
+    /* Ring the doorbell once for the whole batch */
+    if (Queued)
+    {
+        E1000WriteUlong(Adapter, E1000_REG_TDT, Adapter->CurrentTxDesc);
+    }
 }
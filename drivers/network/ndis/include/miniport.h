@@ -96,6 +96,14 @@ typedef struct _LOGICAL_ADAPTER
     HARDWARE_ADDRESS            Address;                /* Hardware address of adapter */
     ULONG                       AddressLength;          /* Length of hardware address */
     PMINIPORT_BUGCHECK_CONTEXT  BugcheckContext;        /* Adapter's shutdown handler */
+    ULONG                       ReceiveCopies;          /* Packets copied for legacy Receive handlers */
+    ULONG                       ReceiveCopyBytes;       /* Bytes copied for legacy Receive handlers */
+    ULONG                       ReceivedPackets;        /* Packets indicated by the miniport */
+    ULONG                       SentPackets;            /* Packets completed by the miniport */
+    ULONG                       LastReceivedPackets;    /* ReceivedPackets at the last sample */
+    ULONG                       LastSentPackets;        /* SentPackets at the last sample */
+    ULONG                       ReceivePacketsPerSecond;
+    ULONG                       SendPacketsPerSecond;
 } LOGICAL_ADAPTER, *PLOGICAL_ADAPTER;
 
 #define GET_LOGICAL_ADAPTER(Handle)((PLOGICAL_ADAPTER)Handle)
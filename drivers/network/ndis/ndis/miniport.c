@@ -215,6 +215,8 @@ MiniIndicateData(
           NDIS_DbgPrint(MIN_TRACE, ("WARNING: No upper protocol layer.\n"));
         }
 
+      Adapter->ReceivedPackets++;
+
       while (CurrentEntry != &Adapter->ProtocolListHead)
         {
           AdapterBinding = CONTAINING_RECORD(CurrentEntry, ADAPTER_BINDING, AdapterListEntry);
@@ -311,6 +313,8 @@ MiniIndicateReceivePacket(
 
     KeAcquireSpinLock(&Adapter->NdisMiniportBlock.Lock, &OldIrql);
 
+    Adapter->ReceivedPackets += NumberOfPackets;
+
     CurrentEntry = Adapter->ProtocolListHead.Flink;
 
     while (CurrentEntry != &Adapter->ProtocolListHead)
@@ -322,13 +326,26 @@ MiniIndicateReceivePacket(
             /* Store the indicating miniport in the packet */
             PacketArray[i]->Reserved[1] = (ULONG_PTR)Adapter;
 
-            if (AdapterBinding->ProtocolBinding->Chars.ReceivePacketHandler &&
-                NDIS_GET_PACKET_STATUS(PacketArray[i]) != NDIS_STATUS_RESOURCES)
+            if (AdapterBinding->ProtocolBinding->Chars.ReceivePacketHandler)
             {
+                INT References;
+
                 NDIS_DbgPrint(MID_TRACE, ("Indicating packet to protocol's ReceivePacket handler\n"));
-                PacketArray[i]->WrapperReserved[0] += (*AdapterBinding->ProtocolBinding->Chars.ReceivePacketHandler)(
-                                                       AdapterBinding->NdisOpenBlock.ProtocolBindingContext,
-                                                       PacketArray[i]);
+                References = (*AdapterBinding->ProtocolBinding->Chars.ReceivePacketHandler)(
+                                  AdapterBinding->NdisOpenBlock.ProtocolBindingContext,
+                                  PacketArray[i]);
+
+                /* With NDIS_STATUS_RESOURCES the protocol has to copy what it needs,
+                 * it can't keep the packet. This still saves us the lookahead copy. */
+                if (NDIS_GET_PACKET_STATUS(PacketArray[i]) != NDIS_STATUS_RESOURCES)
+                {
+                    PacketArray[i]->WrapperReserved[0] += References;
+                }
+                else
+                {
+                    ASSERT(References == 0);
+                }
+
                 NDIS_DbgPrint(MID_TRACE, ("Protocol is holding %d references to the packet\n", PacketArray[i]->WrapperReserved[0]));
             }
             else
@@ -360,6 +377,9 @@ MiniIndicateReceivePacket(
                                         HeaderSize,
                                         LookAheadSize);
 
+                Adapter->ReceiveCopies++;
+                Adapter->ReceiveCopyBytes += LookAheadSize;
+
                 NDIS_DbgPrint(MID_TRACE, ("Indicating packet to protocol's legacy Receive handler\n"));
                 (*AdapterBinding->ProtocolBinding->Chars.ReceiveHandler)(
                      AdapterBinding->NdisOpenBlock.ProtocolBindingContext,
@@ -551,6 +571,8 @@ MiniSendComplete(
 
     KeRaiseIrql(DISPATCH_LEVEL, &OldIrql);
 
+    InterlockedIncrement((PLONG)&Adapter->SentPackets);
+
     if (Adapter->NdisMiniportBlock.ScatterGatherListSize != 0)
     {
         NDIS_DbgPrint(MAX_TRACE, ("Freeing Scatter/Gather list\n"));
@@ -953,6 +975,24 @@ MiniportHangDpc(
         PVOID SystemArgument2)
 {
   PLOGICAL_ADAPTER Adapter = DeferredContext;
+  ULONG ReceivedPackets, SentPackets;
+
+  /* Sample the packet rates, this runs every CheckForHangSeconds */
+  ReceivedPackets = Adapter->ReceivedPackets;
+  SentPackets = Adapter->SentPackets;
+  Adapter->ReceivePacketsPerSecond = (ReceivedPackets - Adapter->LastReceivedPackets) /
+                                     Adapter->NdisMiniportBlock.CheckForHangSeconds;
+  Adapter->SendPacketsPerSecond = (SentPackets - Adapter->LastSentPackets) /
+                                  Adapter->NdisMiniportBlock.CheckForHangSeconds;
+  Adapter->LastReceivedPackets = ReceivedPackets;
+  Adapter->LastSentPackets = SentPackets;
+
+  NDIS_DbgPrint(MID_TRACE, ("%wZ: %lu packets/s received, %lu packets/s sent\n",
+                            &Adapter->NdisMiniportBlock.MiniportName,
+                            Adapter->ReceivePacketsPerSecond, Adapter->SendPacketsPerSecond));
+  NDIS_DbgPrint(MID_TRACE, ("%wZ: %lu packets (%lu bytes) copied for legacy Receive handlers\n",
+                            &Adapter->NdisMiniportBlock.MiniportName,
+                            Adapter->ReceiveCopies, Adapter->ReceiveCopyBytes));
 
   if (MiniCheckForHang(Adapter)) {
       NDIS_DbgPrint(MIN_TRACE, ("Miniport detected adapter hang\n"));
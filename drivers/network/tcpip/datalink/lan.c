@@ -26,6 +26,7 @@ typedef struct _LAN_WQ_ITEM {
     PLAN_ADAPTER Adapter;
     UINT BytesTransferred;
     BOOLEAN LegacyReceive;
+    BOOLEAN ReturnPacket;
 } LAN_WQ_ITEM, *PLAN_WQ_ITEM;
 
 typedef struct _RECONFIGURE_CONTEXT {
@@ -168,6 +169,37 @@ GetPacketTypeFromNdisPacket(PLAN_ADAPTER Adapter,
 }
 
 
+static VOID LanStopReceiveQueues(
+    PLAN_ADAPTER Adapter)
+/*
+ * FUNCTION: Stops accepting receive work and waits until all receive
+ *           queues of an adapter are drained
+ * ARGUMENTS:
+ *     Adapter = Pointer to LAN_ADAPTER structure
+ */
+{
+    KIRQL OldIrql;
+    ULONG i;
+
+    /* Once every queue lock has been taken with the flag set, any work
+     * submitted before it already accounts for a queued worker */
+    Adapter->ReceiveStopped = TRUE;
+    for (i = 0; i < Adapter->ReceiveQueueCount; i++) {
+        TcpipAcquireSpinLock(&Adapter->ReceiveQueues[i].Lock, &OldIrql);
+        TcpipReleaseSpinLock(&Adapter->ReceiveQueues[i].Lock, OldIrql);
+    }
+
+    KeWaitForSingleObject(&Adapter->ReceiveIdleEvent, Executive, KernelMode, FALSE, NULL);
+
+    /* The last worker signals the event with its queue lock held,
+     * make sure it let go of it before the adapter is freed */
+    for (i = 0; i < Adapter->ReceiveQueueCount; i++) {
+        TcpipAcquireSpinLock(&Adapter->ReceiveQueues[i].Lock, &OldIrql);
+        ASSERT(!Adapter->ReceiveQueues[i].WorkerQueued);
+        TcpipReleaseSpinLock(&Adapter->ReceiveQueues[i].Lock, OldIrql);
+    }
+}
+
 VOID FreeAdapter(
     PLAN_ADAPTER Adapter)
 /*
@@ -304,14 +336,14 @@ VOID NTAPI ProtocolSendComplete(
     FreeNdisPacket(Packet);
 }
 
-VOID LanReceiveWorker( PVOID Context ) {
+static VOID LanProcessReceive( PLAN_WQ_ITEM WorkItem ) {
     ULONG PacketType;
-    PLAN_WQ_ITEM WorkItem = (PLAN_WQ_ITEM)Context;
     PNDIS_PACKET Packet;
     PLAN_ADAPTER Adapter;
     UINT BytesTransferred;
     IP_PACKET IPPacket;
     BOOLEAN LegacyReceive;
+    BOOLEAN ReturnPacket;
     PIP_INTERFACE Interface;
 
     TI_DbgPrint(DEBUG_DATALINK, ("Called.\n"));
@@ -320,6 +352,7 @@ VOID LanReceiveWorker( PVOID Context ) {
     Adapter = WorkItem->Adapter;
     BytesTransferred = WorkItem->BytesTransferred;
     LegacyReceive = WorkItem->LegacyReceive;
+    ReturnPacket = WorkItem->ReturnPacket;
 
     ExFreePoolWithTag(WorkItem, WQ_CONTEXT_TAG);
 
@@ -328,7 +361,7 @@ VOID LanReceiveWorker( PVOID Context ) {
     IPInitializePacket(&IPPacket, 0);
 
     IPPacket.NdisPacket = Packet;
-    IPPacket.ReturnPacket = !LegacyReceive;
+    IPPacket.ReturnPacket = ReturnPacket;
 
     if (LegacyReceive)
     {
@@ -385,26 +418,157 @@ VOID LanReceiveWorker( PVOID Context ) {
     }
 }
 
-VOID LanSubmitReceiveWork(
+VOID LanReceiveWorker( PVOID Context ) {
+    PLAN_RECEIVE_QUEUE Queue = Context;
+    PLAN_WQ_ITEM WorkItem;
+    LIST_ENTRY Batch;
+    KIRQL OldIrql;
+    ULONG Count;
+
+    TI_DbgPrint(DEBUG_DATALINK, ("Called.\n"));
+
+    for (;;) {
+        InitializeListHead(&Batch);
+
+        /* Take a batch of packets off the queue */
+        TcpipAcquireSpinLock(&Queue->Lock, &OldIrql);
+        for (Count = 0; Count < LAN_RECEIVE_BATCH && !IsListEmpty(&Queue->ListHead); Count++)
+            InsertTailList(&Batch, RemoveHeadList(&Queue->ListHead));
+
+        if (Count == 0) {
+            /* The queue is drained. Don't touch it after this, the
+             * adapter may go away as soon as the lock is released */
+            Queue->WorkerQueued = FALSE;
+
+            TcpipAcquireSpinLockAtDpcLevel(&Queue->Adapter->ReceiveIdleLock);
+            if (--Queue->Adapter->ActiveReceiveQueues == 0)
+                KeSetEvent(&Queue->Adapter->ReceiveIdleEvent, IO_NETWORK_INCREMENT, FALSE);
+            TcpipReleaseSpinLockFromDpcLevel(&Queue->Adapter->ReceiveIdleLock);
+
+            TcpipReleaseSpinLock(&Queue->Lock, OldIrql);
+            return;
+        }
+        TcpipReleaseSpinLock(&Queue->Lock, OldIrql);
+
+        while (!IsListEmpty(&Batch)) {
+            WorkItem = CONTAINING_RECORD(RemoveHeadList(&Batch), LAN_WQ_ITEM, ListEntry);
+            LanProcessReceive(WorkItem);
+        }
+    }
+}
+
+static ULONG LanGetReceiveQueue(
+    PLAN_ADAPTER Adapter,
+    PNDIS_PACKET Packet,
+    BOOLEAN LegacyReceive)
+/*
+ * FUNCTION: Picks the receive queue for a packet
+ * ARGUMENTS:
+ *     Adapter       = Pointer to a LAN_ADAPTER structure
+ *     Packet        = Pointer to the received packet
+ *     LegacyReceive = Whether the packet lacks the media header
+ * RETURNS:
+ *     Index of the receive queue
+ * NOTES:
+ *     All packets of a flow go to the same queue, so they are handed up
+ *     in order. Fragments only hash on the addresses, like the rest of
+ *     the datagram, and everything that isn't IPv4 goes to the first queue
+ */
+{
+    PUCHAR Data = NULL;
+    UINT Size = 0, Offset, HeaderSize;
+    ULONG PacketType, Hash, Ports;
+    PIPv4_HEADER IPv4Header;
+
+    if (Adapter->ReceiveQueueCount == 1)
+        return 0;
+
+    GetDataPtr(Packet, 0, (PCHAR *)&Data, &Size);
+    if (!Data)
+        return 0;
+
+    if (LegacyReceive) {
+        PacketType = PC(Packet)->PacketType;
+        Offset = 0;
+    } else {
+        if (GetPacketTypeFromHeaderBuffer(Adapter, Data, Size, &PacketType) != NDIS_STATUS_SUCCESS)
+            return 0;
+        Offset = Adapter->HeaderSize;
+    }
+
+    if (PacketType != ETYPE_IPv4 || Size < Offset + sizeof(IPv4_HEADER))
+        return 0;
+
+    IPv4Header = (PIPv4_HEADER)(Data + Offset);
+    Hash = IPv4Header->SrcAddr ^ IPv4Header->DstAddr;
+
+    HeaderSize = (IPv4Header->VerIHL & 0x0F) << 2;
+    if (!(WN2H(IPv4Header->FlagsFragOfs) & (IPv4_FRAGOFS_MASK | IPv4_MF_MASK)) &&
+        (IPv4Header->Protocol == IPPROTO_TCP || IPv4Header->Protocol == IPPROTO_UDP) &&
+        Size >= Offset + HeaderSize + sizeof(Ports)) {
+        /* Source and destination ports */
+        RtlCopyMemory(&Ports, Data + Offset + HeaderSize, sizeof(Ports));
+        Hash ^= Ports;
+    }
+
+    Hash ^= Hash >> 16;
+    Hash ^= Hash >> 8;
+
+    return Hash % Adapter->ReceiveQueueCount;
+}
+
+BOOLEAN LanSubmitReceiveWork(
     NDIS_HANDLE BindingContext,
     PNDIS_PACKET Packet,
     UINT BytesTransferred,
-    BOOLEAN LegacyReceive) {
+    BOOLEAN LegacyReceive,
+    BOOLEAN ReturnPacket) {
     PLAN_WQ_ITEM WQItem = ExAllocatePoolWithTag(NonPagedPool, sizeof(LAN_WQ_ITEM),
                                                 WQ_CONTEXT_TAG);
     PLAN_ADAPTER Adapter = (PLAN_ADAPTER)BindingContext;
+    PLAN_RECEIVE_QUEUE Queue;
+    KIRQL OldIrql;
 
     TI_DbgPrint(DEBUG_DATALINK,("called\n"));
 
-    if (!WQItem) return;
+    if (!WQItem) return FALSE;
 
     WQItem->Packet = Packet;
     WQItem->Adapter = Adapter;
     WQItem->BytesTransferred = BytesTransferred;
     WQItem->LegacyReceive = LegacyReceive;
+    WQItem->ReturnPacket = ReturnPacket;
+
+    Queue = &Adapter->ReceiveQueues[LanGetReceiveQueue(Adapter, Packet, LegacyReceive)];
+
+    TcpipAcquireSpinLock(&Queue->Lock, &OldIrql);
 
-    if (!ChewCreate( LanReceiveWorker, WQItem ))
+    if (Adapter->ReceiveStopped) {
+        TcpipReleaseSpinLock(&Queue->Lock, OldIrql);
         ExFreePoolWithTag(WQItem, WQ_CONTEXT_TAG);
+        return FALSE;
+    }
+
+    /* Only start a worker if the queue was idle, a running one picks it up */
+    if (!Queue->WorkerQueued) {
+        if (!ChewCreate( LanReceiveWorker, Queue )) {
+            TcpipReleaseSpinLock(&Queue->Lock, OldIrql);
+            ExFreePoolWithTag(WQItem, WQ_CONTEXT_TAG);
+            return FALSE;
+        }
+        Queue->WorkerQueued = TRUE;
+
+        TcpipAcquireSpinLockAtDpcLevel(&Adapter->ReceiveIdleLock);
+        if (Adapter->ActiveReceiveQueues++ == 0)
+            KeClearEvent(&Adapter->ReceiveIdleEvent);
+        TcpipReleaseSpinLockFromDpcLevel(&Adapter->ReceiveIdleLock);
+    }
+
+    InsertTailList(&Queue->ListHead, &WQItem->ListEntry);
+
+    TcpipReleaseSpinLock(&Queue->Lock, OldIrql);
+
+    return TRUE;
 }
 
 VOID NTAPI ProtocolTransferDataComplete(
@@ -431,32 +595,77 @@ VOID NTAPI ProtocolTransferDataComplete(
     TransferDataCompleteCalled++;
     ASSERT(TransferDataCompleteCalled <= TransferDataCalled);
 
-    if( Status != NDIS_STATUS_SUCCESS ) return;
+    if( Status != NDIS_STATUS_SUCCESS ) {
+        FreeNdisPacket(Packet);
+        return;
+    }
 
-    LanSubmitReceiveWork(BindingContext,
-                         Packet,
-                         BytesTransferred,
-                         TRUE);
+    if (!LanSubmitReceiveWork(BindingContext,
+                              Packet,
+                              BytesTransferred,
+                              TRUE,
+                              FALSE))
+        FreeNdisPacket(Packet);
 }
 
 INT NTAPI ProtocolReceivePacket(
     NDIS_HANDLE BindingContext,
     PNDIS_PACKET NdisPacket)
+/*
+ * FUNCTION: Called by NDIS when a miniport indicates a full packet
+ * ARGUMENTS:
+ *     BindingContext = Pointer to a device context (LAN_ADAPTER)
+ *     NdisPacket     = Pointer to the indicated packet
+ * RETURNS:
+ *     Number of references held on the packet
+ * NOTES:
+ *     The packet is kept and handed up the stack as is, unless the miniport
+ *     is short on resources and needs it back right away
+ */
 {
     PLAN_ADAPTER Adapter = BindingContext;
+    PNDIS_PACKET CopyPacket;
+    PCHAR CopyData;
+    UINT PacketLength, BufferLength;
+    NDIS_STATUS NdisStatus;
 
     if (Adapter->State != LAN_STATE_STARTED) {
         TI_DbgPrint(DEBUG_DATALINK, ("Adapter is stopped.\n"));
         return 0;
     }
 
-    LanSubmitReceiveWork(BindingContext,
-                         NdisPacket,
-                         0, /* Unused */
-                         FALSE);
+    if (NDIS_GET_PACKET_STATUS(NdisPacket) != NDIS_STATUS_RESOURCES) {
+        if (!LanSubmitReceiveWork(BindingContext,
+                                  NdisPacket,
+                                  0, /* Unused */
+                                  FALSE,
+                                  TRUE))
+            return 0;
+
+        /* Hold 1 reference on this packet */
+        return 1;
+    }
+
+    /* The miniport wants this packet back, so take a private copy */
+    NdisQueryPacketLength(NdisPacket, &PacketLength);
 
-    /* Hold 1 reference on this packet */
-    return 1;
+    NdisStatus = AllocatePacketWithBuffer(&CopyPacket, NULL, PacketLength);
+    if (NdisStatus != NDIS_STATUS_SUCCESS)
+        return 0;
+
+    GetDataPtr(CopyPacket, 0, &CopyData, &BufferLength);
+    CopyPacketToBuffer(CopyData, NdisPacket, 0, PacketLength);
+
+    RECEIVE_COPY_STAT(Datalink, PacketLength);
+
+    if (!LanSubmitReceiveWork(BindingContext,
+                              CopyPacket,
+                              0, /* Unused */
+                              FALSE,
+                              FALSE))
+        FreeNdisPacket(CopyPacket);
+
+    return 0;
 }
 
 NDIS_STATUS NTAPI ProtocolReceive(
@@ -525,6 +734,8 @@ NDIS_STATUS NTAPI ProtocolReceive(
 
     TransferDataCalled++;
 
+    RECEIVE_COPY_STAT(Datalink, PacketSize);
+
     if (LookaheadBufferSize == PacketSize)
     {
         /* Optimized code path for packets that are fully contained in
@@ -1449,6 +1660,7 @@ NDIS_STATUS LANRegisterAdapter(
     NDIS_STATUS NdisStatus;
     NDIS_STATUS OpenStatus;
     UINT MediaIndex;
+    ULONG i;
     NDIS_MEDIUM MediaArray[MAX_MEDIA];
     UINT AddressOID;
 
@@ -1468,6 +1680,16 @@ NDIS_STATUS LANRegisterAdapter(
     /* Initialize protecting spin lock */
     KeInitializeSpinLock(&IF->Lock);
 
+    /* One receive queue per processor */
+    IF->ReceiveQueueCount = min(KeNumberProcessors, LAN_MAX_RECEIVE_QUEUES);
+    for (i = 0; i < IF->ReceiveQueueCount; i++) {
+        KeInitializeSpinLock(&IF->ReceiveQueues[i].Lock);
+        InitializeListHead(&IF->ReceiveQueues[i].ListHead);
+        IF->ReceiveQueues[i].Adapter = IF;
+    }
+    KeInitializeSpinLock(&IF->ReceiveIdleLock);
+    KeInitializeEvent(&IF->ReceiveIdleEvent, NotificationEvent, TRUE);
+
     KeInitializeEvent(&IF->Event, SynchronizationEvent, FALSE);
 
     /* Initialize array with media IDs we support */
@@ -1581,6 +1803,9 @@ NDIS_STATUS LANUnregisterAdapter(
     /* Unlink the adapter from the list */
     RemoveEntryList(&Adapter->ListEntry);
 
+    /* Let the receive workers finish with the interface before it goes */
+    LanStopReceiveQueues(Adapter);
+
     /* Unbind adapter from IP layer */
     UnbindAdapter(Adapter);
 
@@ -35,6 +35,22 @@ typedef struct ETH_HEADER {
 /* Max packets queued for a single adapter */
 #define IP_MAX_RECV_BACKLOG 0x20
 
+/* Max receive queues per adapter, received flows are spread over them */
+#define LAN_MAX_RECEIVE_QUEUES 8
+
+/* Max packets a receive worker takes off its queue at once */
+#define LAN_RECEIVE_BATCH 32
+
+struct LAN_ADAPTER;
+
+/* Receive queue, drained by one worker at a time to keep flows in order */
+typedef struct LAN_RECEIVE_QUEUE {
+    KSPIN_LOCK Lock;                        /* Lock for this structure */
+    LIST_ENTRY ListHead;                    /* Received packets (LAN_WQ_ITEM) */
+    BOOLEAN WorkerQueued;                   /* A worker is draining the queue */
+    struct LAN_ADAPTER *Adapter;            /* Adapter owning this queue */
+} LAN_RECEIVE_QUEUE, *PLAN_RECEIVE_QUEUE;
+
 /* Per adapter information */
 typedef struct LAN_ADAPTER {
     LIST_ENTRY ListEntry;                   /* Entry on list */
@@ -59,6 +75,12 @@ typedef struct LAN_ADAPTER {
     UINT MacOptions;                        /* MAC options for NIC driver/adapter */
     UINT Speed;                             /* Link speed */
     UINT PacketFilter;                      /* Packet filter for this adapter */
+    ULONG ReceiveQueueCount;                /* Number of receive queues in use */
+    KSPIN_LOCK ReceiveIdleLock;             /* Protects ActiveReceiveQueues and ReceiveIdleEvent */
+    ULONG ActiveReceiveQueues;              /* Receive queues with a worker queued */
+    KEVENT ReceiveIdleEvent;                /* Signaled when no receive worker is queued */
+    BOOLEAN ReceiveStopped;                 /* No more receive work is accepted */
+    LAN_RECEIVE_QUEUE ReceiveQueues[LAN_MAX_RECEIVE_QUEUES];
 } LAN_ADAPTER, *PLAN_ADAPTER;
 
 /* LAN adapter state constants */
@@ -45,6 +45,26 @@ typedef struct IPDATAGRAM_REASSEMBLY {
     UINT TimeoutCount;           /* Timeout counter */
 } IPDATAGRAM_REASSEMBLY, *PIPDATAGRAM_REASSEMBLY;
 
+/* Receive path copy statistics, one pair of counters per layer */
+typedef struct _RECEIVE_COPY_STATS {
+    ULONG DatalinkCopies;     /* Frames copied out of miniport owned packets */
+    ULONG DatalinkCopyBytes;
+    ULONG NetworkCopies;      /* Datagrams copied to make them contiguous */
+    ULONG NetworkCopyBytes;
+    ULONG TransportCopies;    /* Segments copied into lwIP pbufs */
+    ULONG TransportCopyBytes;
+    ULONG UserCopies;         /* Copies into the receive request buffer */
+    ULONG UserCopyBytes;
+    ULONG ZeroCopySegments;   /* Segments handed to lwIP in place */
+} RECEIVE_COPY_STATS, *PRECEIVE_COPY_STATS;
+
+#define RECEIVE_COPY_STAT(Layer, Bytes) \
+    do { \
+        InterlockedIncrement((PLONG)&ReceiveCopyStats.Layer##Copies); \
+        InterlockedExchangeAdd((PLONG)&ReceiveCopyStats.Layer##CopyBytes, (LONG)(Bytes)); \
+    } while (0)
+
+extern RECEIVE_COPY_STATS ReceiveCopyStats;
 
 extern LIST_ENTRY ReassemblyListHead;
 extern KSPIN_LOCK ReassemblyListLock;
@@ -59,6 +79,9 @@ VOID IPFreeReassemblyList(
 VOID IPDatagramReassemblyTimeout(
     VOID);
 
+VOID LogReceiveCopyStats(
+    VOID);
+
 VOID IPReceive(
     PIP_INTERFACE IF,
     PIP_PACKET IPPacket);
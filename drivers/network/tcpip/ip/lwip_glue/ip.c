@@ -25,10 +25,40 @@ LibIPInsertPacket(void *ifarg,
 
         RtlCopyMemory(p->payload, data, p->len);
 
-        ((PNETIF)ifarg)->input(p, (PNETIF)ifarg);
+        RECEIVE_COPY_STAT(Transport, size);
+
+        if (((PNETIF)ifarg)->input(p, (PNETIF)ifarg) != ERR_OK)
+            pbuf_free(p);
     }
 }
 
+BOOLEAN
+LibIPInsertNdisPacket(void *ifarg,
+                      PNDIS_PACKET NdisPacket,
+                      BOOLEAN ReturnPacket,
+                      void *data,
+                      const u32_t size)
+{
+    struct pbuf *p;
+
+    ASSERT(ifarg);
+    ASSERT(NdisPacket);
+    ASSERT(data);
+    ASSERT(size > 0);
+
+    /* lwIP takes over the NDIS packet, it goes back to its owner with the pbuf */
+    p = LibIPAllocNdisPbuf(NdisPacket, ReturnPacket, (void *)data, (u16_t)size);
+    if (!p)
+        return FALSE;
+
+    InterlockedIncrement((PLONG)&ReceiveCopyStats.ZeroCopySegments);
+
+    if (((PNETIF)ifarg)->input(p, (PNETIF)ifarg) != ERR_OK)
+        pbuf_free(p);
+
+    return TRUE;
+}
+
 void
 LibIPInitialize(void)
 {
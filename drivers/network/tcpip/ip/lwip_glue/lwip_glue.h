@@ -10,6 +10,7 @@
     #define LWIP_TAG         'PIwl'
     #define LWIP_MESSAGE_TAG 'sMwl'
     #define LWIP_QUEUE_TAG   'uQwl'
+    #define LWIP_PBUF_TAG    'bPwl'
 #endif
 
 typedef struct tcp_pcb* PTCP_PCB;
@@ -118,6 +119,8 @@ void        LibTCPGetSocketStatus(PTCP_PCB pcb, PULONG State);
 
 /* IP functions */
 void LibIPInsertPacket(void *ifarg, const void *const data, const u32_t size);
+BOOLEAN LibIPInsertNdisPacket(void *ifarg, PNDIS_PACKET NdisPacket, BOOLEAN ReturnPacket, void *data, const u32_t size);
+struct pbuf *LibIPAllocNdisPbuf(PNDIS_PACKET NdisPacket, BOOLEAN ReturnPacket, void *data, u16_t size);
 void LibIPInitialize(void);
 void LibIPShutdown(void);
 
@@ -1,5 +1,7 @@
 #include <lwip/mem.h>
 
+#include "lwip_glue.h"
+
 #ifndef LWIP_TAG
     #define LWIP_TAG 'PIwl'
 #endif
@@ -61,3 +63,72 @@ realloc(void *mem, size_t size)
     /* Return the newly allocated block */
     return new_mem;
 }
+
+/* Miniport packets lwIP may hold at once. TCP keeps pbufs in its receive
+ * and out of order queues until the application reads them, and miniports
+ * don't always switch to NDIS_STATUS_RESOURCES when they run out of receive
+ * buffers, so past this we copy the data instead of loaning the packet.
+ * This is counted for all adapters together since pbufs can outlive the
+ * interface that received them. */
+#define MAX_LOANED_NDIS_PACKETS 32
+
+static LONG LoanedNdisPackets;
+
+/* A pbuf that describes data in place in an NDIS packet. The packet
+ * is given back when lwIP releases the pbuf. */
+typedef struct _NDIS_PBUF
+{
+    struct pbuf_custom Custom;
+    PNDIS_PACKET NdisPacket;
+    BOOLEAN ReturnPacket;
+} NDIS_PBUF, *PNDIS_PBUF;
+
+static
+void
+LibIPFreeNdisPbuf(struct pbuf *p)
+{
+    PNDIS_PBUF NdisPbuf = (PNDIS_PBUF)p;
+
+    if (NdisPbuf->ReturnPacket)
+    {
+        NdisReturnPackets(&NdisPbuf->NdisPacket, 1);
+        InterlockedDecrement(&LoanedNdisPackets);
+    }
+    else
+        FreeNdisPacket(NdisPbuf->NdisPacket);
+
+    ExFreePoolWithTag(NdisPbuf, LWIP_PBUF_TAG);
+}
+
+struct pbuf *
+LibIPAllocNdisPbuf(PNDIS_PACKET NdisPacket,
+                   BOOLEAN ReturnPacket,
+                   void *data,
+                   u16_t size)
+{
+    PNDIS_PBUF NdisPbuf;
+    struct pbuf *p;
+
+    if (ReturnPacket && InterlockedIncrement(&LoanedNdisPackets) > MAX_LOANED_NDIS_PACKETS)
+    {
+        InterlockedDecrement(&LoanedNdisPackets);
+        return NULL;
+    }
+
+    NdisPbuf = ExAllocatePoolWithTag(NonPagedPool, sizeof(*NdisPbuf), LWIP_PBUF_TAG);
+    if (!NdisPbuf)
+    {
+        if (ReturnPacket)
+            InterlockedDecrement(&LoanedNdisPackets);
+        return NULL;
+    }
+
+    NdisPbuf->NdisPacket = NdisPacket;
+    NdisPbuf->ReturnPacket = ReturnPacket;
+    NdisPbuf->Custom.custom_free_function = LibIPFreeNdisPbuf;
+
+    p = pbuf_alloced_custom(PBUF_RAW, size, PBUF_REF, &NdisPbuf->Custom, data, size);
+    ASSERT(p);
+
+    return p;
+}
@@ -133,6 +133,8 @@ NTSTATUS LibTCPGetDataFromConnectionQueue(PCONNECTION_ENDPOINT Connection, PUCHA
             Copied = pbuf_copy_partial(p, RecvBuffer, ReadLength, Offset);
             ASSERT(Copied == ReadLength);
 
+            RECEIVE_COPY_STAT(User, Copied);
+
             /* Update trackers */
             RecvLen -= ReadLength;
             RecvBuffer += ReadLength;
@@ -129,6 +129,7 @@ VOID NTAPI IPTimeoutDpcFn(PKDPC Dpc,
     if ((IpTimerExpirations % 10) == 0)
     {
         LogActiveObjects();
+        LogReceiveCopyStats();
     }
 
     /* Check if datagram fragments have taken too long to assemble */
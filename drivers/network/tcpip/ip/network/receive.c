@@ -17,6 +17,7 @@ KSPIN_LOCK ReassemblyListLock;
 NPAGED_LOOKASIDE_LIST IPDRList;
 NPAGED_LOOKASIDE_LIST IPFragmentList;
 NPAGED_LOOKASIDE_LIST IPHoleList;
+RECEIVE_COPY_STATS ReceiveCopyStats;
 
 PIPDATAGRAM_HOLE CreateHoleDescriptor(
   ULONG First,
@@ -240,6 +241,8 @@ ReassembleDatagram(
                        Fragment->PacketOffset,
                        Fragment->Size);
 
+    RECEIVE_COPY_STAT(Network, Fragment->Size);
+
     CurrentEntry = CurrentEntry->Flink;
   }
 
@@ -552,6 +555,97 @@ VOID IPDatagramReassemblyTimeout(
     TcpipReleaseSpinLockFromDpcLevel(&ReassemblyListLock);
 }
 
+
+VOID LogReceiveCopyStats(
+  VOID)
+/*
+ * FUNCTION: Prints the receive path copy statistics
+ * NOTES:
+ *     This routine is called by IPTimeout every few seconds
+ */
+{
+    TI_DbgPrint(DEBUG_IP, ("Receive copies: datalink %lu (%lu bytes), network %lu (%lu bytes), "
+                           "transport %lu (%lu bytes), user %lu (%lu bytes), in place %lu\n",
+                           ReceiveCopyStats.DatalinkCopies, ReceiveCopyStats.DatalinkCopyBytes,
+                           ReceiveCopyStats.NetworkCopies, ReceiveCopyStats.NetworkCopyBytes,
+                           ReceiveCopyStats.TransportCopies, ReceiveCopyStats.TransportCopyBytes,
+                           ReceiveCopyStats.UserCopies, ReceiveCopyStats.UserCopyBytes,
+                           ReceiveCopyStats.ZeroCopySegments));
+}
+
+static VOID IPv4ReceiveDatagram(
+  PIP_INTERFACE IF,
+  PIP_PACKET IPPacket)
+/*
+ * FUNCTION: Passes an unfragmented IPv4 datagram to the upper layer protocol
+ * ARGUMENTS:
+ *     IF       = Interface
+ *     IPPacket = Pointer to IP packet
+ * NOTES:
+ *     If the datagram is contiguous in the NDIS packet it is passed up in
+ *     place, together with the ownership of the NDIS packet. Otherwise it
+ *     is copied into a pool buffer, like a reassembled datagram
+ */
+{
+  IP_PACKET Datagram;
+  PCHAR Data = NULL;
+  UINT Size = 0, PacketLength;
+
+  NdisQueryPacketLength(IPPacket->NdisPacket, &PacketLength);
+  if (IPPacket->TotalSize < IPPacket->HeaderSize ||
+      IPPacket->Position + IPPacket->TotalSize > PacketLength) {
+    TI_DbgPrint(MIN_TRACE, ("Datagram received with bad total length (%d).\n",
+      IPPacket->TotalSize));
+    return;
+  }
+
+  /* FIXME: Assumes IPv4 */
+  IPInitializePacket(&Datagram, IP_ADDRESS_V4);
+
+  Datagram.TotalSize  = IPPacket->TotalSize;
+  Datagram.HeaderSize = IPPacket->HeaderSize;
+  RtlCopyMemory(&Datagram.SrcAddr, &IPPacket->SrcAddr, sizeof(IP_ADDRESS));
+  RtlCopyMemory(&Datagram.DstAddr, &IPPacket->DstAddr, sizeof(IP_ADDRESS));
+
+  GetDataPtr(IPPacket->NdisPacket, IPPacket->Position, &Data, &Size);
+
+  if (Data && Size >= IPPacket->TotalSize) {
+    Datagram.Header       = Data;
+    Datagram.MappedHeader = TRUE;
+
+    /* The datagram takes over the NDIS packet, so the transport
+       protocol can keep it as long as it needs the data */
+    Datagram.NdisPacket   = IPPacket->NdisPacket;
+    Datagram.ReturnPacket = IPPacket->ReturnPacket;
+    IPPacket->NdisPacket  = NULL;
+  } else {
+    Datagram.Header = ExAllocatePoolWithTag(NonPagedPool, Datagram.TotalSize, PACKET_BUFFER_TAG);
+    if (!Datagram.Header) {
+      TI_DbgPrint(MIN_TRACE, ("Insufficient resources.\n"));
+      Datagram.Free(&Datagram);
+      return;
+    }
+    Datagram.MappedHeader = FALSE;
+
+    CopyPacketToBuffer(Datagram.Header,
+                       IPPacket->NdisPacket,
+                       IPPacket->Position,
+                       Datagram.TotalSize);
+
+    RECEIVE_COPY_STAT(Network, Datagram.TotalSize);
+  }
+
+  Datagram.Data = (PCHAR)Datagram.Header + Datagram.HeaderSize;
+
+  DISPLAY_IP_PACKET(&Datagram);
+
+  /* Give the packet to the protocol dispatcher */
+  IPDispatchProtocol(IF, &Datagram);
+
+  Datagram.Free(&Datagram);
+}
+
+
 VOID IPv4Receive(PIP_INTERFACE IF, PIP_PACKET IPPacket)
 /*
  * FUNCTION: Receives an IPv4 datagram (or fragment)
@@ -631,7 +725,10 @@ VOID IPv4Receive(PIP_INTERFACE IF, PIP_PACKET IPPacket)
 
     /* FIXME: Should we allow packets to be received on the wrong interface? */
     /* XXX Find out if this packet is destined for us */
-    ProcessFragment(IF, IPPacket);
+    if (WN2H(((PIPv4_HEADER)IPPacket->Header)->FlagsFragOfs) & (IPv4_FRAGOFS_MASK | IPv4_MF_MASK))
+        ProcessFragment(IF, IPPacket);
+    else
+        IPv4ReceiveDatagram(IF, IPPacket);
 }
 
 
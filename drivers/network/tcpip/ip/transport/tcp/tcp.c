@@ -202,6 +202,23 @@ VOID TCPReceive(PIP_INTERFACE Interface, PIP_PACKET IPPacket)
                            IPPacket->TotalSize,
                            IPPacket->HeaderSize));
 
+    /* If the datagram is still in the NDIS packet, let lwIP use it in place */
+    if (IPPacket->MappedHeader && IPPacket->NdisPacket)
+    {
+        if (LibIPInsertNdisPacket(Interface->TCPContext,
+                                  IPPacket->NdisPacket,
+                                  IPPacket->ReturnPacket,
+                                  IPPacket->Header,
+                                  IPPacket->TotalSize))
+        {
+            /* lwIP owns the NDIS packet now */
+            IPPacket->NdisPacket = NULL;
+            return;
+        }
+
+        /* Too many miniport packets held already, copy this one */
+    }
+
     LibIPInsertPacket(Interface->TCPContext, IPPacket->Header, IPPacket->TotalSize);
 }
 
@@ -382,6 +382,76 @@ completeIrp:
     return status;
 }
 
+static
+VOID
+SpiAddLunStatistics(
+    _Inout_ PSCSIPORT_STATISTICS Statistics,
+    _In_ PSCSI_PORT_LUN_EXTENSION LunExtension)
+{
+    Statistics->LogicalUnits++;
+    Statistics->Requests += LunExtension->Statistics.Requests;
+    Statistics->TaggedRequests += LunExtension->Statistics.TaggedRequests;
+    Statistics->MergedTransfers += LunExtension->Statistics.MergedTransfers;
+    Statistics->MergedRequests += LunExtension->Statistics.MergedRequests;
+    Statistics->QueueFullEvents += LunExtension->Statistics.QueueFullEvents;
+    Statistics->QueueDepth += LunExtension->MaxQueueCount;
+    Statistics->TotalLatency += LunExtension->Statistics.TotalLatency;
+    Statistics->MaxLatency = max(Statistics->MaxLatency, LunExtension->Statistics.MaxLatency);
+}
+
+static
+NTSTATUS
+SpiGetStatistics(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp)
+{
+    PSCSI_PORT_COMMON_EXTENSION comExt = DeviceObject->DeviceExtension;
+    PSCSI_PORT_DEVICE_EXTENSION portExt;
+    SCSIPORT_STATISTICS Statistics;
+    KIRQL Irql;
+
+    if (!VerifyIrpOutBufferSize(Irp, sizeof(Statistics)))
+        return STATUS_BUFFER_TOO_SMALL;
+
+    RtlZeroMemory(&Statistics, sizeof(Statistics));
+    Statistics.Version = sizeof(Statistics);
+
+    if (comExt->IsFDO)
+        portExt = DeviceObject->DeviceExtension;
+    else
+        portExt = comExt->LowerDevice->DeviceExtension;
+
+    /* The counters are updated by the DPC under the port spinlock */
+    KeAcquireSpinLock(&portExt->SpinLock, &Irql);
+
+    if (comExt->IsFDO)
+    {
+        for (UINT8 pathId = 0; pathId < portExt->NumberOfBuses; pathId++)
+        {
+            PSCSI_BUS_INFO bus = &portExt->Buses[pathId];
+
+            for (PLIST_ENTRY lunEntry = bus->LunsListHead.Flink;
+                 lunEntry != &bus->LunsListHead;
+                 lunEntry = lunEntry->Flink)
+            {
+                SpiAddLunStatistics(&Statistics,
+                    CONTAINING_RECORD(lunEntry, SCSI_PORT_LUN_EXTENSION, LunEntry));
+            }
+        }
+    }
+    else
+    {
+        SpiAddLunStatistics(&Statistics, DeviceObject->DeviceExtension);
+    }
+
+    KeReleaseSpinLock(&portExt->SpinLock, Irql);
+
+    RtlCopyMemory(Irp->AssociatedIrp.SystemBuffer, &Statistics, sizeof(Statistics));
+    Irp->IoStatus.Information = sizeof(Statistics);
+
+    return STATUS_SUCCESS;
+}
+
 /**********************************************************************
  * NAME                         INTERNAL
  *  ScsiPortDeviceControl
@@ -528,6 +598,13 @@ ScsiPortDeviceControl(
             status = SpiGetInquiryData(DeviceObject->DeviceExtension, Irp);
             break;
         }
+        case IOCTL_SCSIPORT_QUERY_STATISTICS:
+        {
+            DPRINT("  IOCTL_SCSIPORT_QUERY_STATISTICS\n");
+
+            status = SpiGetStatistics(DeviceObject, Irp);
+            break;
+        }
         case IOCTL_SCSI_MINIPORT:
             DPRINT1("IOCTL_SCSI_MINIPORT unimplemented!\n");
             status = STATUS_NOT_IMPLEMENTED;
@@ -53,7 +53,7 @@ PdoCreateLunDevice(
     LunExtension->RequestTimeout = -1;
 
     /* Set maximum queue size */
-    LunExtension->MaxQueueCount = 256;
+    LunExtension->MaxQueueCount = SCSI_PORT_MAX_QUEUE_DEPTH;
 
     /* Initialize request queue */
     KeInitializeDeviceQueue(&LunExtension->DeviceQueue);
@@ -338,6 +338,369 @@ ScsiPortDispatchScsi(
     return Status;
 }
 
+/* Part of a coalesced transfer, see SpiCollectMergeableRequests */
+typedef struct _SCSI_PORT_MERGED_REQUEST
+{
+    SCSI_REQUEST_BLOCK Srb;
+    PSCSI_PORT_LUN_EXTENSION LunExtension;
+    ULONG Count;
+    PIRP Irps[SCSI_PORT_MAX_MERGE];
+} SCSI_PORT_MERGED_REQUEST, *PSCSI_PORT_MERGED_REQUEST;
+
+/* SRB flags which must match for two requests to be coalesced */
+#define SRB_FLAGS_SPI_MERGE_MASK                                    \
+    (SRB_FLAGS_UNSPECIFIED_DIRECTION | SRB_FLAGS_QUEUE_ACTION_ENABLE | \
+     SRB_FLAGS_NO_QUEUE_FREEZE | SRB_FLAGS_DISABLE_DISCONNECT |       \
+     SRB_FLAGS_DISABLE_SYNCH_TRANSFER | SRB_FLAGS_ADAPTER_CACHE_ENABLE)
+
+static
+BOOLEAN
+SpiGetMergeableRange(
+    _In_ PSCSI_REQUEST_BLOCK Srb,
+    _In_ PIRP Irp,
+    _Out_ PULONG LogicalBlock,
+    _Out_ PULONG BlockCount)
+{
+    PCDB Cdb = (PCDB)Srb->Cdb;
+    ULONG Direction;
+
+    if (Srb->Function != SRB_FUNCTION_EXECUTE_SCSI ||
+        Srb->CdbLength != CDB10GENERIC_LENGTH ||
+        Srb->DataTransferLength == 0 ||
+        Irp->MdlAddress == NULL ||
+        (Srb->SrbFlags & (SRB_FLAGS_BYPASS_FROZEN_QUEUE | SRB_FLAGS_SPI_NO_MERGE)))
+    {
+        return FALSE;
+    }
+
+    /* Only plain READ(10) and WRITE(10) with a matching data direction */
+    if (Cdb->CDB10.OperationCode == SCSIOP_READ)
+        Direction = SRB_FLAGS_DATA_IN;
+    else if (Cdb->CDB10.OperationCode == SCSIOP_WRITE)
+        Direction = SRB_FLAGS_DATA_OUT;
+    else
+        return FALSE;
+
+    if ((Srb->SrbFlags & SRB_FLAGS_UNSPECIFIED_DIRECTION) != Direction)
+        return FALSE;
+
+    *LogicalBlock = ((ULONG)Cdb->CDB10.LogicalBlockByte0 << 24) |
+                    ((ULONG)Cdb->CDB10.LogicalBlockByte1 << 16) |
+                    ((ULONG)Cdb->CDB10.LogicalBlockByte2 << 8) |
+                    Cdb->CDB10.LogicalBlockByte3;
+    *BlockCount = ((ULONG)Cdb->CDB10.TransferBlocksMsb << 8) |
+                  Cdb->CDB10.TransferBlocksLsb;
+
+    return *BlockCount != 0 && Srb->DataTransferLength % *BlockCount == 0;
+}
+
+/**
+ * @brief      Removes the requests continuing the one which is about to be
+ *             started from the LUN queue. The device queue is sorted by
+ *             QueueSortKey, which class drivers set to the starting LBA, so
+ *             the next candidate is the entry at the end of the current range.
+ *             Must be called with the port spinlock held
+ *
+ * @param[in]  DeviceExtension  The port device extension
+ * @param[in]  LunExtension     The LUN the request belongs to
+ * @param[in]  Irp              The request about to be started
+ *
+ * @return     The requests to coalesce, or NULL if there is nothing to merge
+ */
+static
+PSCSI_PORT_MERGED_REQUEST
+SpiCollectMergeableRequests(
+    _In_ PSCSI_PORT_DEVICE_EXTENSION DeviceExtension,
+    _Inout_ PSCSI_PORT_LUN_EXTENSION LunExtension,
+    _In_ PIRP Irp)
+{
+    PSCSI_PORT_MERGED_REQUEST Merge = NULL;
+    PSCSI_REQUEST_BLOCK Srb, LastSrb, NextSrb;
+    PKDEVICE_QUEUE_ENTRY Entry;
+    PIRP NextIrp;
+    ULONG Block, Blocks, NextBlock, NextBlocks;
+    ULONG BlockSize, Length;
+
+    if (!DeviceExtension->MergeRequests)
+        return NULL;
+
+    Srb = IoGetCurrentIrpStackLocation(Irp)->Parameters.Scsi.Srb;
+    if (!SpiGetMergeableRange(Srb, Irp, &Block, &Blocks))
+        return NULL;
+
+    BlockSize = Srb->DataTransferLength / Blocks;
+    Length = Srb->DataTransferLength;
+    LastSrb = Srb;
+
+    while (Merge == NULL || Merge->Count < SCSI_PORT_MAX_MERGE)
+    {
+        /* Never let KeRemoveByKeyDeviceQueue mark the queue idle, new
+           requests would bypass it. Only inserts can race with us here. */
+        if (IsListEmpty(&LunExtension->DeviceQueue.DeviceListHead))
+            break;
+
+        /* KeRemoveByKeyDeviceQueue wraps around when the last key is not
+           above the one asked for, so look one block before the end */
+        Entry = KeRemoveByKeyDeviceQueue(&LunExtension->DeviceQueue, Block + Blocks - 1);
+        ASSERT(Entry != NULL);
+
+        NextIrp = CONTAINING_RECORD(Entry, IRP, Tail.Overlay.DeviceQueueEntry);
+        NextSrb = IoGetCurrentIrpStackLocation(NextIrp)->Parameters.Scsi.Srb;
+
+        if (!SpiGetMergeableRange(NextSrb, NextIrp, &NextBlock, &NextBlocks) ||
+            NextBlock != Block + Blocks ||
+            NextSrb->DataTransferLength != NextBlocks * BlockSize ||
+            NextSrb->Cdb[1] != Srb->Cdb[1] ||
+            NextSrb->Cdb[9] != Srb->Cdb[9] ||
+            ((NextSrb->SrbFlags ^ Srb->SrbFlags) & SRB_FLAGS_SPI_MERGE_MASK) ||
+            /* The pages are chained into one MDL, see SpiBuildMergedRequest */
+            BYTE_OFFSET((PUCHAR)LastSrb->DataBuffer + LastSrb->DataTransferLength) != 0 ||
+            BYTE_OFFSET(NextSrb->DataBuffer) != 0 ||
+            Blocks + NextBlocks > MAXUSHORT ||
+            Length + NextSrb->DataTransferLength >
+                DeviceExtension->PortCapabilities.MaximumTransferLength ||
+            ADDRESS_AND_SIZE_TO_SPAN_PAGES(Srb->DataBuffer, Length + NextSrb->DataTransferLength) >=
+                DeviceExtension->PortCapabilities.MaximumPhysicalPages)
+        {
+            /* Not a continuation, put it back where it was */
+            KeInsertByKeyDeviceQueue(&LunExtension->DeviceQueue, Entry, Entry->SortKey);
+            break;
+        }
+
+        if (Merge == NULL)
+        {
+            Merge = ExAllocatePoolWithTag(NonPagedPool, sizeof(*Merge), TAG_SCSIPORT);
+            if (Merge == NULL)
+            {
+                KeInsertByKeyDeviceQueue(&LunExtension->DeviceQueue, Entry, Entry->SortKey);
+                break;
+            }
+
+            Merge->LunExtension = LunExtension;
+            Merge->Irps[0] = Irp;
+            Merge->Count = 1;
+        }
+
+        Merge->Irps[Merge->Count++] = NextIrp;
+        Blocks += NextBlocks;
+        Length += NextSrb->DataTransferLength;
+        LastSrb = NextSrb;
+
+        /* The elevator continues after the merged range */
+        LunExtension->SortKey = NextSrb->QueueSortKey + 1;
+    }
+
+    return Merge;
+}
+
+/* Sends the requests which were part of a coalesced transfer one by one */
+static
+VOID
+SpiRequeueMergedRequests(
+    _In_ PSCSI_PORT_MERGED_REQUEST Merge,
+    _In_ ULONG First)
+{
+    PSCSI_REQUEST_BLOCK Srb;
+    ULONG i;
+
+    for (i = First; i < Merge->Count; i++)
+    {
+        Srb = IoGetCurrentIrpStackLocation(Merge->Irps[i])->Parameters.Scsi.Srb;
+        Srb->SrbFlags |= SRB_FLAGS_SPI_NO_MERGE;
+
+        ScsiPortDispatchScsi(Merge->LunExtension->Common.DeviceObject, Merge->Irps[i]);
+    }
+}
+
+IO_COMPLETION_ROUTINE SpiMergeCompletionRoutine;
+
+NTSTATUS
+NTAPI
+SpiMergeCompletionRoutine(
+    _In_ PDEVICE_OBJECT DeviceObject,
+    _In_ PIRP Irp,
+    _In_opt_ PVOID Context)
+{
+    PSCSI_PORT_MERGED_REQUEST Merge = (PSCSI_PORT_MERGED_REQUEST)Context;
+    PSCSI_PORT_LUN_EXTENSION LunExtension = Merge->LunExtension;
+    PSCSI_PORT_DEVICE_EXTENSION DeviceExtension =
+        LunExtension->Common.LowerDevice->DeviceExtension;
+    PSCSI_REQUEST_BLOCK Srb;
+    KIRQL Irql;
+    ULONG i;
+
+    if (SRB_STATUS(Merge->Srb.SrbStatus) == SRB_STATUS_SUCCESS)
+    {
+        for (i = 0; i < Merge->Count; i++)
+        {
+            Srb = IoGetCurrentIrpStackLocation(Merge->Irps[i])->Parameters.Scsi.Srb;
+
+            Srb->SrbStatus = SRB_STATUS_SUCCESS;
+            Srb->ScsiStatus = SCSISTAT_GOOD;
+            Merge->Irps[i]->IoStatus.Status = STATUS_SUCCESS;
+            Merge->Irps[i]->IoStatus.Information = Srb->DataTransferLength;
+
+            IoCompleteRequest(Merge->Irps[i], IO_DISK_INCREMENT);
+        }
+    }
+    else
+    {
+        /* Let every request fail or succeed on its own, so that the class
+           driver gets the right sense data for the right request */
+        DPRINT1("Merged request failed (SrbStatus 0x%x), retrying %lu requests\n",
+                Merge->Srb.SrbStatus, Merge->Count);
+
+        SpiRequeueMergedRequests(Merge, 0);
+
+        /* Nobody else knows about the merged SRB, so release the queue ourselves */
+        if (Merge->Srb.SrbStatus & SRB_STATUS_QUEUE_FROZEN)
+        {
+            KeAcquireSpinLock(&DeviceExtension->SpinLock, &Irql);
+
+            LunExtension->Flags &= ~LUNEX_FROZEN_QUEUE;
+
+            if (LunExtension->SrbInfo.Srb == NULL)
+            {
+                /* SpiGetNextRequestFromLun releases the lock */
+                SpiGetNextRequestFromLun(DeviceExtension, LunExtension, &Irql);
+            }
+            else
+            {
+                KeReleaseSpinLock(&DeviceExtension->SpinLock, Irql);
+            }
+        }
+    }
+
+    /* Drop the system mapping made for MapBuffers miniports, if any */
+    MmPrepareMdlForReuse(Irp->MdlAddress);
+    IoFreeMdl(Irp->MdlAddress);
+    Irp->MdlAddress = NULL;
+    IoFreeIrp(Irp);
+
+    ExFreePoolWithTag(Merge, TAG_SCSIPORT);
+
+    return STATUS_MORE_PROCESSING_REQUIRED;
+}
+
+/**
+ * @brief      Builds one READ/WRITE(10) request covering all the collected
+ *             requests. Their buffers meet on page boundaries, so the pages of
+ *             the original MDLs are chained into one partial MDL, in the way
+ *             IoBuildPartialMdl does it, and the data is transferred in place
+ *
+ * @param[in]  Merge  The requests returned by SpiCollectMergeableRequests
+ *
+ * @return     The IRP to start. If the merged request can't be built, the first
+ *             request is returned and the others are queued again one by one
+ */
+static
+PIRP
+SpiBuildMergedRequest(
+    _In_ PSCSI_PORT_MERGED_REQUEST Merge)
+{
+    PSCSI_PORT_LUN_EXTENSION LunExtension = Merge->LunExtension;
+    PSCSI_REQUEST_BLOCK Srb, FirstSrb;
+    PIO_STACK_LOCATION IoStack;
+    PPFN_NUMBER MergedPages, Pages;
+    PIRP Irp = NULL;
+    PMDL Mdl;
+    PCDB Cdb;
+    ULONG Length = 0, Blocks, TimeOut = 0, PageCount;
+    ULONG i;
+
+    for (i = 0; i < Merge->Count; i++)
+    {
+        Srb = IoGetCurrentIrpStackLocation(Merge->Irps[i])->Parameters.Scsi.Srb;
+
+        Length += Srb->DataTransferLength;
+        TimeOut = max(TimeOut, Srb->TimeOutValue);
+    }
+
+    FirstSrb = IoGetCurrentIrpStackLocation(Merge->Irps[0])->Parameters.Scsi.Srb;
+
+    Irp = IoAllocateIrp(1, FALSE);
+    if (Irp == NULL)
+        goto Failure;
+
+    /* The merged MDL lives in the address space of the first buffer */
+    if (IoAllocateMdl(FirstSrb->DataBuffer, Length, FALSE, FALSE, Irp) == NULL)
+        goto Failure;
+
+    MergedPages = MmGetMdlPfnArray(Irp->MdlAddress);
+
+    for (i = 0; i < Merge->Count; i++)
+    {
+        Mdl = Merge->Irps[i]->MdlAddress;
+        Srb = IoGetCurrentIrpStackLocation(Merge->Irps[i])->Parameters.Scsi.Srb;
+
+        /* Take the locked pages backing this request's part of its MDL */
+        Pages = MmGetMdlPfnArray(Mdl);
+        Pages += ((ULONG_PTR)PAGE_ALIGN(Srb->DataBuffer) - (ULONG_PTR)Mdl->StartVa) >> PAGE_SHIFT;
+        PageCount = ADDRESS_AND_SIZE_TO_SPAN_PAGES(Srb->DataBuffer, Srb->DataTransferLength);
+
+        RtlCopyMemory(MergedPages, Pages, PageCount * sizeof(PFN_NUMBER));
+        MergedPages += PageCount;
+
+        Irp->MdlAddress->MdlFlags |= Mdl->MdlFlags & MDL_IO_PAGE_READ;
+    }
+
+    Irp->MdlAddress->MdlFlags |= MDL_PARTIAL;
+
+    /* The first request gives the address and the flags */
+    Srb = &Merge->Srb;
+    RtlCopyMemory(Srb, FirstSrb, sizeof(SCSI_REQUEST_BLOCK));
+
+    Blocks = Length / (FirstSrb->DataTransferLength /
+                       (((ULONG)FirstSrb->Cdb[7] << 8) | FirstSrb->Cdb[8]));
+    Cdb = (PCDB)Srb->Cdb;
+    Cdb->CDB10.TransferBlocksMsb = (UCHAR)(Blocks >> 8);
+    Cdb->CDB10.TransferBlocksLsb = (UCHAR)Blocks;
+
+    Srb->OriginalRequest = Irp;
+    Srb->DataTransferLength = Length;
+    Srb->TimeOutValue = TimeOut;
+    Srb->SrbStatus = 0;
+    Srb->ScsiStatus = 0;
+    Srb->NextSrb = NULL;
+    Srb->SrbExtension = NULL;
+
+    /* Failures are retried request by request, which provides the sense data */
+    Srb->SenseInfoBuffer = NULL;
+    Srb->SenseInfoBufferLength = 0;
+    Srb->SrbFlags &= ~(SRB_FLAGS_PORT_DRIVER_ALLOCSENSE | SRB_FLAGS_FREE_SENSE_BUFFER |
+                       SRB_FLAGS_IS_ACTIVE);
+    Srb->SrbFlags |= SRB_FLAGS_DISABLE_AUTOSENSE | SRB_FLAGS_SPI_MERGED;
+
+    IoSetCompletionRoutine(Irp, SpiMergeCompletionRoutine, Merge, TRUE, TRUE, TRUE);
+    IoSetNextIrpStackLocation(Irp);
+
+    IoStack = IoGetCurrentIrpStackLocation(Irp);
+    IoStack->MajorFunction = IRP_MJ_SCSI;
+    IoStack->DeviceObject = LunExtension->Common.DeviceObject;
+    IoStack->Parameters.Scsi.Srb = Srb;
+
+    DPRINT("Merged %lu requests into %lu bytes\n", Merge->Count, Length);
+
+    return Irp;
+
+Failure:
+    DPRINT1("Unable to build a merged request\n");
+
+    if (Irp != NULL)
+    {
+        if (Irp->MdlAddress != NULL)
+            IoFreeMdl(Irp->MdlAddress);
+        IoFreeIrp(Irp);
+    }
+
+    /* Start the first request as it is and queue the others again */
+    Irp = Merge->Irps[0];
+    SpiRequeueMergedRequests(Merge, 1);
+    ExFreePoolWithTag(Merge, TAG_SCSIPORT);
+
+    return Irp;
+}
+
 VOID
 SpiGetNextRequestFromLun(
     _In_ PSCSI_PORT_DEVICE_EXTENSION DeviceExtension,
@@ -349,6 +712,7 @@ SpiGetNextRequestFromLun(
     PIRP NextIrp;
     PKDEVICE_QUEUE_ENTRY Entry;
     PSCSI_REQUEST_BLOCK Srb;
+    PSCSI_PORT_MERGED_REQUEST Merge;
 
 
     /* If LUN is not active or queue is more than maximum allowed  */
@@ -431,12 +795,18 @@ SpiGetNextRequestFromLun(
         LunExtension->SortKey = Srb->QueueSortKey;
         LunExtension->SortKey++;
 
+        /* Pick up the requests which continue this one */
+        Merge = SpiCollectMergeableRequests(DeviceExtension, LunExtension, NextIrp);
+
         /* Release the spinlock */
         if (OldIrql != NULL)
             KeReleaseSpinLock(&DeviceExtension->SpinLock, *OldIrql);
         else
             KeReleaseSpinLockFromDpcLevel(&DeviceExtension->SpinLock);
 
+        if (Merge != NULL)
+            NextIrp = SpiBuildMergedRequest(Merge);
+
         /* Start the next pending request */
         IoStartPacket(DeviceExtension->Common.DeviceObject, NextIrp, (PULONG)NULL, NULL);
     }
@@ -642,6 +1012,38 @@ SpiSendRequestSense(
 }
 
 
+/* Called with the port spinlock held */
+static
+VOID
+SpiUpdateStatistics(
+    _Inout_ PSCSI_PORT_LUN_EXTENSION LunExtension,
+    _In_ PSCSI_REQUEST_BLOCK_INFO SrbInfo,
+    _In_ PSCSI_REQUEST_BLOCK Srb)
+{
+    PSCSIPORT_STATISTICS Statistics = &LunExtension->Statistics;
+    ULONGLONG Latency = KeQueryInterruptTime() - SrbInfo->StartTime;
+
+    Statistics->Requests++;
+    Statistics->TotalLatency += Latency;
+    Statistics->MaxLatency = max(Statistics->MaxLatency, Latency);
+
+    if (Srb->SrbFlags & SRB_FLAGS_QUEUE_ACTION_ENABLE)
+        Statistics->TaggedRequests++;
+
+    if (Srb->ScsiStatus == SCSISTAT_QUEUE_FULL)
+        Statistics->QueueFullEvents++;
+
+    if ((Srb->SrbFlags & SRB_FLAGS_SPI_MERGED) &&
+        SRB_STATUS(Srb->SrbStatus) == SRB_STATUS_SUCCESS)
+    {
+        PSCSI_PORT_MERGED_REQUEST Merge =
+            CONTAINING_RECORD(Srb, SCSI_PORT_MERGED_REQUEST, Srb);
+
+        Statistics->MergedTransfers++;
+        Statistics->MergedRequests += Merge->Count;
+    }
+}
+
 static
 VOID
 SpiProcessCompletedRequest(
@@ -780,6 +1182,31 @@ SpiProcessCompletedRequest(
     /* Decrement the queue count */
     LunExtension->QueueCount--;
 
+    /* Account the request */
+    SpiUpdateStatistics(LunExtension, SrbInfo, Srb);
+
+    if (Srb->ScsiStatus == SCSISTAT_QUEUE_FULL)
+    {
+        /* The device can't take more than what it still has outstanding */
+        LunExtension->MaxQueueCount = max(LunExtension->QueueCount, 1);
+        LunExtension->QueueDepthRamp = 0;
+
+        DPRINT1("Queue full, limiting LUN %u:%u:%u to %lu requests\n",
+                LunExtension->PathId, LunExtension->TargetId, LunExtension->Lun,
+                LunExtension->MaxQueueCount);
+    }
+    else if (SRB_STATUS(Srb->SrbStatus) == SRB_STATUS_SUCCESS &&
+             LunExtension->MaxQueueCount < SCSI_PORT_MAX_QUEUE_DEPTH &&
+             ++LunExtension->QueueDepthRamp >= SCSI_PORT_QUEUE_DEPTH_RAMP)
+    {
+        /* Carefully probe for a deeper queue again */
+        LunExtension->MaxQueueCount++;
+        LunExtension->QueueDepthRamp = 0;
+    }
+
+    /* Port private flags must not leak back to the class driver */
+    Srb->SrbFlags &= ~SRB_FLAGS_SPI_NO_MERGE;
+
     /* Free Srb, if needed*/
     if (Srb->QueueTag != SP_UNTAGGED)
     {
@@ -1205,12 +1632,8 @@ SpiSaveInterruptData(IN PVOID Context)
 
             }
 
-            /* Check for a full queue */
-            if (Srb->ScsiStatus == SCSISTAT_QUEUE_FULL)
-            {
-                /* TODO: Implement when it's encountered */
-                ASSERT(FALSE);
-            }
+            /* A full queue is handled by SpiProcessCompletedRequest, which
+               retries the request and lowers the queue depth of the LUN */
         }
 
         /* Let's decide if we need to watch timeout or not */
@@ -1620,6 +2043,25 @@ SpiAllocateSrbStructures(
     return SrbInfo;
 }
 
+static
+VOID
+SpiSetQueueAction(
+    _In_ PSCSI_PORT_DEVICE_EXTENSION DeviceExtension,
+    _In_ PSCSI_PORT_LUN_EXTENSION LunExtension,
+    _Inout_ PSCSI_REQUEST_BLOCK Srb)
+{
+    if (Srb->Function != SRB_FUNCTION_EXECUTE_SCSI)
+        return;
+
+    /* The class driver asks for tagging (QUEUE_ACTION_ENABLE and QueueAction),
+       only take it away when the miniport or the device can't handle tags */
+    if (!DeviceExtension->SupportsTaggedQueuing ||
+        !LunExtension->InquiryData.CommandQueue)
+    {
+        Srb->SrbFlags &= ~SRB_FLAGS_QUEUE_ACTION_ENABLE;
+    }
+}
+
 VOID
 NTAPI
 ScsiPortStartIo(
@@ -1650,6 +2092,9 @@ ScsiPortStartIo(
     /* Apply "default" flags */
     Srb->SrbFlags |= DeviceExtension->SrbFlags;
 
+    /* Don't send tagged commands the LUN can't take */
+    SpiSetQueueAction(DeviceExtension, LunExtension, Srb);
+
     if (DeviceExtension->NeedSrbDataAlloc ||
         DeviceExtension->NeedSrbExtensionAlloc)
     {
@@ -1677,6 +2122,8 @@ ScsiPortStartIo(
         Srb->QueueTag = SP_UNTAGGED;
     }
 
+    SrbInfo->StartTime = KeQueryInterruptTime();
+
     /* Increase sequence number of SRB */
     if (!SrbInfo->SequenceNumber)
     {
@@ -1236,7 +1236,10 @@ CreatePortConfig:
             DeviceExtension->MultipleReqsPerLun = PortConfig->MultipleRequestPerLu = FALSE;
 
         if (ConfigInfo.DisableTaggedQueueing)
-            DeviceExtension->SupportsTaggedQueuing = PortConfig->MultipleRequestPerLu = FALSE;
+            DeviceExtension->SupportsTaggedQueuing = PortConfig->TaggedQueuing = FALSE;
+
+        /* Contiguous reads and writes are coalesced unless disabled */
+        DeviceExtension->MergeRequests = !ConfigInfo.DisableRequestMerging;
 
         /* Check if we need to alloc SRB data */
         if (DeviceExtension->SupportsTaggedQueuing || DeviceExtension->MultipleReqsPerLun)
@@ -1287,6 +1290,9 @@ CreatePortConfig:
             else
                 Count = DeviceExtension->RequestsNumber * 2;
 
+            /* Every SRB data structure is addressed by a queue tag */
+            Count = min(Count, SCSI_PORT_MAX_TAGS);
+
             /* Allocate the data */
             SrbData = ExAllocatePoolWithTag(
                 NonPagedPool, Count * sizeof(SCSI_REQUEST_BLOCK_INFO), TAG_SCSIPORT);
@@ -2429,6 +2435,7 @@ SpiCreatePortConfig(PSCSI_PORT_DEVICE_EXTENSION DeviceExtension,
     /* Clear this information */
     InternalConfigInfo->DisableTaggedQueueing = FALSE;
     InternalConfigInfo->DisableMultipleLun = FALSE;
+    InternalConfigInfo->DisableRequestMerging = FALSE;
 
     /* Store Bus Number */
     ConfigInfo->SystemIoBusNumber = InternalConfigInfo->BusNumber;
@@ -2744,6 +2751,14 @@ SpiParseDeviceInfo(IN PSCSI_PORT_DEVICE_EXTENSION DeviceExtension,
             DPRINT("Multiple requests disabled\n");
         }
 
+        /* Get DisableRequestMerging */
+        if (_wcsnicmp(KeyValueInformation->Name, L"DisableRequestMerging",
+            KeyValueInformation->NameLength/2) == 0)
+        {
+            InternalConfigInfo->DisableRequestMerging = TRUE;
+            DPRINT("Request merging disabled\n");
+        }
+
         /* Get DriverParameters */
         if (_wcsnicmp(KeyValueInformation->Name, L"DriverParameters",
             KeyValueInformation->NameLength/2) == 0)
@@ -13,6 +13,7 @@
 #include <ntddscsi.h>
 #include <ntdddisk.h>
 #include <mountdev.h>
+#include <scsiport/ntddscsiport.h>
 
 #ifdef DBG
 #include <debug/driverdbg.h>
@@ -25,6 +26,21 @@
 
 #define MAX_SG_LIST 17
 
+/* Queue tags are UCHARs, 0 is invalid and SP_UNTAGGED is reserved */
+#define SCSI_PORT_MAX_TAGS 254
+
+/* Queue depth limit of a LUN, and how many successful requests it takes
+   to raise it by one again after the device reported QUEUE FULL */
+#define SCSI_PORT_MAX_QUEUE_DEPTH 256
+#define SCSI_PORT_QUEUE_DEPTH_RAMP 32
+
+/* Maximum number of contiguous requests coalesced into one transfer */
+#define SCSI_PORT_MAX_MERGE 16
+
+/* Port driver private SRB flags (SRB_FLAGS_PORT_DRIVER_RESERVED) */
+#define SRB_FLAGS_SPI_NO_MERGE           0x01000000
+#define SRB_FLAGS_SPI_MERGED             0x02000000
+
 /* Flags */
 #define SCSI_PORT_DEVICE_BUSY            0x00001
 #define SCSI_PORT_LU_ACTIVE              0x00002
@@ -91,6 +107,7 @@ typedef struct _CONFIGURATION_INFO
     /* Features */
     BOOLEAN DisableTaggedQueueing;
     BOOLEAN DisableMultipleLun;
+    BOOLEAN DisableRequestMerging;
 
     /* Parameters */
     PVOID Parameter;
@@ -121,6 +138,7 @@ typedef struct _SCSI_REQUEST_BLOCK_INFO
     PVOID SaveSenseRequest;
 
     ULONG SequenceNumber;
+    ULONGLONG StartTime;
 
     /* DMA stuff */
     PVOID BaseOfMapRegister;
@@ -161,6 +179,7 @@ typedef struct _SCSI_PORT_LUN_EXTENSION
     ULONG SortKey;
     ULONG QueueCount;
     ULONG MaxQueueCount;
+    ULONG QueueDepthRamp;
 
     ULONG AttemptCount;
     LONG RequestTimeout;
@@ -175,6 +194,9 @@ typedef struct _SCSI_PORT_LUN_EXTENSION
 
     HANDLE RegistryMapKey;
 
+    /* Protected by the port spinlock */
+    SCSIPORT_STATISTICS Statistics;
+
     /* More data? */
 
     UCHAR MiniportLunExtension[1]; /* must be the last entry */
@@ -300,6 +322,7 @@ typedef struct _SCSI_PORT_DEVICE_EXTENSION
     BOOLEAN SupportsAutoSense;
     BOOLEAN MultipleReqsPerLun;
     BOOLEAN ReceiveEvent;
+    BOOLEAN MergeRequests;
 
     PHYSICAL_ADDRESS PhysicalAddress;
     ULONG CommonBufferLength;
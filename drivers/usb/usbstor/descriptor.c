@@ -355,3 +355,57 @@ USBSTOR_GetPipeHandles(
 
     return STATUS_SUCCESS;
 }
+
+VOID
+USBSTOR_GetMaxTransferLength(
+    IN PFDO_DEVICE_EXTENSION DeviceExtension)
+{
+    NTSTATUS Status;
+    HANDLE KeyHandle;
+    ULONG MaxTransferLength, RegistryValue = 0;
+    RTL_QUERY_REGISTRY_TABLE QueryTable[2];
+
+    // bulk-only devices do not report a limit, USB 3 devices are known to cope with large transfers
+    if (DeviceExtension->DeviceDescriptor->bcdUSB >= 0x300)
+        MaxTransferLength = USBSTOR_SUPERSPEED_MAX_TRANSFER_LENGTH;
+    else
+        MaxTransferLength = USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH;
+
+    // allow per-device override, same value name as the Windows driver uses
+    Status = IoOpenDeviceRegistryKey(DeviceExtension->PhysicalDeviceObject,
+                                     PLUGPLAY_REGKEY_DEVICE,
+                                     KEY_READ,
+                                     &KeyHandle);
+    if (NT_SUCCESS(Status))
+    {
+        RtlZeroMemory(QueryTable, sizeof(QueryTable));
+        QueryTable[0].Flags = RTL_QUERY_REGISTRY_DIRECT;
+        QueryTable[0].Name = L"MaximumTransferLength";
+        QueryTable[0].EntryContext = &RegistryValue;
+
+        Status = RtlQueryRegistryValues(RTL_REGISTRY_HANDLE,
+                                        (PCWSTR)KeyHandle,
+                                        QueryTable,
+                                        NULL,
+                                        NULL);
+        ZwClose(KeyHandle);
+
+        if (NT_SUCCESS(Status) && RegistryValue)
+        {
+            // the driver always worked with the default length, so never go below it
+            MaxTransferLength = RegistryValue & ~(PAGE_SIZE - 1);
+            MaxTransferLength = max(MaxTransferLength, USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH);
+            MaxTransferLength = min(MaxTransferLength, USBSTOR_MAX_TRANSFER_LENGTH);
+
+            if (MaxTransferLength != RegistryValue)
+            {
+                DPRINT1("USBSTOR_GetMaxTransferLength: MaximumTransferLength %lx clamped to %lx\n",
+                        RegistryValue, MaxTransferLength);
+            }
+        }
+    }
+
+    DeviceExtension->MaxTransferLength = MaxTransferLength;
+
+    DPRINT("USBSTOR_GetMaxTransferLength: MaxTransferLength %lx\n", DeviceExtension->MaxTransferLength);
+}
@@ -16,7 +16,7 @@
 
 static
 BOOLEAN
-IsRequestValid(PIRP Irp)
+IsRequestValid(PFDO_DEVICE_EXTENSION FDODeviceExtension, PIRP Irp)
 {
     ULONG TransferLength;
     PIO_STACK_LOCATION IoStack;
@@ -47,9 +47,9 @@ IsRequestValid(PIRP Irp)
             return FALSE;
         }
 
-        if (TransferLength > USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH)
+        if (TransferLength > FDODeviceExtension->MaxTransferLength)
         {
-            DPRINT1("IsRequestValid: Invalid Srb. TransferLength > 0x10000\n");
+            DPRINT1("IsRequestValid: Invalid Srb. TransferLength > %lx\n", FDODeviceExtension->MaxTransferLength);
             return FALSE;
         }
     }
@@ -99,7 +99,7 @@ USBSTOR_HandleInternalDeviceControl(
         {
             DPRINT("SRB_FUNCTION_EXECUTE_SCSI\n");
 
-            if (!IsRequestValid(Irp))
+            if (!IsRequestValid(PDODeviceExtension->LowerDeviceObject->DeviceExtension, Irp))
             {
                 Status = STATUS_INVALID_PARAMETER;
                 break;
@@ -384,6 +384,9 @@ USBSTOR_HandleQueryProperty(
             return STATUS_SUCCESS;
         }
 
+        PDODeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+        FDODeviceExtension = (PFDO_DEVICE_EXTENSION)PDODeviceExtension->LowerDeviceObject->DeviceExtension;
+
         // get adapter descriptor, information is returned in the same buffer
         AdapterDescriptor = Irp->AssociatedIrp.SystemBuffer;
 
@@ -393,8 +396,8 @@ USBSTOR_HandleQueryProperty(
         *AdapterDescriptor = (STORAGE_ADAPTER_DESCRIPTOR_WIN8) {
             .Version = sizeof(STORAGE_ADAPTER_DESCRIPTOR_WIN8),
             .Size = sizeof(STORAGE_ADAPTER_DESCRIPTOR_WIN8),
-            .MaximumTransferLength = USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH,
-            .MaximumPhysicalPages = USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH / PAGE_SIZE + 1, // See CORE-10515 and CORE-10755
+            .MaximumTransferLength = FDODeviceExtension->MaxTransferLength,
+            .MaximumPhysicalPages = FDODeviceExtension->MaxTransferLength / PAGE_SIZE + 1, // See CORE-10515 and CORE-10755
             .BusType = BusTypeUsb,
             .BusMajorVersion = 2, //FIXME verify
             .BusMinorVersion = 0 //FIXME
@@ -417,6 +420,7 @@ USBSTOR_HandleDeviceControl(
     PIO_STACK_LOCATION IoStack;
     NTSTATUS Status;
     PPDO_DEVICE_EXTENSION PDODeviceExtension;
+    PFDO_DEVICE_EXTENSION FDODeviceExtension;
     PSCSI_ADAPTER_BUS_INFO BusInfo;
     PSCSI_INQUIRY_DATA ScsiInquiryData;
     PINQUIRYDATA InquiryData;
@@ -460,8 +464,11 @@ USBSTOR_HandleDeviceControl(
 
             if (Capabilities)
             {
-                Capabilities->MaximumTransferLength = USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH;
-                Capabilities->MaximumPhysicalPages = USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH / PAGE_SIZE + 1; // See CORE-10515 and CORE-10755
+                PDODeviceExtension = (PPDO_DEVICE_EXTENSION)DeviceObject->DeviceExtension;
+                FDODeviceExtension = (PFDO_DEVICE_EXTENSION)PDODeviceExtension->LowerDeviceObject->DeviceExtension;
+
+                Capabilities->MaximumTransferLength = FDODeviceExtension->MaxTransferLength;
+                Capabilities->MaximumPhysicalPages = FDODeviceExtension->MaxTransferLength / PAGE_SIZE + 1; // See CORE-10515 and CORE-10755
                 Capabilities->SupportedAsynchronousEvents = 0;
                 Capabilities->AlignmentMask = 0;
                 Capabilities->TaggedQueuing = FALSE;
@@ -228,6 +228,9 @@ USBSTOR_FdoHandleStartDevice(
         return Status;
     }
 
+    // pick the largest transfer size usable with this device
+    USBSTOR_GetMaxTransferLength(DeviceExtension);
+
     Status = USBSTOR_GetMaxLUN(DeviceExtension->LowerDeviceObject, DeviceExtension);
     if (!NT_SUCCESS(Status))
     {
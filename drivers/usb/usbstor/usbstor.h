@@ -61,6 +61,8 @@
 #define USB_MAXCHILDREN 16
 #define MAX_LUN 0xF
 #define USBSTOR_DEFAULT_MAX_TRANSFER_LENGTH 0x10000
+#define USBSTOR_SUPERSPEED_MAX_TRANSFER_LENGTH 0x100000
+#define USBSTOR_MAX_TRANSFER_LENGTH 0x200000
 
 #define CBW_SIGNATURE 0x43425355
 #define CSW_SIGNATURE 0x53425355
@@ -133,6 +135,7 @@ typedef struct
     UCHAR BulkInPipeIndex;                                                               // bulk in pipe index
     UCHAR BulkOutPipeIndex;                                                              // bulk out pipe index
     UCHAR MaxLUN;                                                                        // max lun for device
+    ULONG MaxTransferLength;                                                             // max transfer length
     PDEVICE_OBJECT ChildPDO[USB_MAXCHILDREN];                                            // max 16 child pdo devices
     KSPIN_LOCK IrpListLock;                                                              // irp list lock
     LIST_ENTRY IrpListHead;                                                              // irp list head
@@ -265,6 +268,10 @@ NTSTATUS
 USBSTOR_GetPipeHandles(
     IN PFDO_DEVICE_EXTENSION DeviceExtension);
 
+VOID
+USBSTOR_GetMaxTransferLength(
+    IN PFDO_DEVICE_EXTENSION DeviceExtension);
+
 //---------------------------------------------------------------------
 //
 // scsi.c routines
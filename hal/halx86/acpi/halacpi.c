@@ -22,6 +22,7 @@ BOOLEAN HalpPhysicalMemoryMayAppearAbove4GB;
 
 FADT HalpFixedAcpiDescTable;
 PDEBUG_PORT_TABLE HalpDebugPortTable;
+PHPET_TABLE HalpHpetTable;
 PACPI_SRAT HalpAcpiSrat;
 PBOOT_TABLE HalpSimpleBootFlagTable;
 
@@ -825,6 +826,9 @@ HalpSetupAcpiPhase0(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
     /* Get the debug table for KD */
     HalpDebugPortTable = HalAcpiGetTable(LoaderBlock, DBGP_SIGNATURE);
 
+    /* Get the HPET table for the performance counter */
+    HalpHpetTable = HalAcpiGetTable(LoaderBlock, HPET_SIGNATURE);
+
     /* Initialize NUMA through the SRAT */
     HalpNumaInitializeStaticConfiguration(LoaderBlock);
 
@@ -955,6 +959,23 @@ HalpGetDebugPortTable(VOID)
             (HalpDebugPortTable->BaseAddress.AddressSpaceID == 1));
 }
 
+CODE_SEG("INIT")
+BOOLEAN
+NTAPI
+HalpGetHpetAddress(OUT PPHYSICAL_ADDRESS Address)
+{
+    /* The HPET registers must be memory mapped */
+    if (!(HalpHpetTable) ||
+        (HalpHpetTable->BaseAddress.AddressSpaceID != 0) ||
+        !(HalpHpetTable->BaseAddress.Address.QuadPart))
+    {
+        return FALSE;
+    }
+
+    *Address = HalpHpetTable->BaseAddress.Address;
+    return TRUE;
+}
+
 CODE_SEG("INIT")
 ULONG
 NTAPI
@@ -38,6 +38,9 @@ HalpInitProcessor(
     /* Initialize profiling data (but don't start it) */
     HalInitializeProfiling();
 
+    /* Ticks before this processor started are not idle time */
+    KeGetPcr()->HalReserved[HAL_CLOCK_TICK] = HalpClockTicks;
+
     /* Initialize the timer */
     //ApicInitializeTimer(ProcessorNumber);
 }
@@ -0,0 +1,98 @@
+/*
+ * PROJECT:     ReactOS Hardware Abstraction Layer
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     HPET main counter, used to calibrate the TSC and as the
+ *              performance counter when the TSC is not invariant
+ */
+
+/* INCLUDES ******************************************************************/
+
+#include <hal.h>
+#include "hpet.h"
+#define NDEBUG
+#include <debug.h>
+
+/* GLOBALS *******************************************************************/
+
+PUCHAR HalpHpetBase;
+ULONG64 HalpHpetFrequency;
+ULONG64 HalpHpetCounterMask;
+
+/* PRIVATE FUNCTIONS *********************************************************/
+
+FORCEINLINE
+ULONG
+HpetRead(ULONG Register)
+{
+    return READ_REGISTER_ULONG((PULONG)(HalpHpetBase + Register));
+}
+
+FORCEINLINE
+VOID
+HpetWrite(ULONG Register, ULONG Value)
+{
+    WRITE_REGISTER_ULONG((PULONG)(HalpHpetBase + Register), Value);
+}
+
+CODE_SEG("INIT")
+BOOLEAN
+NTAPI
+HalpInitializeHpet(VOID)
+{
+    PHYSICAL_ADDRESS PhysicalAddress;
+    PHARDWARE_PTE Pte;
+    ULONG Capabilities, Period;
+
+    /* Check if the firmware describes an HPET */
+    if (!HalpGetHpetAddress(&PhysicalAddress))
+        return FALSE;
+
+    /* Map the register page uncached */
+    HalpHpetBase = HalpMapPhysicalMemory64Vista(PhysicalAddress, 1, FALSE);
+    if (!HalpHpetBase)
+        return FALSE;
+    Pte = HalAddressToPte(HalpHpetBase);
+    Pte->CacheDisable = 1;
+    HalpFlushTLB();
+
+    /* Get the counter period in femtoseconds and sanity check it */
+    Capabilities = HpetRead(HPET_CAPABILITIES);
+    Period = HpetRead(HPET_CAPABILITIES + 4);
+    if ((Period == 0) || (Period > HPET_MAX_PERIOD_FS))
+    {
+        DPRINT1("Ignoring HPET at 0x%I64x with a period of %lu fs\n",
+                PhysicalAddress.QuadPart, Period);
+        HalpHpetBase = NULL;
+        return FALSE;
+    }
+
+    HalpHpetFrequency = 1000000000000000ULL / Period;
+    HalpHpetCounterMask = (Capabilities & HPET_CAP_COUNTER_64BIT) ? ~0ULL : 0xFFFFFFFFULL;
+
+    /* Start the main counter. Leave the legacy replacement routing off,
+       the RTC keeps delivering the clock interrupt */
+    HpetWrite(HPET_CONFIGURATION, HpetRead(HPET_CONFIGURATION) | HPET_CONF_ENABLE);
+
+    DPRINT1("HPET at 0x%I64x, %I64u Hz, %u bit counter\n",
+            PhysicalAddress.QuadPart, HalpHpetFrequency,
+            (Capabilities & HPET_CAP_COUNTER_64BIT) ? 64 : 32);
+    return TRUE;
+}
+
+ULONG64
+NTAPI
+HalpReadHpetCounter(VOID)
+{
+    ULONG High, Low;
+
+    /* Without a 64 bit counter the upper half reads as zero */
+    do
+    {
+        High = HpetRead(HPET_MAIN_COUNTER + 4);
+        Low = HpetRead(HPET_MAIN_COUNTER);
+    } while (High != HpetRead(HPET_MAIN_COUNTER + 4));
+
+    return ((ULONG64)High << 32) | Low;
+}
+
+/* EOF */
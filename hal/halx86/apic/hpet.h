@@ -0,0 +1,25 @@
+
+#ifndef _HPET_H_
+#define _HPET_H_
+
+/* Register offsets */
+#define HPET_CAPABILITIES   0x000
+#define HPET_CONFIGURATION  0x010
+#define HPET_MAIN_COUNTER   0x0F0
+
+/* HPET_CAPABILITIES bits, the upper half is the counter period in fs */
+#define HPET_CAP_COUNTER_64BIT  0x2000
+
+/* HPET_CONFIGURATION bits */
+#define HPET_CONF_ENABLE        0x1
+
+/* The specification caps the period at 100 ns */
+#define HPET_MAX_PERIOD_FS      100000000
+
+extern ULONG64 HalpHpetFrequency;
+extern ULONG64 HalpHpetCounterMask;
+
+BOOLEAN NTAPI HalpInitializeHpet(VOID);
+ULONG64 NTAPI HalpReadHpetCounter(VOID);
+
+#endif /* !_HPET_H_ */
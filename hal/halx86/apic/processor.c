@@ -8,6 +8,7 @@
 /* INCLUDES ******************************************************************/
 
 #include <hal.h>
+#include <smp.h>
 #define NDEBUG
 #include <debug.h>
 
@@ -45,6 +46,17 @@ VOID
 NTAPI
 HalProcessorIdle(VOID)
 {
+    /* Stop the clock IPIs if nothing else needs them */
+    if (HalpEnterTicklessIdle())
+    {
+        /* Enable interrupts and halt until some real work arrives */
+        _enable();
+        __halt();
+
+        HalpLeaveTicklessIdle();
+        return;
+    }
+
     /* Enable interrupts and halt the processor */
     _enable();
     __halt();
@@ -29,6 +29,7 @@ static ULONG HalpCurrentFractionalIncrement;
 static ULONG HalpRunningFraction;
 static BOOLEAN HalpSetClockRate;
 static UCHAR HalpNextClockRate;
+volatile ULONG HalpClockTicks;
 
 /*!
     \brief Converts the CMOS RTC rate into the time increment in 0.1ns intervals.
@@ -184,6 +185,7 @@ HalpClockInterruptHandler(IN PKTRAP_FRAME TrapFrame)
     }
 
     /* Send the clock IPI to all other CPUs */
+    HalpClockTicks++;
     HalpBroadcastClockIpi(CLOCK_IPI_VECTOR);
 
     /* Update the system time -- on x86 the kernel will exit this trap  */
@@ -210,6 +212,9 @@ HalpClockIpiHandler(IN PKTRAP_FRAME TrapFrame)
         KiEoiHelper(TrapFrame);
     }
 
+    /* Remember the tick, so that an idle processor knows what it missed */
+    KeGetPcr()->HalReserved[HAL_CLOCK_TICK] = HalpClockTicks;
+
     /* Call the kernel to update runtimes */
     KeUpdateRunTime(TrapFrame, Irql);
 
@@ -10,18 +10,28 @@
 
 #include <hal.h>
 #include "tsc.h"
+#include "hpet.h"
 #include "apicp.h"
 #define NDEBUG
 #include <debug.h>
 
 LARGE_INTEGER HalpCpuClockFrequency = {{INITIAL_STALL_COUNT * 1000000}};
 
+/* The TSC runs at a constant rate in all P-, C- and T-states */
+BOOLEAN HalpTscInvariant;
+
+/* The performance counter comes from the HPET rather than from the TSC */
+BOOLEAN HalpUseHpetCounter;
+
 UCHAR TscCalibrationPhase;
 ULONG64 TscCalibrationArray[NUM_SAMPLES];
 
 #define RTC_MODE 6 /* Mode 6 is 1024 Hz */
 #define SAMPLE_FREQUENCY ((32768 << 1) >> RTC_MODE)
 
+/* Calibrating against the HPET takes 20 ms */
+#define HPET_CALIBRATION_DIVISOR 50
+
 /* PRIVATE FUNCTIONS *********************************************************/
 
 static
@@ -50,6 +60,41 @@ DoLinearRegression(
     return (SumXY + (SumXX/2)) / SumXX;
 }
 
+static
+BOOLEAN
+IsTscInvariant(VOID)
+{
+    INT CpuInfo[4];
+
+    /* Check for the advanced power management leaf */
+    __cpuid(CpuInfo, 0x80000000);
+    if ((ULONG)CpuInfo[0] < 0x80000007)
+        return FALSE;
+
+    /* Check the invariant TSC bit */
+    __cpuid(CpuInfo, 0x80000007);
+    return (CpuInfo[3] & 0x100) != 0;
+}
+
+static
+ULONG64
+CalibrateTscWithHpet(VOID)
+{
+    ULONG64 HpetStart, HpetTicks, HpetWait, TscStart, TscEnd;
+
+    /* Count TSC ticks over a fixed number of HPET ticks */
+    HpetWait = HalpHpetFrequency / HPET_CALIBRATION_DIVISOR;
+    HpetStart = HalpReadHpetCounter();
+    TscStart = __rdtsc();
+    do
+    {
+        HpetTicks = (HalpReadHpetCounter() - HpetStart) & HalpHpetCounterMask;
+    } while (HpetTicks < HpetWait);
+    TscEnd = __rdtsc();
+
+    return (TscEnd - TscStart) * HalpHpetFrequency / HpetTicks;
+}
+
 VOID
 NTAPI
 HalpInitializeTsc(VOID)
@@ -64,10 +109,32 @@ HalpInitializeTsc(VOID)
         KeBugCheck(HAL_INITIALIZATION_FAILED);
     }
 
+    HalpTscInvariant = IsTscInvariant();
+
      /* Save flags and disable interrupts */
     Flags = __readeflags();
     _disable();
 
+    /* The HPET gives a much better reference than the RTC */
+    if (HalpInitializeHpet())
+    {
+        HalpCpuClockFrequency.QuadPart = CalibrateTscWithHpet();
+
+        /* A TSC that changes its rate is no use as a performance counter,
+           and only the invariant one is guaranteed to be in sync across
+           processors */
+        HalpUseHpetCounter = (!HalpTscInvariant &&
+                              HalpHpetCounterMask == ~0ULL);
+
+        DPRINT1("TSC %I64u Hz, %sinvariant, performance counter from the %s\n",
+                HalpCpuClockFrequency.QuadPart,
+                HalpTscInvariant ? "" : "not ",
+                HalpUseHpetCounter ? "HPET" : "TSC");
+
+        __writeeflags(Flags);
+        return;
+    }
+
     /* Enable the periodic interrupt in the CMOS */
     RegisterB = HalpReadCmos(RTC_REGISTER_B);
     HalpWriteCmos(RTC_REGISTER_B, RegisterB | RTC_REG_B_PI);
@@ -83,8 +150,10 @@ HalpInitializeTsc(VOID)
     /* Set the calibration ISR */
     KeRegisterInterruptHandler(APIC_CLOCK_VECTOR, TscCalibrationISR);
 
-    /* Reset TSC value to 0 */
-    __writemsr(MSR_RDTSC, 0);
+    /* Reset TSC value to 0, unless that would put it out of sync with
+       the other processors */
+    if (!HalpTscInvariant)
+        __writemsr(MSR_RDTSC, 0);
 
     /* Enable the timer interrupt */
     HalEnableSystemInterrupt(APIC_CLOCK_VECTOR, CLOCK_LEVEL, Latched);
@@ -138,6 +207,16 @@ KeQueryPerformanceCounter(
     /* Make sure it's calibrated */
     ASSERT(HalpCpuClockFrequency.QuadPart != 0);
 
+    /* Use the HPET if the TSC can't be trusted */
+    if (HalpUseHpetCounter)
+    {
+        if (PerformanceFrequency)
+            PerformanceFrequency->QuadPart = HalpHpetFrequency;
+
+        Result.QuadPart = HalpReadHpetCounter();
+        return Result;
+    }
+
     /* Does the caller want the frequency? */
     if (PerformanceFrequency)
     {
@@ -172,7 +251,22 @@ HalCalibratePerformanceCounter(
     IN volatile PLONG Count,
     IN ULONGLONG NewCount)
 {
-    UNIMPLEMENTED;
-    ASSERT(FALSE);
+    ULONG_PTR Flags;
+
+    /* Save flags and disable interrupts */
+    Flags = __readeflags();
+    _disable();
+
+    /* Wait for all the other processors to get here */
+    InterlockedDecrement(Count);
+    while (*Count) YieldProcessor();
+
+    /* The HPET and an invariant TSC are shared or kept in sync by the
+       hardware, anything else has to be set on every processor */
+    if (!HalpUseHpetCounter && !HalpTscInvariant)
+        __writemsr(MSR_RDTSC, NewCount);
+
+    /* Restore flags */
+    __writeeflags(Flags);
 }
 
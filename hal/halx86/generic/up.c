@@ -48,6 +48,19 @@ HalpBroadcastClockIpi(
     NOTHING;
 }
 
+BOOLEAN
+HalpEnterTicklessIdle(VOID)
+{
+    /* The only processor gets the clock interrupt itself */
+    return FALSE;
+}
+
+VOID
+HalpLeaveTicklessIdle(VOID)
+{
+    NOTHING;
+}
+
 #ifdef _M_AMD64
 
 VOID
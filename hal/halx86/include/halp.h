@@ -54,6 +54,9 @@ VOID
 #define HAL_PROFILING_INTERVAL      0
 #define HAL_PROFILING_MULTIPLIER    1
 
+/* Last clock tick accounted on this processor, in KeGetPcr()->HalReserved[] */
+#define HAL_CLOCK_TICK              2
+
 /* Usage flags */
 #define IDT_REGISTERED          0x01
 #define IDT_LATCHED             0x02
@@ -464,6 +467,13 @@ HalpGetDebugPortTable(
     VOID
 );
 
+CODE_SEG("INIT")
+BOOLEAN
+NTAPI
+HalpGetHpetAddress(
+    OUT PPHYSICAL_ADDRESS Address
+);
+
 CODE_SEG("INIT")
 VOID
 NTAPI
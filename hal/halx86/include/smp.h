@@ -50,6 +50,15 @@ FASTCALL
 HalpBroadcastClockIpi(
     _In_ UCHAR Vector);
 
+BOOLEAN
+HalpEnterTicklessIdle(VOID);
+
+VOID
+HalpLeaveTicklessIdle(VOID);
+
+/* Number of clock interrupts so far, inside apic/rtctimer.c */
+extern volatile ULONG HalpClockTicks;
+
 /* APIC specific functions inside apic/apicsmp.c */
 
 VOID
@@ -59,6 +59,15 @@ HalpGetDebugPortTable(VOID)
     return FALSE;
 }
 
+CODE_SEG("INIT")
+BOOLEAN
+NTAPI
+HalpGetHpetAddress(OUT PPHYSICAL_ADDRESS Address)
+{
+    /* No ACPI, so no HPET table either */
+    return FALSE;
+}
+
 CODE_SEG("INIT")
 ULONG
 NTAPI
@@ -18,6 +18,9 @@
 
 extern PPROCESSOR_IDENTITY HalpProcessorIdentity;
 
+/* Processors halted in HalProcessorIdle, which get no clock IPIs */
+static volatile KAFFINITY HalpTicklessProcessors;
+
 /* FUNCTIONS *****************************************************************/
 
 VOID
@@ -39,6 +42,82 @@ FASTCALL
 HalpBroadcastClockIpi(
     _In_ UCHAR Vector)
 {
-    /* Send a clock IPI to all processors */
-    HalpBroadcastIpiSpecifyVector(Vector, FALSE);
+    KAFFINITY TargetSet;
+
+    /* Send a clock IPI to all other processors that are not idle */
+    TargetSet = HalpActiveProcessors &
+                ~HalpTicklessProcessors &
+                ~KeGetCurrentPrcb()->SetMember;
+    if (TargetSet)
+        HalRequestIpiSpecifyVector(TargetSet, Vector);
+}
+
+/*!
+ *  \brief Stops the clock IPIs to the current processor before it halts.
+ *
+ *  \return TRUE if the processor can halt without clock IPIs, FALSE if it
+ *          has work pending or owns the clock interrupt.
+ *
+ *  \remarks Called with interrupts disabled. Timers expire on the boot
+ *           processor and work for an idle processor comes with an IPI,
+ *           so the clock IPIs would only update the idle time. This only
+ *           holds where the kernel sends IPIs (KiIpiSend), which is amd64.
+ */
+BOOLEAN
+HalpEnterTicklessIdle(VOID)
+{
+#ifdef _M_AMD64
+    PKPRCB Prcb = KeGetCurrentPrcb();
+
+    /* The boot processor gets the clock interrupt itself */
+    if (Prcb->Number == 0)
+        return FALSE;
+
+    /* Make remote DPCs interrupt us, see KiInsertQueueDpc */
+    InterlockedExchange(&Prcb->Sleeping, 1);
+    InterlockedOrAffinity((PLONG_PTR)&HalpTicklessProcessors, Prcb->SetMember);
+
+    /* Work might have been queued before we were marked */
+    if ((Prcb->DpcData[0].DpcQueueDepth) ||
+        (Prcb->NextThread) ||
+        (Prcb->DeferredReadyListHead.Next))
+    {
+        HalpLeaveTicklessIdle();
+        return FALSE;
+    }
+
+    return TRUE;
+#else
+    /* Readied threads and DPCs would never wake the processor up */
+    return FALSE;
+#endif
+}
+
+/*!
+ *  \brief Resumes the clock IPIs and charges the missed ticks to the idle
+ *         thread.
+ */
+VOID
+HalpLeaveTicklessIdle(VOID)
+{
+    PKPRCB Prcb = KeGetCurrentPrcb();
+    ULONG_PTR Flags;
+    ULONG Ticks, MissedTicks;
+
+    /* Keep clock IPIs out while the ticks are counted */
+    Flags = __readeflags();
+    _disable();
+
+    InterlockedAndAffinity((PLONG_PTR)&HalpTicklessProcessors, ~Prcb->SetMember);
+    InterlockedExchange(&Prcb->Sleeping, 0);
+
+    /* A clock IPI that raced with us was already accounted */
+    Ticks = HalpClockTicks;
+    MissedTicks = Ticks - KeGetPcr()->HalReserved[HAL_CLOCK_TICK];
+    KeGetPcr()->HalReserved[HAL_CLOCK_TICK] = Ticks;
+
+    Prcb->KernelTime += MissedTicks;
+    Prcb->IdleThread->KernelTime += MissedTicks;
+
+    __writeeflags(Flags);
 }
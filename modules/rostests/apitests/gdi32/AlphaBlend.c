@@ -0,0 +1,335 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for GdiAlphaBlend and GdiTransparentBlt results
+ */
+
+#include "precomp.h"
+
+#define WIDTH 64
+#define HEIGHT 16
+
+static HDC ghdcSrc, ghdcDst;
+static PULONG gpulSrc;
+static PBYTE gpjDst;
+
+static HBITMAP
+CreateSection(HDC hdc, INT cx, INT cy, WORD bpp, PVOID *ppvBits)
+{
+    BITMAPINFO bmi;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = cx;
+    bmi.bmiHeader.biHeight = -cy;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = bpp;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    return CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
+}
+
+/* Source pixels covering opaque, transparent, premultiplied and
+   out of range (color > alpha) values */
+static ULONG
+SourcePixel(INT x, INT y)
+{
+    ULONG i = y * WIDTH + x;
+    ULONG Alpha;
+
+    switch (i % 8)
+    {
+        case 0: return 0;
+        case 1: return 0xFF000000 | (i * 0x010305);
+        case 2: return (i * 0x030507) & 0x00FFFFFF;
+        default:
+            Alpha = (i * 37) & 0xFF;
+            return (Alpha << 24) |
+                   ((((i * 13) & 0xFF) * Alpha / 255) << 16) |
+                   ((((i * 29) & 0xFF) * Alpha / 255) << 8) |
+                   (((i * 53) & 0xFF) * Alpha / 255);
+    }
+}
+
+static ULONG
+DestPixel(INT x, INT y)
+{
+    ULONG i = y * WIDTH + x;
+
+    return (i * 0x07050301) ^ 0x5A3C1E0F;
+}
+
+static UCHAR
+BlendChannel(ULONG Dst, ULONG Src, ULONG Alpha)
+{
+    ULONG Value = (Dst * (255 - Alpha)) / 255 + Src;
+
+    return (Value > 255) ? 255 : (UCHAR)Value;
+}
+
+/* What the DIB engine computes for one channel layout */
+static ULONG
+ReferenceBlend(ULONG Dst, ULONG Src, BLENDFUNCTION Blend)
+{
+    ULONG ScaledSrc = 0, Alpha, Result = 0;
+    INT i;
+
+    for (i = 0; i < 32; i += 8)
+        ScaledSrc |= (((Src >> i) & 0xFF) * Blend.SourceConstantAlpha / 255) << i;
+
+    Alpha = (Blend.AlphaFormat & AC_SRC_ALPHA) ? (ScaledSrc >> 24) : Blend.SourceConstantAlpha;
+
+    for (i = 0; i < 32; i += 8)
+        Result |= (ULONG)BlendChannel((Dst >> i) & 0xFF, (ScaledSrc >> i) & 0xFF, Alpha) << i;
+
+    return Result;
+}
+
+static INT
+MaxChannelDiff(ULONG a, ULONG b, INT Channels)
+{
+    INT i, Diff, Max = 0;
+
+    for (i = 0; i < Channels * 8; i += 8)
+    {
+        Diff = abs((INT)((a >> i) & 0xFF) - (INT)((b >> i) & 0xFF));
+        if (Diff > Max)
+            Max = Diff;
+    }
+    return Max;
+}
+
+static ULONG
+GetDestPixel(INT x, INT y, WORD bpp)
+{
+    PBYTE pj;
+
+    if (bpp == 32)
+        return ((PULONG)gpjDst)[y * WIDTH + x];
+
+    pj = gpjDst + y * ((WIDTH * 3 + 3) & ~3) + x * 3;
+    return pj[0] | (pj[1] << 8) | (pj[2] << 16);
+}
+
+static VOID
+FillDest(WORD bpp)
+{
+    INT x, y;
+    ULONG Pixel;
+    PBYTE pj;
+
+    for (y = 0; y < HEIGHT; y++)
+    {
+        for (x = 0; x < WIDTH; x++)
+        {
+            Pixel = DestPixel(x, y);
+            if (bpp == 32)
+            {
+                ((PULONG)gpjDst)[y * WIDTH + x] = Pixel;
+            }
+            else
+            {
+                pj = gpjDst + y * ((WIDTH * 3 + 3) & ~3) + x * 3;
+                pj[0] = (BYTE)Pixel;
+                pj[1] = (BYTE)(Pixel >> 8);
+                pj[2] = (BYTE)(Pixel >> 16);
+            }
+        }
+    }
+}
+
+static VOID
+TestBlend(WORD bpp, BYTE AlphaFormat, BYTE ConstAlpha, INT cxDst)
+{
+    BLENDFUNCTION Blend = { AC_SRC_OVER, 0, ConstAlpha, AlphaFormat };
+    INT x, y, sx, Diff, MaxDiff = 0, Errors = 0;
+    ULONG Expected, Result;
+    BOOL ret;
+
+    FillDest(bpp);
+    GdiFlush();
+
+    ret = GdiAlphaBlend(ghdcDst, 0, 0, cxDst, HEIGHT, ghdcSrc, 0, 0, WIDTH, HEIGHT, Blend);
+    ok(ret, "GdiAlphaBlend failed for %u bpp, format %u, alpha %u\n", bpp, AlphaFormat, ConstAlpha);
+    if (!ret)
+        return;
+    GdiFlush();
+
+    for (y = 0; y < HEIGHT; y++)
+    {
+        for (x = 0; x < WIDTH; x++)
+        {
+            Expected = DestPixel(x, y);
+            if (x < cxDst)
+            {
+                sx = x * WIDTH / cxDst;
+                Expected = ReferenceBlend(Expected, gpulSrc[y * WIDTH + sx], Blend);
+            }
+
+            /* Only compare the color channels, the 32 bpp alpha channel is
+               not something applications can rely on */
+            Result = GetDestPixel(x, y, bpp);
+            Diff = MaxChannelDiff(Result, Expected, 3);
+            if (Diff)
+            {
+                Errors++;
+                MaxDiff = max(MaxDiff, Diff);
+            }
+        }
+    }
+
+    /* Other implementations round differently, but never by more than one */
+    ok(Errors == 0 || broken(MaxDiff <= 1),
+       "%u bpp, format %u, alpha %u, width %d: %d pixels differ, by up to %d\n",
+       bpp, AlphaFormat, ConstAlpha, cxDst, Errors, MaxDiff);
+}
+
+/* A 24 bpp source has no alpha channel, only the constant alpha applies */
+static VOID
+TestBlend24Source(BYTE ConstAlpha)
+{
+    BLENDFUNCTION Blend = { AC_SRC_OVER, 0, ConstAlpha, 0 };
+    INT x, y, Diff, MaxDiff = 0, Errors = 0;
+    ULONG Expected, Source;
+    HBITMAP hbmSrc24;
+    PBYTE pjSrc24, pj;
+    HDC hdcSrc24;
+    BOOL ret;
+
+    hdcSrc24 = CreateCompatibleDC(NULL);
+    hbmSrc24 = CreateSection(hdcSrc24, WIDTH, HEIGHT, 24, (PVOID*)&pjSrc24);
+    ok(hbmSrc24 != NULL, "Failed to create the 24 bpp source bitmap\n");
+    if (!hbmSrc24)
+    {
+        DeleteDC(hdcSrc24);
+        return;
+    }
+    SelectObject(hdcSrc24, hbmSrc24);
+
+    for (y = 0; y < HEIGHT; y++)
+    {
+        for (x = 0; x < WIDTH; x++)
+        {
+            Source = SourcePixel(x, y);
+            pj = pjSrc24 + y * ((WIDTH * 3 + 3) & ~3) + x * 3;
+            pj[0] = (BYTE)Source;
+            pj[1] = (BYTE)(Source >> 8);
+            pj[2] = (BYTE)(Source >> 16);
+        }
+    }
+
+    FillDest(32);
+    GdiFlush();
+
+    ret = GdiAlphaBlend(ghdcDst, 0, 0, WIDTH, HEIGHT, hdcSrc24, 0, 0, WIDTH, HEIGHT, Blend);
+    ok(ret, "GdiAlphaBlend failed for a 24 bpp source, alpha %u\n", ConstAlpha);
+    GdiFlush();
+
+    for (y = 0; ret && y < HEIGHT; y++)
+    {
+        for (x = 0; x < WIDTH; x++)
+        {
+            Source = SourcePixel(x, y) & 0x00FFFFFF;
+            Expected = ReferenceBlend(DestPixel(x, y), Source, Blend);
+
+            Diff = MaxChannelDiff(GetDestPixel(x, y, 32), Expected, 3);
+            if (Diff)
+            {
+                Errors++;
+                MaxDiff = max(MaxDiff, Diff);
+            }
+        }
+    }
+
+    ok(Errors == 0 || broken(MaxDiff <= 1),
+       "24 bpp source, alpha %u: %d pixels differ, by up to %d\n",
+       ConstAlpha, Errors, MaxDiff);
+
+    DeleteDC(hdcSrc24);
+    DeleteObject(hbmSrc24);
+}
+
+static VOID
+TestTransparent(VOID)
+{
+    INT x, y, Errors = 0;
+    ULONG Expected, TransColor = SourcePixel(1, 0) & 0x00FFFFFF;
+    BOOL ret;
+
+    FillDest(32);
+    GdiFlush();
+
+    ret = GdiTransparentBlt(ghdcDst, 0, 0, WIDTH, HEIGHT, ghdcSrc, 0, 0, WIDTH, HEIGHT,
+                            RGB(TransColor >> 16, (TransColor >> 8) & 0xFF, TransColor & 0xFF));
+    ok(ret, "GdiTransparentBlt failed\n");
+    GdiFlush();
+
+    for (y = 0; y < HEIGHT; y++)
+    {
+        for (x = 0; x < WIDTH; x++)
+        {
+            Expected = gpulSrc[y * WIDTH + x];
+            if ((Expected & 0x00FFFFFF) == TransColor)
+                Expected = DestPixel(x, y);
+
+            if ((GetDestPixel(x, y, 32) & 0x00FFFFFF) != (Expected & 0x00FFFFFF))
+                Errors++;
+        }
+    }
+
+    ok_int(Errors, 0);
+}
+
+START_TEST(AlphaBlend)
+{
+    static const BYTE ConstAlphas[] = { 0, 1, 77, 128, 254, 255 };
+    HBITMAP hbmSrc, hbmDst;
+    WORD bpp;
+    INT x, y, i;
+
+    ghdcSrc = CreateCompatibleDC(NULL);
+    ghdcDst = CreateCompatibleDC(NULL);
+    ok(ghdcSrc && ghdcDst, "CreateCompatibleDC failed\n");
+
+    hbmSrc = CreateSection(ghdcSrc, WIDTH, HEIGHT, 32, (PVOID*)&gpulSrc);
+    ok(hbmSrc != NULL, "Failed to create the source bitmap\n");
+    if (!hbmSrc)
+        return;
+    SelectObject(ghdcSrc, hbmSrc);
+
+    for (y = 0; y < HEIGHT; y++)
+        for (x = 0; x < WIDTH; x++)
+            gpulSrc[y * WIDTH + x] = SourcePixel(x, y);
+
+    for (bpp = 24; bpp <= 32; bpp += 8)
+    {
+        hbmDst = CreateSection(ghdcDst, WIDTH, HEIGHT, bpp, (PVOID*)&gpjDst);
+        ok(hbmDst != NULL, "Failed to create the %u bpp destination bitmap\n", bpp);
+        if (!hbmDst)
+            continue;
+        SelectObject(ghdcDst, hbmDst);
+
+        for (i = 0; i < sizeof(ConstAlphas) / sizeof(ConstAlphas[0]); i++)
+        {
+            TestBlend(bpp, 0, ConstAlphas[i], WIDTH);
+            TestBlend(bpp, AC_SRC_ALPHA, ConstAlphas[i], WIDTH);
+            TestBlend(bpp, AC_SRC_ALPHA, ConstAlphas[i], WIDTH / 2);
+        }
+
+        if (bpp == 32)
+        {
+            for (i = 0; i < sizeof(ConstAlphas) / sizeof(ConstAlphas[0]); i++)
+                TestBlend24Source(ConstAlphas[i]);
+
+            TestTransparent();
+        }
+
+        SelectObject(ghdcDst, GetStockObject(DEFAULT_BITMAP));
+        DeleteObject(hbmDst);
+    }
+
+    SelectObject(ghdcSrc, GetStockObject(DEFAULT_BITMAP));
+    DeleteObject(hbmSrc);
+    DeleteDC(ghdcSrc);
+    DeleteDC(ghdcDst);
+}
@@ -0,0 +1,264 @@
+/*
+ * PROJECT:     ReactOS api tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Test for CopyFileExW results, progress and throughput
+ */
+
+#include "precomp.h"
+
+static const WCHAR SourceName[] = L"CopyFileSource.xxx";
+static const WCHAR DestName[] = L"CopyFileDest.xxx";
+
+#define LARGE_FILE_SIZE (64 * 1024 * 1024)
+
+typedef struct _PROGRESS_DATA
+{
+    ULONG Calls;
+    ULONG StreamSwitches;
+    LONGLONG LastTransferred;
+    BOOL Backwards;
+    DWORD Result;
+    ULONG StopAfter;
+} PROGRESS_DATA, *PPROGRESS_DATA;
+
+static BYTE
+PatternByte(ULONG Offset)
+{
+    return (BYTE)((Offset * 7) ^ (Offset >> 9) ^ (Offset >> 17));
+}
+
+static BOOL
+CreateSourceFile(ULONG Size)
+{
+    HANDLE hFile;
+    PBYTE Buffer;
+    ULONG Offset, Chunk, i;
+    DWORD Written;
+    BOOL Ret = TRUE;
+
+    hFile = CreateFileW(SourceName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return FALSE;
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, 0x10000);
+    if (!Buffer)
+    {
+        CloseHandle(hFile);
+        return FALSE;
+    }
+
+    for (Offset = 0; Ret && Offset < Size; Offset += Chunk)
+    {
+        Chunk = min(Size - Offset, 0x10000);
+        for (i = 0; i < Chunk; i++)
+            Buffer[i] = PatternByte(Offset + i);
+        Ret = WriteFile(hFile, Buffer, Chunk, &Written, NULL) && Written == Chunk;
+    }
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    CloseHandle(hFile);
+    return Ret;
+}
+
+/* Returns the offset of the first wrong byte, or -1 if the copy matches */
+static LONGLONG
+CheckDestFile(ULONG Size)
+{
+    HANDLE hFile;
+    PBYTE Buffer;
+    ULONG Offset, i;
+    DWORD Read;
+    LONGLONG Result = -1;
+
+    hFile = CreateFileW(DestName, GENERIC_READ, 0, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return 0;
+
+    if (GetFileSize(hFile, NULL) != Size)
+    {
+        CloseHandle(hFile);
+        return 0;
+    }
+
+    Buffer = HeapAlloc(GetProcessHeap(), 0, 0x10000);
+    if (!Buffer)
+    {
+        CloseHandle(hFile);
+        return 0;
+    }
+
+    for (Offset = 0; Result == -1 && Offset < Size; Offset += Read)
+    {
+        if (!ReadFile(hFile, Buffer, 0x10000, &Read, NULL) || !Read)
+        {
+            Result = Offset;
+            break;
+        }
+        for (i = 0; i < Read; i++)
+        {
+            if (Buffer[i] != PatternByte(Offset + i))
+            {
+                Result = Offset + i;
+                break;
+            }
+        }
+    }
+
+    HeapFree(GetProcessHeap(), 0, Buffer);
+    CloseHandle(hFile);
+    return Result;
+}
+
+static DWORD
+CALLBACK
+ProgressRoutine(
+    LARGE_INTEGER TotalFileSize,
+    LARGE_INTEGER TotalBytesTransferred,
+    LARGE_INTEGER StreamSize,
+    LARGE_INTEGER StreamBytesTransferred,
+    DWORD dwStreamNumber,
+    DWORD dwCallbackReason,
+    HANDLE hSourceFile,
+    HANDLE hDestinationFile,
+    LPVOID lpData)
+{
+    PPROGRESS_DATA Data = lpData;
+
+    Data->Calls++;
+    if (dwCallbackReason == CALLBACK_STREAM_SWITCH)
+        Data->StreamSwitches++;
+    if (TotalBytesTransferred.QuadPart < Data->LastTransferred ||
+        TotalBytesTransferred.QuadPart > TotalFileSize.QuadPart)
+    {
+        Data->Backwards = TRUE;
+    }
+    Data->LastTransferred = TotalBytesTransferred.QuadPart;
+
+    if (Data->StopAfter && Data->Calls >= Data->StopAfter)
+        return Data->Result;
+    return PROGRESS_CONTINUE;
+}
+
+static VOID
+TestCopy(ULONG Size, DWORD Flags)
+{
+    PROGRESS_DATA Data;
+    BOOL Ret;
+
+    ok(CreateSourceFile(Size), "Failed to create a %lu bytes source file\n", Size);
+
+    RtlZeroMemory(&Data, sizeof(Data));
+    Ret = CopyFileExW(SourceName, DestName, ProgressRoutine, &Data, NULL, Flags);
+    ok(Ret, "Copying %lu bytes with flags 0x%lx failed with %lu\n", Size, Flags, GetLastError());
+    ok(CheckDestFile(Size) == -1, "Copy of %lu bytes with flags 0x%lx differs\n", Size, Flags);
+    ok(Data.StreamSwitches == 1, "%lu stream switches for %lu bytes\n", Data.StreamSwitches, Size);
+    ok(!Data.Backwards, "Progress went backwards for %lu bytes\n", Size);
+    ok(Data.LastTransferred == Size, "Last progress was %I64d for %lu bytes\n", Data.LastTransferred, Size);
+
+    DeleteFileW(DestName);
+}
+
+static VOID
+TestExistingDest(VOID)
+{
+    BOOL Ret;
+
+    ok(CreateSourceFile(1000), "Failed to create the source file\n");
+    ok(CopyFileExW(SourceName, DestName, NULL, NULL, NULL, 0), "First copy failed with %lu\n", GetLastError());
+
+    /* Only COPY_FILE_FAIL_IF_EXISTS may keep an existing file */
+    SetLastError(0xdeadbeef);
+    Ret = CopyFileExW(SourceName, DestName, NULL, NULL, NULL, COPY_FILE_FAIL_IF_EXISTS);
+    ok(!Ret, "Copy over an existing file succeeded\n");
+    ok_err(ERROR_FILE_EXISTS);
+
+    Ret = CopyFileExW(SourceName, DestName, NULL, NULL, NULL, COPY_FILE_NO_BUFFERING);
+    ok(Ret, "Replacing copy failed with %lu\n", GetLastError());
+    ok(CheckDestFile(1000) == -1, "Replaced copy differs\n");
+
+    DeleteFileW(DestName);
+}
+
+static VOID
+TestCancel(VOID)
+{
+    PROGRESS_DATA Data;
+    BOOL Ret;
+
+    ok(CreateSourceFile(8 * 1024 * 1024), "Failed to create the source file\n");
+
+    /* Cancelling removes the target */
+    RtlZeroMemory(&Data, sizeof(Data));
+    Data.StopAfter = 2;
+    Data.Result = PROGRESS_CANCEL;
+    SetLastError(0xdeadbeef);
+    Ret = CopyFileExW(SourceName, DestName, ProgressRoutine, &Data, NULL, 0);
+    ok(!Ret, "Cancelled copy succeeded\n");
+    ok_err(ERROR_REQUEST_ABORTED);
+    ok(GetFileAttributesW(DestName) == INVALID_FILE_ATTRIBUTES, "Target of the cancelled copy exists\n");
+
+    /* Stopping keeps it */
+    RtlZeroMemory(&Data, sizeof(Data));
+    Data.StopAfter = 2;
+    Data.Result = PROGRESS_STOP;
+    Ret = CopyFileExW(SourceName, DestName, ProgressRoutine, &Data, NULL, 0);
+    ok(!Ret, "Stopped copy succeeded\n");
+    ok(GetFileAttributesW(DestName) != INVALID_FILE_ATTRIBUTES, "Target of the stopped copy is gone\n");
+
+    DeleteFileW(DestName);
+}
+
+static VOID
+TestThroughput(DWORD Flags)
+{
+    LARGE_INTEGER Frequency, Start, Stop;
+    double Seconds;
+    BOOL Ret;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    Ret = CopyFileExW(SourceName, DestName, NULL, NULL, NULL, Flags);
+    QueryPerformanceCounter(&Stop);
+    ok(Ret, "Copy with flags 0x%lx failed with %lu\n", Flags, GetLastError());
+
+    Seconds = (double)(Stop.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    trace("Copying %u MB with flags 0x%lx: %.0f ms, %.1f MB/s\n",
+          LARGE_FILE_SIZE / (1024 * 1024), Flags, Seconds * 1000,
+          LARGE_FILE_SIZE / (1024.0 * 1024.0) / Seconds);
+
+    ok(CheckDestFile(LARGE_FILE_SIZE) == -1, "Large copy with flags 0x%lx differs\n", Flags);
+    DeleteFileW(DestName);
+}
+
+START_TEST(CopyFile)
+{
+    /* Around the chunk and sector sizes, and past a few pipelined chunks */
+    static const ULONG Sizes[] =
+    {
+        0, 1, 511, 512, 513, 4096, 65535, 65536, 65537,
+        3 * 65536 + 17, 1024 * 1024, 3 * 1024 * 1024 + 1, 5 * 1024 * 1024 + 4097
+    };
+    ULONG i;
+
+    for (i = 0; i < sizeof(Sizes) / sizeof(Sizes[0]); i++)
+    {
+        TestCopy(Sizes[i], 0);
+        TestCopy(Sizes[i], COPY_FILE_NO_BUFFERING);
+    }
+
+    TestExistingDest();
+    TestCancel();
+
+    if (CreateSourceFile(LARGE_FILE_SIZE))
+    {
+        TestThroughput(0);
+        TestThroughput(COPY_FILE_NO_BUFFERING);
+    }
+    else
+    {
+        skip("Could not create a %u MB file\n", LARGE_FILE_SIZE / (1024 * 1024));
+    }
+
+    DeleteFileW(SourceName);
+    DeleteFileW(DestName);
+}
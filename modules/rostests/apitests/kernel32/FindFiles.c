@@ -534,6 +534,77 @@ static void Test_FindFirstFileExW(void)
     SetCurrentDirectoryW(CurrentDirectory);
 }
 
+#define LARGE_DIR_FILES 5000
+
+static ULONG CountFilesW(LPCWSTR Pattern, FINDEX_INFO_LEVELS InfoLevel, DWORD Flags, double *Seconds)
+{
+    LARGE_INTEGER Frequency, Start, Stop;
+    WIN32_FIND_DATAW fd;
+    HANDLE h;
+    ULONG Count = 0;
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    h = FindFirstFileExW(Pattern, InfoLevel, &fd, FindExSearchNameMatch, NULL, Flags);
+    ok(h != INVALID_HANDLE_VALUE, "FindFirstFileExW with flags 0x%lx failed with %lu\n", Flags, GetLastError());
+    if (h == INVALID_HANDLE_VALUE)
+        return 0;
+    do
+    {
+        if (!(fd.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            ++Count;
+    } while (FindNextFileW(h, &fd));
+    ok(GetLastError() == ERROR_NO_MORE_FILES, "FindNextFileW failed with %lu\n", GetLastError());
+    FindClose(h);
+    QueryPerformanceCounter(&Stop);
+
+    *Seconds = (double)(Stop.QuadPart - Start.QuadPart) / Frequency.QuadPart;
+    return Count;
+}
+
+static void Test_LargeDirectory(void)
+{
+    WCHAR TempPath[MAX_PATH], DirName[MAX_PATH], FileName[MAX_PATH + 16];
+    HANDLE hFile;
+    ULONG i, Created, Count;
+    double Seconds;
+
+    GetTempPathW(_countof(TempPath), TempPath);
+    StringCchPrintfW(DirName, _countof(DirName), L"%sFindFilesLargeDir", TempPath);
+    if (!CreateDirectoryW(DirName, NULL) && GetLastError() != ERROR_ALREADY_EXISTS)
+    {
+        skip("Could not create %ls\n", DirName);
+        return;
+    }
+
+    /* Long names so that the directory takes several buffers */
+    for (Created = 0; Created < LARGE_DIR_FILES; ++Created)
+    {
+        StringCchPrintfW(FileName, _countof(FileName), L"%s\\a_rather_long_file_name_for_the_find_buffers_%05lu.txt", DirName, Created);
+        hFile = CreateFileW(FileName, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (hFile == INVALID_HANDLE_VALUE)
+            break;
+        CloseHandle(hFile);
+    }
+    ok(Created == LARGE_DIR_FILES, "Created %lu files, error %lu\n", Created, GetLastError());
+
+    StringCchPrintfW(FileName, _countof(FileName), L"%s\\*", DirName);
+    Count = CountFilesW(FileName, FindExInfoStandard, 0, &Seconds);
+    ok(Count == Created, "Found %lu files instead of %lu\n", Count, Created);
+    trace("Enumerating %lu files: %.1f ms\n", Count, Seconds * 1000);
+
+    Count = CountFilesW(FileName, FindExInfoBasic, FIND_FIRST_EX_LARGE_FETCH, &Seconds);
+    ok(Count == Created, "Found %lu files instead of %lu with FIND_FIRST_EX_LARGE_FETCH\n", Count, Created);
+    trace("Enumerating %lu files with FIND_FIRST_EX_LARGE_FETCH: %.1f ms\n", Count, Seconds * 1000);
+
+    for (i = 0; i < Created; ++i)
+    {
+        StringCchPrintfW(FileName, _countof(FileName), L"%s\\a_rather_long_file_name_for_the_find_buffers_%05lu.txt", DirName, i);
+        DeleteFileW(FileName);
+    }
+    RemoveDirectoryW(DirName);
+}
+
 static int init(void)
 {
     LPSTR p;
@@ -582,4 +653,5 @@ START_TEST(FindFiles)
     Test_FindFirstFileW();
     Test_FindFirstFileExA();
     Test_FindFirstFileExW();
+    Test_LargeDirectory();
 }
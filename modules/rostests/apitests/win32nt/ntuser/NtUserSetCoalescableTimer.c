@@ -0,0 +1,162 @@
+/*
+ * PROJECT:     ReactOS API tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Tests for NtUserSetCoalescableTimer
+ */
+
+#include "../win32nt.h"
+
+#ifndef TIMERV_NO_COALESCING
+#define TIMERV_DEFAULT_COALESCING   0
+#define TIMERV_NO_COALESCING        0xFFFFFFFF
+#define TIMERV_COALESCING_MAX       0x7FFFFFF5
+#endif
+
+#define TIMER_COUNT 8
+#define TIMER_INTERVAL 20
+#define TIMER_TOLERANCE 30
+#define RUN_TIME 500
+
+/* A lax timer set first, then a strict one due after it but needed sooner */
+#define LAX_TIMER_ID 100
+#define LAX_INTERVAL 100
+#define LAX_TOLERANCE 1000
+#define STRICT_TIMER_ID 101
+#define STRICT_INTERVAL 200
+/* A few clock ticks */
+#define FIRE_SLACK 50
+
+static UINT Counters[TIMER_COUNT];
+static DWORD LaxFired, StrictFired;
+
+static LRESULT CALLBACK
+WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    if (uMsg == WM_TIMER && wParam < TIMER_COUNT)
+    {
+        Counters[wParam]++;
+        return 0;
+    }
+
+    if (uMsg == WM_TIMER && wParam == LAX_TIMER_ID)
+    {
+        if (!LaxFired)
+            LaxFired = GetTickCount();
+        return 0;
+    }
+
+    if (uMsg == WM_TIMER && wParam == STRICT_TIMER_ID)
+    {
+        if (!StrictFired)
+            StrictFired = GetTickCount();
+        return 0;
+    }
+
+    return DefWindowProcW(hwnd, uMsg, wParam, lParam);
+}
+
+static VOID
+RunMessageLoop(VOID)
+{
+    DWORD StartTime = GetTickCount();
+    MSG msg;
+
+    while (GetMessageW(&msg, NULL, 0, 0))
+    {
+        DispatchMessageW(&msg);
+
+        if (GetTickCount() - StartTime >= RUN_TIME)
+            PostQuitMessage(0);
+    }
+}
+
+static VOID
+TestCoalescing(HWND hwnd)
+{
+    DWORD StartTime;
+    UINT_PTR Ret;
+    MSG msg;
+
+    StartTime = GetTickCount();
+
+    Ret = NtUserSetCoalescableTimer(hwnd, LAX_TIMER_ID, LAX_INTERVAL, NULL, LAX_TOLERANCE);
+    ok(Ret != 0, "NtUserSetCoalescableTimer failed\n");
+    Ret = NtUserSetCoalescableTimer(hwnd, STRICT_TIMER_ID, STRICT_INTERVAL, NULL, TIMERV_NO_COALESCING);
+    ok(Ret != 0, "NtUserSetCoalescableTimer failed\n");
+
+    while ((!LaxFired || !StrictFired) &&
+           GetTickCount() - StartTime < LAX_INTERVAL + LAX_TOLERANCE + 500)
+    {
+        if (GetMessageW(&msg, NULL, 0, 0))
+            DispatchMessageW(&msg);
+    }
+
+    KillTimer(hwnd, LAX_TIMER_ID);
+    KillTimer(hwnd, STRICT_TIMER_ID);
+
+    /* The strict timer must not wait for the deadline of the lax one */
+    ok(StrictFired && StrictFired - StartTime <= STRICT_INTERVAL + FIRE_SLACK,
+       "Strict timer fired after %lu ms\n", StrictFired ? StrictFired - StartTime : 0);
+
+    /* The lax timer is due by then, so it goes off with it instead of on its own later */
+    ok(LaxFired && LaxFired - StartTime >= LAX_INTERVAL - FIRE_SLACK &&
+       LaxFired - StartTime <= STRICT_INTERVAL + FIRE_SLACK,
+       "Lax timer fired after %lu ms\n", LaxFired ? LaxFired - StartTime : 0);
+}
+
+START_TEST(NtUserSetCoalescableTimer)
+{
+    WNDCLASSW wc = { 0 };
+    HWND hwnd;
+    UINT_PTR Ret;
+    UINT i;
+
+    wc.lpfnWndProc = WindowProc;
+    wc.hInstance = GetModuleHandleW(NULL);
+    wc.lpszClassName = L"CoalescableTimerClass";
+    RegisterClassW(&wc);
+
+    hwnd = CreateWindowExW(0, L"CoalescableTimerClass", L"Timer Window", 0,
+                           CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
+                           HWND_MESSAGE, NULL, GetModuleHandleW(NULL), NULL);
+    ok(hwnd != NULL, "CreateWindowExW failed\n");
+    if (!hwnd)
+        return;
+
+    /* Invalid tolerance */
+    SetLastError(0xdeadbeef);
+    Ret = NtUserSetCoalescableTimer(hwnd, 0, TIMER_INTERVAL, NULL, TIMERV_COALESCING_MAX + 1);
+    ok_long(Ret, 0);
+    ok_long(GetLastError(), ERROR_INVALID_PARAMETER);
+
+    /* Timers with a tolerance still fire, each one at its own rate */
+    for (i = 0; i < TIMER_COUNT; i++)
+    {
+        Ret = NtUserSetCoalescableTimer(hwnd, i, TIMER_INTERVAL + i,
+                                        NULL, (i % 2) ? TIMER_TOLERANCE : TIMERV_NO_COALESCING);
+        ok(Ret != 0, "Timer %u: NtUserSetCoalescableTimer failed\n", i);
+    }
+
+    RunMessageLoop();
+
+    for (i = 0; i < TIMER_COUNT; i++)
+    {
+        /* At most the rate without tolerance, at least the rate with the longest delay */
+        ok(Counters[i] >= RUN_TIME / (TIMER_INTERVAL + i + TIMER_TOLERANCE) / 2 &&
+           Counters[i] <= RUN_TIME / (TIMER_INTERVAL + i) + 1,
+           "Timer %u fired %u times\n", i, Counters[i]);
+        ok(KillTimer(hwnd, i), "Timer %u: KillTimer failed\n", i);
+    }
+
+    /* The default tolerance is accepted too, and the timer can be reset */
+    Ret = NtUserSetCoalescableTimer(hwnd, 0, TIMER_INTERVAL, NULL, TIMERV_DEFAULT_COALESCING);
+    ok(Ret != 0, "NtUserSetCoalescableTimer failed\n");
+    Ret = NtUserSetCoalescableTimer(hwnd, 0, TIMER_INTERVAL * 2, NULL, TIMER_TOLERANCE);
+    ok(Ret != 0, "NtUserSetCoalescableTimer failed\n");
+    ok(KillTimer(hwnd, 0), "KillTimer failed\n");
+
+    TestCoalescing(hwnd);
+
+    DestroyWindow(hwnd);
+    UnregisterClassW(L"CoalescableTimerClass", NULL);
+}
@@ -62,6 +62,7 @@ extern void func_NtUserProcessConnect(void);
 extern void func_NtUserRedrawWindow(void);
 extern void func_NtUserScrollDC(void);
 extern void func_NtUserSelectPalette(void);
+extern void func_NtUserSetCoalescableTimer(void);
 extern void func_NtUserSetTimer(void);
 extern void func_NtUserSystemParametersInfo(void);
 extern void func_NtUserToUnicodeEx(void);
@@ -131,6 +132,7 @@ const struct test winetest_testlist[] =
     { "NtUserRedrawWindow", func_NtUserRedrawWindow },
     { "NtUserScrollDC", func_NtUserScrollDC },
     { "NtUserSelectPalette", func_NtUserSelectPalette },
+    { "NtUserSetCoalescableTimer", func_NtUserSetCoalescableTimer },
     { "NtUserSetTimer", func_NtUserSetTimer },
     { "NtUserSystemParametersInfo", func_NtUserSystemParametersInfo },
     { "NtUserToUnicodeEx", func_NtUserToUnicodeEx },
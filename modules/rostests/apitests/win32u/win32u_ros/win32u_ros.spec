@@ -515,6 +515,7 @@
 @ stdcall NtUserSetClassWord(ptr long long)
 @ stdcall NtUserSetClipboardData(long ptr ptr)
 @ stdcall NtUserSetClipboardViewer(ptr)
+@ stdcall NtUserSetCoalescableTimer(ptr ptr long ptr long)
 @ stdcall NtUserSetConsoleReserveKeys(long long)
 @ stdcall NtUserSetCursor(ptr)
 @ stdcall NtUserSetCursorContents(ptr ptr)
@@ -0,0 +1,181 @@
+/*
+ * Times SRCCOPY BitBlt between DIB sections for every combination of
+ * source and destination format, which exercises the color translation
+ * of the DIB BitBltSrcCopy routines.
+ *
+ * Usage: bltbench [iterations]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define WIDTH  640
+#define HEIGHT 480
+
+static const struct
+{
+    int bpp;
+    BOOL b565;
+    const char *name;
+} Formats[] =
+{
+    { 8, FALSE, "8" },
+    { 16, FALSE, "16/555" },
+    { 16, TRUE, "16/565" },
+    { 24, FALSE, "24" },
+    { 32, FALSE, "32" },
+};
+
+#define FORMAT_COUNT (sizeof(Formats) / sizeof(Formats[0]))
+
+static HBITMAP
+CreateSection(HDC hdc, int iFormat, void **ppvBits)
+{
+    struct
+    {
+        BITMAPINFOHEADER bmiHeader;
+        RGBQUAD bmiColors[256];
+    } bmi;
+    DWORD *pdwMasks = (DWORD *)bmi.bmiColors;
+    int i;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = WIDTH;
+    bmi.bmiHeader.biHeight = -HEIGHT;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = Formats[iFormat].bpp;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    if (Formats[iFormat].b565)
+    {
+        bmi.bmiHeader.biCompression = BI_BITFIELDS;
+        pdwMasks[0] = 0xF800;
+        pdwMasks[1] = 0x07E0;
+        pdwMasks[2] = 0x001F;
+    }
+    else
+    {
+        /* A 6x6x6 color cube plus grays, so that blits to 8 bpp need a
+           nearest color search */
+        for (i = 0; i < 216; i++)
+        {
+            bmi.bmiColors[i].rgbRed = (i / 36) * 51;
+            bmi.bmiColors[i].rgbGreen = ((i / 6) % 6) * 51;
+            bmi.bmiColors[i].rgbBlue = (i % 6) * 51;
+        }
+        for (; i < 256; i++)
+        {
+            bmi.bmiColors[i].rgbRed = (i - 216) * 6 + 8;
+            bmi.bmiColors[i].rgbGreen = (i - 216) * 6 + 8;
+            bmi.bmiColors[i].rgbBlue = (i - 216) * 6 + 8;
+        }
+    }
+
+    return CreateDIBSection(hdc, (BITMAPINFO *)&bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
+}
+
+static void
+FillPattern(BYTE *pjBits, int bpp)
+{
+    int stride = ((WIDTH * bpp + 31) / 32) * 4;
+    int x, y;
+
+    for (y = 0; y < HEIGHT; y++)
+    {
+        for (x = 0; x < stride; x++)
+        {
+            pjBits[y * stride + x] = (BYTE)(x * 7 + y * 13 + (x ^ y));
+        }
+    }
+}
+
+static double
+TimeBlt(HDC hdcDst, HDC hdcSrc, int iterations)
+{
+    LARGE_INTEGER freq, start, stop;
+    int i;
+
+    /* Warm up */
+    BitBlt(hdcDst, 0, 0, WIDTH, HEIGHT, hdcSrc, 0, 0, SRCCOPY);
+    GdiFlush();
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < iterations; i++)
+    {
+        BitBlt(hdcDst, 0, 0, WIDTH, HEIGHT, hdcSrc, 0, 0, SRCCOPY);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&stop);
+
+    return (double)(stop.QuadPart - start.QuadPart) / freq.QuadPart;
+}
+
+int main(int argc, char *argv[])
+{
+    HDC hdcScreen, hdcSrc, hdcDst;
+    HBITMAP ahbm[FORMAT_COUNT], hbmOldSrc, hbmOldDst;
+    void *pvBits;
+    int iterations = 50;
+    int s, d;
+    double seconds;
+
+    if (argc > 1)
+        iterations = max(1, atoi(argv[1]));
+
+    hdcScreen = GetDC(NULL);
+    hdcSrc = CreateCompatibleDC(hdcScreen);
+    hdcDst = CreateCompatibleDC(hdcScreen);
+
+    for (s = 0; s < FORMAT_COUNT; s++)
+    {
+        ahbm[s] = CreateSection(hdcScreen, s, &pvBits);
+        if (!ahbm[s])
+        {
+            printf("Could not create a %s bpp bitmap (error %lu)\n", Formats[s].name, GetLastError());
+            return 1;
+        }
+        FillPattern(pvBits, Formats[s].bpp);
+    }
+
+    printf("%d iterations, %dx%d, Mpixel/s\n\n", iterations, WIDTH, HEIGHT);
+    printf("%-8s", "src\\dst");
+    for (d = 0; d < FORMAT_COUNT; d++)
+        printf("%10s", Formats[d].name);
+    printf("\n");
+
+    for (s = 0; s < FORMAT_COUNT; s++)
+    {
+        printf("%-8s", Formats[s].name);
+        hbmOldSrc = SelectObject(hdcSrc, ahbm[s]);
+
+        for (d = 0; d < FORMAT_COUNT; d++)
+        {
+            /* A bitmap can only be selected into one DC */
+            if (d == s)
+            {
+                printf("%10s", "-");
+                continue;
+            }
+
+            hbmOldDst = SelectObject(hdcDst, ahbm[d]);
+            seconds = TimeBlt(hdcDst, hdcSrc, iterations);
+            SelectObject(hdcDst, hbmOldDst);
+            printf("%10.1f", (double)WIDTH * HEIGHT * iterations / seconds / 1000000.0);
+        }
+        printf("\n");
+
+        /* Free the source for use as a destination */
+        SelectObject(hdcSrc, hbmOldSrc);
+    }
+
+    for (s = 0; s < FORMAT_COUNT; s++)
+        DeleteObject(ahbm[s]);
+    DeleteDC(hdcDst);
+    DeleteDC(hdcSrc);
+    ReleaseDC(NULL, hdcScreen);
+
+    return 0;
+}
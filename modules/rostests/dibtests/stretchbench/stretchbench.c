@@ -0,0 +1,162 @@
+/*
+ * Times StretchBlt between DIB sections of different bit depths into a
+ * 32 bpp DIB section, for enlarging and shrinking, in COLORONCOLOR and
+ * HALFTONE mode.
+ *
+ * Usage: stretchbench [iterations]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SRC_WIDTH  640
+#define SRC_HEIGHT 480
+
+static const struct
+{
+    int cx, cy;
+    const char *name;
+} Sizes[] =
+{
+    { SRC_WIDTH, SRC_HEIGHT, "1:1" },
+    { SRC_WIDTH * 2, SRC_HEIGHT * 2, "2x" },
+    { SRC_WIDTH * 3 / 2, SRC_HEIGHT * 3 / 2, "1.5x" },
+    { SRC_WIDTH / 2, SRC_HEIGHT / 2, "0.5x" },
+    { SRC_WIDTH / 3, SRC_HEIGHT / 3, "0.33x" },
+};
+
+static const int Depths[] = { 8, 16, 24, 32 };
+
+static HBITMAP
+CreateSection(HDC hdc, int cx, int cy, int bpp, void **ppvBits)
+{
+    struct
+    {
+        BITMAPINFOHEADER bmiHeader;
+        RGBQUAD bmiColors[256];
+    } bmi;
+    int i;
+
+    ZeroMemory(&bmi, sizeof(bmi));
+    bmi.bmiHeader.biSize = sizeof(BITMAPINFOHEADER);
+    bmi.bmiHeader.biWidth = cx;
+    bmi.bmiHeader.biHeight = -cy;
+    bmi.bmiHeader.biPlanes = 1;
+    bmi.bmiHeader.biBitCount = bpp;
+    bmi.bmiHeader.biCompression = BI_RGB;
+
+    /* A gray ramp, so that 8 bpp sources need palette translation */
+    for (i = 0; i < 256; i++)
+    {
+        bmi.bmiColors[i].rgbRed = i;
+        bmi.bmiColors[i].rgbGreen = i;
+        bmi.bmiColors[i].rgbBlue = 255 - i;
+    }
+
+    return CreateDIBSection(hdc, (BITMAPINFO *)&bmi, DIB_RGB_COLORS, ppvBits, NULL, 0);
+}
+
+static void
+FillPattern(BYTE *pjBits, int cx, int cy, int bpp)
+{
+    int stride = ((cx * bpp + 31) / 32) * 4;
+    int x, y;
+
+    for (y = 0; y < cy; y++)
+    {
+        for (x = 0; x < stride; x++)
+        {
+            pjBits[y * stride + x] = (BYTE)(x * 7 + y * 13 + (x ^ y));
+        }
+    }
+}
+
+static double
+TimeStretch(HDC hdcDst, HDC hdcSrc, int cx, int cy, int mode, int iterations)
+{
+    LARGE_INTEGER freq, start, stop;
+    int i;
+
+    SetStretchBltMode(hdcDst, mode);
+
+    /* Warm up */
+    StretchBlt(hdcDst, 0, 0, cx, cy, hdcSrc, 0, 0, SRC_WIDTH, SRC_HEIGHT, SRCCOPY);
+    GdiFlush();
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < iterations; i++)
+    {
+        StretchBlt(hdcDst, 0, 0, cx, cy, hdcSrc, 0, 0, SRC_WIDTH, SRC_HEIGHT, SRCCOPY);
+    }
+    GdiFlush();
+    QueryPerformanceCounter(&stop);
+
+    return (double)(stop.QuadPart - start.QuadPart) / freq.QuadPart;
+}
+
+int main(int argc, char *argv[])
+{
+    HDC hdcScreen, hdcSrc, hdcDst;
+    HBITMAP hbmSrc, hbmDst, hbmOldSrc, hbmOldDst;
+    void *pvSrc, *pvDst;
+    int iterations = 50;
+    int d, s, m;
+    double seconds;
+
+    if (argc > 1)
+        iterations = max(1, atoi(argv[1]));
+
+    hdcScreen = GetDC(NULL);
+    hdcSrc = CreateCompatibleDC(hdcScreen);
+    hdcDst = CreateCompatibleDC(hdcScreen);
+
+    hbmDst = CreateSection(hdcScreen, SRC_WIDTH * 2, SRC_HEIGHT * 2, 32, &pvDst);
+    if (!hbmDst)
+    {
+        printf("Could not create the destination bitmap (error %lu)\n", GetLastError());
+        return 1;
+    }
+    hbmOldDst = SelectObject(hdcDst, hbmDst);
+
+    printf("%d iterations, source %dx%d, destination 32 bpp\n\n", iterations, SRC_WIDTH, SRC_HEIGHT);
+    printf("%-4s %-6s %-13s %10s %12s\n", "bpp", "scale", "mode", "ms/blt", "Mpixel/s");
+
+    for (d = 0; d < sizeof(Depths) / sizeof(Depths[0]); d++)
+    {
+        hbmSrc = CreateSection(hdcScreen, SRC_WIDTH, SRC_HEIGHT, Depths[d], &pvSrc);
+        if (!hbmSrc)
+        {
+            printf("Could not create a %d bpp source bitmap (error %lu)\n", Depths[d], GetLastError());
+            continue;
+        }
+        FillPattern(pvSrc, SRC_WIDTH, SRC_HEIGHT, Depths[d]);
+        hbmOldSrc = SelectObject(hdcSrc, hbmSrc);
+
+        for (s = 0; s < sizeof(Sizes) / sizeof(Sizes[0]); s++)
+        {
+            for (m = 0; m < 2; m++)
+            {
+                int mode = m ? HALFTONE : COLORONCOLOR;
+
+                seconds = TimeStretch(hdcDst, hdcSrc, Sizes[s].cx, Sizes[s].cy, mode, iterations);
+                printf("%-4d %-6s %-13s %10.3f %12.1f\n",
+                       Depths[d], Sizes[s].name, m ? "HALFTONE" : "COLORONCOLOR",
+                       seconds * 1000.0 / iterations,
+                       (double)Sizes[s].cx * Sizes[s].cy * iterations / seconds / 1000000.0);
+            }
+        }
+
+        SelectObject(hdcSrc, hbmOldSrc);
+        DeleteObject(hbmSrc);
+    }
+
+    SelectObject(hdcDst, hbmOldDst);
+    DeleteObject(hbmDst);
+    DeleteDC(hdcDst);
+    DeleteDC(hdcSrc);
+    ReleaseDC(NULL, hdcScreen);
+
+    return 0;
+}
@@ -0,0 +1,223 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.0-or-later (https://spdx.org/licenses/LGPL-2.0-or-later)
+ * PURPOSE:     Times large MCB operations on heavily fragmented files
+ */
+
+#include <kmt_test.h>
+
+#define NDEBUG
+#include <debug.h>
+
+/* Runs of 8 sectors with 8 sector holes in between, like a badly
+   fragmented file, which gives twice as many runs once holes count */
+#define SMALL_RUNS  25000
+#define LARGE_RUNS  100000
+#define RUN_SECTORS 8
+#define RUN_VBN(i)        ((LONGLONG)(i) * RUN_SECTORS * 2 + RUN_SECTORS)
+#define RUN_LBN(Runs, i)  ((LONGLONG)((Runs) - (i)) * RUN_SECTORS * 3)
+
+/* LARGE_RUNS is 4 times SMALL_RUNS. Operations which cost O(1) or
+   O(log n) each take about 4 times as long on the large file, ones which
+   rescan the runs take 16 times as long. Split the difference. */
+#define MAX_RATIO 8
+
+/* Timings below this are mostly noise, don't compare against them */
+#define MIN_SMALL_US 1000
+
+typedef enum _MCB_OPERATION
+{
+    McbAppend,
+    McbEnumerate,
+    McbLookup,
+    McbTruncate,
+    McbOperationCount
+} MCB_OPERATION;
+
+static const PCSTR OperationNames[McbOperationCount] =
+{
+    "Appending",
+    "Enumerating",
+    "Looking up",
+    "Truncating"
+};
+
+static LARGE_INTEGER Frequency;
+
+static LONGLONG
+ElapsedUs(LARGE_INTEGER Start)
+{
+    LARGE_INTEGER Now = KeQueryPerformanceCounter(NULL);
+
+    return (Now.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+}
+
+static LONGLONG
+TestAppend(PLARGE_MCB Mcb, ULONG Runs)
+{
+    LARGE_INTEGER Start;
+    LONGLONG Us;
+    ULONG i, Failures = 0;
+
+    Start = KeQueryPerformanceCounter(&Frequency);
+    for (i = 0; i < Runs; i++)
+    {
+        if (!FsRtlAddLargeMcbEntry(Mcb, RUN_VBN(i), RUN_LBN(Runs, i), RUN_SECTORS))
+            Failures++;
+    }
+    Us = ElapsedUs(Start);
+
+    ok_eq_ulong(Failures, 0UL);
+    ok_eq_ulong(FsRtlNumberOfRunsInLargeMcb(Mcb), Runs * 2);
+    return Us;
+}
+
+static LONGLONG
+TestEnumerate(PLARGE_MCB Mcb, ULONG Runs)
+{
+    LARGE_INTEGER Start;
+    LONGLONG Us, Vbn, Lbn, SectorCount;
+    ULONG i, Failures = 0;
+
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; FsRtlGetNextLargeMcbEntry(Mcb, i, &Vbn, &Lbn, &SectorCount); i++)
+    {
+        /* Odd indexes are the mapped runs, even ones the holes before them */
+        if (SectorCount != RUN_SECTORS ||
+            Vbn != (LONGLONG)i * RUN_SECTORS ||
+            Lbn != ((i & 1) ? RUN_LBN(Runs, i / 2) : -1))
+        {
+            Failures++;
+        }
+    }
+    Us = ElapsedUs(Start);
+
+    ok_eq_ulong(i, Runs * 2);
+    ok_eq_ulong(Failures, 0UL);
+    return Us;
+}
+
+static LONGLONG
+TestLookup(PLARGE_MCB Mcb, ULONG Runs)
+{
+    LARGE_INTEGER Start;
+    LONGLONG Us, Vbn, Lbn, SectorCount;
+    ULONG i, Run, Index, Failures = 0;
+
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; i < Runs; i++)
+    {
+        /* Jump around rather than walking the file */
+        Run = (i * 7919) % Runs;
+        Vbn = RUN_VBN(Run) + 3;
+        if (!FsRtlLookupLargeMcbEntry(Mcb, Vbn, &Lbn, &SectorCount, NULL, NULL, &Index) ||
+            Lbn != RUN_LBN(Runs, Run) + 3 ||
+            SectorCount != RUN_SECTORS - 3 ||
+            Index != Run * 2 + 1)
+        {
+            Failures++;
+        }
+    }
+    Us = ElapsedUs(Start);
+
+    ok_eq_ulong(Failures, 0UL);
+
+    ok(FsRtlLookupLastLargeMcbEntryAndIndex(Mcb, &Vbn, &Lbn, &Index) == TRUE, "expected TRUE, got FALSE\n");
+    ok_eq_longlong(Vbn, RUN_VBN(Runs - 1) + RUN_SECTORS - 1);
+    ok_eq_longlong(Lbn, RUN_LBN(Runs, Runs - 1) + RUN_SECTORS - 1);
+    ok_eq_ulong(Index, Runs * 2 - 1);
+    return Us;
+}
+
+static LONGLONG
+TestTruncate(PLARGE_MCB Mcb, ULONG Runs)
+{
+    LARGE_INTEGER Start;
+    LONGLONG Us;
+    ULONG i;
+
+    /* Cut the file back, from its end down to the first half */
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = Runs; i > Runs / 2; i--)
+    {
+        FsRtlTruncateLargeMcb(Mcb, RUN_VBN(i - 1));
+    }
+    Us = ElapsedUs(Start);
+
+    ok_eq_ulong(FsRtlNumberOfRunsInLargeMcb(Mcb), Runs);
+    return Us;
+}
+
+/* Removing and splitting move the runs behind the change, so they are
+   checked for their results only */
+static VOID
+TestRemoveAndSplit(PLARGE_MCB Mcb, ULONG Runs)
+{
+    LARGE_INTEGER Start;
+    LONGLONG Us, Vbn, Lbn, SectorCount;
+    ULONG i;
+
+    /* Punch a hole in the middle of every 50th run that is left */
+    Start = KeQueryPerformanceCounter(NULL);
+    for (i = 0; i < Runs / 2; i += 50)
+    {
+        FsRtlRemoveLargeMcbEntry(Mcb, RUN_VBN(i) + RUN_SECTORS / 2, 1);
+    }
+    Us = ElapsedUs(Start);
+
+    /* Each punched run is now two runs and a hole */
+    ok_eq_ulong(FsRtlNumberOfRunsInLargeMcb(Mcb), Runs + Runs / 50);
+    trace("Removing %lu ranges: %I64d us\n", Runs / 100, Us);
+
+    /* Shift everything past the first run up by a run, which grows the
+       hole before the second one */
+    Start = KeQueryPerformanceCounter(NULL);
+    ok(FsRtlSplitLargeMcb(Mcb, RUN_VBN(1), RUN_SECTORS) == TRUE, "expected TRUE, got FALSE\n");
+    Us = ElapsedUs(Start);
+    trace("Splitting: %I64d us\n", Us);
+
+    ok(FsRtlGetNextLargeMcbEntry(Mcb, 4, &Vbn, &Lbn, &SectorCount) == TRUE, "expected TRUE, got FALSE\n");
+    ok_eq_longlong(Vbn, RUN_VBN(0) + RUN_SECTORS);
+    ok_eq_longlong(Lbn, -1LL);
+    ok_eq_longlong(SectorCount, (LONGLONG)RUN_SECTORS * 2);
+    ok(FsRtlGetNextLargeMcbEntry(Mcb, 5, &Vbn, &Lbn, &SectorCount) == TRUE, "expected TRUE, got FALSE\n");
+    ok_eq_longlong(Vbn, RUN_VBN(1) + RUN_SECTORS);
+    ok_eq_longlong(Lbn, RUN_LBN(Runs, 1));
+    ok_eq_longlong(SectorCount, (LONGLONG)RUN_SECTORS);
+}
+
+static VOID
+TestRuns(ULONG Runs, LONGLONG Us[McbOperationCount])
+{
+    LARGE_MCB Mcb;
+    ULONG i;
+
+    FsRtlInitializeLargeMcb(&Mcb, PagedPool);
+
+    Us[McbAppend] = TestAppend(&Mcb, Runs);
+    Us[McbEnumerate] = TestEnumerate(&Mcb, Runs);
+    Us[McbLookup] = TestLookup(&Mcb, Runs);
+    Us[McbTruncate] = TestTruncate(&Mcb, Runs);
+    TestRemoveAndSplit(&Mcb, Runs);
+
+    for (i = 0; i < McbOperationCount; i++)
+        trace("%s with %lu runs: %I64d us\n", OperationNames[i], Runs, Us[i]);
+
+    FsRtlUninitializeLargeMcb(&Mcb);
+}
+
+START_TEST(FsRtlMcbPerformance)
+{
+    LONGLONG SmallUs[McbOperationCount], LargeUs[McbOperationCount];
+    ULONG i;
+
+    TestRuns(SMALL_RUNS, SmallUs);
+    TestRuns(LARGE_RUNS, LargeUs);
+
+    for (i = 0; i < McbOperationCount; i++)
+    {
+        ok(LargeUs[i] <= max(SmallUs[i], MIN_SMALL_US) * MAX_RATIO,
+           "%s: %I64d us for %d runs, %I64d us for %d runs\n",
+           OperationNames[i], SmallUs[i], SMALL_RUNS, LargeUs[i], LARGE_RUNS);
+    }
+}
@@ -0,0 +1,181 @@
+/*
+ * PROJECT:     ReactOS kernel-mode tests
+ * LICENSE:     LGPL-2.1+ (https://spdx.org/licenses/LGPL-2.1+)
+ * PURPOSE:     Times LPC request/reply round trips between a client and a
+ *              server thread
+ */
+
+#include <kmt_test.h>
+#include <ndk/lpcfuncs.h>
+
+#define SMALL_ROUND_TRIPS 5000
+#define LARGE_ROUND_TRIPS 20000
+
+/* The large batch is 4 times the small one, so with a constant cost per
+   round trip it takes 4 times as long. A cost growing with the number of
+   messages already exchanged makes that 16 times. Split the difference. */
+#define MAX_RATIO 8
+
+/* Timings below this are mostly noise, don't compare against them */
+#define MIN_SMALL_US 1000
+
+typedef struct _TEST_MESSAGE
+{
+    PORT_MESSAGE Header;
+    ULONG Sequence;
+    ULONG Payload[15];
+} TEST_MESSAGE, *PTEST_MESSAGE;
+
+static UNICODE_STRING PortName = RTL_CONSTANT_STRING(L"\\KmtestLpcPerformancePort");
+
+static
+DWORD
+WINAPI
+ServerThread(
+    _In_ PVOID Parameter)
+{
+    NTSTATUS Status;
+    HANDLE ServerPortHandle = Parameter;
+    HANDLE PortHandle;
+    TEST_MESSAGE Message;
+    PPORT_MESSAGE ReplyMessage = NULL;
+    ULONG Replies = 0;
+
+    RtlZeroMemory(&Message, sizeof(Message));
+    Status = NtListenPort(ServerPortHandle, &Message.Header);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return 0;
+
+    Status = NtAcceptConnectPort(&PortHandle, NULL, &Message.Header, TRUE, NULL, NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (!NT_SUCCESS(Status))
+        return 0;
+
+    Status = NtCompleteConnectPort(PortHandle);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+
+    /* Answer every request by bumping its sequence number, and reply to the
+       previous request while waiting for the next one, like CSRSS does */
+    for (;;)
+    {
+        Status = NtReplyWaitReceivePort(PortHandle, NULL, ReplyMessage, &Message.Header);
+        if (!NT_SUCCESS(Status))
+            break;
+
+        if (Message.Header.u2.s2.Type != LPC_REQUEST)
+        {
+            ReplyMessage = NULL;
+            if (Message.Header.u2.s2.Type == LPC_PORT_CLOSED ||
+                Message.Header.u2.s2.Type == LPC_CLIENT_DIED)
+            {
+                break;
+            }
+            continue;
+        }
+
+        Message.Sequence++;
+        ReplyMessage = &Message.Header;
+        Replies++;
+    }
+
+    ok_eq_ulong(Replies, (ULONG)(SMALL_ROUND_TRIPS + LARGE_ROUND_TRIPS));
+    NtClose(PortHandle);
+    return 0;
+}
+
+static
+LONGLONG
+TimeRoundTrips(
+    _In_ HANDLE PortHandle,
+    _In_ ULONG First,
+    _In_ ULONG Count)
+{
+    NTSTATUS Status;
+    TEST_MESSAGE Request, Reply;
+    LARGE_INTEGER Frequency, Start, Stop;
+    LONGLONG Microseconds;
+    ULONG i, Failures = 0;
+
+    RtlZeroMemory(&Request, sizeof(Request));
+    Request.Header.u1.s1.TotalLength = sizeof(Request);
+    Request.Header.u1.s1.DataLength = sizeof(Request) - sizeof(Request.Header);
+
+    QueryPerformanceFrequency(&Frequency);
+    QueryPerformanceCounter(&Start);
+    for (i = First; i < First + Count; i++)
+    {
+        Request.Sequence = i;
+        Status = NtRequestWaitReplyPort(PortHandle, &Request.Header, &Reply.Header);
+        if (!NT_SUCCESS(Status) || Reply.Sequence != i + 1)
+            Failures++;
+    }
+    QueryPerformanceCounter(&Stop);
+
+    Microseconds = (Stop.QuadPart - Start.QuadPart) * 1000000 / Frequency.QuadPart;
+    ok_eq_ulong(Failures, 0UL);
+    trace("%lu round trips: %I64d us, %I64d ns each\n",
+          Count, Microseconds, Microseconds * 1000 / Count);
+    return Microseconds;
+}
+
+START_TEST(LpcPerformance)
+{
+    NTSTATUS Status;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    SECURITY_QUALITY_OF_SERVICE SecurityQos;
+    HANDLE ServerPortHandle, PortHandle, ThreadHandle;
+    LONGLONG SmallUs, LargeUs;
+
+    InitializeObjectAttributes(&ObjectAttributes,
+                               &PortName,
+                               OBJ_CASE_INSENSITIVE,
+                               NULL,
+                               NULL);
+    Status = NtCreatePort(&ServerPortHandle,
+                          &ObjectAttributes,
+                          0,
+                          sizeof(TEST_MESSAGE),
+                          0);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (skip(NT_SUCCESS(Status), "Failed to create port\n"))
+        return;
+
+    ThreadHandle = CreateThread(NULL, 0, ServerThread, ServerPortHandle, 0, NULL);
+    ok(ThreadHandle != NULL, "CreateThread failed, error %lu\n", GetLastError());
+    if (skip(ThreadHandle != NULL, "No server thread\n"))
+    {
+        NtClose(ServerPortHandle);
+        return;
+    }
+
+    SecurityQos.Length = sizeof(SecurityQos);
+    SecurityQos.ImpersonationLevel = SecurityIdentification;
+    SecurityQos.EffectiveOnly = TRUE;
+    SecurityQos.ContextTrackingMode = SECURITY_STATIC_TRACKING;
+    Status = NtConnectPort(&PortHandle,
+                           &PortName,
+                           &SecurityQos,
+                           NULL,
+                           NULL,
+                           NULL,
+                           NULL,
+                           NULL);
+    ok_eq_hex(Status, STATUS_SUCCESS);
+    if (NT_SUCCESS(Status))
+    {
+        SmallUs = TimeRoundTrips(PortHandle, 0, SMALL_ROUND_TRIPS);
+        LargeUs = TimeRoundTrips(PortHandle, SMALL_ROUND_TRIPS, LARGE_ROUND_TRIPS);
+
+        ok(LargeUs <= max(SmallUs, MIN_SMALL_US) * MAX_RATIO,
+           "%d round trips took %I64d us, %d took %I64d us\n",
+           SMALL_ROUND_TRIPS, SmallUs, LARGE_ROUND_TRIPS, LargeUs);
+
+        NtClose(PortHandle);
+    }
+
+    /* Closing our end makes the server see LPC_PORT_CLOSED and quit */
+    ok_eq_ulong(WaitForSingleObject(ThreadHandle, 10000), (ULONG)WAIT_OBJECT_0);
+    CloseHandle(ThreadHandle);
+    NtClose(ServerPortHandle);
+}
@@ -0,0 +1,146 @@
+/*
+ * PROJECT:     ReactOS Tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Times streaming messages of 64 bytes up to 1 MB over a local
+ *              named pipe. Small messages mostly find the reader waiting,
+ *              messages larger than the pipe quota make the writer wait.
+ *
+ * Usage: pipebench [megabytes per size]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define PIPE_NAME   "\\\\.\\pipe\\pipebench"
+#define MIN_SIZE    64
+#define MAX_SIZE    (1024 * 1024)
+#define PIPE_QUOTA  (64 * 1024)
+
+typedef struct _READER
+{
+    HANDLE hPipe;
+    DWORD cbMessage;
+    DWORD cMessages;
+    DWORD cErrors;
+} READER;
+
+static DWORD WINAPI
+ReaderThread(LPVOID lpParameter)
+{
+    READER *pReader = lpParameter;
+    BYTE *pjBuffer;
+    DWORD i, cbRead;
+
+    pjBuffer = malloc(pReader->cbMessage);
+    if (!pjBuffer)
+        return 1;
+
+    for (i = 0; i < pReader->cMessages; i++)
+    {
+        if (!ReadFile(pReader->hPipe, pjBuffer, pReader->cbMessage, &cbRead, NULL) ||
+            cbRead != pReader->cbMessage ||
+            pjBuffer[0] != (BYTE)i ||
+            pjBuffer[cbRead - 1] != (BYTE)i)
+        {
+            pReader->cErrors++;
+        }
+    }
+
+    free(pjBuffer);
+    return 0;
+}
+
+static double
+TimeTransfer(DWORD cbMessage, DWORD cMessages, DWORD *pcErrors)
+{
+    LARGE_INTEGER freq, start, stop;
+    HANDLE hServer, hClient, hThread;
+    READER Reader;
+    BYTE *pjBuffer;
+    DWORD i, cbWritten;
+
+    *pcErrors = 1;
+    hServer = CreateNamedPipeA(PIPE_NAME,
+                               PIPE_ACCESS_INBOUND,
+                               PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT,
+                               1,
+                               PIPE_QUOTA,
+                               PIPE_QUOTA,
+                               0,
+                               NULL);
+    if (hServer == INVALID_HANDLE_VALUE)
+    {
+        printf("CreateNamedPipe failed (error %lu)\n", GetLastError());
+        return 0.0;
+    }
+
+    hClient = CreateFileA(PIPE_NAME, GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+    if (hClient == INVALID_HANDLE_VALUE)
+    {
+        printf("CreateFile failed (error %lu)\n", GetLastError());
+        CloseHandle(hServer);
+        return 0.0;
+    }
+
+    pjBuffer = malloc(cbMessage);
+    if (!pjBuffer)
+    {
+        CloseHandle(hClient);
+        CloseHandle(hServer);
+        return 0.0;
+    }
+
+    Reader.hPipe = hServer;
+    Reader.cbMessage = cbMessage;
+    Reader.cMessages = cMessages;
+    Reader.cErrors = 0;
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+
+    hThread = CreateThread(NULL, 0, ReaderThread, &Reader, 0, NULL);
+    for (i = 0; i < cMessages; i++)
+    {
+        memset(pjBuffer, (BYTE)i, cbMessage);
+        if (!WriteFile(hClient, pjBuffer, cbMessage, &cbWritten, NULL) || cbWritten != cbMessage)
+            Reader.cErrors++;
+    }
+    WaitForSingleObject(hThread, INFINITE);
+
+    QueryPerformanceCounter(&stop);
+
+    *pcErrors = Reader.cErrors;
+    CloseHandle(hThread);
+    CloseHandle(hClient);
+    CloseHandle(hServer);
+    free(pjBuffer);
+
+    return (double)(stop.QuadPart - start.QuadPart) / freq.QuadPart;
+}
+
+int main(int argc, char *argv[])
+{
+    DWORD cbTotal = 64 * 1024 * 1024;
+    DWORD cbMessage, cMessages, cErrors;
+    double seconds;
+
+    if (argc > 1)
+        cbTotal = max(1, atoi(argv[1])) * 1024 * 1024;
+
+    printf("%lu MB per message size, pipe quota %u bytes\n\n", cbTotal / (1024 * 1024), PIPE_QUOTA);
+    printf("%10s %10s %10s\n", "size", "messages", "MB/s");
+
+    for (cbMessage = MIN_SIZE; cbMessage <= MAX_SIZE; cbMessage *= 4)
+    {
+        cMessages = max(cbTotal / cbMessage, 16);
+        seconds = TimeTransfer(cbMessage, cMessages, &cErrors);
+        if (cErrors)
+            printf("%10lu %10lu %6lu errors\n", cbMessage, cMessages, cErrors);
+        else
+            printf("%10lu %10lu %10.1f\n", cbMessage, cMessages,
+                   (double)cbMessage * cMessages / seconds / (1024.0 * 1024.0));
+    }
+
+    return 0;
+}
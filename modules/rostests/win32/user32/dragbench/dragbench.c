@@ -0,0 +1,129 @@
+/*
+ * PROJECT:     ReactOS Tests
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Times dragging a window over a number of sibling windows,
+ *              which exercises the visible region and DCE recalculation
+ *
+ * Usage: dragbench [siblings] [moves]
+ */
+
+#include <windows.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SIBLING_SIZE 120
+#define DRAG_SIZE    200
+
+static LRESULT CALLBACK
+WndProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
+{
+    PAINTSTRUCT ps;
+    HDC hdc;
+
+    switch (uMsg)
+    {
+        case WM_PAINT:
+            hdc = BeginPaint(hwnd, &ps);
+            FillRect(hdc, &ps.rcPaint, (HBRUSH)(COLOR_WINDOW + 1));
+            EndPaint(hwnd, &ps);
+            return 0;
+    }
+
+    return DefWindowProcW(hwnd, uMsg, wParam, lParam);
+}
+
+static void
+PumpMessages(void)
+{
+    MSG msg;
+
+    while (PeekMessageW(&msg, NULL, 0, 0, PM_REMOVE))
+    {
+        TranslateMessage(&msg);
+        DispatchMessageW(&msg);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    WNDCLASSW wc;
+    HWND *phwndSiblings, hwndDrag;
+    LARGE_INTEGER freq, start, stop;
+    int siblings = 64, moves = 500;
+    int cxScreen, cyScreen, columns;
+    int i, x, y;
+    double seconds;
+
+    if (argc > 1)
+        siblings = max(1, atoi(argv[1]));
+    if (argc > 2)
+        moves = max(1, atoi(argv[2]));
+
+    ZeroMemory(&wc, sizeof(wc));
+    wc.lpfnWndProc = WndProc;
+    wc.hInstance = GetModuleHandleW(NULL);
+    wc.hCursor = LoadCursorW(NULL, (LPCWSTR)IDC_ARROW);
+    wc.lpszClassName = L"DragBench";
+    if (!RegisterClassW(&wc))
+    {
+        printf("Could not register the window class (error %lu)\n", GetLastError());
+        return 1;
+    }
+
+    phwndSiblings = malloc(siblings * sizeof(HWND));
+    if (!phwndSiblings)
+        return 1;
+
+    cxScreen = GetSystemMetrics(SM_CXSCREEN);
+    cyScreen = GetSystemMetrics(SM_CYSCREEN);
+    columns = max(1, (cxScreen - SIBLING_SIZE) / (SIBLING_SIZE / 2));
+
+    /* Overlapping siblings tiled over the screen */
+    for (i = 0; i < siblings; i++)
+    {
+        x = (i % columns) * (SIBLING_SIZE / 2);
+        y = ((i / columns) * (SIBLING_SIZE / 2)) % max(1, cyScreen - SIBLING_SIZE);
+        phwndSiblings[i] = CreateWindowExW(0, L"DragBench", L"Sibling",
+                                           WS_POPUP | WS_BORDER | WS_VISIBLE | WS_CLIPSIBLINGS,
+                                           x, y, SIBLING_SIZE, SIBLING_SIZE,
+                                           NULL, NULL, wc.hInstance, NULL);
+    }
+
+    hwndDrag = CreateWindowExW(WS_EX_TOPMOST, L"DragBench", L"Drag",
+                               WS_POPUP | WS_CAPTION | WS_VISIBLE | WS_CLIPSIBLINGS,
+                               0, 0, DRAG_SIZE, DRAG_SIZE,
+                               NULL, NULL, wc.hInstance, NULL);
+    if (!hwndDrag)
+    {
+        printf("Could not create the window (error %lu)\n", GetLastError());
+        return 1;
+    }
+    PumpMessages();
+
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&start);
+    for (i = 0; i < moves; i++)
+    {
+        /* Sweep diagonally over the siblings, a few pixels per move like a mouse drag */
+        x = (i * 7) % max(1, cxScreen - DRAG_SIZE);
+        y = (i * 5) % max(1, cyScreen - DRAG_SIZE);
+        SetWindowPos(hwndDrag, NULL, x, y, 0, 0,
+                     SWP_NOSIZE | SWP_NOZORDER | SWP_NOACTIVATE);
+        PumpMessages();
+    }
+    QueryPerformanceCounter(&stop);
+
+    seconds = (double)(stop.QuadPart - start.QuadPart) / freq.QuadPart;
+    printf("%d siblings, %d moves: %.3f ms/move, %.1f moves/s\n",
+           siblings, moves, seconds * 1000.0 / moves, moves / seconds);
+
+    DestroyWindow(hwndDrag);
+    for (i = 0; i < siblings; i++)
+    {
+        if (phwndSiblings[i])
+            DestroyWindow(phwndSiblings[i]);
+    }
+    free(phwndSiblings);
+
+    return 0;
+}
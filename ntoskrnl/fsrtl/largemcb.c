@@ -22,97 +22,203 @@
 PAGED_LOOKASIDE_LIST FsRtlFirstMappingLookasideList;
 NPAGED_LOOKASIDE_LIST FsRtlFastMutexLookasideList;
 
-/* We use only real 'mapping' runs; we do not store 'holes' to our GTree. */
+/* We use only real 'mapping' runs; we do not store 'holes' to our run array. */
 typedef struct _LARGE_MCB_MAPPING_ENTRY // run
 {
     LARGE_INTEGER RunStartVbn;
     LARGE_INTEGER RunEndVbn;   /* RunStartVbn+SectorCount; that means +1 after the last sector */
     LARGE_INTEGER StartingLbn; /* Lbn of 'RunStartVbn' */
+    ULONG RunIndex;            /* Index of this run as reported to callers, holes included */
 } LARGE_MCB_MAPPING_ENTRY, *PLARGE_MCB_MAPPING_ENTRY;
 
+/*
+ * The runs are kept sorted by VBN in one array, so that lookups by VBN are a
+ * binary search. The first runs live in the mapping itself, larger MCBs get
+ * their array from the MCB's pool. The RunIndex of the first IndexedRunCount
+ * runs is up to date; changes only invalidate the runs from the first one
+ * they touch, which keeps appending runs and enumerating them cheap.
+ */
 typedef struct _LARGE_MCB_MAPPING // mcb_priv
 {
-    RTL_GENERIC_TABLE Table;
+    PLARGE_MCB_MAPPING_ENTRY Runs;
+    ULONG IndexedRunCount;
+    LARGE_MCB_MAPPING_ENTRY InitialRuns[MAXIMUM_PAIR_COUNT];
 } LARGE_MCB_MAPPING, *PLARGE_MCB_MAPPING;
 
 typedef struct _BASE_MCB_INTERNAL {
-    ULONG MaximumPairCount;
-    ULONG PairCount;
+    ULONG MaximumPairCount;     /* Size of the run array */
+    ULONG PairCount;            /* Number of runs, holes excluded */
     USHORT PoolType;
     USHORT Flags;
     PLARGE_MCB_MAPPING Mapping;
 } BASE_MCB_INTERNAL, *PBASE_MCB_INTERNAL;
 
-/*
-static LARGE_MCB_MAPPING_ENTRY StaticRunBelow0 = {
-    {{-1}}, // ignored
-    {{0}},
-    {{-1}}, // ignored
-};
-*/
-
-static PVOID NTAPI McbMappingAllocate(PRTL_GENERIC_TABLE Table, CLONG Bytes)
+/* PRIVATE FUNCTIONS *********************************************************/
+
+/* Returns the position of the first run ending after Vbn, or PairCount */
+static
+ULONG
+McbFindRun(IN PBASE_MCB_INTERNAL Mcb,
+           IN LONGLONG Vbn)
 {
-    PVOID Result;
-    PBASE_MCB Mcb = (PBASE_MCB)Table->TableContext;
-    Result = ExAllocatePoolWithTag(Mcb->PoolType, Bytes, 'BCML');
-    DPRINT("McbMappingAllocate(%lu) => %p\n", Bytes, Result);
-    return Result;
+    PLARGE_MCB_MAPPING_ENTRY Runs = Mcb->Mapping->Runs;
+    ULONG Low = 0, High = Mcb->PairCount, Middle;
+
+    while (Low < High)
+    {
+        Middle = Low + (High - Low) / 2;
+        if (Runs[Middle].RunEndVbn.QuadPart <= Vbn)
+            Low = Middle + 1;
+        else
+            High = Middle;
+    }
+
+    return Low;
 }
 
-static VOID NTAPI McbMappingFree(PRTL_GENERIC_TABLE Table, PVOID Buffer)
+/* Brings the RunIndex of the runs up to Count up to date */
+static
+VOID
+McbIndexRuns(IN PBASE_MCB_INTERNAL Mcb,
+             IN ULONG Count)
 {
-    DPRINT("McbMappingFree(%p)\n", Buffer);
-    ExFreePoolWithTag(Buffer, 'BCML');
+    PLARGE_MCB_MAPPING Mapping = Mcb->Mapping;
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    ULONG i;
+
+    ASSERT(Count <= Mcb->PairCount);
+
+    for (i = Mapping->IndexedRunCount; i < Count; i++)
+    {
+        Run = &Mapping->Runs[i];
+        if (i == 0)
+        {
+            /* Mapping 0 always starts at virtual block 0 */
+            Run->RunIndex = (Run->RunStartVbn.QuadPart > 0) ? 1 : 0;
+        }
+        else
+        {
+            Run->RunIndex = Run[-1].RunIndex + 1;
+            if (Run->RunStartVbn.QuadPart > Run[-1].RunEndVbn.QuadPart)
+                Run->RunIndex++;
+        }
+    }
+
+    Mapping->IndexedRunCount = MAX(Mapping->IndexedRunCount, Count);
 }
 
+/* Returns the position of the first run whose RunIndex is RunIndex or more, or PairCount */
 static
-RTL_GENERIC_COMPARE_RESULTS
-NTAPI
-McbMappingCompare(PRTL_GENERIC_TABLE Table,
-                  PVOID PtrA,
-                  PVOID PtrB)
+ULONG
+McbFindRunByIndex(IN PBASE_MCB_INTERNAL Mcb,
+                  IN ULONG RunIndex)
 {
-    PLARGE_MCB_MAPPING_ENTRY A = PtrA, B = PtrB;
-    RTL_GENERIC_COMPARE_RESULTS Res;
-
-    ASSERT(A);
-    ASSERT(B);
-
-    if (A->RunStartVbn.QuadPart == B->RunStartVbn.QuadPart && A->RunEndVbn.QuadPart == B->RunEndVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunEndVbn.QuadPart <= B->RunStartVbn.QuadPart)
-        Res = GenericLessThan;
-    else if (A->RunEndVbn.QuadPart >= B->RunStartVbn.QuadPart)
-        Res = GenericGreaterThan;
-    else
+    PLARGE_MCB_MAPPING Mapping = Mcb->Mapping;
+    ULONG Low = 0, High, Middle;
+
+    /* Only index as far as we have to, enumerations mostly go forward */
+    while (Mapping->IndexedRunCount < Mcb->PairCount &&
+           (Mapping->IndexedRunCount == 0 ||
+            Mapping->Runs[Mapping->IndexedRunCount - 1].RunIndex < RunIndex))
+    {
+        McbIndexRuns(Mcb, MIN(Mcb->PairCount, Mapping->IndexedRunCount * 2 + 1));
+    }
+
+    High = Mapping->IndexedRunCount;
+    while (Low < High)
     {
-        ASSERT(FALSE);
-        Res = GenericEqual;
+        Middle = Low + (High - Low) / 2;
+        if (Mapping->Runs[Middle].RunIndex < RunIndex)
+            Low = Middle + 1;
+        else
+            High = Middle;
     }
 
-    return Res;
+    return Low;
 }
 
-static RTL_GENERIC_COMPARE_RESULTS NTAPI McbMappingIntersectCompare(PRTL_GENERIC_TABLE Table, PVOID PtrA, PVOID PtrB)
+/* Makes room for Count runs, keeping the current ones */
+static
+BOOLEAN
+McbReserveRuns(IN PBASE_MCB_INTERNAL Mcb,
+               IN ULONG Count)
 {
-    PLARGE_MCB_MAPPING_ENTRY A = PtrA, B = PtrB;
-    RTL_GENERIC_COMPARE_RESULTS Res;
-
-    if (A->RunStartVbn.QuadPart <= B->RunStartVbn.QuadPart && A->RunEndVbn.QuadPart > B->RunStartVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunStartVbn.QuadPart >= B->RunStartVbn.QuadPart && B->RunEndVbn.QuadPart > A->RunStartVbn.QuadPart)
-        Res = GenericEqual;
-    else if (A->RunStartVbn.QuadPart < B->RunStartVbn.QuadPart)
-        Res = GenericLessThan;
-    else if (A->RunStartVbn.QuadPart > B->RunStartVbn.QuadPart)
-        Res = GenericGreaterThan;
-    else
-        Res = GenericEqual;
+    PLARGE_MCB_MAPPING Mapping = Mcb->Mapping;
+    PLARGE_MCB_MAPPING_ENTRY NewRuns;
+    ULONG NewCount;
+
+    if (Count <= Mcb->MaximumPairCount)
+        return TRUE;
 
-    return Res;
+    NewCount = MAX(Count, Mcb->MaximumPairCount * 2);
+    if (NewCount > MAXULONG / sizeof(LARGE_MCB_MAPPING_ENTRY))
+        return FALSE;
+
+    NewRuns = ExAllocatePoolWithTag(Mcb->PoolType,
+                                    NewCount * sizeof(LARGE_MCB_MAPPING_ENTRY),
+                                    'BCML');
+    if (!NewRuns)
+        return FALSE;
+
+    RtlCopyMemory(NewRuns, Mapping->Runs, Mcb->PairCount * sizeof(LARGE_MCB_MAPPING_ENTRY));
+    if (Mapping->Runs != Mapping->InitialRuns)
+        ExFreePoolWithTag(Mapping->Runs, 'BCML');
+
+    Mapping->Runs = NewRuns;
+    Mcb->MaximumPairCount = NewCount;
+    return TRUE;
 }
 
+/* The run at Position changed, so do the indexes of all the runs after it */
+static
+VOID
+McbInvalidateIndex(IN PBASE_MCB_INTERNAL Mcb,
+                   IN ULONG Position)
+{
+    Mcb->Mapping->IndexedRunCount = MIN(Mcb->Mapping->IndexedRunCount, Position);
+}
+
+/* The caller has to reserve the room for the new run */
+static
+VOID
+McbInsertRun(IN PBASE_MCB_INTERNAL Mcb,
+             IN ULONG Position,
+             IN LONGLONG StartVbn,
+             IN LONGLONG EndVbn,
+             IN LONGLONG Lbn)
+{
+    PLARGE_MCB_MAPPING_ENTRY Run = &Mcb->Mapping->Runs[Position];
+
+    ASSERT(Mcb->PairCount < Mcb->MaximumPairCount);
+    ASSERT(Position <= Mcb->PairCount);
+
+    RtlMoveMemory(Run + 1, Run, (Mcb->PairCount - Position) * sizeof(*Run));
+    Run->RunStartVbn.QuadPart = StartVbn;
+    Run->RunEndVbn.QuadPart = EndVbn;
+    Run->StartingLbn.QuadPart = Lbn;
+    ++Mcb->PairCount;
+
+    McbInvalidateIndex(Mcb, Position);
+}
+
+static
+VOID
+McbDeleteRuns(IN PBASE_MCB_INTERNAL Mcb,
+              IN ULONG Position,
+              IN ULONG Count)
+{
+    PLARGE_MCB_MAPPING_ENTRY Run = &Mcb->Mapping->Runs[Position];
+
+    ASSERT(Position + Count <= Mcb->PairCount);
+
+    if (Count == 0)
+        return;
+
+    RtlMoveMemory(Run, Run + Count, (Mcb->PairCount - Position - Count) * sizeof(*Run));
+    Mcb->PairCount -= Count;
+
+    McbInvalidateIndex(Mcb, Position);
+}
 
 /* PUBLIC FUNCTIONS **********************************************************/
 
@@ -140,10 +246,9 @@ FsRtlAddBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
     BOOLEAN Result = TRUE;
     BOOLEAN IntResult;
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    LARGE_MCB_MAPPING_ENTRY Node, NeedleRun;
-    PLARGE_MCB_MAPPING_ENTRY LowerRun, HigherRun;
-    BOOLEAN NewElement;
-    LONGLONG IntLbn, IntSectorCount;
+    PLARGE_MCB_MAPPING_ENTRY Runs, LowerRun, HigherRun;
+    LONGLONG EndVbn, IntLbn, IntSectorCount;
+    ULONG Position;
 
     DPRINT("FsRtlAddBaseMcbEntry(%p, %I64d, %I64d, %I64d)\n", OpaqueMcb, Vbn, Lbn, SectorCount);
 
@@ -153,7 +258,7 @@ FsRtlAddBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
         goto quit;
     }
 
-    if (SectorCount <= 0)
+    if (SectorCount <= 0 || Vbn + SectorCount <= Vbn)
     {
         Result = FALSE;
         goto quit;
@@ -175,105 +280,68 @@ FsRtlAddBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
         }
     }
 
+    /* Clearing our range may split a run in two, and we may add one more.
+     * Make sure we cannot fail half way through. */
+    if (!McbReserveRuns(Mcb, Mcb->PairCount + 2))
+    {
+        Result = FALSE;
+        goto quit;
+    }
+
     /* clean any possible previous entries in our range */
     FsRtlRemoveBaseMcbEntry(OpaqueMcb, Vbn, SectorCount);
 
     // We need to map [Vbn, Vbn+SectorCount) to [Lbn, Lbn+SectorCount),
-    // taking in account the fact that we need to merge these runs if
-    // they are adjacent or overlap, but fail if new run fully fits into another run
-
-    /* initially we think we will be inserted as a separate run */
-    Node.RunStartVbn.QuadPart = Vbn;
-    Node.RunEndVbn.QuadPart = Vbn + SectorCount;
-    Node.StartingLbn.QuadPart = Lbn;
-
-    /* optionally merge with lower run */
-    NeedleRun.RunStartVbn.QuadPart = Node.RunStartVbn.QuadPart - 1;
-    NeedleRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart + 1;
-    NeedleRun.StartingLbn.QuadPart = ~0ULL;
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    if ((LowerRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)) &&
-        (LowerRun->StartingLbn.QuadPart + (LowerRun->RunEndVbn.QuadPart - LowerRun->RunStartVbn.QuadPart) == Node.StartingLbn.QuadPart))
+    // merging with the runs right below and above when they are adjacent
+    // both in VBNs and in LBNs.
+    EndVbn = Vbn + SectorCount;
+    Runs = Mcb->Mapping->Runs;
+    Position = McbFindRun(Mcb, Vbn);
+    ASSERT(Position == Mcb->PairCount || Runs[Position].RunStartVbn.QuadPart >= EndVbn);
+
+    LowerRun = (Position > 0) ? &Runs[Position - 1] : NULL;
+    if (LowerRun &&
+        (LowerRun->RunEndVbn.QuadPart != Vbn ||
+         LowerRun->StartingLbn.QuadPart + (LowerRun->RunEndVbn.QuadPart - LowerRun->RunStartVbn.QuadPart) != Lbn))
     {
-        ASSERT(LowerRun->RunEndVbn.QuadPart == Node.RunStartVbn.QuadPart);
-        Node.RunStartVbn.QuadPart = LowerRun->RunStartVbn.QuadPart;
-        Node.StartingLbn.QuadPart = LowerRun->StartingLbn.QuadPart;
-        Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, LowerRun);
-        --Mcb->PairCount;
-        DPRINT("Intersecting lower run found (%I64d,%I64d) Lbn: %I64d\n", LowerRun->RunStartVbn.QuadPart, LowerRun->RunEndVbn.QuadPart, LowerRun->StartingLbn.QuadPart);
+        LowerRun = NULL;
     }
 
-    /* optionally merge with higher run */
-    NeedleRun.RunStartVbn.QuadPart = Node.RunEndVbn.QuadPart;
-    NeedleRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart + 1;
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    if ((HigherRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)) &&
-        (Node.StartingLbn.QuadPart <= HigherRun->StartingLbn.QuadPart))
+    HigherRun = (Position < Mcb->PairCount) ? &Runs[Position] : NULL;
+    if (HigherRun &&
+        (HigherRun->RunStartVbn.QuadPart != EndVbn ||
+         HigherRun->StartingLbn.QuadPart != Lbn + SectorCount))
     {
-        ASSERT(HigherRun->RunStartVbn.QuadPart == Node.RunEndVbn.QuadPart);
-        Node.RunEndVbn.QuadPart = HigherRun->RunEndVbn.QuadPart;
-        Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, HigherRun);
-        --Mcb->PairCount;
-        DPRINT("Intersecting higher run found (%I64d,%I64d) Lbn: %I64d\n", HigherRun->RunStartVbn.QuadPart, HigherRun->RunEndVbn.QuadPart, HigherRun->StartingLbn.QuadPart);
+        HigherRun = NULL;
     }
-    Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
 
-    /* finally insert the resulting run */
-    RtlInsertElementGenericTable(&Mcb->Mapping->Table, &Node, sizeof(Node), &NewElement);
-    ++Mcb->PairCount;
-    ASSERT(NewElement);
+    if (LowerRun)
+    {
+        DPRINT("Intersecting lower run found (%I64d,%I64d) Lbn: %I64d\n", LowerRun->RunStartVbn.QuadPart, LowerRun->RunEndVbn.QuadPart, LowerRun->StartingLbn.QuadPart);
+        LowerRun->RunEndVbn.QuadPart = EndVbn;
+        if (HigherRun)
+        {
+            DPRINT("Intersecting higher run found (%I64d,%I64d) Lbn: %I64d\n", HigherRun->RunStartVbn.QuadPart, HigherRun->RunEndVbn.QuadPart, HigherRun->StartingLbn.QuadPart);
+            LowerRun->RunEndVbn.QuadPart = HigherRun->RunEndVbn.QuadPart;
+            McbDeleteRuns(Mcb, Position, 1);
+        }
+        McbInvalidateIndex(Mcb, Position - 1);
+    }
+    else if (HigherRun)
+    {
+        DPRINT("Intersecting higher run found (%I64d,%I64d) Lbn: %I64d\n", HigherRun->RunStartVbn.QuadPart, HigherRun->RunEndVbn.QuadPart, HigherRun->StartingLbn.QuadPart);
+        HigherRun->RunStartVbn.QuadPart = Vbn;
+        HigherRun->StartingLbn.QuadPart = Lbn;
+        McbInvalidateIndex(Mcb, Position);
+    }
+    else
+    {
+        /* finally insert the resulting run */
+        McbInsertRun(Mcb, Position, Vbn, EndVbn, Lbn);
+    }
 
     // NB: Two consecutive runs can only be merged, if actual LBNs also match!
-
-    /* 1.
-            Existing->RunStartVbn
-            |
-            |///////|
-                |/////////////|
-                |
-                Node->RunStartVbn
-
-        2.
-            Existing->RunStartVbn
-            |
-            |///////|
-        |//////|
-        |
-        Node->RunStartVbn
-
-        3.
-            Existing->RunStartVbn
-            |
-            |///////|
-                |///|
-                |
-                Node->RunStartVbn
-
-        4.
-            Existing->RunStartVbn
-            |
-            |///////|
-        |///////////////|
-        |
-        Node->RunStartVbn
-
-
-    Situation with holes:
-    1. Holes at both ends
-    2. Hole at the right, new run merged with the previous run
-    3. Hole at the right, new run is not merged with the previous run
-    4. Hole at the left, new run merged with the next run
-    5. Hole at the left, new run is not merged with the next run
-    6. No holes, exact fit to merge with both previous and next runs
-    7. No holes, merges only with the next run
-    8. No holes, merges only with the previous run
-    9. No holes, does not merge with next or prev runs
-
-
-    Overwriting existing mapping is not possible and results in FALSE being returned
-    */
+    // Overwriting existing mapping is not possible and results in FALSE being returned
 
 quit:
     DPRINT("FsRtlAddBaseMcbEntry(%p, %I64d, %I64d, %I64d) = %d\n", Mcb, Vbn, Lbn, SectorCount, Result);
@@ -337,48 +405,31 @@ FsRtlGetNextBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
 {
     BOOLEAN Result = FALSE;
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Run = NULL;
-    ULONG CurrentIndex = 0;
-    ULONGLONG LastVbn = 0;
-    ULONGLONG LastSectorCount = 0;
-
-    // Traverse the tree
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-    Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
-    {
-        // is the current index a hole?
-        if (Run->RunStartVbn.QuadPart > (LastVbn + LastSectorCount))
-        {
-            // Is this the index we're looking for?
-            if (RunIndex == CurrentIndex)
-            {
-                *Vbn = LastVbn + LastSectorCount;
-                *Lbn = -1;
-                *SectorCount = Run->RunStartVbn.QuadPart - *Vbn;
-
-                Result = TRUE;
-                goto quit;
-            }
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    ULONG Position;
 
-            CurrentIndex++;
-        }
-
-        if (RunIndex == CurrentIndex)
-        {
-            *Vbn = Run->RunStartVbn.QuadPart;
-            *Lbn = Run->StartingLbn.QuadPart;
-            *SectorCount = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
-
-            Result = TRUE;
-            goto quit;
-        }
+    Position = McbFindRunByIndex(Mcb, RunIndex);
+    if (Position == Mcb->PairCount)
+        goto quit;
 
-        CurrentIndex++;
-        LastVbn = Run->RunStartVbn.QuadPart;
-        LastSectorCount = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
+    Run = &Mcb->Mapping->Runs[Position];
+    if (Run->RunIndex == RunIndex)
+    {
+        *Vbn = Run->RunStartVbn.QuadPart;
+        *Lbn = Run->StartingLbn.QuadPart;
+        *SectorCount = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
+    }
+    else
+    {
+        /* The hole right before this run */
+        ASSERT(Run->RunIndex == RunIndex + 1);
+        *Vbn = (Position > 0) ? Run[-1].RunEndVbn.QuadPart : 0;
+        *Lbn = -1;
+        *SectorCount = Run->RunStartVbn.QuadPart - *Vbn;
     }
 
+    Result = TRUE;
+
 quit:
     DPRINT("FsRtlGetNextBaseMcbEntry(%p, %d, %p, %p, %p) = %d (%I64d, %I64d, %I64d)\n", Mcb, RunIndex, Vbn, Lbn, SectorCount, Result, *Vbn, *Lbn, *SectorCount);
     return Result;
@@ -436,11 +487,8 @@ FsRtlInitializeBaseMcb(IN PBASE_MCB OpaqueMcb,
     Mcb->PoolType = PoolType;
     Mcb->PairCount = 0;
     Mcb->MaximumPairCount = MAXIMUM_PAIR_COUNT;
-    RtlInitializeGenericTable(&Mcb->Mapping->Table,
-                              McbMappingCompare,
-                              McbMappingAllocate,
-                              McbMappingFree,
-                              Mcb);
+    Mcb->Mapping->Runs = Mcb->Mapping->InitialRuns;
+    Mcb->Mapping->IndexedRunCount = 0;
 }
 
 /*
@@ -511,38 +559,58 @@ FsRtlLookupBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
     OUT PULONG Index OPTIONAL)
 {
     BOOLEAN Result = FALSE;
-    ULONG i;
-    LONGLONG LastVbn = 0, LastLbn = 0, Count = 0;   // the last values we've found during traversal
+    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    LONGLONG HoleStartVbn;
+    ULONG Position;
 
     DPRINT("FsRtlLookupBaseMcbEntry(%p, %I64d, %p, %p, %p, %p, %p)\n", OpaqueMcb, Vbn, Lbn, SectorCountFromLbn, StartingLbn, SectorCountFromStartingLbn, Index);
 
-    for (i = 0; FsRtlGetNextBaseMcbEntry(OpaqueMcb, i, &LastVbn, &LastLbn, &Count); i++)
-    {
-        // have we reached the target mapping?
-        if (Vbn < LastVbn + Count)
-        {
-            if (Lbn)
-            {
-                if (LastLbn == -1)
-                    *Lbn = -1;
-                else
-                    *Lbn = LastLbn + (Vbn - LastVbn);
-            }
+    if (Vbn < 0)
+        goto quit;
 
-            if (SectorCountFromLbn)
-                *SectorCountFromLbn = LastVbn + Count - Vbn;
-            if (StartingLbn)
-                *StartingLbn = LastLbn;
-            if (SectorCountFromStartingLbn)
-                *SectorCountFromStartingLbn = LastVbn + Count - LastVbn;
-            if (Index)
-                *Index = i;
+    // find the run ending past the target, or the hole before it
+    Position = McbFindRun(Mcb, Vbn);
+    if (Position == Mcb->PairCount)
+        goto quit;
 
-            Result = TRUE;
-            goto quit;
-        }
+    Run = &Mcb->Mapping->Runs[Position];
+    if (Index)
+    {
+        McbIndexRuns(Mcb, Position + 1);
+    }
+
+    if (Vbn >= Run->RunStartVbn.QuadPart)
+    {
+        if (Lbn)
+            *Lbn = Run->StartingLbn.QuadPart + (Vbn - Run->RunStartVbn.QuadPart);
+        if (SectorCountFromLbn)
+            *SectorCountFromLbn = Run->RunEndVbn.QuadPart - Vbn;
+        if (StartingLbn)
+            *StartingLbn = Run->StartingLbn.QuadPart;
+        if (SectorCountFromStartingLbn)
+            *SectorCountFromStartingLbn = Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart;
+        if (Index)
+            *Index = Run->RunIndex;
+    }
+    else
+    {
+        HoleStartVbn = (Position > 0) ? Run[-1].RunEndVbn.QuadPart : 0;
+
+        if (Lbn)
+            *Lbn = -1;
+        if (SectorCountFromLbn)
+            *SectorCountFromLbn = Run->RunStartVbn.QuadPart - Vbn;
+        if (StartingLbn)
+            *StartingLbn = -1;
+        if (SectorCountFromStartingLbn)
+            *SectorCountFromStartingLbn = Run->RunStartVbn.QuadPart - HoleStartVbn;
+        if (Index)
+            *Index = Run->RunIndex - 1;
     }
 
+    Result = TRUE;
+
 quit:
     DPRINT("FsRtlLookupBaseMcbEntry(%p, %I64d, %p, %p, %p, %p, %p) = %d (%I64d, %I64d, %I64d, %I64d, %d)\n",
            OpaqueMcb, Vbn, Lbn, SectorCountFromLbn, StartingLbn, SectorCountFromStartingLbn, Index, Result,
@@ -594,47 +662,27 @@ FsRtlLookupLastLargeMcbEntryAndIndex_internal(IN PBASE_MCB_INTERNAL Mcb,
                                               OUT PLONGLONG Lbn,
                                               OUT PULONG Index OPTIONAL)
 {
-    ULONG RunIndex = 0;
-    PLARGE_MCB_MAPPING_ENTRY Run, RunFound = NULL;
-    LONGLONG LastVbn = 0;
-
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-        Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
-    {
-        /* Take care when we must emulate missing 'hole' runs. */
-        if (Run->RunStartVbn.QuadPart > LastVbn)
-        {
-            RunIndex++;
-        }
-        LastVbn = Run->RunEndVbn.QuadPart;
-        RunIndex++;
-        RunFound = Run;
-    }
+    PLARGE_MCB_MAPPING_ENTRY Run;
 
-    if (!RunFound)
+    if (Mcb->PairCount == 0)
     {
         return FALSE;
     }
 
+    Run = &Mcb->Mapping->Runs[Mcb->PairCount - 1];
+
     if (Vbn)
     {
-        *Vbn = RunFound->RunEndVbn.QuadPart - 1;
+        *Vbn = Run->RunEndVbn.QuadPart - 1;
     }
     if (Lbn)
     {
-        if (1)
-        {
-            *Lbn = RunFound->StartingLbn.QuadPart + (RunFound->RunEndVbn.QuadPart - RunFound->RunStartVbn.QuadPart) - 1;
-        }
-        else
-        {
-            *Lbn = ~0ULL;
-        }
+        *Lbn = Run->StartingLbn.QuadPart + (Run->RunEndVbn.QuadPart - Run->RunStartVbn.QuadPart) - 1;
     }
     if (Index)
     {
-        *Index = RunIndex - 1;
+        McbIndexRuns(Mcb, Mcb->PairCount);
+        *Index = Run->RunIndex;
     }
 
     return TRUE;
@@ -741,16 +789,16 @@ ULONG
 NTAPI
 FsRtlNumberOfRunsInBaseMcb(IN PBASE_MCB OpaqueMcb)
 {
+    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
     ULONG NumberOfRuns = 0;
-    LONGLONG Vbn, Lbn, Count;
-    int i;
 
     DPRINT("FsRtlNumberOfRunsInBaseMcb(%p)\n", OpaqueMcb);
 
-    // Count how many Mcb entries there are
-    for (i = 0; FsRtlGetNextBaseMcbEntry(OpaqueMcb, i, &Vbn, &Lbn, &Count); i++)
+    // The index of the last run, holes included, gives the count
+    if (Mcb->PairCount)
     {
-        NumberOfRuns++;
+        McbIndexRuns(Mcb, Mcb->PairCount);
+        NumberOfRuns = Mcb->Mapping->Runs[Mcb->PairCount - 1].RunIndex + 1;
     }
 
     DPRINT("FsRtlNumberOfRunsInBaseMcb(%p) = %d\n", OpaqueMcb, NumberOfRuns);
@@ -797,8 +845,9 @@ FsRtlRemoveBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
                         IN LONGLONG SectorCount)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    LARGE_MCB_MAPPING_ENTRY NeedleRun;
-    PLARGE_MCB_MAPPING_ENTRY HaystackRun;
+    PLARGE_MCB_MAPPING_ENTRY Runs, Run;
+    LONGLONG EndVbn, RunEndVbn;
+    ULONG First, Last;
     BOOLEAN Result = TRUE;
 
     DPRINT("FsRtlRemoveBaseMcbEntry(%p, %I64d, %I64d)\n", OpaqueMcb, Vbn, SectorCount);
@@ -815,82 +864,50 @@ FsRtlRemoveBaseMcbEntry(IN PBASE_MCB OpaqueMcb,
         goto quit;
     }
 
-    NeedleRun.RunStartVbn.QuadPart = Vbn;
-    NeedleRun.RunEndVbn.QuadPart = Vbn + SectorCount;
-    NeedleRun.StartingLbn.QuadPart = -1;
+    EndVbn = Vbn + SectorCount;
+    First = McbFindRun(Mcb, Vbn);
+    if (First == Mcb->PairCount)
+        goto quit;
 
-    /* adjust/destroy all intersecting ranges */
-    Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-    while ((HaystackRun = RtlLookupElementGenericTable(&Mcb->Mapping->Table, &NeedleRun)))
+    Run = &Mcb->Mapping->Runs[First];
+    if (Run->RunStartVbn.QuadPart < Vbn)
     {
-        if (HaystackRun->RunStartVbn.QuadPart < NeedleRun.RunStartVbn.QuadPart)
+        RunEndVbn = Run->RunEndVbn.QuadPart;
+        if (RunEndVbn > EndVbn)
         {
-            LONGLONG HaystackRunEnd = HaystackRun->RunEndVbn.QuadPart;
-            ASSERT(HaystackRun->RunEndVbn.QuadPart > NeedleRun.RunStartVbn.QuadPart);
-
-            HaystackRun->RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart;
-
-            if (HaystackRunEnd > NeedleRun.RunEndVbn.QuadPart)
+            /* The range we are deleting is included in this run.
+             * Keep the head here and add the tail back. */
+            if (!McbReserveRuns(Mcb, Mcb->PairCount + 1))
             {
-                /* The run we are deleting is included in the run we just truncated.
-                 * Add the tail back. */
-                LARGE_MCB_MAPPING_ENTRY TailRun;
-                BOOLEAN NewElement;
-
-                TailRun.RunStartVbn.QuadPart = NeedleRun.RunEndVbn.QuadPart;
-                TailRun.RunEndVbn.QuadPart = HaystackRunEnd;
-                TailRun.StartingLbn.QuadPart = HaystackRun->StartingLbn.QuadPart + (NeedleRun.RunEndVbn.QuadPart - HaystackRun->RunStartVbn.QuadPart);
-
-                Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-
-                RtlInsertElementGenericTable(&Mcb->Mapping->Table, &TailRun, sizeof(TailRun), &NewElement);
-                ++Mcb->PairCount;
-                ASSERT(NewElement);
-
-                Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
+                Result = FALSE;
+                goto quit;
             }
-        }
-        else if (HaystackRun->RunEndVbn.QuadPart > NeedleRun.RunEndVbn.QuadPart)
-        {
-            LONGLONG HaystackRunStart = HaystackRun->RunStartVbn.QuadPart;
-            LONGLONG HaystackStartingLbn = HaystackRun->StartingLbn.QuadPart;
+            Run = &Mcb->Mapping->Runs[First];
 
-            ASSERT(HaystackRun->RunStartVbn.QuadPart < NeedleRun.RunEndVbn.QuadPart);
-            HaystackRun->RunStartVbn.QuadPart = NeedleRun.RunEndVbn.QuadPart;
-            /* Adjust the starting LBN */
-            HaystackRun->StartingLbn.QuadPart += NeedleRun.RunEndVbn.QuadPart - HaystackRunStart;
-
-            if (HaystackRunStart < NeedleRun.RunStartVbn.QuadPart)
-            {
-                /* The run we are deleting is included in the run we just truncated.
-                 * Add the head back. */
-                LARGE_MCB_MAPPING_ENTRY HeadRun;
-                BOOLEAN NewElement;
-
-                HeadRun.RunStartVbn.QuadPart = HaystackRunStart;
-                HeadRun.RunEndVbn.QuadPart = NeedleRun.RunStartVbn.QuadPart;
-                HeadRun.StartingLbn.QuadPart = HaystackStartingLbn;
-
-                Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
+            McbInsertRun(Mcb, First + 1, EndVbn, RunEndVbn,
+                         Run->StartingLbn.QuadPart + (EndVbn - Run->RunStartVbn.QuadPart));
+            Run->RunEndVbn.QuadPart = Vbn;
+            goto quit;
+        }
 
-                RtlInsertElementGenericTable(&Mcb->Mapping->Table, &HeadRun, sizeof(HeadRun), &NewElement);
-                ++Mcb->PairCount;
-                ASSERT(NewElement);
+        /* Keep the head of the run */
+        Run->RunEndVbn.QuadPart = Vbn;
+        McbInvalidateIndex(Mcb, First);
+        First++;
+    }
 
-                Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-            }
-        }
-        else
-        {
-            //ASSERT(NeedleRun.RunStartVbn.QuadPart >= HaystackRun->RunStartVbn.QuadPart);
-            //ASSERT(NeedleRun.RunEndVbn.QuadPart <= HaystackRun->RunEndVbn.QuadPart);
-            Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
-            RtlDeleteElementGenericTable(&Mcb->Mapping->Table, HaystackRun);
-            --Mcb->PairCount;
-            Mcb->Mapping->Table.CompareRoutine = McbMappingIntersectCompare;
-        }
+    /* Runs First up to Last are fully within the range */
+    Last = McbFindRun(Mcb, EndVbn);
+    Runs = Mcb->Mapping->Runs;
+    if (Last < Mcb->PairCount && Runs[Last].RunStartVbn.QuadPart < EndVbn)
+    {
+        /* Keep the tail of the run and adjust its starting LBN */
+        Runs[Last].StartingLbn.QuadPart += EndVbn - Runs[Last].RunStartVbn.QuadPart;
+        Runs[Last].RunStartVbn.QuadPart = EndVbn;
+        McbInvalidateIndex(Mcb, Last);
     }
-    Mcb->Mapping->Table.CompareRoutine = McbMappingCompare;
+
+    McbDeleteRuns(Mcb, First, Last - First);
 
 quit:
     DPRINT("FsRtlRemoveBaseMcbEntry(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, SectorCount, Result);
@@ -921,18 +938,20 @@ NTAPI
 FsRtlResetBaseMcb(IN PBASE_MCB OpaqueMcb)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Element;
+    PLARGE_MCB_MAPPING Mapping = Mcb->Mapping;
 
     DPRINT("FsRtlResetBaseMcb(%p)\n", OpaqueMcb);
 
-    while (RtlNumberGenericTableElements(&Mcb->Mapping->Table) &&
-           (Element = (PLARGE_MCB_MAPPING_ENTRY)RtlGetElementGenericTable(&Mcb->Mapping->Table, 0)))
+    /* Go back to the runs held in the mapping itself */
+    if (Mapping->Runs != Mapping->InitialRuns)
     {
-        RtlDeleteElementGenericTable(&Mcb->Mapping->Table, Element);
+        ExFreePoolWithTag(Mapping->Runs, 'BCML');
+        Mapping->Runs = Mapping->InitialRuns;
     }
+    Mapping->IndexedRunCount = 0;
 
     Mcb->PairCount = 0;
-    Mcb->MaximumPairCount = 0;
+    Mcb->MaximumPairCount = MAXIMUM_PAIR_COUNT;
 }
 
 /*
@@ -955,7 +974,9 @@ FsRtlResetLargeMcb(IN PLARGE_MCB Mcb,
 }
 
 /*
- * @unimplemented
+ * @implemented
+ * Inserts a hole of @Amount sectors at @Vbn, shifting up all the mappings
+ * starting at or after @Vbn. A run crossing @Vbn is split in two.
  */
 BOOLEAN
 NTAPI
@@ -964,54 +985,60 @@ FsRtlSplitBaseMcb(IN PBASE_MCB OpaqueMcb,
                   IN LONGLONG Amount)
 {
     PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
-    PLARGE_MCB_MAPPING_ENTRY Run, InsertLowerRun = NULL, ExistingRun = NULL;
-    BOOLEAN NewElement;
+    PLARGE_MCB_MAPPING_ENTRY Runs, Run;
+    BOOLEAN Result = TRUE;
+    ULONG Position, i;
 
     DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d)\n", OpaqueMcb, Vbn, Amount);
 
-    /* Traverse the tree */
-    for (Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, TRUE);
-        Run;
-        Run = (PLARGE_MCB_MAPPING_ENTRY)RtlEnumerateGenericTable(&Mcb->Mapping->Table, FALSE))
+    if (Vbn < 0 || Amount < 0)
     {
-        /* unaffected run? */
-        /* FIXME: performance: effective skip of all 'lower' runs without traversing them */
-        if (Vbn >= Run->RunEndVbn.QuadPart) { DPRINT("Skipping it\n"); continue; }
-
-        /* crossing run to be split?
-        * 'lower_run' is created on the original place; just shortened.
-        * current 'run' is shifted up later
-        */
-        if (Vbn < Run->RunEndVbn.QuadPart)
-        {
-            /* FIXME: shift 'run->Lbn_start' ? */
-            Run->RunStartVbn.QuadPart = Vbn;
-
-            InsertLowerRun = NULL;
-        }
+        Result = FALSE;
+        goto quit;
+    }
 
-        /* Shift the current 'run'.
-        * Ordering is not changed in Generic Tree so I hope I do not need to reinsert it.
-        */
-        Run->RunStartVbn.QuadPart += Amount;
-        ASSERT(Run->RunEndVbn.QuadPart + Amount > Run->RunEndVbn.QuadPart); /* overflow? */
-        Run->RunEndVbn.QuadPart += Amount;
-        /* FIXME: shift 'run->Lbn_start' ? */
+    Position = McbFindRun(Mcb, Vbn);
+    if (Amount == 0 || Position == Mcb->PairCount)
+        goto quit;
 
-        /* continue the traversal */
+    /* overflow? */
+    Runs = Mcb->Mapping->Runs;
+    if (Runs[Mcb->PairCount - 1].RunEndVbn.QuadPart + Amount <= Runs[Mcb->PairCount - 1].RunEndVbn.QuadPart)
+    {
+        Result = FALSE;
+        goto quit;
     }
 
-    if (InsertLowerRun)
+    /* crossing run to be split?
+     * the lower part stays in place, the upper part is shifted below */
+    if (Runs[Position].RunStartVbn.QuadPart < Vbn)
     {
-        ExistingRun = RtlInsertElementGenericTable(&Mcb->Mapping->Table, InsertLowerRun, sizeof(*InsertLowerRun), &NewElement);
-        ++Mcb->PairCount;
+        if (!McbReserveRuns(Mcb, Mcb->PairCount + 1))
+        {
+            Result = FALSE;
+            goto quit;
+        }
+
+        Run = &Mcb->Mapping->Runs[Position];
+        McbInsertRun(Mcb, Position + 1, Vbn, Run->RunEndVbn.QuadPart,
+                     Run->StartingLbn.QuadPart + (Vbn - Run->RunStartVbn.QuadPart));
+        Run->RunEndVbn.QuadPart = Vbn;
+        Position++;
     }
 
-    ASSERT(ExistingRun == NULL);
+    /* shift all the following runs */
+    Runs = Mcb->Mapping->Runs;
+    for (i = Position; i < Mcb->PairCount; i++)
+    {
+        Runs[i].RunStartVbn.QuadPart += Amount;
+        Runs[i].RunEndVbn.QuadPart += Amount;
+    }
+    McbInvalidateIndex(Mcb, Position);
 
-    DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, Amount, TRUE);
+quit:
+    DPRINT("FsRtlSplitBaseMcb(%p, %I64d, %I64d) = %d\n", OpaqueMcb, Vbn, Amount, Result);
 
-    return TRUE;
+    return Result;
 }
 
 /*
@@ -1039,16 +1066,36 @@ FsRtlSplitLargeMcb(IN PLARGE_MCB Mcb,
 }
 
 /*
- * @unimplemented
+ * @implemented
  */
 VOID
 NTAPI
 FsRtlTruncateBaseMcb(IN PBASE_MCB OpaqueMcb,
                      IN LONGLONG Vbn)
 {
+    PBASE_MCB_INTERNAL Mcb = (PBASE_MCB_INTERNAL)OpaqueMcb;
+    PLARGE_MCB_MAPPING_ENTRY Run;
+    ULONG Position;
+
     DPRINT("FsRtlTruncateBaseMcb(%p, %I64d)\n", OpaqueMcb, Vbn);
 
-    FsRtlRemoveBaseMcbEntry(OpaqueMcb, Vbn, MAXLONG - Vbn + 1);
+    if (Vbn < 0)
+        return;
+
+    /* Drop everything from Vbn on, keeping the head of a crossing run */
+    Position = McbFindRun(Mcb, Vbn);
+    if (Position == Mcb->PairCount)
+        return;
+
+    Run = &Mcb->Mapping->Runs[Position];
+    if (Run->RunStartVbn.QuadPart < Vbn)
+    {
+        Run->RunEndVbn.QuadPart = Vbn;
+        McbInvalidateIndex(Mcb, Position);
+        Position++;
+    }
+
+    McbDeleteRuns(Mcb, Position, Mcb->PairCount - Position);
 }
 
 /*
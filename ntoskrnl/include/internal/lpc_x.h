@@ -92,6 +92,17 @@
     KeReleaseSemaphore(s, 1, 1, FALSE);                     \
 }
 
+//
+// Releases an LPC Semaphore and keeps the dispatcher locked until the caller
+// waits for its reply, so that it can switch straight to the woken thread
+//
+#define LpcpCompleteWaitAndHandoff(s)                       \
+{                                                           \
+    /* Release it, the reply wait drops the lock */         \
+    LPCTRACE(LPC_SEND_DEBUG, "Release and wait: %p\n", s);  \
+    KeReleaseSemaphore(s, 1, 1, TRUE);                      \
+}
+
 //
 // Allocates a new message
 //
@@ -101,13 +112,13 @@ LpcpAllocateFromPortZone(VOID)
 {
     PLPCP_MESSAGE Message;
 
-    /* Allocate a message from the port zone while holding the lock */
-    KeAcquireGuardedMutex(&LpcpLock);
+    /* Allocate a message from the port zone. The lookaside list does its
+       own locking and nobody else can see the message yet, so this does
+       not need the LPC lock */
     Message = (PLPCP_MESSAGE)ExAllocateFromPagedLookasideList(&LpcpMessagesLookaside);
     if (!Message)
     {
         /* Fail, and let caller cleanup */
-        KeReleaseGuardedMutex(&LpcpLock);
         return NULL;
     }
 
@@ -115,9 +126,6 @@ LpcpAllocateFromPortZone(VOID)
     InitializeListHead(&Message->Entry);
     Message->RepliedToThread = NULL;
     Message->Request.u2.ZeroInit = 0;
-
-    /* Release the lock */
-    KeReleaseGuardedMutex(&LpcpLock);
     return Message;
 }
 
@@ -478,6 +478,7 @@ extern LARGE_INTEGER ShortPsLockDelay;
 extern UNICODE_STRING PsNtDllPathName;
 extern LIST_ENTRY PsLoadedModuleList;
 extern KSPIN_LOCK PsLoadedModuleSpinLock;
+extern ULONG PsLoadedModuleListGeneration;
 extern ERESOURCE PsLoadedModuleResource;
 extern ULONG_PTR PsNtosImageBase;
 
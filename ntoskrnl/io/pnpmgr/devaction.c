@@ -41,6 +41,12 @@ extern BOOLEAN PnPBootDriversInitialized;
 #define MAX_SEPARATORS_INSTANCEID  0
 #define MAX_SEPARATORS_DEVICEID    1
 
+/* Sibling devices are started by up to this many threads at once */
+#define PI_MAX_START_THREADS       8
+
+/* Device starts taking longer than this show up in the debug log */
+#define PI_SLOW_START_MS           100
+
 /* DATA **********************************************************************/
 
 LIST_ENTRY IopDeviceActionRequestList;
@@ -84,6 +90,18 @@ typedef struct _ATTACH_FILTER_DRIVERS_CONTEXT
     PLIST_ENTRY DriversListHead;
 } ATTACH_FILTER_DRIVERS_CONTEXT, *PATTACH_FILTER_DRIVERS_CONTEXT;
 
+/* Nodes of a group share a driver and are started one after the other */
+#define PI_END_OF_GROUP            MAXULONG
+
+typedef struct _START_DEVICES_CONTEXT
+{
+    PDEVICE_NODE *DeviceNodes;
+    PULONG NextInGroup;
+    PULONG Groups;
+    ULONG GroupCount;
+    volatile LONG NextGroup;
+} START_DEVICES_CONTEXT, *PSTART_DEVICES_CONTEXT;
+
 /* FUNCTIONS *****************************************************************/
 
 PDEVICE_OBJECT
@@ -2307,6 +2325,374 @@ PiFakeResourceRebalance(
     DeviceNode->Flags &= ~DNF_RESOURCE_REQUIREMENTS_CHANGED;
 }
 
+/**
+ * @brief      Brings a device node up to the point where it can be started
+ *
+ * Does what PiDevNodeStateMachine would do for the node before sending
+ * IRP_MN_START_DEVICE to it.
+ *
+ * @return     TRUE if the node now has its resources assigned
+ */
+static
+BOOLEAN
+PiPrepareDevNodeStart(
+    _In_ PDEVICE_NODE DeviceNode)
+{
+    PNP_DEVNODE_STATE State;
+    NTSTATUS Status = STATUS_SUCCESS;
+
+    while (NT_SUCCESS(Status) && !(DeviceNode->Flags & DNF_HAS_PROBLEM))
+    {
+        State = DeviceNode->State;
+        switch (State)
+        {
+            case DeviceNodeUninitialized:
+                Status = PiInitializeDevNode(DeviceNode);
+                break;
+            case DeviceNodeInitialized:
+                Status = PiCallDriverAddDevice(DeviceNode, PnPBootDriversInitialized);
+                break;
+            case DeviceNodeDriversAdded:
+                Status = IopAssignDeviceResources(DeviceNode);
+                break;
+            case DeviceNodeResourcesAssigned:
+                return TRUE;
+            default:
+                return FALSE;
+        }
+
+        // Leave nodes that got stuck to the state machine
+        if (DeviceNode->State == State)
+            break;
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief      Storage stacks are started ahead of their siblings, the boot
+ *             volume may be waiting for them
+ */
+static
+BOOLEAN
+PiIsStorageDevNode(
+    _In_ PDEVICE_NODE DeviceNode)
+{
+    PDEVICE_OBJECT fdo;
+    DEVICE_TYPE deviceType;
+
+    fdo = IoGetAttachedDeviceReference(DeviceNode->PhysicalDeviceObject);
+    deviceType = fdo->DeviceType;
+    ObDereferenceObject(fdo);
+
+    return deviceType == FILE_DEVICE_CONTROLLER ||
+           deviceType == FILE_DEVICE_DISK ||
+           deviceType == FILE_DEVICE_CD_ROM ||
+           deviceType == FILE_DEVICE_MASS_STORAGE;
+}
+
+/**
+ * @brief      Checks whether two device stacks have a driver in common above
+ *             their PDOs
+ *
+ * Such drivers may share hardware or state between the devices and expect
+ * their starts to come one at a time. The bus driver owns the PDOs of all
+ * the siblings, so it is not taken into account.
+ */
+static
+BOOLEAN
+PiDevNodesShareDriver(
+    _In_ PDEVICE_NODE DeviceNode1,
+    _In_ PDEVICE_NODE DeviceNode2)
+{
+    PDEVICE_OBJECT device1, device2;
+
+    for (device1 = DeviceNode1->PhysicalDeviceObject->AttachedDevice;
+         device1;
+         device1 = device1->AttachedDevice)
+    {
+        for (device2 = DeviceNode2->PhysicalDeviceObject->AttachedDevice;
+             device2;
+             device2 = device2->AttachedDevice)
+        {
+            if (device1->DriverObject == device2->DriverObject)
+                return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+/**
+ * @brief      Returns the first node of the set a node belongs to, see
+ *             PiGroupDevNodesByDriver
+ */
+static
+ULONG
+PiFindDevNodeGroup(
+    _Inout_ PULONG Parent,
+    _In_ ULONG Node)
+{
+    while (Parent[Node] != Node)
+    {
+        // Path halving keeps the chains short
+        Parent[Node] = Parent[Parent[Node]];
+        Node = Parent[Node];
+    }
+
+    return Node;
+}
+
+/**
+ * @brief      Puts the device nodes of the context into groups, so that nodes
+ *             sharing a driver end up in the same group, in their order
+ *
+ * Sharing is transitive: a node sharing drivers with two groups joins them
+ * into one. The groups are built as disjoint sets first, with the Groups
+ * array holding the parent links, each set led by its first node.
+ */
+static
+VOID
+PiGroupDevNodesByDriver(
+    _Inout_ PSTART_DEVICES_CONTEXT Context,
+    _In_ ULONG Count)
+{
+    PULONG parent = Context->Groups;
+    ULONG i, node, root1, root2;
+
+    for (i = 0; i < Count; i++)
+        parent[i] = i;
+
+    for (i = 1; i < Count; i++)
+    {
+        for (node = 0; node < i; node++)
+        {
+            root1 = PiFindDevNodeGroup(parent, i);
+            root2 = PiFindDevNodeGroup(parent, node);
+            if (root1 == root2)
+                continue;
+
+            if (PiDevNodesShareDriver(Context->DeviceNodes[i], Context->DeviceNodes[node]))
+                parent[max(root1, root2)] = min(root1, root2);
+        }
+    }
+
+    for (i = 0; i < Count; i++)
+    {
+        parent[i] = PiFindDevNodeGroup(parent, i);
+        Context->NextInGroup[i] = PI_END_OF_GROUP;
+    }
+
+    // Link each set in order. Going backwards, the link of a set's first
+    // node collects the others until that node itself is reached.
+    for (i = Count; i-- > 0;)
+    {
+        root1 = parent[i];
+        if (root1 != i)
+        {
+            Context->NextInGroup[i] = Context->NextInGroup[root1];
+            Context->NextInGroup[root1] = i;
+        }
+    }
+
+    // The group heads replace the parent links, there are never more
+    // heads before a node than nodes before it
+    Context->GroupCount = 0;
+    for (i = 0; i < Count; i++)
+    {
+        if (parent[i] == i)
+            Context->Groups[Context->GroupCount++] = i;
+    }
+}
+
+static
+VOID
+PiStartDevNodeTimed(
+    _In_ PDEVICE_NODE DeviceNode)
+{
+    LARGE_INTEGER frequency, start, end;
+    ULONGLONG milliseconds;
+
+    start = KeQueryPerformanceCounter(&frequency);
+    PiIrpStartDevice(DeviceNode);
+    end = KeQueryPerformanceCounter(NULL);
+
+    milliseconds = (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart;
+    if (milliseconds >= PI_SLOW_START_MS)
+    {
+        DPRINT1("Starting %wZ took %I64u ms (status 0x%08lx)\n",
+                &DeviceNode->InstancePath, milliseconds, DeviceNode->CompletionStatus);
+    }
+    else
+    {
+        DPRINT("Starting %wZ took %I64u ms\n", &DeviceNode->InstancePath, milliseconds);
+    }
+}
+
+static
+VOID
+PiStartDevicesFromContext(
+    _In_ PSTART_DEVICES_CONTEXT Context)
+{
+    LONG group;
+    ULONG node;
+
+    while ((group = InterlockedIncrement(&Context->NextGroup) - 1) < (LONG)Context->GroupCount)
+    {
+        for (node = Context->Groups[group]; node != PI_END_OF_GROUP; node = Context->NextInGroup[node])
+        {
+            PiStartDevNodeTimed(Context->DeviceNodes[node]);
+        }
+    }
+}
+
+static
+VOID
+NTAPI
+PiStartDevicesThread(
+    _In_ PVOID Context)
+{
+    PiStartDevicesFromContext(Context);
+    PsTerminateSystemThread(STATUS_SUCCESS);
+}
+
+/**
+ * @brief      Sends IRP_MN_START_DEVICE to a device node and, if asked to, to
+ *             its following siblings at the same time
+ *
+ * The siblings are brought up to the start first, the starts then run on
+ * a few system threads. Siblings whose stacks share a driver are started
+ * one after the other, on the same thread. Parents are always started
+ * before their children,
+ * since children only appear when their parent gets enumerated.
+ * All the started nodes end up in DeviceNodeStartCompletion.
+ */
+static
+VOID
+PiStartDevNodeAndSiblings(
+    _In_ PDEVICE_NODE DeviceNode,
+    _In_ BOOLEAN IncludeSiblings)
+{
+    START_DEVICES_CONTEXT context;
+    PDEVICE_NODE *deviceNodes = NULL;
+    PDEVICE_NODE node;
+    HANDLE threadHandles[PI_MAX_START_THREADS - 1];
+    OBJECT_ATTRIBUTES objectAttributes;
+    LARGE_INTEGER frequency, start, end;
+    ULONG count = 1, startCount, threadCount = 0, storageCount = 0, i;
+    KIRQL oldIrql;
+    NTSTATUS status;
+
+    if (IncludeSiblings)
+    {
+        KeAcquireSpinLock(&IopDeviceTreeLock, &oldIrql);
+        for (node = DeviceNode->Sibling; node; node = node->Sibling)
+            count++;
+        KeReleaseSpinLock(&IopDeviceTreeLock, oldIrql);
+    }
+
+    // The node array is followed by the group links and heads
+    if (count > 1)
+    {
+        deviceNodes = ExAllocatePoolWithTag(PagedPool,
+                                            count * (sizeof(*deviceNodes) + 2 * sizeof(ULONG)),
+                                            TAG_PNP_DEVACTION);
+    }
+
+    if (!deviceNodes)
+    {
+        PiStartDevNodeTimed(DeviceNode);
+        PiSetDevNodeState(DeviceNode, DeviceNodeStartCompletion);
+        return;
+    }
+
+    // Collect the siblings, they are kept referenced until started
+    KeAcquireSpinLock(&IopDeviceTreeLock, &oldIrql);
+    deviceNodes[0] = DeviceNode;
+    ObReferenceObject(DeviceNode->PhysicalDeviceObject);
+    for (i = 1, node = DeviceNode->Sibling; node && i < count; node = node->Sibling, i++)
+    {
+        deviceNodes[i] = node;
+        ObReferenceObject(node->PhysicalDeviceObject);
+    }
+    count = i;
+    KeReleaseSpinLock(&IopDeviceTreeLock, oldIrql);
+
+    // Keep the ones which can be started, storage first
+    for (i = 0, startCount = 0; i < count; i++)
+    {
+        node = deviceNodes[i];
+        if (i > 0 && !PiPrepareDevNodeStart(node))
+        {
+            ObDereferenceObject(node->PhysicalDeviceObject);
+            continue;
+        }
+
+        if (PiIsStorageDevNode(node))
+        {
+            RtlMoveMemory(&deviceNodes[storageCount + 1],
+                          &deviceNodes[storageCount],
+                          (startCount - storageCount) * sizeof(*deviceNodes));
+            deviceNodes[storageCount++] = node;
+        }
+        else
+        {
+            deviceNodes[startCount] = node;
+        }
+        startCount++;
+    }
+
+    context.DeviceNodes = deviceNodes;
+    context.NextInGroup = (PULONG)&deviceNodes[count];
+    context.Groups = &context.NextInGroup[count];
+    context.NextGroup = 0;
+    PiGroupDevNodesByDriver(&context, startCount);
+
+    start = KeQueryPerformanceCounter(&frequency);
+
+    // Use a thread per group, up to a limit; this thread is one of them
+    InitializeObjectAttributes(&objectAttributes, NULL, OBJ_KERNEL_HANDLE, NULL, NULL);
+    while (threadCount + 1 < min(context.GroupCount, PI_MAX_START_THREADS))
+    {
+        status = PsCreateSystemThread(&threadHandles[threadCount],
+                                      THREAD_ALL_ACCESS,
+                                      &objectAttributes,
+                                      NULL,
+                                      NULL,
+                                      PiStartDevicesThread,
+                                      &context);
+        if (!NT_SUCCESS(status))
+        {
+            DPRINT1("PsCreateSystemThread() failed (status 0x%08lx)\n", status);
+            break;
+        }
+        threadCount++;
+    }
+
+    PiStartDevicesFromContext(&context);
+
+    // The context lives on our stack, wait until nobody uses it
+    for (i = 0; i < threadCount; i++)
+    {
+        ZwWaitForSingleObject(threadHandles[i], FALSE, NULL);
+        ZwClose(threadHandles[i]);
+    }
+
+    end = KeQueryPerformanceCounter(NULL);
+    DPRINT("Started %lu devices next to %wZ with %lu threads in %I64u ms\n",
+           startCount, &DeviceNode->InstancePath, threadCount + 1,
+           (end.QuadPart - start.QuadPart) * 1000 / frequency.QuadPart);
+
+    // skip DeviceNodeStartPending, it is probably used for an async IRP_MN_START_DEVICE
+    for (i = 0; i < startCount; i++)
+    {
+        PiSetDevNodeState(deviceNodes[i], DeviceNodeStartCompletion);
+        ObDereferenceObject(deviceNodes[i]->PhysicalDeviceObject);
+    }
+
+    ExFreePoolWithTag(deviceNodes, TAG_PNP_DEVACTION);
+}
+
 static
 VOID
 PiDevNodeStateMachine(
@@ -2354,11 +2740,9 @@ PiDevNodeStateMachine(
                 break;
             case DeviceNodeResourcesAssigned:
                 DPRINT("DeviceNodeResourcesAssigned %wZ\n", &currentNode->InstancePath);
-                // send IRP_MN_START_DEVICE
-                PiIrpStartDevice(currentNode);
-
-                // skip DeviceNodeStartPending, it is probably used for an async IRP_MN_START_DEVICE
-                PiSetDevNodeState(currentNode, DeviceNodeStartCompletion);
+                // send IRP_MN_START_DEVICE, together with the siblings that are
+                // not started yet, unless we were only asked for this node
+                PiStartDevNodeAndSiblings(currentNode, currentNode != RootNode);
                 doProcessAgain = TRUE;
                 break;
             case DeviceNodeStartPending: // skipped on XP/2003
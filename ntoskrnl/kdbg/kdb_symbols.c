@@ -27,6 +27,22 @@ typedef struct _IMAGE_SYMBOL_INFO_CACHE
 }
 IMAGE_SYMBOL_INFO_CACHE, *PIMAGE_SYMBOL_INFO_CACHE;
 
+#define KDB_MODULE_INDEX_SIZE 512
+
+typedef struct _KDB_MODULE_RANGE
+{
+    ULONG_PTR Start;
+    ULONG_PTR End;
+    PLDR_DATA_TABLE_ENTRY LdrEntry;
+}
+KDB_MODULE_RANGE, *PKDB_MODULE_RANGE;
+
+/* Kernel modules sorted by base address, rebuilt whenever PsLoadedModuleList changes */
+static KDB_MODULE_RANGE KdbpModuleIndex[KDB_MODULE_INDEX_SIZE];
+static ULONG KdbpModuleIndexCount = 0;
+static ULONG KdbpModuleIndexGeneration = MAXULONG;
+static BOOLEAN KdbpModuleIndexValid = FALSE;
+
 static BOOLEAN LoadSymbols = FALSE;
 static LIST_ENTRY SymbolsToLoad;
 static KSPIN_LOCK SymbolsToLoadLock;
@@ -60,6 +76,82 @@ KdbpSymSearchModuleList(
     return FALSE;
 }
 
+/*! \brief Bring the kernel module index up to date.
+ *
+ * The index is rebuilt in place when the loaded module list changed since it
+ * was last built, so lookups never need to allocate.
+ *
+ * \note PsLoadedModuleSpinLock must be held.
+ *
+ * \retval TRUE   The index covers every kernel module.
+ * \retval FALSE  There are more modules than the index can hold.
+ */
+static
+BOOLEAN
+KdbpSymUpdateModuleIndex(VOID)
+{
+    PLIST_ENTRY ListEntry;
+    PLDR_DATA_TABLE_ENTRY LdrEntry;
+    ULONG_PTR Start;
+    ULONG Count = 0;
+    ULONG i;
+
+    if (KdbpModuleIndexGeneration == PsLoadedModuleListGeneration)
+        return KdbpModuleIndexValid;
+
+    KdbpModuleIndexGeneration = PsLoadedModuleListGeneration;
+    KdbpModuleIndexValid = FALSE;
+    KdbpModuleIndexCount = 0;
+
+    for (ListEntry = PsLoadedModuleList.Flink;
+         ListEntry != &PsLoadedModuleList;
+         ListEntry = ListEntry->Flink)
+    {
+        if (Count == KDB_MODULE_INDEX_SIZE)
+            return FALSE;
+
+        LdrEntry = CONTAINING_RECORD(ListEntry, LDR_DATA_TABLE_ENTRY, InLoadOrderLinks);
+        Start = (ULONG_PTR)LdrEntry->DllBase;
+
+        /* Modules are mostly loaded at increasing addresses, so this rarely moves anything */
+        for (i = Count; i > 0 && KdbpModuleIndex[i - 1].Start > Start; i--)
+            KdbpModuleIndex[i] = KdbpModuleIndex[i - 1];
+
+        KdbpModuleIndex[i].Start = Start;
+        KdbpModuleIndex[i].End = Start + LdrEntry->SizeOfImage;
+        KdbpModuleIndex[i].LdrEntry = LdrEntry;
+        Count++;
+    }
+
+    KdbpModuleIndexCount = Count;
+    KdbpModuleIndexValid = TRUE;
+    return TRUE;
+}
+
+static
+PLDR_DATA_TABLE_ENTRY
+KdbpSymLookupModuleIndex(
+    IN ULONG_PTR Address)
+{
+    LONG Low = 0;
+    LONG High = (LONG)KdbpModuleIndexCount - 1;
+    LONG Mid;
+
+    while (Low <= High)
+    {
+        Mid = (Low + High) / 2;
+
+        if (Address < KdbpModuleIndex[Mid].Start)
+            High = Mid - 1;
+        else if (Address >= KdbpModuleIndex[Mid].End)
+            Low = Mid + 1;
+        else
+            return KdbpModuleIndex[Mid].LdrEntry;
+    }
+
+    return NULL;
+}
+
 /*! \brief Find a module...
  *
  * \param Address      If \a Address is not NULL the module containing \a Address
@@ -80,21 +172,30 @@ KdbpSymFindModule(
 {
     LONG Count = 0;
     PEPROCESS CurrentProcess;
+    BOOLEAN Found;
 
     /* First try to look up the module in the kernel module list. */
     KeAcquireSpinLockAtDpcLevel(&PsLoadedModuleSpinLock);
-    if(KdbpSymSearchModuleList(PsLoadedModuleList.Flink,
-                               &PsLoadedModuleList,
-                               &Count,
-                               Address,
-                               Index,
-                               pLdrEntry))
+    if (Address && Index < 0 && KdbpSymUpdateModuleIndex())
     {
-        KeReleaseSpinLockFromDpcLevel(&PsLoadedModuleSpinLock);
-        return TRUE;
+        /* Address lookups go through the sorted index */
+        *pLdrEntry = KdbpSymLookupModuleIndex((ULONG_PTR)Address);
+        Found = (*pLdrEntry != NULL);
+    }
+    else
+    {
+        Found = KdbpSymSearchModuleList(PsLoadedModuleList.Flink,
+                                        &PsLoadedModuleList,
+                                        &Count,
+                                        Address,
+                                        Index,
+                                        pLdrEntry);
     }
     KeReleaseSpinLockFromDpcLevel(&PsLoadedModuleSpinLock);
 
+    if (Found)
+        return TRUE;
+
     /* That didn't succeed. Try the module list of the current process now. */
     CurrentProcess = PsGetCurrentProcess();
 
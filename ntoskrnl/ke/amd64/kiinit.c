@@ -467,6 +467,9 @@ KiInitModuleList(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
         /* Insert the copy into the list */
         InsertTailList(&PsLoadedModuleList, &LdrCoreEntries[i].InLoadOrderLinks);
     }
+
+    /* Let cached views of the list know that it changed */
+    PsLoadedModuleListGeneration++;
 }
 
 CODE_SEG("INIT")
@@ -810,15 +810,23 @@ KeInsertQueueDpc(IN PKDPC Dpc,
                 if (Prcb != CurrentPrcb)
                 {
                     /*
-                     * Check if the DPC is of high importance or above the
+                     * Order the queue depth update before reading Sleeping,
+                     * the HAL sets Sleeping before it checks the depth.
+                     */
+                    KeMemoryBarrier();
+
+                    /*
+                     * A sleeping CPU gets no clock interrupts that would drain
+                     * its queue, so it is interrupted for any DPC. Otherwise
+                     * check if the DPC is of high importance or above the
                      * maximum depth. If it is, then make sure that the CPU
-                     * isn't idle, or that it's sleeping.
+                     * isn't idle.
                      */
-                    if (((Dpc->Importance == HighImportance) ||
-                        (DpcData->DpcQueueDepth >=
-                         Prcb->MaximumDpcQueueDepth)) &&
-                        (!(AFFINITY_MASK(Cpu) & KiIdleSummary) ||
-                         (Prcb->Sleeping)))
+                    if ((Prcb->Sleeping) ||
+                        (((Dpc->Importance == HighImportance) ||
+                          (DpcData->DpcQueueDepth >=
+                           Prcb->MaximumDpcQueueDepth)) &&
+                         !(AFFINITY_MASK(Cpu) & KiIdleSummary)))
                     {
                         /* Set interrupt requested */
                         Prcb->DpcInterruptRequested = TRUE;
@@ -351,8 +351,9 @@ LpcRequestWaitReplyPort(IN PVOID PortObject,
         }
     }
 
-    /* Now release the semaphore */
-    LpcpCompleteWait(Semaphore);
+    /* Now release the semaphore, keeping the dispatcher locked until we wait
+       for the reply so that the receiver gets our processor right away */
+    LpcpCompleteWaitAndHandoff(Semaphore);
     KeLeaveCriticalRegion();
 
     /* And let's wait for the reply */
@@ -959,8 +960,9 @@ NtRequestWaitReplyPort(IN HANDLE PortHandle,
         }
     }
 
-    /* Now release the semaphore */
-    LpcpCompleteWait(Semaphore);
+    /* Now release the semaphore, keeping the dispatcher locked until we wait
+       for the reply so that the receiver gets our processor right away */
+    LpcpCompleteWaitAndHandoff(Semaphore);
     KeLeaveCriticalRegion();
 
     /* And let's wait for the reply */
@@ -21,6 +21,7 @@
 LIST_ENTRY PsLoadedModuleList;
 LIST_ENTRY MmLoadedUserImageList;
 KSPIN_LOCK PsLoadedModuleSpinLock;
+ULONG PsLoadedModuleListGeneration;
 ERESOURCE PsLoadedModuleResource;
 ULONG_PTR PsNtosImageBase;
 KMUTANT MmSystemLoadLock;
@@ -637,6 +638,9 @@ MiProcessLoaderEntry(IN PLDR_DATA_TABLE_ENTRY LdrEntry,
     else
         RemoveEntryList(&LdrEntry->InLoadOrderLinks);
 
+    /* Let cached views of the list know that it changed */
+    PsLoadedModuleListGeneration++;
+
     /* Release locks */
     KeReleaseSpinLock(&PsLoadedModuleSpinLock, OldIrql);
     ExReleaseResourceLite(&PsLoadedModuleResource);
@@ -2319,6 +2323,9 @@ MiInitializeLoadedModuleList(IN PLOADER_PARAMETER_BLOCK LoaderBlock)
         NextEntry = NextEntry->Flink;
     }
 
+    /* The list was rebuilt, views of the early one are stale */
+    PsLoadedModuleListGeneration++;
+
     /* Build the import lists for the boot drivers */
     MiBuildImportsForBootDrivers();
 
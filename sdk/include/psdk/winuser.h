@@ -908,6 +908,13 @@ extern "C" {
 #define USER_TIMER_MAXIMUM  2147483647
 #define USER_TIMER_MINIMUM  10
 
+#if (_WIN32_WINNT >= 0x0602)
+#define TIMERV_DEFAULT_COALESCING   0
+#define TIMERV_NO_COALESCING        0xFFFFFFFF
+#define TIMERV_COALESCING_MIN       1
+#define TIMERV_COALESCING_MAX       0x7FFFFFF5
+#endif
+
 #define MWMO_WAITALL 1
 #define MWMO_ALERTABLE 2
 #define MWMO_INPUTAVAILABLE 4
@@ -5325,6 +5332,9 @@ BOOL WINAPI SetSystemCursor(_In_ HCURSOR, _In_ DWORD);
 BOOL WINAPI SetSystemMenu(HWND,HMENU);
 BOOL WINAPI SetThreadDesktop(_In_ HDESK);
 UINT_PTR WINAPI SetTimer(_In_opt_ HWND, _In_ UINT_PTR, _In_ UINT, _In_opt_ TIMERPROC);
+#if (_WIN32_WINNT >= 0x0602)
+UINT_PTR WINAPI SetCoalescableTimer(_In_opt_ HWND, _In_ UINT_PTR, _In_ UINT, _In_opt_ TIMERPROC, _In_ ULONG);
+#endif
 UINT_PTR WINAPI SetSystemTimer(HWND,UINT_PTR,UINT,TIMERPROC);
 
 BOOL
@@ -0,0 +1,47 @@
+/*
+ * PROJECT:     ReactOS Boot Loader
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     Boot bundle format, as read by FreeLoader
+ */
+
+#pragma once
+
+/*
+ * A boot bundle holds the files FreeLoader needs to start the system (kernel,
+ * HAL, hives, NLS files, boot drivers) so that they can be read from the boot
+ * media in a single sequential read. It is laid out as:
+ *
+ *   BOOT_BUNDLE_HEADER
+ *   BOOT_BUNDLE_ENTRY[EntryCount]
+ *   file data, each file starting on a BOOT_BUNDLE_ALIGNMENT boundary
+ *
+ * All values are little-endian.
+ */
+
+#define BOOT_BUNDLE_SIGNATURE   0x4C444E42  /* "BNDL" */
+#define BOOT_BUNDLE_VERSION     1
+#define BOOT_BUNDLE_ALIGNMENT   16
+#define BOOT_BUNDLE_MAX_NAME    120
+
+/* Same values as COMPRESSION_FORMAT_NONE and COMPRESSION_FORMAT_LZNT1 */
+#define BOOT_BUNDLE_COMPRESSION_NONE    0
+#define BOOT_BUNDLE_COMPRESSION_LZNT1   2
+
+typedef struct _BOOT_BUNDLE_HEADER
+{
+    ULONG Signature;
+    ULONG Version;
+    ULONG HeaderSize;       /* Header and entries, the file data follows */
+    ULONG EntryCount;
+    ULONG StoredSize;       /* Size of the whole bundle */
+    ULONG TotalSize;        /* Uncompressed size, each file aligned */
+} BOOT_BUNDLE_HEADER, *PBOOT_BUNDLE_HEADER;
+
+typedef struct _BOOT_BUNDLE_ENTRY
+{
+    CHAR Name[BOOT_BUNDLE_MAX_NAME];    /* Relative to the system root, '\\' separated */
+    ULONG Offset;           /* From the start of the bundle */
+    ULONG StoredSize;
+    ULONG Size;
+    ULONG Compression;
+} BOOT_BUNDLE_ENTRY, *PBOOT_BUNDLE_ENTRY;
@@ -0,0 +1,26 @@
+/*
+ * PROJECT:     ReactOS Storage Stack
+ * LICENSE:     GPL-2.0-or-later (https://spdx.org/licenses/GPL-2.0-or-later)
+ * PURPOSE:     SCSI Port driver private IOCTL definitions
+ */
+
+#pragma once
+
+/* Returns SCSIPORT_STATISTICS. Sent to a LUN it describes that LUN,
+   sent to the adapter it sums up all of its LUNs */
+#define IOCTL_SCSIPORT_QUERY_STATISTICS \
+            CTL_CODE(IOCTL_SCSI_BASE, 0x0800, METHOD_BUFFERED, FILE_ANY_ACCESS)
+
+typedef struct _SCSIPORT_STATISTICS
+{
+    ULONG Version;              /* sizeof(SCSIPORT_STATISTICS) */
+    ULONG LogicalUnits;         /* Number of LUNs summed up */
+    ULONG Requests;             /* Requests completed by the miniport */
+    ULONG TaggedRequests;       /* ... of which were sent as tagged commands */
+    ULONG MergedTransfers;      /* Coalesced transfers sent to the miniport */
+    ULONG MergedRequests;       /* Requests carried by those transfers */
+    ULONG QueueFullEvents;      /* QUEUE FULL statuses returned by the device */
+    ULONG QueueDepth;           /* Current queue depth limit */
+    ULONGLONG TotalLatency;     /* Miniport service time, 100ns units */
+    ULONGLONG MaxLatency;
+} SCSIPORT_STATISTICS, *PSCSIPORT_STATISTICS;
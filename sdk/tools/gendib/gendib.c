@@ -23,8 +23,13 @@
  * rop codes and all depths. The drawback is that it will be relatively slow.
  * The other extreme is to write (generate) a separate Blt routine for each
  * rop code/depth combination. This will result in a extremely large amount
- * of code. So, we opt for something in between: named rops get their own
- * routine, unnamed rops are handled by a generic routine.
+ * of code. So, we opt for something in between: named rops and the unnamed
+ * rops commonly used for masking get their own routine, the other rops are
+ * handled by a generic routine. The generic routine combines the pixels with
+ * DIB_DoRop, which is generated too, with a separate expression per rop.
+ * No SIMD variants are generated: each would add another routine per rop and
+ * depth, and on x86 a CPU feature check and FPU state save per blit (see
+ * DIB_ScalePixel in win32ss/gdi/dib/dib.h).
  * Basically, what happens is that generic code which looks like:
  *
  * for (...)
@@ -116,11 +121,13 @@
 
 #define ROPCODE_GENERIC     256 /* Special case */
 
+#define OPERATION_MAX       128
+
 typedef struct _ROPINFO
 {
     unsigned RopCode;
     const char *Name;
-    const char *Operation;
+    char Operation[OPERATION_MAX];
     int UsesDest;
     int UsesSource;
     int UsesPattern;
@@ -133,29 +140,93 @@ ROPINFO, *PROPINFO;
 #define FLAG_FORCENOUSESSOURCE   0x08
 #define FLAG_FORCERAWSOURCEAVAIL 0x10
 
+/*
+ * All rop codes in reverse polish notation, as listed in the Platform SDK
+ * ternary raster operations table. The operands are D (dest), S (source)
+ * and P (pattern), the operators a (and), o (or), x (xor) and n (not).
+ */
+static const char *RopRpn[256] =
+{
+    "0", "DPSoon", "DPSona", "PSon", "SDPona", "DPon", "PDSxnon", "PDSaon",
+    "SDPnaa", "PDSxon", "DPna", "PSDnaon", "SPna", "PDSnaon", "PDSonon", "Pn",
+    "PDSona", "DSon", "SDPxnon", "SDPaon", "DPSxnon", "DPSaon", "PSDPSanaxx",
+    "SSPxDSxaxn", "SPxPDxa", "SDPSanaxn", "PDSPaox", "SDPSxaxn", "PSDPaox",
+    "DSPDxaxn", "PDSox", "PDSoan", "DPSnaa", "SDPxon", "DSna", "SPDnaon",
+    "SPxDSxa", "PDSPanaxn", "SDPSaox", "SDPSxnox", "DPSxa", "PSDPSaoxxn",
+    "DPSana", "SSPxPDxaxn", "SPDSoax", "PSDnox", "PSDPxox", "PSDnoan", "PSna",
+    "SDPnaon", "SDPSoox", "Sn", "SPDSaox", "SPDSxnox", "SDPox", "SDPoan",
+    "PSDPoax", "SPDnox", "SPDSxox", "SPDnoan", "PSx", "SPDSonox", "SPDSnaox",
+    "PSan", "PSDnaa", "DPSxon", "SDxPDxa", "SPDSanaxn", "SDna", "DPSnaon",
+    "DSPDaox", "PSDPxaxn", "SDPxa", "PDSPDaoxxn", "DPSDoax", "PDSnox", "SDPana",
+    "SSPxDSxoxn", "PDSPxox", "PDSnoan", "PDna", "DSPnaon", "DPSDaox",
+    "SPDSxaxn", "DPSonon", "Dn", "DPSox", "DPSoan", "PDSPoax", "DPSnox", "DPx",
+    "DPSDonox", "DPSDxox", "DPSnoan", "DPSDnaox", "DPan", "PDSxa", "DSPDSaoxxn",
+    "DSPDoax", "SDPnox", "SDPSoax", "DSPnox", "DSx", "SDPSonox", "DSPDSonoxxn",
+    "PDSxxn", "DPSax", "PSDPSoaxxn", "SDPax", "PDSPDoaxxn", "SDPSnoax",
+    "PDSxnan", "PDSana", "SSDxPDxaxn", "SDPSxox", "SDPnoan", "DSPDxox",
+    "DSPnoan", "SDPSnaox", "DSan", "PDSax", "DSPDSoaxxn", "DPSDnoax", "SDPxnan",
+    "SPDSnoax", "DPSxnan", "SPxDSxo", "DPSaan", "DPSaa", "SPxDSxon", "DPSxna",
+    "SPDSnoaxn", "SDPxna", "PDSPnoaxn", "DSPDSoaxx", "PDSaxn", "DSa",
+    "SDPSnaoxn", "DSPnoa", "DSPDxoxn", "SDPnoa", "SDPSxoxn", "SSDxPDxax",
+    "PDSanan", "PDSxna", "SDPSnoaxn", "DPSDPoaxx", "SPDaxn", "PSDPSoaxx",
+    "DPSaxn", "DPSxx", "PSDPSonoxx", "SDPSonoxn", "DSxn", "DPSnax", "SDPSoaxn",
+    "SPDnax", "DSPDoaxn", "DSPDSaoxx", "PDSxan", "DPa", "PDSPnaoxn", "DPSnoa",
+    "DPSDxoxn", "PDSPonoxn", "PDxn", "DSPnax", "PDSPoaxn", "DPSoa", "DPSoxn",
+    "D", "DPSono", "SPDSxax", "DPSDaoxn", "DSPnao", "DPno", "PDSnoa",
+    "PDSPxoxn", "SSPxDSxox", "SDPanan", "PSDnax", "DPSDoaxn", "DPSDPaoxx",
+    "SDPxan", "PSDPxax", "DSPDaoxn", "DPSnao", "DSno", "SPDSanax", "SDxPDxan",
+    "DPSxo", "DPSano", "PSa", "SPDSnaoxn", "SPDSonoxn", "PSxn", "SPDnoa",
+    "SPDSxoxn", "SDPnax", "PSDPoaxn", "SDPoa", "SPDoxn", "DPSDxax", "SPDSaoxn",
+    "S", "SDPono", "SDPnao", "SPno", "PSDnoa", "PSDPxoxn", "PDSnax", "SPDSoaxn",
+    "SSPxPDxax", "DPSanan", "PSDPSaoxx", "DPSxan", "PDSPxax", "SDPSaoxn",
+    "DPSDanax", "SPxDSxan", "SPDnao", "SDno", "SDPxo", "SDPano", "PDSoa",
+    "PDSoxn", "DSPDxax", "PSDPaoxn", "SDPSxax", "PDSPaoxn", "SDPSanax",
+    "SPxPDxan", "SSPxDSxax", "DSPDSanaxxn", "DPSao", "DPSxno", "SDPao",
+    "SDPxno", "DSo", "SDPnoo", "P", "PDSono", "PDSnao", "PSno", "PSDnao",
+    "PDno", "PDSxo", "PDSano", "PDSao", "PDSxno", "DPo", "DPSnoo", "PSo",
+    "PSDnoo", "DPSoo", "1"
+};
+
+/*
+ * Rop codes which get their own routine. Besides the named rops these are
+ * the unnamed rops used for masking and brush operations. Everything else
+ * goes through the generic routine. The operation and the operands used are
+ * filled in from RopRpn by InitRopInfo.
+ */
+static ROPINFO KnownCodes[] =
+{
+    { ROPCODE_BLACKNESS,    "BLACKNESS",   "", 0, 0, 0 },
+    { ROPCODE_NOTSRCERASE,  "NOTSRCERASE", "", 0, 0, 0 },
+    { ROPCODE_NOTSRCCOPY,   "NOTSRCCOPY",  "", 0, 0, 0 },
+    { ROPCODE_SRCERASE,     "SRCERASE",    "", 0, 0, 0 },
+    { ROPCODE_DSTINVERT,    "DSTINVERT",   "", 0, 0, 0 },
+    { ROPCODE_PATINVERT,    "PATINVERT",   "", 0, 0, 0 },
+    { ROPCODE_SRCINVERT,    "SRCINVERT",   "", 0, 0, 0 },
+    { ROPCODE_SRCAND,       "SRCAND",      "", 0, 0, 0 },
+    { ROPCODE_NOOP,         "NOOP",        "", 0, 0, 0 },
+    { ROPCODE_MERGEPAINT,   "MERGEPAINT",  "", 0, 0, 0 },
+    { ROPCODE_MERGECOPY,    "MERGECOPY",   "", 0, 0, 0 },
+    { ROPCODE_SRCCOPY,      "SRCCOPY",     "", 0, 0, 0 },
+    { ROPCODE_SRCPAINT,     "SRCPAINT",    "", 0, 0, 0 },
+    { ROPCODE_PATCOPY,      "PATCOPY",     "", 0, 0, 0 },
+    { ROPCODE_PATPAINT,     "PATPAINT",    "", 0, 0, 0 },
+    { ROPCODE_WHITENESS,    "WHITENESS",   "", 0, 0, 0 },
+    { 0x0a,                 "DPna",        "", 0, 0, 0 },
+    { 0x0f,                 "Pn",          "", 0, 0, 0 },
+    { 0x22,                 "DSna",        "", 0, 0, 0 },
+    { 0x5f,                 "DPan",        "", 0, 0, 0 },
+    { 0x99,                 "DSxn",        "", 0, 0, 0 },
+    { 0xa0,                 "DPa",         "", 0, 0, 0 },
+    { 0xb8,                 "PSDPxax",     "", 0, 0, 0 },
+    { 0xca,                 "DPSDxax",     "", 0, 0, 0 },
+    { 0xe2,                 "DSPDxax",     "", 0, 0, 0 },
+    { 0xfa,                 "DPo",         "", 0, 0, 0 },
+    { ROPCODE_GENERIC,      NULL,          "", 0, 0, 0 }
+};
+
 static PROPINFO
 FindRopInfo(unsigned RopCode)
 {
-    static ROPINFO KnownCodes[] =
-    {
-        { ROPCODE_BLACKNESS,   "BLACKNESS",  "0",            0, 0, 0 },
-        { ROPCODE_NOTSRCERASE, "NOTSRCERASE","~(D | S)",     1, 1, 0 },
-        { ROPCODE_NOTSRCCOPY,  "NOTSRCCOPY", "~S",           0, 1, 0 },
-        { ROPCODE_SRCERASE,    "SRCERASE",   "(~D) & S",     1, 1, 0 },
-        { ROPCODE_DSTINVERT,   "DSTINVERT",  "~D",           1, 0, 0 },
-        { ROPCODE_PATINVERT,   "PATINVERT",  "D ^ P",        1, 0, 1 },
-        { ROPCODE_SRCINVERT,   "SRCINVERT",  "D ^ S",        1, 1, 0 },
-        { ROPCODE_SRCAND,      "SRCAND",     "D & S",        1, 1, 0 },
-        { ROPCODE_NOOP,        "NOOP",       "D",            1, 0, 0 },
-        { ROPCODE_MERGEPAINT,  "MERGEPAINT", "D | (~S)",     1, 1, 0 },
-        { ROPCODE_MERGECOPY,   "MERGECOPY",  "S & P",        0, 1, 1 },
-        { ROPCODE_SRCCOPY,     "SRCCOPY",    "S",            0, 1, 0 },
-        { ROPCODE_SRCPAINT,    "SRCPAINT",   "D | S",        1, 1, 0 },
-        { ROPCODE_PATCOPY,     "PATCOPY",    "P",            0, 0, 1 },
-        { ROPCODE_PATPAINT,    "PATPAINT",   "D | (~S) | P", 1, 1, 1 },
-        { ROPCODE_WHITENESS,   "WHITENESS",  "0xffffffff",   0, 0, 0 },
-        { ROPCODE_GENERIC,     NULL,         NULL,           1, 1, 1 }
-    };
     unsigned Index;
 
     for (Index = 0; Index < sizeof(KnownCodes) / sizeof(KnownCodes[0]); Index++)
@@ -169,6 +240,132 @@ FindRopInfo(unsigned RopCode)
     return NULL;
 }
 
+/* Evaluates a rop in reverse polish notation on single bits */
+static int
+EvaluateRpn(const char *Rpn, int Dest, int Source, int Pattern)
+{
+    int Stack[16];
+    unsigned Top = 0;
+
+    if (0 == strcmp(Rpn, "0") || 0 == strcmp(Rpn, "1"))
+    {
+        return '1' == Rpn[0];
+    }
+
+    for (; '\0' != *Rpn; Rpn++)
+    {
+        switch (*Rpn)
+        {
+        case 'D': Stack[Top++] = Dest; break;
+        case 'S': Stack[Top++] = Source; break;
+        case 'P': Stack[Top++] = Pattern; break;
+        case 'n': Stack[Top - 1] = ! Stack[Top - 1]; break;
+        case 'a': Top--; Stack[Top - 1] &= Stack[Top]; break;
+        case 'o': Top--; Stack[Top - 1] |= Stack[Top]; break;
+        case 'x': Top--; Stack[Top - 1] ^= Stack[Top]; break;
+        }
+    }
+
+    return Stack[0];
+}
+
+/* Converts a rop in reverse polish notation to a C expression of D, S and P */
+static void
+RpnToOperation(const char *Rpn, char *Operation)
+{
+    char Stack[8][OPERATION_MAX];
+    char Buffer[OPERATION_MAX];
+    unsigned Top = 0;
+    const char *Op;
+
+    if (0 == strcmp(Rpn, "0") || 0 == strcmp(Rpn, "1"))
+    {
+        strcpy(Operation, '0' == Rpn[0] ? "0" : "0xffffffff");
+        return;
+    }
+
+    for (; '\0' != *Rpn; Rpn++)
+    {
+        switch (*Rpn)
+        {
+        case 'D':
+        case 'S':
+        case 'P':
+            sprintf(Stack[Top++], "%c", *Rpn);
+            break;
+        case 'n':
+            if (1 == strlen(Stack[Top - 1]) || '(' == Stack[Top - 1][0])
+            {
+                sprintf(Buffer, "~%s", Stack[Top - 1]);
+            }
+            else
+            {
+                sprintf(Buffer, "~(%s)", Stack[Top - 1]);
+            }
+            strcpy(Stack[Top - 1], Buffer);
+            break;
+        default:
+            Op = ('a' == *Rpn ? "&" : 'o' == *Rpn ? "|" : "^");
+            Top--;
+            sprintf(Buffer, "(%s %s %s)", Stack[Top - 1], Op, Stack[Top]);
+            strcpy(Stack[Top - 1], Buffer);
+            break;
+        }
+    }
+
+    /* Drop the outer parentheses of a binary operation */
+    if ('(' == Stack[0][0])
+    {
+        strcpy(Operation, Stack[0] + 1);
+        Operation[strlen(Operation) - 1] = '\0';
+    }
+    else
+    {
+        strcpy(Operation, Stack[0]);
+    }
+}
+
+/* Checks the rop table against the rop codes and fills in the known rops */
+static void
+InitRopInfo(void)
+{
+    unsigned RopCode, Index, Bits;
+
+    for (RopCode = 0; RopCode < 256; RopCode++)
+    {
+        Bits = 0;
+        for (Index = 0; Index < 8; Index++)
+        {
+            Bits |= EvaluateRpn(RopRpn[RopCode], Index & 1, (Index >> 1) & 1,
+                                (Index >> 2) & 1) << Index;
+        }
+        if (Bits != RopCode)
+        {
+            fprintf(stderr, "Rop 0x%02x (%s) evaluates to 0x%02x\n",
+                    RopCode, RopRpn[RopCode], Bits);
+            exit(1);
+        }
+    }
+
+    for (Index = 0; Index < sizeof(KnownCodes) / sizeof(KnownCodes[0]); Index++)
+    {
+        RopCode = KnownCodes[Index].RopCode;
+        if (ROPCODE_GENERIC == RopCode)
+        {
+            KnownCodes[Index].UsesDest = 1;
+            KnownCodes[Index].UsesSource = 1;
+            KnownCodes[Index].UsesPattern = 1;
+        }
+        else
+        {
+            RpnToOperation(RopRpn[RopCode], KnownCodes[Index].Operation);
+            KnownCodes[Index].UsesDest = USES_DEST(RopCode);
+            KnownCodes[Index].UsesSource = USES_SOURCE(RopCode);
+            KnownCodes[Index].UsesPattern = USES_PATTERN(RopCode);
+        }
+    }
+}
+
 static void
 Output(FILE *Out, const char *Fmt, ...)
 {
@@ -967,15 +1164,13 @@ CreateBitBlt(FILE *Out, unsigned Bpp)
     Output(Out, "}\n");
 }
 
-static void
-Generate(char *OutputDir, unsigned Bpp)
+static FILE *
+OpenOutput(char *OutputDir, const char *Name)
 {
     FILE *Out;
-    unsigned RopCode;
-    PROPINFO RopInfo;
     char *FileName;
 
-    FileName = malloc(strlen(OutputDir) + 12);
+    FileName = malloc(strlen(OutputDir) + strlen(Name) + 2);
     if (NULL == FileName)
     {
         fprintf(stderr, "Out of memory\n");
@@ -986,7 +1181,7 @@ Generate(char *OutputDir, unsigned Bpp)
     {
         strcat(FileName, "/");
     }
-    sprintf(FileName + strlen(FileName), "dib%ugen.c", Bpp);
+    strcat(FileName, Name);
 
     Out = fopen(FileName, "w");
     free(FileName);
@@ -1000,6 +1195,20 @@ Generate(char *OutputDir, unsigned Bpp)
     Output(Out, "/* This is a generated file. Please do not edit */\n");
     Output(Out, "\n");
     Output(Out, "#include <win32k.h>\n");
+
+    return Out;
+}
+
+static void
+Generate(char *OutputDir, unsigned Bpp)
+{
+    FILE *Out;
+    unsigned RopCode;
+    PROPINFO RopInfo;
+    char Name[16];
+
+    sprintf(Name, "dib%ugen.c", Bpp);
+    Out = OpenOutput(OutputDir, Name);
     CreateShiftTables(Out);
 
     RopInfo = FindRopInfo(ROPCODE_GENERIC);
@@ -1018,20 +1227,82 @@ Generate(char *OutputDir, unsigned Bpp)
     fclose(Out);
 }
 
+/*
+ * DIB_DoRop is what all the code without a specialized routine, including
+ * the generic routines above, uses to combine one pixel or dword. Every rop
+ * gets its own case, so a call is a jump through a table followed by at
+ * most a handful of logical operations.
+ */
+static void
+GenerateDoRop(char *OutputDir)
+{
+    FILE *Out;
+    unsigned RopCode;
+    char Operation[OPERATION_MAX];
+    const char *Template;
+
+    Out = OpenOutput(OutputDir, "dibropgen.c");
+
+    MARK(Out);
+    Output(Out, "\n");
+    Output(Out, "ULONG\n");
+    Output(Out, "DIB_DoRop(ULONG Rop, ULONG Dest, ULONG Source, ULONG Pattern)\n");
+    Output(Out, "{\n");
+    Output(Out, "switch (Rop & 0xff)\n");
+    Output(Out, "{\n");
+    for (RopCode = 0; RopCode < 256; RopCode++)
+    {
+        RpnToOperation(RopRpn[RopCode], Operation);
+        Output(Out, "case 0x%02x: /* %s */\n", RopCode, RopRpn[RopCode]);
+        Output(Out, "    return ");
+        for (Template = Operation; '\0' != *Template; Template++)
+        {
+            switch (*Template)
+            {
+            case 'D':
+                Output(Out, "Dest");
+                break;
+            case 'S':
+                Output(Out, "Source");
+                break;
+            case 'P':
+                Output(Out, "Pattern");
+                break;
+            default:
+                Output(Out, "%c", *Template);
+                break;
+            }
+        }
+        Output(Out, ";\n");
+    }
+    Output(Out, "}\n");
+    Output(Out, "\n");
+    Output(Out, "/* Not reached */\n");
+    Output(Out, "return Dest;\n");
+    Output(Out, "}\n");
+
+    fclose(Out);
+}
+
 int
 main(int argc, char *argv[])
 {
     unsigned Index;
+    /* 24 bpp pixels straddle the dwords the generated loops work on, so
+       DIB_24BPP_BitBlt stays hand written and only uses DIB_DoRop */
     static unsigned DestBpp[] =
     { 8, 16, 32 };
 
     if (argc < 2)
         return 0;
 
+    InitRopInfo();
+
     for (Index = 0; Index < sizeof(DestBpp) / sizeof(DestBpp[0]); Index++)
     {
         Generate(argv[1], DestBpp[Index]);
     }
+    GenerateDoRop(argv[1]);
 
     return 0;
 }
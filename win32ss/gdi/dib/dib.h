@@ -35,7 +35,7 @@ typedef ULONG (*PFN_DIB_GetPixel)(SURFOBJ*,LONG,LONG);
 typedef VOID (*PFN_DIB_HLine)(SURFOBJ*,LONG,LONG,LONG,ULONG);
 typedef VOID (*PFN_DIB_VLine)(SURFOBJ*,LONG,LONG,LONG,ULONG);
 typedef BOOLEAN (*PFN_DIB_BitBlt)(PBLTINFO);
-typedef BOOLEAN (*PFN_DIB_StretchBlt)(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4);
+typedef BOOLEAN (*PFN_DIB_StretchBlt)(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4,ULONG);
 typedef BOOLEAN (*PFN_DIB_TransparentBlt)(SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,XLATEOBJ*,ULONG);
 typedef BOOLEAN (*PFN_DIB_ColorFill)(SURFOBJ*, RECTL*, ULONG);
 typedef BOOLEAN (*PFN_DIB_AlphaBlend)(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
@@ -61,7 +61,7 @@ ULONG Dummy_GetPixel(SURFOBJ*,LONG,LONG);
 VOID Dummy_HLine(SURFOBJ*,LONG,LONG,LONG,ULONG);
 VOID Dummy_VLine(SURFOBJ*,LONG,LONG,LONG,ULONG);
 BOOLEAN Dummy_BitBlt(PBLTINFO);
-BOOLEAN Dummy_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4);
+BOOLEAN Dummy_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4,ULONG);
 BOOLEAN Dummy_TransparentBlt(SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,XLATEOBJ*,ULONG);
 BOOLEAN Dummy_ColorFill(SURFOBJ*, RECTL*, ULONG);
 BOOLEAN Dummy_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
@@ -123,7 +123,7 @@ BOOLEAN DIB_32BPP_TransparentBlt(SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,XLATEOBJ*,ULONG
 BOOLEAN DIB_32BPP_ColorFill(SURFOBJ*, RECTL*, ULONG);
 BOOLEAN DIB_32BPP_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
 
-BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4);
+BOOLEAN DIB_XXBPP_StretchBlt(SURFOBJ*,SURFOBJ*,SURFOBJ*,SURFOBJ*,RECTL*,RECTL*,POINTL*,BRUSHOBJ*,POINTL*,XLATEOBJ*,ROP4,ULONG);
 BOOLEAN DIB_XXBPP_FloodFillSolid(SURFOBJ*, BRUSHOBJ*, RECTL*, POINTL*, ULONG, UINT);
 BOOLEAN DIB_XXBPP_AlphaBlend(SURFOBJ*, SURFOBJ*, RECTL*, RECTL*, CLIPOBJ*, XLATEOBJ*, BLENDOBJ*);
 
@@ -133,6 +133,10 @@ extern unsigned char altnotmask[2];
 
 ULONG DIB_DoRop(ULONG Rop, ULONG Dest, ULONG Source, ULONG Pattern);
 
+/* Pixels translated per call by DIB_XlateRow, bounds its stack buffer */
+#define DIB_ROW_CHUNK 256
+VOID DIB_XlateRow(XLATEOBJ*,ULONG,PBYTE,BOOLEAN,ULONG,PBYTE,ULONG);
+
 #define DIB_GetSource(SourceSurf,sx,sy,ColorTranslation)    \
   XLATEOBJ_iXlate(ColorTranslation,                         \
     DibFunctionsForBitmapFormat[SourceSurf->iBitmapFormat]. \
@@ -141,3 +145,39 @@ ULONG DIB_DoRop(ULONG Rop, ULONG Dest, ULONG Source, ULONG Pattern);
 #define DIB_GetSourceIndex(SourceSurf,sx,sy)                \
   DibFunctionsForBitmapFormat[SourceSurf->iBitmapFormat].   \
     DIB_GetPixel(SourceSurf, sx, sy)
+
+/* (Channel * Alpha) / 255 on all four 8 bit channels at once. Two channels
+   share one 32 bit register, the division by 255 is exact for 0..255*255.
+   The DIB code has no SSE2 paths: x86 builds target plain Pentiums, so they
+   would need a KF_XMMI check and a KeSaveFloatingPointState/Restore pair
+   around each blit, as in ntgdi/arc.c. This is the portable baseline. */
+FORCEINLINE
+ULONG
+DIB_ScalePixel(ULONG Color, ULONG Alpha)
+{
+  ULONG rb = (Color & 0x00FF00FF) * Alpha;
+  ULONG ag = ((Color >> 8) & 0x00FF00FF) * Alpha;
+
+  rb = ((rb + 0x00010001 + ((rb >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+  ag = (ag + 0x00010001 + ((ag >> 8) & 0x00FF00FF)) & 0xFF00FF00;
+  return rb | ag;
+}
+
+/* Clamp8((Dest * (255 - Alpha)) / 255 + Source) on all four channels */
+FORCEINLINE
+ULONG
+DIB_BlendPixel(ULONG Dest, ULONG Source, ULONG Alpha)
+{
+  ULONG rb, ag, Carry;
+
+  Dest = DIB_ScalePixel(Dest, 255 - Alpha);
+  rb = (Dest & 0x00FF00FF) + (Source & 0x00FF00FF);
+  ag = ((Dest >> 8) & 0x00FF00FF) + ((Source >> 8) & 0x00FF00FF);
+
+  /* Saturate the channels that went past 255 */
+  Carry = rb & 0x01000100;
+  rb = (rb | (Carry - (Carry >> 8))) & 0x00FF00FF;
+  Carry = ag & 0x01000100;
+  ag = (ag | (Carry - (Carry >> 8))) & 0x00FF00FF;
+  return rb | (ag << 8);
+}
@@ -289,22 +289,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      if (bLeftToRight)
-      {
-        /* This sets SourceBits to the rightmost pixel */
-        SourceBits += (BltInfo->DestRect.right - BltInfo->DestRect.left - 1);
-      }
-
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest, *SourceBits);
-        DEC_OR_INC(SourceBits, bLeftToRight, 1);
-        DestBits += 2;
-      }
+      DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_8BPP, SourceLine, bLeftToRight,
+                   BMF_16BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
       DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
       DestLine += BltInfo->DestSurface->lDelta;
     }
@@ -385,17 +371,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         DestLine = DestBits;
         for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
         {
-          SourceBits = SourceLine;
-          DestBits = DestLine;
-          for (i = BltInfo->DestRect.left; i <
-            BltInfo->DestRect.right; i++)
-          {
-            *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-              BltInfo->XlateSourceToDest,
-              *((WORD *)SourceBits));
-            SourceBits += 2;
-            DestBits += 2;
-          }
+          DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_16BPP, SourceLine, FALSE,
+                       BMF_16BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
           SourceLine += BltInfo->SourceSurface->lDelta;
           DestLine += BltInfo->DestSurface->lDelta;
         }
@@ -417,17 +394,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
         for (j = BltInfo->DestRect.bottom - 1;
           BltInfo->DestRect.top <= j; j--)
         {
-          SourceBits = SourceLine;
-          DestBits = DestLine;
-          for (i = BltInfo->DestRect.left; i <
-            BltInfo->DestRect.right; i++)
-          {
-            *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-              BltInfo->XlateSourceToDest,
-              *((WORD *)SourceBits));
-            SourceBits += 2;
-            DestBits += 2;
-          }
+          DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_16BPP, SourceLine, FALSE,
+                       BMF_16BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
           SourceLine -= BltInfo->SourceSurface->lDelta;
           DestLine -= BltInfo->DestSurface->lDelta;
         }
@@ -595,25 +563,8 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      if (bLeftToRight)
-      {
-        /* This sets the SourceBits to the rightmost pixel */
-        SourceBits += (BltInfo->DestRect.right - BltInfo->DestRect.left - 1) * 3;
-      }
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = (*(SourceBits + 2) << 0x10) +
-          (*(SourceBits + 1) << 0x08) + (*(SourceBits));
-
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest, xColor);
-
-        DEC_OR_INC(SourceBits, bLeftToRight, 3);
-        DestBits += 2;
-      }
+      DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_24BPP, SourceLine, bLeftToRight,
+                   BMF_16BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
       DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
       DestLine += BltInfo->DestSurface->lDelta;
     }
@@ -630,30 +581,14 @@ DIB_16BPP_BitBltSrcCopy(PBLTINFO BltInfo)
     if (bTopToBottom)
     {
       /* This sets SourceLine to the bottom line */
-      SourceLine += BltInfo->DestRect.bottom - BltInfo->DestRect.top - 1;
+      SourceLine += BltInfo->SourceSurface->lDelta * (BltInfo->DestRect.bottom - BltInfo->DestRect.top - 1);
     }
     DestLine = DestBits;
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      if (bLeftToRight)
-      {
-        /* This sets SourceBits to the rightmost pixel */
-        SourceBits += (BltInfo->DestRect.right - BltInfo->DestRect.left - 1) * 4;
-      }
-
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        *((WORD *)DestBits) = (WORD)XLATEOBJ_iXlate(
-          BltInfo->XlateSourceToDest,
-          *((PDWORD) SourceBits));
-        DEC_OR_INC(SourceBits, bLeftToRight, 4);
-        DestBits += 2;
-      }
-
+      DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_32BPP, SourceLine, bLeftToRight,
+                   BMF_16BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
       DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
       DestLine += BltInfo->DestSurface->lDelta;
     }
@@ -918,18 +853,22 @@ DIB_16BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
 
           Alpha >>= 3;
 
-          DstPixel16.us = DIB_16BPP_GetPixel(Dest, DstX, DstY) & 0xFFFF;
-          /* Perform bit loss */
-          SrcPixel32.col.red >>= 3;
-          SrcPixel32.col.green >>= 3;
-          SrcPixel32.col.blue >>= 3;
-
-          /* Do the blend in the right bit depth */
-          DstPixel16.col.red = Clamp5((DstPixel16.col.red * (31 - Alpha)) / 31 + SrcPixel32.col.red);
-          DstPixel16.col.green = Clamp5((DstPixel16.col.green * (31 - Alpha)) / 31 + SrcPixel32.col.green);
-          DstPixel16.col.blue = Clamp5((DstPixel16.col.blue * (31 - Alpha)) / 31 + SrcPixel32.col.blue);
-
-          DIB_16BPP_PutPixel(Dest, DstX, DstY, DstPixel16.us);
+          /* Transparent after the bit loss, the destination does not change */
+          if (Alpha != 0 || (SrcPixel32.ul & 0x00F8F8F8) != 0)
+          {
+            DstPixel16.us = DIB_16BPP_GetPixel(Dest, DstX, DstY) & 0xFFFF;
+            /* Perform bit loss */
+            SrcPixel32.col.red >>= 3;
+            SrcPixel32.col.green >>= 3;
+            SrcPixel32.col.blue >>= 3;
+
+            /* Do the blend in the right bit depth */
+            DstPixel16.col.red = Clamp5((DstPixel16.col.red * (31 - Alpha)) / 31 + SrcPixel32.col.red);
+            DstPixel16.col.green = Clamp5((DstPixel16.col.green * (31 - Alpha)) / 31 + SrcPixel32.col.green);
+            DstPixel16.col.blue = Clamp5((DstPixel16.col.blue * (31 - Alpha)) / 31 + SrcPixel32.col.blue);
+
+            DIB_16BPP_PutPixel(Dest, DstX, DstY, DstPixel16.us);
+          }
 
           DstX++;
           SrcX = SourceRect->left + ((DstX-DestRect->left)*(SourceRect->right - SourceRect->left))
@@ -965,18 +904,22 @@ DIB_16BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
           Alpha6 = Alpha >> 2;
           Alpha5 = Alpha >> 3;
 
-          DstPixel16.us = DIB_16BPP_GetPixel(Dest, DstX, DstY) & 0xFFFF;
-          /* Perform bit loss */
-          SrcPixel32.col.red >>= 3;
-          SrcPixel32.col.green >>= 2;
-          SrcPixel32.col.blue >>= 3;
-
-          /* Do the blend in the right bit depth */
-          DstPixel16.col.red = Clamp5((DstPixel16.col.red * (31 - Alpha5)) / 31 + SrcPixel32.col.red);
-          DstPixel16.col.green = Clamp6((DstPixel16.col.green * (63 - Alpha6)) / 63 + SrcPixel32.col.green);
-          DstPixel16.col.blue = Clamp5((DstPixel16.col.blue * (31 - Alpha5)) / 31 + SrcPixel32.col.blue);
-
-          DIB_16BPP_PutPixel(Dest, DstX, DstY, DstPixel16.us);
+          /* Transparent after the bit loss, the destination does not change */
+          if (Alpha6 != 0 || (SrcPixel32.ul & 0x00F8FCF8) != 0)
+          {
+            DstPixel16.us = DIB_16BPP_GetPixel(Dest, DstX, DstY) & 0xFFFF;
+            /* Perform bit loss */
+            SrcPixel32.col.red >>= 3;
+            SrcPixel32.col.green >>= 2;
+            SrcPixel32.col.blue >>= 3;
+
+            /* Do the blend in the right bit depth */
+            DstPixel16.col.red = Clamp5((DstPixel16.col.red * (31 - Alpha5)) / 31 + SrcPixel32.col.red);
+            DstPixel16.col.green = Clamp6((DstPixel16.col.green * (63 - Alpha6)) / 63 + SrcPixel32.col.green);
+            DstPixel16.col.blue = Clamp5((DstPixel16.col.blue * (31 - Alpha5)) / 31 + SrcPixel32.col.blue);
+
+            DIB_16BPP_PutPixel(Dest, DstX, DstY, DstPixel16.us);
+          }
 
           DstX++;
           SrcX = SourceRect->left + ((DstX-DestRect->left)*(SourceRect->right - SourceRect->left))
@@ -56,7 +56,6 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
   LONG     i, j, sx, sy, xColor, f1;
   PBYTE    SourceBits, DestBits, SourceLine, DestLine;
   PBYTE    SourceBits_4BPP, SourceLine_4BPP;
-  PWORD    SourceBits_16BPP, SourceLine_16BPP;
   BOOLEAN  bTopToBottom, bLeftToRight;
 
   DPRINT("DIB_24BPP_BitBltSrcCopy: SrcSurf cx/cy (%d/%d), DestSuft cx/cy (%d/%d) dstRect: (%d,%d)-(%d,%d)\n",
@@ -181,24 +180,8 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
       for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
       {
-        SourceBits = SourceLine;
-        DestBits = DestLine;
-
-        if (bLeftToRight)
-        {
-          /* This sets the SourceBits to the rightmost pixel */
-          SourceBits += (BltInfo->DestRect.right - BltInfo->DestRect.left - 1);
-        }
-
-        for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-        {
-          xColor = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *SourceBits);
-          *DestBits = xColor & 0xff;
-          *(PWORD)(DestBits + 1) = (WORD)(xColor >> 8);
-          DEC_OR_INC(SourceBits, bLeftToRight, 1);
-          DestBits += 3;
-        }
-
+        DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_8BPP, SourceLine, bLeftToRight,
+                     BMF_24BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
         DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
         DestLine += BltInfo->DestSurface->lDelta;
       }
@@ -208,43 +191,22 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       DPRINT("16BPP Case Selected with DestRect Width of '%d'.\n",
              BltInfo->DestRect.right - BltInfo->DestRect.left);
 
-      /* This sets SourceBits_16BPP to the top line */
-      SourceBits_16BPP = (PWORD)((PBYTE)BltInfo->SourceSurface->pvScan0 + (BltInfo->SourcePoint.y * BltInfo->SourceSurface->lDelta) + 2 * BltInfo->SourcePoint.x);
+      /* This sets SourceLine to the top line */
+      SourceLine = (PBYTE)BltInfo->SourceSurface->pvScan0 + (BltInfo->SourcePoint.y * BltInfo->SourceSurface->lDelta) + 2 * BltInfo->SourcePoint.x;
 
       if (bTopToBottom)
       {
-        /* This sets SourceBits_16BPP to the bottom line */
-        SourceBits_16BPP += (BltInfo->DestRect.bottom - BltInfo->DestRect.top - 1) * BltInfo->SourceSurface->lDelta;
+        /* This sets SourceLine to the bottom line */
+        SourceLine += BltInfo->SourceSurface->lDelta * (BltInfo->DestRect.bottom - BltInfo->DestRect.top - 1);
       }
+      DestLine = DestBits;
 
-      for (j=BltInfo->DestRect.top; j<BltInfo->DestRect.bottom; j++)
+      for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
       {
-        SourceLine_16BPP = SourceBits_16BPP;
-        DestLine = DestBits;
-
-        if (bLeftToRight)
-        {
-          /* This sets the SourceLine_16BPP to the rightmost pixel */
-          SourceLine_16BPP += (BltInfo->DestRect.right - BltInfo->DestRect.left - 1);
-        }
-
-        for (i=BltInfo->DestRect.left; i<BltInfo->DestRect.right; i++)
-        {
-          xColor = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *SourceLine_16BPP);
-          *DestLine++ = xColor & 0xff;
-          *(PWORD)DestLine = (WORD)(xColor >> 8);
-          DestLine += 2;
-          DEC_OR_INC(SourceLine_16BPP, bLeftToRight, 1);
-        }
-        if (bTopToBottom)
-        {
-          SourceBits_16BPP = (PWORD)((PBYTE)SourceBits_16BPP - BltInfo->SourceSurface->lDelta);
-        }
-        else
-        {
-          SourceBits_16BPP = (PWORD)((PBYTE)SourceBits_16BPP + BltInfo->SourceSurface->lDelta);
-        }
-        DestBits += BltInfo->DestSurface->lDelta;
+        DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_16BPP, SourceLine, bLeftToRight,
+                     BMF_24BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
+        DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
+        DestLine += BltInfo->DestSurface->lDelta;
       }
       break;
 
@@ -445,29 +407,14 @@ DIB_24BPP_BitBltSrcCopy(PBLTINFO BltInfo)
       if (bTopToBottom)
       {
         /* This sets SourceLine to the bottom line */
-        SourceLine += BltInfo->DestRect.bottom - BltInfo->DestRect.top - 1;
+        SourceLine += BltInfo->SourceSurface->lDelta * (BltInfo->DestRect.bottom - BltInfo->DestRect.top - 1);
       }
       DestLine = DestBits;
 
       for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
       {
-        SourceBits = SourceLine;
-        DestBits = DestLine;
-
-        if (bLeftToRight)
-        {
-          /* This sets SourceBits to the rightmost pixel */
-          SourceBits += (BltInfo->DestRect.right - BltInfo->DestRect.left - 1) * 4;
-        }
-        for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-        {
-          xColor = XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, *((PDWORD) SourceBits));
-          *DestBits = xColor & 0xff;
-          *(PWORD)(DestBits + 1) = (WORD)(xColor >> 8);
-          DEC_OR_INC(SourceBits, bLeftToRight, 4);
-          DestBits += 3;
-        }
-
+        DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_32BPP, SourceLine, bLeftToRight,
+                     BMF_24BPP, DestLine, BltInfo->DestRect.right - BltInfo->DestRect.left);
         DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
         DestLine += BltInfo->DestSurface->lDelta;
       }
@@ -705,33 +652,17 @@ DIB_24BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
   return TRUE;
 }
 
-typedef union {
-   ULONG ul;
-   struct {
-      UCHAR red;
-      UCHAR green;
-      UCHAR blue;
-      UCHAR alpha;
-   } col;
-} NICEPIXEL32;
-
-static __inline UCHAR
-Clamp8(ULONG val)
-{
-   return (val > 255) ? 255 : (UCHAR)val;
-}
-
 BOOLEAN
 DIB_24BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
                      XLATEOBJ* ColorTranslation, BLENDOBJ* BlendObj)
 {
-   INT Rows, Cols, SrcX, SrcY;
-   register PUCHAR Dst;
+   LONG Rows, Cols, SrcX, SrcY, DstWidth, DstHeight, SrcWidth, SrcHeight;
+   PUCHAR Dst;
+   PULONG SrcRow = NULL;
    BLENDFUNCTION BlendFunc;
-   register NICEPIXEL32 DstPixel, SrcPixel;
-   UCHAR Alpha;
-   //UCHAR SrcBpp;
+   ULONG SrcPixel, DstPixel, Alpha, ConstAlpha;
+   BOOLEAN PerPixelAlpha, DirectSource;
 
    DPRINT("DIB_24BPP_AlphaBlend: srcRect: (%d,%d)-(%d,%d), dstRect: (%d,%d)-(%d,%d)\n",
           SourceRect->left, SourceRect->top, SourceRect->right, SourceRect->bottom,
@@ -760,43 +691,66 @@ DIB_24BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
       return FALSE;
    }
 
-   Dst = (PUCHAR)((ULONG_PTR)Dest->pvScan0 + (DestRect->top * Dest->lDelta) +
-                             (DestRect->left * 3));
-   //SrcBpp = BitsPerFormat(Source->iBitmapFormat);
+   ConstAlpha = BlendFunc.SourceConstantAlpha;
+   PerPixelAlpha = (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0;
 
-   Rows = 0;
-   SrcY = SourceRect->top;
-   while (++Rows <= DestRect->bottom - DestRect->top)
-  {
-    Cols = 0;
-    SrcX = SourceRect->left;
-    while (++Cols <= DestRect->right - DestRect->left)
-    {
-      SrcPixel.ul = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
-      SrcPixel.col.red = (SrcPixel.col.red * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.green = (SrcPixel.col.green * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.blue = (SrcPixel.col.blue * BlendFunc.SourceConstantAlpha) / 255;
-      if (!(BlendFunc.AlphaFormat & AC_SRC_ALPHA))
-      {
-          Alpha = BlendFunc.SourceConstantAlpha ;
-      }
-      else
+   /* Everything gets scaled down to nothing, the destination stays as is */
+   if (ConstAlpha == 0)
+      return TRUE;
+
+   DirectSource = (Source->iBitmapFormat == BMF_32BPP) &&
+                  (!ColorTranslation || (ColorTranslation->flXlate & XO_TRIVIAL));
+
+   DstWidth = DestRect->right - DestRect->left;
+   DstHeight = DestRect->bottom - DestRect->top;
+   SrcWidth = SourceRect->right - SourceRect->left;
+   SrcHeight = SourceRect->bottom - SourceRect->top;
+
+   for (Rows = 0; Rows < DstHeight; Rows++)
+   {
+      Dst = (PUCHAR)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Rows) * Dest->lDelta) +
+                     (DestRect->left * 3));
+      SrcY = SourceRect->top + (Rows * SrcHeight) / DstHeight;
+      if (DirectSource)
+         SrcRow = (PULONG)((ULONG_PTR)Source->pvScan0 + SrcY * Source->lDelta);
+
+      for (Cols = 0; Cols < DstWidth; Cols++, Dst += 3)
       {
-        Alpha = (SrcPixel.col.alpha * BlendFunc.SourceConstantAlpha) / 255;
-      }
+         SrcX = (SrcWidth == DstWidth) ? SourceRect->left + Cols :
+                SourceRect->left + (Cols * SrcWidth) / DstWidth;
 
-      DstPixel.col.red = Clamp8((*Dst * (255 - Alpha)) / 255 + SrcPixel.col.red) ;
-      DstPixel.col.green = Clamp8((*(Dst+1) * (255 - Alpha) / 255 + SrcPixel.col.green)) ;
-      DstPixel.col.blue = Clamp8((*(Dst+2) * (255 - Alpha)) / 255 + SrcPixel.col.blue) ;
-      *Dst++ = DstPixel.col.red;
-      *Dst++ = DstPixel.col.green;
-      *Dst++ = DstPixel.col.blue;
-      SrcX = SourceRect->left + (Cols*(SourceRect->right - SourceRect->left))/(DestRect->right - DestRect->left);
-    }
-    Dst = (PUCHAR)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Rows) * Dest->lDelta) +
-                (DestRect->left*3));
-    SrcY = SourceRect->top + (Rows*(SourceRect->bottom - SourceRect->top))/(DestRect->bottom - DestRect->top);
-  }
+         if (DirectSource)
+            SrcPixel = SrcRow[SrcX];
+         else
+            SrcPixel = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
+
+         if (PerPixelAlpha && ConstAlpha == 255)
+         {
+            Alpha = SrcPixel >> 24;
+            if (Alpha == 0 && (SrcPixel & 0x00FFFFFF) == 0)
+               continue;
+         }
+         else
+         {
+            Alpha = PerPixelAlpha ? ((SrcPixel >> 24) * ConstAlpha) / 255 : ConstAlpha;
+            SrcPixel = DIB_ScalePixel(SrcPixel, ConstAlpha);
+         }
+
+         if (Alpha == 255)
+         {
+            DstPixel = SrcPixel;
+         }
+         else
+         {
+            DstPixel = Dst[0] | (Dst[1] << 8) | (Dst[2] << 16);
+            DstPixel = DIB_BlendPixel(DstPixel, SrcPixel, Alpha);
+         }
+
+         Dst[0] = (UCHAR)DstPixel;
+         Dst[1] = (UCHAR)(DstPixel >> 8);
+         Dst[2] = (UCHAR)(DstPixel >> 16);
+      }
+   }
 
    return TRUE;
 }
@@ -227,22 +227,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      if (bLeftToRight)
-      {
-        /* This sets the SourceBits to the rightmost pixel */
-        SourceBits += (DestWidth - 1);
-      }
-
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = *SourceBits;
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        DEC_OR_INC(SourceBits, bLeftToRight, 1);
-        DestBits += 4;
-      }
+      DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_8BPP, SourceLine, bLeftToRight,
+                   BMF_32BPP, DestLine, DestWidth);
       DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
       DestLine += BltInfo->DestSurface->lDelta;
     }
@@ -269,23 +255,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      if (bLeftToRight)
-      {
-        /* This sets the SourceBits to the rightmost pixel */
-        SourceBits += (DestWidth - 1) * 2;
-      }
-
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = *((PWORD) SourceBits);
-        *((PDWORD) DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        DEC_OR_INC(SourceBits, bLeftToRight, 2);
-        DestBits += 4;
-      }
-
+      DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_16BPP, SourceLine, bLeftToRight,
+                   BMF_32BPP, DestLine, DestWidth);
       DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
       DestLine += BltInfo->DestSurface->lDelta;
     }
@@ -313,25 +284,8 @@ DIB_32BPP_BitBltSrcCopy(PBLTINFO BltInfo)
 
     for (j = BltInfo->DestRect.top; j < BltInfo->DestRect.bottom; j++)
     {
-      SourceBits = SourceLine;
-      DestBits = DestLine;
-
-      if (bLeftToRight)
-      {
-        /* This sets the SourceBits to the rightmost pixel */
-        SourceBits += (DestWidth - 1) * 3;
-      }
-
-      for (i = BltInfo->DestRect.left; i < BltInfo->DestRect.right; i++)
-      {
-        xColor = (*(SourceBits + 2) << 0x10) +
-          (*(SourceBits + 1) << 0x08) +
-          (*(SourceBits));
-        *((PDWORD)DestBits) = (DWORD)XLATEOBJ_iXlate(BltInfo->XlateSourceToDest, xColor);
-        DEC_OR_INC(SourceBits, bLeftToRight, 3);
-        DestBits += 4;
-      }
-
+      DIB_XlateRow(BltInfo->XlateSourceToDest, BMF_24BPP, SourceLine, bLeftToRight,
+                   BMF_32BPP, DestLine, DestWidth);
       DEC_OR_INC(SourceLine, bTopToBottom, BltInfo->SourceSurface->lDelta);
       DestLine += BltInfo->DestSurface->lDelta;
     }
@@ -703,7 +657,8 @@ DIB_32BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
                          XLATEOBJ *ColorTranslation, ULONG iTransColor)
 {
   LONG X, Y, SourceX, SourceY = 0, wd;
-  ULONG *DestBits, Source = 0;
+  ULONG *DestBits, *SourceRow = NULL, Source = 0;
+  BOOLEAN DirectSource, Translate;
 
   LONG DstHeight;
   LONG DstWidth;
@@ -715,6 +670,11 @@ DIB_32BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
   SrcHeight = SourceRect->bottom - SourceRect->top;
   SrcWidth = SourceRect->right - SourceRect->left;
 
+  /* 32 bpp sources are read in place, and identity translations skipped */
+  DirectSource = (SourceSurf->iBitmapFormat == BMF_32BPP);
+  Translate = ColorTranslation && !(ColorTranslation->flXlate & XO_TRIVIAL);
+  iTransColor &= 0x00FFFFFF;
+
   DestBits = (ULONG*)((PBYTE)DestSurf->pvScan0 +
     (DestRect->left << 2) +
     DestRect->top * DestSurf->lDelta);
@@ -723,16 +683,29 @@ DIB_32BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
   for (Y = DestRect->top; Y < DestRect->bottom; Y++)
   {
     SourceY = SourceRect->top+(Y - DestRect->top) * SrcHeight / DstHeight;
+    if (SourceY < 0 || SourceSurf->sizlBitmap.cy <= SourceY)
+    {
+      DestBits = (ULONG*)((ULONG_PTR)DestBits + wd + (DstWidth << 2));
+      continue;
+    }
+
+    if (DirectSource)
+      SourceRow = (ULONG*)((PBYTE)SourceSurf->pvScan0 + SourceY * SourceSurf->lDelta);
+
     for (X = DestRect->left; X < DestRect->right; X++, DestBits++)
     {
-      SourceX = SourceRect->left+(X - DestRect->left) * SrcWidth / DstWidth;
-      if (SourceX >= 0 && SourceY >= 0 &&
-        SourceSurf->sizlBitmap.cx > SourceX && SourceSurf->sizlBitmap.cy > SourceY)
+      SourceX = (SrcWidth == DstWidth) ? SourceRect->left + (X - DestRect->left) :
+                SourceRect->left + (X - DestRect->left) * SrcWidth / DstWidth;
+      if (SourceX >= 0 && SourceSurf->sizlBitmap.cx > SourceX)
       {
-        Source = DIB_GetSourceIndex(SourceSurf, SourceX, SourceY);
-        if ((0x00FFFFFF & Source) != (0x00FFFFFF & iTransColor))
+        if (DirectSource)
+          Source = SourceRow[SourceX];
+        else
+          Source = DIB_GetSourceIndex(SourceSurf, SourceX, SourceY);
+
+        if ((0x00FFFFFF & Source) != iTransColor)
         {
-          *DestBits = XLATEOBJ_iXlate(ColorTranslation, Source);
+          *DestBits = Translate ? XLATEOBJ_iXlate(ColorTranslation, Source) : Source;
         }
       }
     }
@@ -743,32 +716,17 @@ DIB_32BPP_TransparentBlt(SURFOBJ *DestSurf, SURFOBJ *SourceSurf,
   return TRUE;
 }
 
-typedef union {
-  ULONG ul;
-  struct {
-    UCHAR red;
-    UCHAR green;
-    UCHAR blue;
-    UCHAR alpha;
-  } col;
-} NICEPIXEL32;
-
-static __inline UCHAR
-Clamp8(ULONG val)
-{
-  return (val > 255) ? 255 : (UCHAR)val;
-}
-
 BOOLEAN
 DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
                      RECTL* SourceRect, CLIPOBJ* ClipRegion,
                      XLATEOBJ* ColorTranslation, BLENDOBJ* BlendObj)
 {
-  INT Rows, Cols, SrcX, SrcY;
-  register PULONG Dst;
+  LONG Rows, Cols, SrcX, SrcY, DstWidth, DstHeight, SrcWidth, SrcHeight;
+  PULONG Dst, SrcRow = NULL;
   BLENDFUNCTION BlendFunc;
-  register NICEPIXEL32 DstPixel, SrcPixel;
-  UCHAR Alpha, SrcBpp;
+  ULONG SrcPixel, Alpha, ConstAlpha;
+  BOOLEAN PerPixelAlpha, OpaqueSource, DirectSource;
+  UCHAR SrcBpp;
 
   DPRINT("DIB_32BPP_AlphaBlend: SourceRect: (%d,%d)-(%d,%d), DestRect: (%d,%d)-(%d,%d)\n",
     SourceRect->left, SourceRect->top, SourceRect->right, SourceRect->bottom,
@@ -797,40 +755,66 @@ DIB_32BPP_AlphaBlend(SURFOBJ* Dest, SURFOBJ* Source, RECTL* DestRect,
     return FALSE;
   }
 
-  Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + (DestRect->top * Dest->lDelta) +
-    (DestRect->left << 2));
+  ConstAlpha = BlendFunc.SourceConstantAlpha;
+  PerPixelAlpha = (BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0;
   SrcBpp = BitsPerFormat(Source->iBitmapFormat);
 
-  Rows = 0;
-   SrcY = SourceRect->top;
-   while (++Rows <= DestRect->bottom - DestRect->top)
+  /* Everything gets scaled down to nothing, the destination stays as is */
+  if (ConstAlpha == 0)
+    return TRUE;
+
+  /* Read 32 bpp sources that need no translation straight from the bits */
+  DirectSource = (SrcBpp == 32) &&
+                 (!ColorTranslation || (ColorTranslation->flXlate & XO_TRIVIAL));
+
+  /* Only a 32 bpp source carries the alpha the shortcut below looks at */
+  OpaqueSource = PerPixelAlpha && ConstAlpha == 255 && SrcBpp == 32;
+
+  DstWidth = DestRect->right - DestRect->left;
+  DstHeight = DestRect->bottom - DestRect->top;
+  SrcWidth = SourceRect->right - SourceRect->left;
+  SrcHeight = SourceRect->bottom - SourceRect->top;
+
+  for (Rows = 0; Rows < DstHeight; Rows++)
   {
-    Cols = 0;
-    SrcX = SourceRect->left;
-    while (++Cols <= DestRect->right - DestRect->left)
+    Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Rows) * Dest->lDelta)) + DestRect->left;
+    SrcY = SourceRect->top + (Rows * SrcHeight) / DstHeight;
+    if (DirectSource)
+      SrcRow = (PULONG)((ULONG_PTR)Source->pvScan0 + SrcY * Source->lDelta);
+
+    for (Cols = 0; Cols < DstWidth; Cols++, Dst++)
     {
-      SrcPixel.ul = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
-      SrcPixel.col.red = (SrcPixel.col.red * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.green = (SrcPixel.col.green * BlendFunc.SourceConstantAlpha)  / 255;
-      SrcPixel.col.blue = (SrcPixel.col.blue * BlendFunc.SourceConstantAlpha) / 255;
-      SrcPixel.col.alpha = (32 == SrcBpp) ?
-                        (SrcPixel.col.alpha * BlendFunc.SourceConstantAlpha) / 255 :
-                        BlendFunc.SourceConstantAlpha ;
-
-      Alpha = ((BlendFunc.AlphaFormat & AC_SRC_ALPHA) != 0) ?
-           SrcPixel.col.alpha : BlendFunc.SourceConstantAlpha ;
-
-      DstPixel.ul = *Dst;
-      DstPixel.col.red = Clamp8((DstPixel.col.red * (255 - Alpha)) / 255 + SrcPixel.col.red) ;
-      DstPixel.col.green = Clamp8((DstPixel.col.green * (255 - Alpha)) / 255 + SrcPixel.col.green) ;
-      DstPixel.col.blue = Clamp8((DstPixel.col.blue * (255 - Alpha)) / 255 + SrcPixel.col.blue) ;
-      DstPixel.col.alpha = Clamp8((DstPixel.col.alpha * (255 - Alpha)) / 255 + SrcPixel.col.alpha) ;
-      *Dst++ = DstPixel.ul;
-      SrcX = SourceRect->left + (Cols*(SourceRect->right - SourceRect->left))/(DestRect->right - DestRect->left);
+      SrcX = (SrcWidth == DstWidth) ? SourceRect->left + Cols :
+             SourceRect->left + (Cols * SrcWidth) / DstWidth;
+
+      if (DirectSource)
+        SrcPixel = SrcRow[SrcX];
+      else
+        SrcPixel = DIB_GetSource(Source, SrcX, SrcY, ColorTranslation);
+
+      if (OpaqueSource)
+      {
+        /* Premultiplied source as is: opaque pixels replace the destination,
+           fully transparent ones leave it alone */
+        Alpha = SrcPixel >> 24;
+        if (Alpha == 255)
+        {
+          *Dst = SrcPixel;
+          continue;
+        }
+        if (SrcPixel == 0)
+          continue;
+      }
+      else
+      {
+        SrcPixel = DIB_ScalePixel(SrcPixel, ConstAlpha);
+        if (SrcBpp != 32)
+          SrcPixel = (SrcPixel & 0x00FFFFFF) | (ConstAlpha << 24);
+        Alpha = PerPixelAlpha ? SrcPixel >> 24 : ConstAlpha;
+      }
+
+      *Dst = DIB_BlendPixel(*Dst, SrcPixel, Alpha);
     }
-    Dst = (PULONG)((ULONG_PTR)Dest->pvScan0 + ((DestRect->top + Rows) * Dest->lDelta) +
-                (DestRect->left << 2));
-    SrcY = SourceRect->top + (Rows*(SourceRect->bottom - SourceRect->top))/(DestRect->bottom - DestRect->top);
   }
 
   return TRUE;
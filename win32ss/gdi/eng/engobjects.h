@@ -129,9 +129,10 @@ typedef struct _SHARED_FACE_CACHE {
 } SHARED_FACE_CACHE, *PSHARED_FACE_CACHE;
 
 typedef struct _SHARED_FACE {
-  FT_Face       Face;
+  FT_Face       Face;           /* NULL until loaded, for fonts from the font info cache */
   LONG          RefCount;
   PSHARED_MEM   Memory;
+  LONG          FontIndex;      /* Face index within the font file */
   SHARED_FACE_CACHE EnglishUS;
   SHARED_FACE_CACHE UserLanguage;
 } SHARED_FACE, *PSHARED_FACE;
@@ -165,6 +166,9 @@ typedef struct _FONTGDI {
   LONG          Magic;
   LONG          lfHeight;
   LONG          lfWidth;
+
+  /* Enumeration information of a system font, as loaded */
+  PFONTFAMILYINFO FamilyInfo;
 } FONTGDI, *PFONTGDI;
 
 /* The initialized 'Magic' value in FONTGDI */
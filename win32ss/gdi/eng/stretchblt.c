@@ -36,7 +36,8 @@ typedef BOOLEAN (APIENTRY *PSTRETCHRECTFUNC)(SURFOBJ* OutputObj,
                                             POINTL* MaskOrigin,
                                             BRUSHOBJ* pbo,
                                             POINTL* BrushOrigin,
-                                            ROP4 Rop4);
+                                            ROP4 Rop4,
+                                            ULONG Mode);
 
 static BOOLEAN APIENTRY
 CallDibStretchBlt(SURFOBJ* psoDest,
@@ -48,7 +49,8 @@ CallDibStretchBlt(SURFOBJ* psoDest,
                   POINTL* MaskOrigin,
                   BRUSHOBJ* pbo,
                   POINTL* BrushOrigin,
-                  ROP4 Rop4)
+                  ROP4 Rop4,
+                  ULONG Mode)
 {
     POINTL RealBrushOrigin;
     SURFOBJ* psoPattern;
@@ -83,7 +85,7 @@ CallDibStretchBlt(SURFOBJ* psoDest,
     bResult = DibFunctionsForBitmapFormat[psoDest->iBitmapFormat].DIB_StretchBlt(
                psoDest, psoSource, Mask, psoPattern,
                OutputRect, InputRect, MaskOrigin, pbo, &RealBrushOrigin,
-               ColorTranslation, Rop4);
+               ColorTranslation, Rop4, Mode);
 
     return bResult;
 }
@@ -312,7 +314,7 @@ EngStretchBltROP(
 
             Ret = (*BltRectFunc)(psoOutput, psoInput, Mask,
                          ColorTranslation, &OutputRect, &InputRect, MaskOrigin,
-                         pbo, &AdjustedBrushOrigin, Rop4);
+                         pbo, &AdjustedBrushOrigin, Rop4, Mode);
             break;
         case DC_RECT:
             // Clip the blt to the clip rectangle
@@ -351,7 +353,8 @@ EngStretchBltROP(
                            MaskOrigin,
                            pbo,
                            &AdjustedBrushOrigin,
-                           Rop4);
+                           Rop4,
+                           Mode);
             }
             break;
         case DC_COMPLEX:
@@ -414,7 +417,8 @@ EngStretchBltROP(
                            MaskOrigin,
                            pbo,
                            &AdjustedBrushOrigin,
-                           Rop4);
+                           Rop4,
+                           Mode);
                     }
                 }
             }
@@ -477,7 +481,8 @@ IntEngStretchBlt(SURFOBJ *psoDest,
                  POINTL *pMaskOrigin,
                  BRUSHOBJ *pbo,
                  POINTL *BrushOrigin,
-                 DWORD Rop4)
+                 DWORD Rop4,
+                 ULONG Mode)
 {
     BOOLEAN ret;
     POINTL MaskOrigin = {0, 0};
@@ -808,7 +813,7 @@ IntEngStretchBlt(SURFOBJ *psoDest,
                                                  &OutputRect,
                                                  &InputRect,
                                                  &MaskOrigin,
-                                                 COLORONCOLOR,
+                                                 Mode,
                                                  pbo,
                                                  Rop4);
     }
@@ -844,7 +849,7 @@ IntEngStretchBlt(SURFOBJ *psoDest,
                                &OutputRect,
                                &InputRect,
                                &MaskOrigin,
-                               COLORONCOLOR,
+                               Mode,
                                pbo,
                                Rop4);
     }
@@ -41,6 +41,9 @@ typedef struct _EXLATEOBJ
             ULONG ulBlueShift;
         };
     };
+
+    /* Lazily filled 16 bpp to palette index cache, see XLATEOBJ_vXlateRow */
+    PBYTE pjXlate16;
 } EXLATEOBJ, *PEXLATEOBJ;
 
 extern EXLATEOBJ gexloTrivial;
@@ -54,6 +57,14 @@ XLATEOBJ_pfnXlate(
     return ((PEXLATEOBJ)pxlo)->pfnXlate;
 }
 
+VOID
+NTAPI
+XLATEOBJ_vXlateRow(
+    _In_opt_ XLATEOBJ *pxlo,
+    _In_ ULONG cColors,
+    _In_reads_(cColors) const ULONG *pulSrc,
+    _Out_writes_(cColors) PULONG pulDst);
+
 VOID
 NTAPI
 EXLATEOBJ_vInitialize(
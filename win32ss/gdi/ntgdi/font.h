@@ -63,6 +63,27 @@ typedef struct _FONT_CACHE_ENTRY
 C_ASSERT(FIELD_OFFSET(FONT_CACHE_ENTRY, Hashed) % sizeof(DWORD) == 0); /* for hashing */
 C_ASSERT(sizeof(FONT_CACHE_HASHED) % sizeof(DWORD) == 0); /* for hashing */
 
+/* A realized font, by the LOGFONTW it was realized for */
+typedef struct _FONT_LOOKUP_ENTRY
+{
+    LIST_ENTRY ListEntry;
+    FONTOBJ *FontObj;
+    DWORD dwHash;
+    LOGFONTW LogFont;       /* lfFaceName zero-filled after the name */
+} FONT_LOOKUP_ENTRY, *PFONT_LOOKUP_ENTRY;
+
+C_ASSERT(FIELD_OFFSET(FONT_LOOKUP_ENTRY, LogFont) % sizeof(DWORD) == 0); /* for hashing */
+C_ASSERT(sizeof(LOGFONTW) % sizeof(DWORD) == 0); /* for hashing */
+
+/* A name of a global font, in the face name index */
+typedef struct _FONT_NAME_LINK
+{
+    LIST_ENTRY ListEntry;
+    PFONT_ENTRY Entry;
+    LPCWSTR Name;           /* Points into the FamilyInfo of the font */
+    ULONG Hash;
+} FONT_NAME_LINK, *PFONT_NAME_LINK;
+
 /*
  * FONTSUBST_... --- constants for font substitutes
  */
@@ -92,3 +113,53 @@ typedef struct GDI_LOAD_FONT
     PFONT_ENTRY_MEM     PrivateEntry;
 } GDI_LOAD_FONT, *PGDI_LOAD_FONT;
 
+/*
+ * FONTINFO_CACHE_... --- the font information cache
+ *
+ * The cache file holds what IntGdiLoadFontsFromMemory and FontFamilyFillInfo
+ * get out of FreeType for every system font file, keyed by the path, size and
+ * last write time of the file. It is the header, followed by the file records,
+ * followed by the face records of all files.
+ */
+#define FONTINFO_CACHE_MAGIC    'CIFR'
+#define FONTINFO_CACHE_VERSION  1
+
+typedef struct _FONTINFO_CACHE_HEADER
+{
+    ULONG           Magic;
+    ULONG           Version;
+    LANGID          LanguageID;     /* the language the names were localized for */
+    USHORT          Reserved;
+    ULONG           cFiles;
+    ULONG           cFaces;
+} FONTINFO_CACHE_HEADER, *PFONTINFO_CACHE_HEADER;
+
+typedef struct _FONTINFO_CACHE_FILE
+{
+    WCHAR           PathName[MAX_PATH];
+    LARGE_INTEGER   FileSize;
+    LARGE_INTEGER   LastWriteTime;
+    ULONG           IsTrueType;
+    ULONG           iFirstFace;
+    ULONG           cFaces;
+} FONTINFO_CACHE_FILE, *PFONTINFO_CACHE_FILE;
+
+typedef struct _FONTINFO_CACHE_FACE
+{
+    LONG            FontIndex;
+    LONG            OriginalWeight;
+    BYTE            OriginalItalic;
+    BYTE            CharSet;
+    WCHAR           FaceName[LF_FULLFACESIZE];
+    WCHAR           StyleName[LF_FACESIZE];
+    FONTFAMILYINFO  FamilyInfo;
+} FONTINFO_CACHE_FACE, *PFONTINFO_CACHE_FACE;
+
+/* A file record collected while loading the system fonts */
+typedef struct _FONTINFO_CACHE_NODE
+{
+    LIST_ENTRY          ListEntry;
+    FONTINFO_CACHE_FILE File;
+    FONTINFO_CACHE_FACE Faces[ANYSIZE_ARRAY];
+} FONTINFO_CACHE_NODE, *PFONTINFO_CACHE_NODE;
+
@@ -367,9 +367,25 @@ static UNICODE_STRING g_FontRegPath =
    to serialize access to it */
 static PFAST_MUTEX      g_FreeTypeLock;
 
+/* Font lookup takes this one shared and leaves the FreeType lock alone
+   where it can. The FreeType lock may be held when acquiring it, but it
+   must not be acquired the other way round */
+static PERESOURCE       g_FontListLock;
+
 static RTL_STATIC_LIST_HEAD(g_FontListHead);
 static BOOL             g_RenderingEnabled = TRUE;
 
+/* The font info cache, used while loading the system fonts at startup */
+#define FONTINFO_CACHE_MAX_SIZE (16 * 1024 * 1024)
+static UNICODE_STRING g_FontInfoCachePath =
+    RTL_CONSTANT_STRING(L"\\SystemRoot\\System32\\FontInfo.dat");
+static PFONTINFO_CACHE_HEADER g_FontInfoCache = NULL;  /* The cache file as read */
+static ULONG            g_FontInfoCacheHint = 0;        /* The file record to look at first */
+static ULONG            g_FontInfoCacheHits = 0;
+static BOOL             g_FontInfoCacheActive = FALSE;
+static BOOL             g_FontInfoCacheDirty = FALSE;
+static RTL_STATIC_LIST_HEAD(g_FontInfoCacheNodes);      /* What the cache file will hold */
+
 #define ASSERT_FREETYPE_LOCK_HELD() \
     ASSERT(g_FreeTypeLock->Owner == KeGetCurrentThread())
 
@@ -388,11 +404,49 @@ do { \
     ExReleaseFastMutexUnsafeAndLeaveCriticalRegion(g_FreeTypeLock); \
 } while(0)
 
+#define IntLockFontListShared() \
+do { \
+    KeEnterCriticalRegion(); \
+    ExAcquireResourceSharedLite(g_FontListLock, TRUE); \
+} while (0)
+
+#define IntLockFontListExclusive() \
+do { \
+    KeEnterCriticalRegion(); \
+    ExAcquireResourceExclusiveLite(g_FontListLock, TRUE); \
+} while (0)
+
+#define IntUnLockFontList() \
+do { \
+    ExReleaseResourceLite(g_FontListLock); \
+    KeLeaveCriticalRegion(); \
+} while (0)
+
+#define ASSERT_FONT_LIST_LOCK_HELD() \
+    ASSERT(ExIsResourceAcquiredSharedLite(g_FontListLock))
+
+#define ASSERT_FONT_LIST_LOCK_EXCLUSIVE() \
+    ASSERT(ExIsResourceAcquiredExclusiveLite(g_FontListLock))
+
 #define MAX_FONT_CACHE 256
 
 static RTL_STATIC_LIST_HEAD(g_FontCacheListHead);
 static UINT g_FontCacheNumEntries;
 
+/* The global fonts by face name and full name, for FindBestFontFromList.
+   Only fonts with their enumeration information at hand are in there */
+#define FONT_NAME_INDEX_SIZE 256
+
+static LIST_ENTRY g_FontNameIndex[FONT_NAME_INDEX_SIZE];
+
+/* The fonts realized from the global list, by LOGFONTW. Both are protected
+   by the font list lock and flushed when a global font is added */
+#define MAX_FONT_LOOKUP_CACHE 64
+
+static RTL_STATIC_LIST_HEAD(g_FontLookupCacheHead);
+static UINT g_FontLookupCacheNumEntries;
+static ULONG g_FontListGeneration;      /* Bumped on every change of g_FontListHead */
+
 static PWCHAR g_ElfScripts[32] =   /* These are in the order of the fsCsb[0] bits */
 {
     L"Western", /* 00 */
@@ -499,6 +553,9 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
 static BOOL
 MatchFontName(PSHARED_FACE SharedFace, PUNICODE_STRING Name1, FT_UShort NameID, FT_UShort LangID);
 
+static BOOL FASTCALL
+IntFillFamilyInfo(PFONTFAMILYINFO Info, PFONTGDI FontGDI);
+
 static BOOL
 FontLink_PrepareFontInfo(
     _Inout_ PFONTLINK pFontLink)
@@ -526,8 +583,10 @@ FontLink_PrepareFontInfo(
                          &Win32Process->PrivateFontListHead);
 
     // Search system fonts
+    IntLockFontListShared();
     FindBestFontFromList(&pFontObj, &MatchPenalty, &pFontLink->LogFont,
                          &g_FontListHead);
+    IntUnLockFontList();
 
     if (!pFontObj) // Not found?
     {
@@ -579,6 +638,7 @@ SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
         Ptr->Face = Face;
         Ptr->RefCount = 1;
         Ptr->Memory = Memory;
+        Ptr->FontIndex = Face->face_index;
         SharedFaceCache_Init(&Ptr->EnglishUS);
         SharedFaceCache_Init(&Ptr->UserLanguage);
 
@@ -588,6 +648,25 @@ SharedFace_Create(FT_Face Face, PSHARED_MEM Memory)
     return Ptr;
 }
 
+/* Creates a shared face for a font from the font info cache. The face itself
+   is loaded by SharedFace_Load once it is needed */
+static PSHARED_FACE
+SharedFace_CreateDeferred(LONG FontIndex)
+{
+    PSHARED_FACE Ptr;
+    Ptr = ExAllocatePoolWithTag(PagedPool, sizeof(SHARED_FACE), TAG_FONT);
+    if (Ptr)
+    {
+        Ptr->Face = NULL;
+        Ptr->RefCount = 1;
+        Ptr->Memory = NULL;
+        Ptr->FontIndex = FontIndex;
+        SharedFaceCache_Init(&Ptr->EnglishUS);
+        SharedFaceCache_Init(&Ptr->UserLanguage);
+    }
+    return Ptr;
+}
+
 static PSHARED_MEM
 SharedMem_Create(PBYTE Buffer, ULONG BufferSize, BOOL IsMapping)
 {
@@ -646,6 +725,137 @@ RemoveCacheEntries(FT_Face Face)
     }
 }
 
+static ULONG
+IntHashFontName(LPCWSTR pszName)
+{
+    ULONG Hash = 0;
+
+    while (*pszName)
+        Hash = Hash * 31 + RtlUpcaseUnicodeChar(*pszName++);
+
+    return Hash;
+}
+
+static VOID
+IntIndexFontName(PFONT_ENTRY Entry, LPCWSTR pszName)
+{
+    PFONT_NAME_LINK Link;
+
+    ASSERT_FONT_LIST_LOCK_EXCLUSIVE();
+
+    /* A font missing from the index is only looked at the slow way */
+    Link = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_NAME_LINK), TAG_FONT);
+    if (!Link)
+        return;
+
+    Link->Entry = Entry;
+    Link->Name = pszName;
+    Link->Hash = IntHashFontName(pszName);
+    InsertTailList(&g_FontNameIndex[Link->Hash % FONT_NAME_INDEX_SIZE], &Link->ListEntry);
+}
+
+/* Adds a global font to the face name index */
+static VOID
+IntIndexFontEntry(PFONT_ENTRY Entry)
+{
+    const ENUMLOGFONTEXW *EnumLogFont;
+
+    ASSERT_FONT_LIST_LOCK_EXCLUSIVE();
+
+    if (!Entry->Font->FamilyInfo)
+        return;
+
+    EnumLogFont = &Entry->Font->FamilyInfo->EnumLogFontEx;
+    IntIndexFontName(Entry, EnumLogFont->elfLogFont.lfFaceName);
+    if (_wcsicmp(EnumLogFont->elfLogFont.lfFaceName, EnumLogFont->elfFullName) != 0)
+        IntIndexFontName(Entry, EnumLogFont->elfFullName);
+}
+
+static VOID
+IntFreeFontNameIndex(VOID)
+{
+    PLIST_ENTRY ListEntry;
+    UINT i;
+
+    for (i = 0; i < FONT_NAME_INDEX_SIZE; ++i)
+    {
+        while (!IsListEmpty(&g_FontNameIndex[i]))
+        {
+            ListEntry = RemoveHeadList(&g_FontNameIndex[i]);
+            ExFreePoolWithTag(CONTAINING_RECORD(ListEntry, FONT_NAME_LINK, ListEntry), TAG_FONT);
+        }
+    }
+}
+
+/* Forgets the realized fonts, after a change of the global font list */
+static VOID
+FontLookupCache_Flush(VOID)
+{
+    PLIST_ENTRY ListEntry;
+
+    ASSERT_FONT_LIST_LOCK_EXCLUSIVE();
+
+    while (!IsListEmpty(&g_FontLookupCacheHead))
+    {
+        ListEntry = RemoveHeadList(&g_FontLookupCacheHead);
+        ExFreePoolWithTag(CONTAINING_RECORD(ListEntry, FONT_LOOKUP_ENTRY, ListEntry), TAG_FONT);
+    }
+    g_FontLookupCacheNumEntries = 0;
+    ++g_FontListGeneration;
+}
+
+/* Entries are not moved on a hit, so that lookups can share the lock.
+   The oldest entry goes first when the cache is full */
+static FONTOBJ *
+FontLookupCache_Find(const LOGFONTW *pLogFont, DWORD dwHash)
+{
+    PLIST_ENTRY ListEntry;
+    PFONT_LOOKUP_ENTRY Entry;
+
+    ASSERT_FONT_LIST_LOCK_HELD();
+
+    for (ListEntry = g_FontLookupCacheHead.Flink;
+         ListEntry != &g_FontLookupCacheHead;
+         ListEntry = ListEntry->Flink)
+    {
+        Entry = CONTAINING_RECORD(ListEntry, FONT_LOOKUP_ENTRY, ListEntry);
+        if (Entry->dwHash == dwHash &&
+            RtlEqualMemory(&Entry->LogFont, pLogFont, sizeof(LOGFONTW)))
+        {
+            return Entry->FontObj;
+        }
+    }
+
+    return NULL;
+}
+
+static VOID
+FontLookupCache_Add(const LOGFONTW *pLogFont, DWORD dwHash, FONTOBJ *FontObj)
+{
+    PFONT_LOOKUP_ENTRY Entry;
+
+    ASSERT_FONT_LIST_LOCK_EXCLUSIVE();
+
+    if (FontLookupCache_Find(pLogFont, dwHash))
+        return;
+
+    Entry = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_LOOKUP_ENTRY), TAG_FONT);
+    if (!Entry)
+        return;
+
+    Entry->FontObj = FontObj;
+    Entry->dwHash = dwHash;
+    Entry->LogFont = *pLogFont;
+    InsertHeadList(&g_FontLookupCacheHead, &Entry->ListEntry);
+
+    if (++g_FontLookupCacheNumEntries > MAX_FONT_LOOKUP_CACHE)
+    {
+        Entry = CONTAINING_RECORD(RemoveTailList(&g_FontLookupCacheHead), FONT_LOOKUP_ENTRY, ListEntry);
+        ExFreePoolWithTag(Entry, TAG_FONT);
+        g_FontLookupCacheNumEntries--;
+    }
+}
+
 static void SharedMem_Release(PSHARED_MEM Ptr)
 {
     ASSERT_FREETYPE_LOCK_HELD();
@@ -685,10 +895,13 @@ SharedFace_Release(PSHARED_FACE Ptr)
     --Ptr->RefCount;
     if (Ptr->RefCount == 0)
     {
-        DPRINT("Releasing SharedFace for %s\n", Ptr->Face->family_name ? Ptr->Face->family_name : "<NULL>");
-        RemoveCacheEntries(Ptr->Face);
-        FT_Done_Face(Ptr->Face);
-        SharedMem_Release(Ptr->Memory);
+        if (Ptr->Face)
+        {
+            DPRINT("Releasing SharedFace for %s\n", Ptr->Face->family_name ? Ptr->Face->family_name : "<NULL>");
+            RemoveCacheEntries(Ptr->Face);
+            FT_Done_Face(Ptr->Face);
+            SharedMem_Release(Ptr->Memory);
+        }
         SharedFaceCache_Release(&Ptr->EnglishUS);
         SharedFaceCache_Release(&Ptr->UserLanguage);
         ExFreePoolWithTag(Ptr, TAG_FONT);
@@ -696,6 +909,111 @@ SharedFace_Release(PSHARED_FACE Ptr)
     IntUnLockFreeType();
 }
 
+/* Maps a font file into system space */
+static NTSTATUS
+IntMapFontFile(HANDLE FileHandle, PVOID *pBuffer, PSIZE_T pViewSize)
+{
+    NTSTATUS Status;
+    PVOID SectionObject;
+    PFILE_OBJECT FileObject;
+    LARGE_INTEGER SectionSize;
+
+    *pBuffer = NULL;
+    *pViewSize = 0;
+
+    Status = ObReferenceObjectByHandle(FileHandle, FILE_READ_DATA, NULL,
+                                       KernelMode, (PVOID*)&FileObject, NULL);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("ObReferenceObjectByHandle failed.\n");
+        return Status;
+    }
+
+    SectionSize.QuadPart = 0LL;
+    Status = MmCreateSection(&SectionObject,
+                             STANDARD_RIGHTS_REQUIRED | SECTION_QUERY | SECTION_MAP_READ,
+                             NULL, &SectionSize, PAGE_READONLY,
+                             SEC_COMMIT, FileHandle, FileObject);
+    if (NT_SUCCESS(Status))
+    {
+        Status = MmMapViewInSystemSpace(SectionObject, pBuffer, pViewSize);
+        ObDereferenceObject(SectionObject);
+    }
+
+    ObDereferenceObject(FileObject);
+    return Status;
+}
+
+/*
+ * Loads the face of a font from the font info cache, which was added to the
+ * font list without opening it. The FreeType lock must be held.
+ */
+static BOOL
+SharedFace_Load(PSHARED_FACE SharedFace, LPCWSTR pszFileName)
+{
+    NTSTATUS Status;
+    HANDLE FileHandle;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK Iosb;
+    UNICODE_STRING PathName;
+    PVOID Buffer;
+    SIZE_T ViewSize;
+    PSHARED_MEM Memory;
+    FT_Face Face;
+    FT_Error Error;
+
+    ASSERT_FREETYPE_LOCK_HELD();
+
+    if (SharedFace->Face)
+        return TRUE;
+
+    if (!pszFileName)
+        return FALSE;
+
+    RtlInitUnicodeString(&PathName, pszFileName);
+    InitializeObjectAttributes(&ObjectAttributes, &PathName,
+                               OBJ_KERNEL_HANDLE | OBJ_CASE_INSENSITIVE, NULL, NULL);
+    Status = ZwOpenFile(&FileHandle,
+                        FILE_GENERIC_READ | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &Iosb,
+                        FILE_SHARE_READ,
+                        FILE_SYNCHRONOUS_IO_NONALERT);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Could not load font file: %wZ\n", &PathName);
+        return FALSE;
+    }
+
+    Status = IntMapFontFile(FileHandle, &Buffer, &ViewSize);
+    ZwClose(FileHandle);
+    if (!NT_SUCCESS(Status))
+    {
+        DPRINT1("Could not map file: %wZ\n", &PathName);
+        return FALSE;
+    }
+
+    Memory = SharedMem_Create(Buffer, ViewSize, TRUE);
+    if (!Memory)
+    {
+        MmUnmapViewInSystemSpace(Buffer);
+        return FALSE;
+    }
+
+    Error = FT_New_Memory_Face(g_FreeTypeLibrary, Buffer, ViewSize,
+                               SharedFace->FontIndex, &Face);
+    if (Error)
+    {
+        DPRINT1("Error reading font %wZ (error code: %d)\n", &PathName, Error);
+        SharedMem_Release(Memory);
+        return FALSE;
+    }
+
+    DPRINT("Loaded SharedFace for %s\n", Face->family_name ? Face->family_name : "<NULL>");
+    SharedFace->Face = Face;
+    SharedFace->Memory = Memory;
+    return TRUE;
+}
 
 static VOID FASTCALL
 CleanupFontEntryEx(PFONT_ENTRY FontEntry, PFONTGDI FontGDI)
@@ -706,6 +1024,9 @@ CleanupFontEntryEx(PFONT_ENTRY FontEntry, PFONTGDI FontGDI)
     if (FontGDI->Filename)
         ExFreePoolWithTag(FontGDI->Filename, GDITAG_PFF);
 
+    if (FontGDI->FamilyInfo)
+        ExFreePoolWithTag(FontGDI->FamilyInfo, TAG_FONT);
+
     if (FontEntry->StyleName.Buffer)
         RtlFreeUnicodeString(&FontEntry->StyleName);
 
@@ -852,7 +1173,9 @@ VOID DumpGlobalFontList(BOOL bDoLock)
     if (bDoLock)
         IntLockFreeType();
 
+    IntLockFontListShared();
     DumpFontList(&g_FontListHead);
+    IntUnLockFontList();
 
     if (bDoLock)
         IntUnLockFreeType();
@@ -1020,6 +1343,8 @@ BOOL FASTCALL
 InitFontSupport(VOID)
 {
     ULONG ulError;
+    LARGE_INTEGER StartTime, EndTime, Frequency;
+    UINT i;
 
     g_FontCacheNumEntries = 0;
 
@@ -1030,6 +1355,16 @@ InitFontSupport(VOID)
     }
     ExInitializeFastMutex(g_FreeTypeLock);
 
+    g_FontListLock = ExAllocatePoolWithTag(NonPagedPool, sizeof(ERESOURCE), TAG_INTERNAL_SYNC);
+    if (g_FontListLock == NULL)
+    {
+        return FALSE;
+    }
+    ExInitializeResourceLite(g_FontListLock);
+
+    for (i = 0; i < FONT_NAME_INDEX_SIZE; ++i)
+        InitializeListHead(&g_FontNameIndex[i]);
+
     ulError = FT_Init_FreeType(&g_FreeTypeLibrary);
     if (ulError)
     {
@@ -1037,6 +1372,10 @@ InitFontSupport(VOID)
         return FALSE;
     }
 
+    StartTime = KeQueryPerformanceCounter(&Frequency);
+    FontInfoCache_Read();
+    g_FontInfoCacheActive = TRUE;
+
     if (!IntLoadFontsInRegistry())
     {
         DPRINT1("Fonts registry is empty.\n");
@@ -1045,6 +1384,20 @@ InitFontSupport(VOID)
         IntLoadSystemFonts();
     }
 
+    /* Update the cache if fonts were added, changed or removed */
+    g_FontInfoCacheActive = FALSE;
+    if (g_FontInfoCacheDirty ||
+        (g_FontInfoCache && g_FontInfoCache->cFiles != g_FontInfoCacheHits))
+    {
+        FontInfoCache_Write();
+    }
+    FontInfoCache_Free();
+
+    EndTime = KeQueryPerformanceCounter(NULL);
+    DPRINT1("Loaded the system fonts in %I64u ms, %lu font files from the font info cache\n",
+            (EndTime.QuadPart - StartTime.QuadPart) * 1000 / Frequency.QuadPart,
+            g_FontInfoCacheHits);
+
     IntLoadFontSubstList(&g_FontSubstListHead);
 
 #if 0
@@ -1088,6 +1441,9 @@ FreeFontSupport(VOID)
     }
 
     // Free font list
+    IntLockFontListExclusive();
+    FontLookupCache_Flush();
+    IntFreeFontNameIndex();
     pHead = &g_FontListHead;
     while (!IsListEmpty(pHead))
     {
@@ -1095,6 +1451,7 @@ FreeFontSupport(VOID)
         pFontEntry = CONTAINING_RECORD(pEntry, FONT_ENTRY, ListEntry);
         CleanupFontEntry(pFontEntry);
     }
+    IntUnLockFontList();
 
     if (g_FreeTypeLibrary)
     {
@@ -1102,6 +1459,10 @@ FreeFontSupport(VOID)
         g_FreeTypeLibrary = NULL;
     }
 
+    ExDeleteResourceLite(g_FontListLock);
+    ExFreePoolWithTag(g_FontListLock, TAG_INTERNAL_SYNC);
+    g_FontListLock = NULL;
+
     ExFreePoolWithTag(g_FreeTypeLock, TAG_INTERNAL_SYNC);
     g_FreeTypeLock = NULL;
 }
@@ -1715,6 +2076,57 @@ UINT FASTCALL IntGetCharSet(INT nIndex, FT_ULong CodePageRange1)
 /* pixels to points */
 #define PX2PT(pixels) FT_MulDiv((pixels), 72, 96)
 
+/* Appends the name of a face to the registry value name of its font file */
+static VOID FASTCALL
+IntAppendFontRegValueName(PUNICODE_STRING pValueName, PFONT_ENTRY Entry)
+{
+    USHORT NameLength = Entry->FaceName.Length;
+
+    if (Entry->StyleName.Length)
+        NameLength += Entry->StyleName.Length + sizeof(WCHAR);
+
+    if (pValueName->Length == 0)
+    {
+        pValueName->Length = 0;
+        pValueName->MaximumLength = NameLength + sizeof(WCHAR);
+        pValueName->Buffer = ExAllocatePoolWithTag(PagedPool,
+                                                   pValueName->MaximumLength,
+                                                   TAG_USTR);
+        if (!pValueName->Buffer)
+        {
+            pValueName->MaximumLength = 0;
+            return;
+        }
+        pValueName->Buffer[0] = UNICODE_NULL;
+        RtlAppendUnicodeStringToString(pValueName, &Entry->FaceName);
+    }
+    else
+    {
+        UNICODE_STRING NewString;
+        USHORT Length = pValueName->Length + 3 * sizeof(WCHAR) + NameLength;
+        NewString.Length = 0;
+        NewString.MaximumLength = Length + sizeof(WCHAR);
+        NewString.Buffer = ExAllocatePoolWithTag(PagedPool,
+                                                 NewString.MaximumLength,
+                                                 TAG_USTR);
+        if (!NewString.Buffer)
+            return;
+        NewString.Buffer[0] = UNICODE_NULL;
+
+        RtlAppendUnicodeStringToString(&NewString, pValueName);
+        RtlAppendUnicodeToString(&NewString, L" & ");
+        RtlAppendUnicodeStringToString(&NewString, &Entry->FaceName);
+
+        RtlFreeUnicodeString(pValueName);
+        *pValueName = NewString;
+    }
+    if (Entry->StyleName.Length)
+    {
+        RtlAppendUnicodeToString(pValueName, L" ");
+        RtlAppendUnicodeStringToString(pValueName, &Entry->StyleName);
+    }
+}
+
 static INT FASTCALL
 IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
                           PSHARED_FACE SharedFace, FT_Long FontIndex, INT CharSetIndex)
@@ -1730,7 +2142,6 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
     INT                 FaceCount = 0, CharSetCount = 0;
     PUNICODE_STRING     pFileName       = pLoadFont->pFileName;
     DWORD               Characteristics = pLoadFont->Characteristics;
-    PUNICODE_STRING     pValueName = &pLoadFont->RegValueName;
     TT_OS2 *            pOS2;
     INT                 BitIndex;
     FT_UShort           os2_version;
@@ -1980,7 +2391,10 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
     else
     {
         /* global font */
+        IntLockFontListExclusive();
         InsertTailList(&g_FontListHead, &Entry->ListEntry);
+        FontLookupCache_Flush();
+        IntUnLockFontList();
     }
     IntUnLockFreeType();
 
@@ -2001,84 +2415,559 @@ IntGdiLoadFontsFromMemory(PGDI_LOAD_FONT pLoadFont,
         FontIndex = 0;
     }
 
-    if (CharSetIndex == -1)
-    {
-        INT i;
-        USHORT NameLength = Entry->FaceName.Length;
+    if (CharSetIndex == -1)
+    {
+        INT i;
+
+        IntAppendFontRegValueName(&pLoadFont->RegValueName, Entry);
+
+        for (i = 1; i < CharSetCount; ++i)
+        {
+            /* Do not count charsets towards 'faces' loaded */
+            IntGdiLoadFontsFromMemory(pLoadFont, SharedFace, FontIndex, i);
+        }
+    }
+
+    return FaceCount;   /* number of loaded faces */
+}
+
+static LPCWSTR FASTCALL
+NameFromCharSet(BYTE CharSet)
+{
+    switch (CharSet)
+    {
+        case ANSI_CHARSET: return L"ANSI";
+        case DEFAULT_CHARSET: return L"Default";
+        case SYMBOL_CHARSET: return L"Symbol";
+        case SHIFTJIS_CHARSET: return L"Shift_JIS";
+        case HANGUL_CHARSET: return L"Hangul";
+        case GB2312_CHARSET: return L"GB 2312";
+        case CHINESEBIG5_CHARSET: return L"Chinese Big5";
+        case OEM_CHARSET: return L"OEM";
+        case JOHAB_CHARSET: return L"Johab";
+        case HEBREW_CHARSET: return L"Hebrew";
+        case ARABIC_CHARSET: return L"Arabic";
+        case GREEK_CHARSET: return L"Greek";
+        case TURKISH_CHARSET: return L"Turkish";
+        case VIETNAMESE_CHARSET: return L"Vietnamese";
+        case THAI_CHARSET: return L"Thai";
+        case EASTEUROPE_CHARSET: return L"Eastern European";
+        case RUSSIAN_CHARSET: return L"Russian";
+        case MAC_CHARSET: return L"Mac";
+        case BALTIC_CHARSET: return L"Baltic";
+        default: return L"Unknown";
+    }
+}
+
+/*
+ * FontInfoCache_...
+ *
+ * Opening every font file with FreeType at startup only to learn the names,
+ * charsets and weights of the faces takes a good part of the session startup.
+ * The font info cache remembers all of that, and what FontFamilyFillInfo
+ * returns, for the system font files, keyed by their path, size and last write
+ * time. Fonts found in the cache are added to the font list with a deferred
+ * SHARED_FACE, and only opened by SharedFace_Load once a DC realizes them.
+ */
+
+static BOOL FASTCALL
+FontInfoCache_Validate(PFONTINFO_CACHE_HEADER Header, ULONG Size)
+{
+    PFONTINFO_CACHE_FILE Files;
+    PFONTINFO_CACHE_FACE Faces;
+    ULONG i;
+
+    if (Header->Magic != FONTINFO_CACHE_MAGIC ||
+        Header->Version != FONTINFO_CACHE_VERSION ||
+        Header->LanguageID != gusLanguageID)
+    {
+        return FALSE;
+    }
+
+    Size -= sizeof(FONTINFO_CACHE_HEADER);
+    if (Header->cFiles > Size / sizeof(FONTINFO_CACHE_FILE))
+        return FALSE;
+
+    Size -= Header->cFiles * sizeof(FONTINFO_CACHE_FILE);
+    if (Header->cFaces > Size / sizeof(FONTINFO_CACHE_FACE) ||
+        Header->cFaces * sizeof(FONTINFO_CACHE_FACE) != Size)
+    {
+        return FALSE;
+    }
+
+    Files = (PFONTINFO_CACHE_FILE)(Header + 1);
+    for (i = 0; i < Header->cFiles; ++i)
+    {
+        if (Files[i].cFaces == 0 ||
+            Files[i].iFirstFace > Header->cFaces ||
+            Files[i].cFaces > Header->cFaces - Files[i].iFirstFace)
+        {
+            return FALSE;
+        }
+        Files[i].PathName[_countof(Files[i].PathName) - 1] = UNICODE_NULL;
+    }
+
+    Faces = (PFONTINFO_CACHE_FACE)(Files + Header->cFiles);
+    for (i = 0; i < Header->cFaces; ++i)
+    {
+        Faces[i].FaceName[_countof(Faces[i].FaceName) - 1] = UNICODE_NULL;
+        Faces[i].StyleName[_countof(Faces[i].StyleName) - 1] = UNICODE_NULL;
+    }
+
+    return TRUE;
+}
+
+static VOID FASTCALL
+FontInfoCache_Read(VOID)
+{
+    NTSTATUS Status;
+    HANDLE FileHandle;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK Iosb;
+    FILE_STANDARD_INFORMATION FileInfo;
+    PFONTINFO_CACHE_HEADER Header;
+    ULONG Size;
+
+    InitializeObjectAttributes(&ObjectAttributes, &g_FontInfoCachePath,
+                               OBJ_KERNEL_HANDLE | OBJ_CASE_INSENSITIVE, NULL, NULL);
+    Status = ZwOpenFile(&FileHandle,
+                        FILE_GENERIC_READ | SYNCHRONIZE,
+                        &ObjectAttributes,
+                        &Iosb,
+                        FILE_SHARE_READ,
+                        FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE);
+    if (!NT_SUCCESS(Status))
+        return;     /* No cache yet */
+
+    Status = ZwQueryInformationFile(FileHandle, &Iosb, &FileInfo, sizeof(FileInfo),
+                                    FileStandardInformation);
+    if (!NT_SUCCESS(Status) ||
+        FileInfo.EndOfFile.QuadPart < sizeof(FONTINFO_CACHE_HEADER) ||
+        FileInfo.EndOfFile.QuadPart > FONTINFO_CACHE_MAX_SIZE)
+    {
+        ZwClose(FileHandle);
+        return;
+    }
+
+    Size = FileInfo.EndOfFile.LowPart;
+    Header = ExAllocatePoolWithTag(PagedPool, Size, TAG_FONT);
+    if (!Header)
+    {
+        ZwClose(FileHandle);
+        return;
+    }
+
+    Status = ZwReadFile(FileHandle, NULL, NULL, NULL, &Iosb, Header, Size, NULL, NULL);
+    ZwClose(FileHandle);
+
+    if (!NT_SUCCESS(Status) || Iosb.Information != Size ||
+        !FontInfoCache_Validate(Header, Size))
+    {
+        DPRINT1("Ignoring the font info cache\n");
+        ExFreePoolWithTag(Header, TAG_FONT);
+        return;
+    }
+
+    g_FontInfoCache = Header;
+    g_FontInfoCacheHint = 0;
+}
+
+static VOID FASTCALL
+FontInfoCache_Write(VOID)
+{
+    NTSTATUS Status;
+    HANDLE FileHandle;
+    OBJECT_ATTRIBUTES ObjectAttributes;
+    IO_STATUS_BLOCK Iosb;
+    PLIST_ENTRY ListEntry;
+    PFONTINFO_CACHE_NODE Node;
+    PFONTINFO_CACHE_HEADER Header;
+    PFONTINFO_CACHE_FILE Files;
+    PFONTINFO_CACHE_FACE Faces;
+    ULONG cFiles = 0, cFaces = 0, Size;
+
+    for (ListEntry = g_FontInfoCacheNodes.Flink;
+         ListEntry != &g_FontInfoCacheNodes;
+         ListEntry = ListEntry->Flink)
+    {
+        Node = CONTAINING_RECORD(ListEntry, FONTINFO_CACHE_NODE, ListEntry);
+        ++cFiles;
+        cFaces += Node->File.cFaces;
+    }
+
+    Size = sizeof(FONTINFO_CACHE_HEADER) +
+           cFiles * sizeof(FONTINFO_CACHE_FILE) +
+           cFaces * sizeof(FONTINFO_CACHE_FACE);
+    if (Size > FONTINFO_CACHE_MAX_SIZE)
+        return;
+
+    Header = ExAllocatePoolWithTag(PagedPool, Size, TAG_FONT);
+    if (!Header)
+        return;
+
+    Header->Magic = FONTINFO_CACHE_MAGIC;
+    Header->Version = FONTINFO_CACHE_VERSION;
+    Header->LanguageID = gusLanguageID;
+    Header->Reserved = 0;
+    Header->cFiles = cFiles;
+    Header->cFaces = cFaces;
+
+    Files = (PFONTINFO_CACHE_FILE)(Header + 1);
+    Faces = (PFONTINFO_CACHE_FACE)(Files + cFiles);
+    cFaces = 0;
+    for (ListEntry = g_FontInfoCacheNodes.Flink;
+         ListEntry != &g_FontInfoCacheNodes;
+         ListEntry = ListEntry->Flink)
+    {
+        Node = CONTAINING_RECORD(ListEntry, FONTINFO_CACHE_NODE, ListEntry);
+        *Files = Node->File;
+        Files->iFirstFace = cFaces;
+        RtlCopyMemory(&Faces[cFaces], Node->Faces, Node->File.cFaces * sizeof(FONTINFO_CACHE_FACE));
+        cFaces += Node->File.cFaces;
+        ++Files;
+    }
+
+    InitializeObjectAttributes(&ObjectAttributes, &g_FontInfoCachePath,
+                               OBJ_KERNEL_HANDLE | OBJ_CASE_INSENSITIVE, NULL, NULL);
+    Status = ZwCreateFile(&FileHandle,
+                          FILE_GENERIC_WRITE | SYNCHRONIZE,
+                          &ObjectAttributes,
+                          &Iosb,
+                          NULL,
+                          FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM,
+                          0,
+                          FILE_OVERWRITE_IF,
+                          FILE_SYNCHRONOUS_IO_NONALERT | FILE_NON_DIRECTORY_FILE,
+                          NULL,
+                          0);
+    if (NT_SUCCESS(Status))
+    {
+        /* A partly written file does not pass FontInfoCache_Validate */
+        Status = ZwWriteFile(FileHandle, NULL, NULL, NULL, &Iosb, Header, Size, NULL, NULL);
+        ZwClose(FileHandle);
+    }
+
+    if (!NT_SUCCESS(Status))
+        DPRINT1("Could not write the font info cache: 0x%08X\n", Status);
+
+    ExFreePoolWithTag(Header, TAG_FONT);
+}
+
+static VOID FASTCALL
+FontInfoCache_Free(VOID)
+{
+    PLIST_ENTRY ListEntry;
+
+    while (!IsListEmpty(&g_FontInfoCacheNodes))
+    {
+        ListEntry = RemoveHeadList(&g_FontInfoCacheNodes);
+        ExFreePoolWithTag(CONTAINING_RECORD(ListEntry, FONTINFO_CACHE_NODE, ListEntry), TAG_FONT);
+    }
+
+    if (g_FontInfoCache)
+    {
+        ExFreePoolWithTag(g_FontInfoCache, TAG_FONT);
+        g_FontInfoCache = NULL;
+    }
+}
+
+static PFONTINFO_CACHE_FILE FASTCALL
+FontInfoCache_Find(PUNICODE_STRING PathName, PFILE_NETWORK_OPEN_INFORMATION FileInfo)
+{
+    PFONTINFO_CACHE_FILE Files;
+    UNICODE_STRING Name;
+    ULONG i, Index;
+
+    if (!g_FontInfoCache || g_FontInfoCache->cFiles == 0)
+        return NULL;
+
+    /* The fonts get loaded in the same order every time, so the record after
+       the last match is usually the one */
+    Files = (PFONTINFO_CACHE_FILE)(g_FontInfoCache + 1);
+    for (i = 0; i < g_FontInfoCache->cFiles; ++i)
+    {
+        Index = (g_FontInfoCacheHint + i) % g_FontInfoCache->cFiles;
+        RtlInitUnicodeString(&Name, Files[Index].PathName);
+        if (!RtlEqualUnicodeString(&Name, PathName, TRUE))
+            continue;
+
+        g_FontInfoCacheHint = Index + 1;
+
+        if (Files[Index].FileSize.QuadPart != FileInfo->EndOfFile.QuadPart ||
+            Files[Index].LastWriteTime.QuadPart != FileInfo->LastWriteTime.QuadPart)
+        {
+            return NULL;    /* The file has changed */
+        }
+
+        return &Files[Index];
+    }
+
+    return NULL;
+}
+
+/* Returns the index of the first face record of the file for the same face */
+static ULONG FASTCALL
+FontInfoCache_FirstOfFace(const FONTINFO_CACHE_FACE *Faces, ULONG Index)
+{
+    ULONG i;
+
+    for (i = 0; i < Index; ++i)
+    {
+        if (Faces[i].FontIndex == Faces[Index].FontIndex)
+            break;
+    }
+
+    return i;
+}
+
+/* Records a system font file which was loaded with FreeType, pPrevEntry being
+   the font list entry before its fonts */
+static VOID FASTCALL
+FontInfoCache_AddFile(PFILE_NETWORK_OPEN_INFORMATION FileInfo,
+                      PGDI_LOAD_FONT pLoadFont,
+                      PLIST_ENTRY pPrevEntry)
+{
+    PUNICODE_STRING PathName = pLoadFont->pFileName;
+    PLIST_ENTRY ListEntry;
+    PFONT_ENTRY Entry;
+    PFONTGDI FontGDI;
+    PFONTINFO_CACHE_NODE Node;
+    PFONTINFO_CACHE_FACE Face;
+    PFONTFAMILYINFO FamilyInfo;
+    ULONG cFaces = 0;
+
+    if (PathName->Length >= sizeof(Node->File.PathName))
+        return;
+
+    IntLockFreeType();
+    IntLockFontListExclusive();
+
+    for (ListEntry = pPrevEntry->Flink; ListEntry != &g_FontListHead; ListEntry = ListEntry->Flink)
+        ++cFaces;
+
+    Node = ExAllocatePoolWithTag(PagedPool, FIELD_OFFSET(FONTINFO_CACHE_NODE, Faces[cFaces]), TAG_FONT);
+    if (!Node)
+    {
+        IntUnLockFontList();
+        IntUnLockFreeType();
+        return;
+    }
+
+    RtlZeroMemory(Node, FIELD_OFFSET(FONTINFO_CACHE_NODE, Faces[cFaces]));
+    RtlCopyMemory(Node->File.PathName, PathName->Buffer, PathName->Length);
+    Node->File.FileSize = FileInfo->EndOfFile;
+    Node->File.LastWriteTime = FileInfo->LastWriteTime;
+    Node->File.IsTrueType = pLoadFont->IsTrueType;
+    Node->File.cFaces = cFaces;
+
+    Face = Node->Faces;
+    for (ListEntry = pPrevEntry->Flink; ListEntry != &g_FontListHead; ListEntry = ListEntry->Flink)
+    {
+        Entry = CONTAINING_RECORD(ListEntry, FONT_ENTRY, ListEntry);
+        FontGDI = Entry->Font;
+
+        /* Names which do not fit would come back truncated */
+        if (Entry->FaceName.Length >= sizeof(Face->FaceName) ||
+            Entry->StyleName.Length >= sizeof(Face->StyleName))
+        {
+            break;
+        }
+
+        /* The enumeration information of the face as loaded, which is also
+           what the fonts from the cache get */
+        FamilyInfo = ExAllocatePoolWithTag(PagedPool, sizeof(FONTFAMILYINFO), TAG_FONT);
+        if (!FamilyInfo)
+            break;
+        if (!IntFillFamilyInfo(FamilyInfo, FontGDI))
+        {
+            ExFreePoolWithTag(FamilyInfo, TAG_FONT);
+            break;
+        }
+        FontGDI->FamilyInfo = FamilyInfo;
+        RtlCopyMemory(&Face->FamilyInfo, FamilyInfo, sizeof(FONTFAMILYINFO));
+        IntIndexFontEntry(Entry);
+
+        Face->FontIndex = FontGDI->SharedFace->FontIndex;
+        Face->OriginalWeight = FontGDI->OriginalWeight;
+        Face->OriginalItalic = FontGDI->OriginalItalic;
+        Face->CharSet = FontGDI->CharSet;
+        RtlCopyMemory(Face->FaceName, Entry->FaceName.Buffer, Entry->FaceName.Length);
+        if (Entry->StyleName.Length)
+            RtlCopyMemory(Face->StyleName, Entry->StyleName.Buffer, Entry->StyleName.Length);
+        ++Face;
+    }
+
+    IntUnLockFontList();
+    IntUnLockFreeType();
+
+    if (ListEntry != &g_FontListHead)
+    {
+        /* Leave this one to FreeType every time */
+        ExFreePoolWithTag(Node, TAG_FONT);
+        return;
+    }
+
+    InsertTailList(&g_FontInfoCacheNodes, &Node->ListEntry);
+    g_FontInfoCacheDirty = TRUE;
+}
+
+static PFONT_ENTRY FASTCALL
+IntCreateCachedFontEntry(const FONTINFO_CACHE_FACE *Face,
+                         PSHARED_FACE SharedFace,
+                         PUNICODE_STRING pFileName)
+{
+    PFONT_ENTRY Entry;
+    PFONTGDI FontGDI;
+
+    Entry = ExAllocatePoolWithTag(PagedPool, sizeof(FONT_ENTRY), TAG_FONT);
+    if (!Entry)
+        return NULL;
+
+    FontGDI = EngAllocMem(FL_ZERO_MEMORY, sizeof(FONTGDI), GDITAG_RFONT);
+    if (!FontGDI)
+    {
+        ExFreePoolWithTag(Entry, TAG_FONT);
+        return NULL;
+    }
+
+    RtlInitUnicodeString(&Entry->FaceName, NULL);
+    RtlInitUnicodeString(&Entry->StyleName, NULL);
+    FontGDI->Filename = ExAllocatePoolWithTag(PagedPool,
+                                              pFileName->Length + sizeof(UNICODE_NULL),
+                                              GDITAG_PFF);
+    FontGDI->FamilyInfo = ExAllocatePoolWithTag(PagedPool, sizeof(FONTFAMILYINFO), TAG_FONT);
+    if (!FontGDI->Filename || !FontGDI->FamilyInfo ||
+        !RtlCreateUnicodeString(&Entry->FaceName, Face->FaceName) ||
+        (Face->StyleName[0] && !RtlCreateUnicodeString(&Entry->StyleName, Face->StyleName)))
+    {
+        if (Entry->FaceName.Buffer)
+            RtlFreeUnicodeString(&Entry->FaceName);
+        if (FontGDI->FamilyInfo)
+            ExFreePoolWithTag(FontGDI->FamilyInfo, TAG_FONT);
+        if (FontGDI->Filename)
+            ExFreePoolWithTag(FontGDI->Filename, GDITAG_PFF);
+        EngFreeMem(FontGDI);
+        ExFreePoolWithTag(Entry, TAG_FONT);
+        return NULL;
+    }
+
+    RtlCopyMemory(FontGDI->Filename, pFileName->Buffer, pFileName->Length);
+    FontGDI->Filename[pFileName->Length / sizeof(WCHAR)] = UNICODE_NULL;
+    RtlCopyMemory(FontGDI->FamilyInfo, &Face->FamilyInfo, sizeof(FONTFAMILYINFO));
+
+    FontGDI->SharedFace = SharedFace;
+    FontGDI->CharSet = Face->CharSet;
+    FontGDI->OriginalItalic = Face->OriginalItalic;
+    FontGDI->RequestItalic = FALSE;
+    FontGDI->OriginalWeight = Face->OriginalWeight;
+    FontGDI->RequestWeight = FW_NORMAL;
+
+    Entry->Font = FontGDI;
+    Entry->NotEnum = 0;
+    return Entry;
+}
+
+/*
+ * IntLoadFontsFromCache
+ *
+ * Adds the fonts of a system font file from the font info cache, without
+ * opening it with FreeType. Returns the number of faces added, like
+ * IntGdiLoadFontsFromMemory, or 0 if the file is not in the cache.
+ */
+static INT FASTCALL
+IntLoadFontsFromCache(PFILE_NETWORK_OPEN_INFORMATION FileInfo, PGDI_LOAD_FONT pLoadFont)
+{
+    PFONTINFO_CACHE_FILE File;
+    PFONTINFO_CACHE_FACE Faces;
+    PFONTINFO_CACHE_NODE Node;
+    PFONT_ENTRY *Entries;
+    PSHARED_FACE SharedFace;
+    ULONG i, j;
+    INT FaceCount = 0;
 
-        if (Entry->StyleName.Length)
-            NameLength += Entry->StyleName.Length + sizeof(WCHAR);
+    File = FontInfoCache_Find(pLoadFont->pFileName, FileInfo);
+    if (!File)
+        return 0;
 
-        if (pLoadFont->RegValueName.Length == 0)
-        {
-            pValueName->Length = 0;
-            pValueName->MaximumLength = NameLength + sizeof(WCHAR);
-            pValueName->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                                       pValueName->MaximumLength,
-                                                       TAG_USTR);
-            pValueName->Buffer[0] = UNICODE_NULL;
-            RtlAppendUnicodeStringToString(pValueName, &Entry->FaceName);
-        }
-        else
-        {
-            UNICODE_STRING NewString;
-            USHORT Length = pValueName->Length + 3 * sizeof(WCHAR) + NameLength;
-            NewString.Length = 0;
-            NewString.MaximumLength = Length + sizeof(WCHAR);
-            NewString.Buffer = ExAllocatePoolWithTag(PagedPool,
-                                                     NewString.MaximumLength,
-                                                     TAG_USTR);
-            NewString.Buffer[0] = UNICODE_NULL;
+    Faces = (PFONTINFO_CACHE_FACE)((PFONTINFO_CACHE_FILE)(g_FontInfoCache + 1) +
+                                   g_FontInfoCache->cFiles) + File->iFirstFace;
 
-            RtlAppendUnicodeStringToString(&NewString, pValueName);
-            RtlAppendUnicodeToString(&NewString, L" & ");
-            RtlAppendUnicodeStringToString(&NewString, &Entry->FaceName);
+    Node = ExAllocatePoolWithTag(PagedPool, FIELD_OFFSET(FONTINFO_CACHE_NODE, Faces[File->cFaces]), TAG_FONT);
+    Entries = ExAllocatePoolWithTag(PagedPool, File->cFaces * sizeof(PFONT_ENTRY), TAG_FONT);
+    if (!Node || !Entries)
+    {
+        if (Node)
+            ExFreePoolWithTag(Node, TAG_FONT);
+        if (Entries)
+            ExFreePoolWithTag(Entries, TAG_FONT);
+        return 0;
+    }
 
-            RtlFreeUnicodeString(pValueName);
-            *pValueName = NewString;
+    for (i = 0; i < File->cFaces; ++i)
+    {
+        /* The charsets of a face share it */
+        j = FontInfoCache_FirstOfFace(Faces, i);
+        if (j < i)
+        {
+            SharedFace = Entries[j]->Font->SharedFace;
+            IntLockFreeType();
+            SharedFace_AddRef(SharedFace);
+            IntUnLockFreeType();
         }
-        if (Entry->StyleName.Length)
+        else
         {
-            RtlAppendUnicodeToString(pValueName, L" ");
-            RtlAppendUnicodeStringToString(pValueName, &Entry->StyleName);
+            SharedFace = SharedFace_CreateDeferred(Faces[i].FontIndex);
+            if (!SharedFace)
+                break;
+            ++FaceCount;
         }
 
-        for (i = 1; i < CharSetCount; ++i)
+        Entries[i] = IntCreateCachedFontEntry(&Faces[i], SharedFace, pLoadFont->pFileName);
+        if (!Entries[i])
         {
-            /* Do not count charsets towards 'faces' loaded */
-            IntGdiLoadFontsFromMemory(pLoadFont, SharedFace, FontIndex, i);
+            SharedFace_Release(SharedFace);
+            break;
         }
     }
 
-    return FaceCount;   /* number of loaded faces */
-}
+    if (i < File->cFaces)
+    {
+        /* Out of memory, leave it to FreeType */
+        while (i-- > 0)
+            CleanupFontEntry(Entries[i]);
+        ExFreePoolWithTag(Entries, TAG_FONT);
+        ExFreePoolWithTag(Node, TAG_FONT);
+        return 0;
+    }
 
-static LPCWSTR FASTCALL
-NameFromCharSet(BYTE CharSet)
-{
-    switch (CharSet)
+    /* Build the registry value name the way IntGdiLoadFontsFromMemory does,
+       which names the first face of a collection last */
+    for (i = 1; i <= File->cFaces; ++i)
     {
-        case ANSI_CHARSET: return L"ANSI";
-        case DEFAULT_CHARSET: return L"Default";
-        case SYMBOL_CHARSET: return L"Symbol";
-        case SHIFTJIS_CHARSET: return L"Shift_JIS";
-        case HANGUL_CHARSET: return L"Hangul";
-        case GB2312_CHARSET: return L"GB 2312";
-        case CHINESEBIG5_CHARSET: return L"Chinese Big5";
-        case OEM_CHARSET: return L"OEM";
-        case JOHAB_CHARSET: return L"Johab";
-        case HEBREW_CHARSET: return L"Hebrew";
-        case ARABIC_CHARSET: return L"Arabic";
-        case GREEK_CHARSET: return L"Greek";
-        case TURKISH_CHARSET: return L"Turkish";
-        case VIETNAMESE_CHARSET: return L"Vietnamese";
-        case THAI_CHARSET: return L"Thai";
-        case EASTEUROPE_CHARSET: return L"Eastern European";
-        case RUSSIAN_CHARSET: return L"Russian";
-        case MAC_CHARSET: return L"Mac";
-        case BALTIC_CHARSET: return L"Baltic";
-        default: return L"Unknown";
+        j = i % File->cFaces;
+        if (FontInfoCache_FirstOfFace(Faces, j) == j)
+            IntAppendFontRegValueName(&pLoadFont->RegValueName, Entries[j]);
     }
+    pLoadFont->IsTrueType = File->IsTrueType;
+
+    IntLockFontListExclusive();
+    for (i = 0; i < File->cFaces; ++i)
+    {
+        InsertTailList(&g_FontListHead, &Entries[i]->ListEntry);
+        IntIndexFontEntry(Entries[i]);
+    }
+    FontLookupCache_Flush();
+    IntUnLockFontList();
+
+    ExFreePoolWithTag(Entries, TAG_FONT);
+
+    /* Keep the record for the next cache file */
+    Node->File = *File;
+    RtlCopyMemory(Node->Faces, Faces, File->cFaces * sizeof(FONTINFO_CACHE_FACE));
+    InsertTailList(&g_FontInfoCacheNodes, &Node->ListEntry);
+    ++g_FontInfoCacheHits;
+
+    return FaceCount;
 }
 
 /*
@@ -2095,16 +2984,16 @@ IntGdiAddFontResourceEx(PUNICODE_STRING FileName, DWORD Characteristics,
     HANDLE FileHandle;
     PVOID Buffer = NULL;
     IO_STATUS_BLOCK Iosb;
-    PVOID SectionObject;
     SIZE_T ViewSize = 0, Length;
-    LARGE_INTEGER SectionSize;
     OBJECT_ATTRIBUTES ObjectAttributes;
     GDI_LOAD_FONT LoadFont;
-    INT FontCount;
+    INT FontCount = 0;
     HANDLE KeyHandle;
     UNICODE_STRING PathName;
     LPWSTR pszBuffer;
-    PFILE_OBJECT FileObject;
+    FILE_NETWORK_OPEN_INFORMATION FileInfo;
+    BOOL bUseCache = FALSE;
+    PLIST_ENTRY pPrevEntry = NULL;
     static const UNICODE_STRING TrueTypePostfix = RTL_CONSTANT_STRING(L" (TrueType)");
     static const UNICODE_STRING DosPathPrefix = RTL_CONSTANT_STRING(L"\\??\\");
 
@@ -2144,58 +3033,58 @@ IntGdiAddFontResourceEx(PUNICODE_STRING FileName, DWORD Characteristics,
         return 0;
     }
 
-    Status = ObReferenceObjectByHandle(FileHandle, FILE_READ_DATA, NULL,
-                                       KernelMode, (PVOID*)&FileObject, NULL);
-    if (!NT_SUCCESS(Status))
+    LoadFont.pFileName          = &PathName;
+    LoadFont.Memory             = NULL;
+    LoadFont.Characteristics    = Characteristics;
+    RtlInitUnicodeString(&LoadFont.RegValueName, NULL);
+    LoadFont.IsTrueType         = FALSE;
+    LoadFont.CharSet            = DEFAULT_CHARSET;
+    LoadFont.PrivateEntry       = NULL;
+
+    /* The system fonts loaded at startup go through the font info cache */
+    if (g_FontInfoCacheActive && Characteristics == 0)
     {
-        DPRINT1("ObReferenceObjectByHandle failed.\n");
-        ZwClose(FileHandle);
-        RtlFreeUnicodeString(&PathName);
-        return 0;
+        Status = ZwQueryInformationFile(FileHandle, &Iosb, &FileInfo, sizeof(FileInfo),
+                                        FileNetworkOpenInformation);
+        bUseCache = NT_SUCCESS(Status);
+        if (bUseCache)
+            FontCount = IntLoadFontsFromCache(&FileInfo, &LoadFont);
     }
 
-    SectionSize.QuadPart = 0LL;
-    Status = MmCreateSection(&SectionObject,
-                             STANDARD_RIGHTS_REQUIRED | SECTION_QUERY | SECTION_MAP_READ,
-                             NULL, &SectionSize, PAGE_READONLY,
-                             SEC_COMMIT, FileHandle, FileObject);
-    if (!NT_SUCCESS(Status))
+    if (FontCount > 0)
     {
-        DPRINT1("Could not map file: %wZ\n", &PathName);
         ZwClose(FileHandle);
-        ObDereferenceObject(FileObject);
-        RtlFreeUnicodeString(&PathName);
-        return 0;
     }
-    ZwClose(FileHandle);
-
-    Status = MmMapViewInSystemSpace(SectionObject, &Buffer, &ViewSize);
-    if (!NT_SUCCESS(Status))
+    else
     {
-        DPRINT1("Could not map file: %wZ\n", &PathName);
-        ObDereferenceObject(SectionObject);
-        ObDereferenceObject(FileObject);
-        RtlFreeUnicodeString(&PathName);
-        return 0;
-    }
+        Status = IntMapFontFile(FileHandle, &Buffer, &ViewSize);
+        ZwClose(FileHandle);
+        if (!NT_SUCCESS(Status))
+        {
+            DPRINT1("Could not map file: %wZ\n", &PathName);
+            RtlFreeUnicodeString(&PathName);
+            return 0;
+        }
 
-    LoadFont.pFileName          = &PathName;
-    LoadFont.Memory             = SharedMem_Create(Buffer, ViewSize, TRUE);
-    LoadFont.Characteristics    = Characteristics;
-    RtlInitUnicodeString(&LoadFont.RegValueName, NULL);
-    LoadFont.IsTrueType         = FALSE;
-    LoadFont.CharSet            = DEFAULT_CHARSET;
-    LoadFont.PrivateEntry       = NULL;
-    FontCount = IntGdiLoadFontsFromMemory(&LoadFont, NULL, -1, -1);
+        /* The new fonts are appended after the current last one */
+        if (bUseCache)
+        {
+            IntLockFontListShared();
+            pPrevEntry = g_FontListHead.Blink;
+            IntUnLockFontList();
+        }
 
-    /* Release our copy */
-    IntLockFreeType();
-    SharedMem_Release(LoadFont.Memory);
-    IntUnLockFreeType();
+        LoadFont.Memory = SharedMem_Create(Buffer, ViewSize, TRUE);
+        FontCount = IntGdiLoadFontsFromMemory(&LoadFont, NULL, -1, -1);
 
-    ObDereferenceObject(SectionObject);
+        /* Release our copy */
+        IntLockFreeType();
+        SharedMem_Release(LoadFont.Memory);
+        IntUnLockFreeType();
 
-    ObDereferenceObject(FileObject);
+        if (bUseCache && FontCount > 0)
+            FontInfoCache_AddFile(&FileInfo, &LoadFont, pPrevEntry);
+    }
 
     /* Save the loaded font name into the registry */
     if (FontCount > 0 && (dwFlags & AFRX_WRITE_REGISTRY))
@@ -3446,9 +4335,8 @@ IntGetFontLocalizedName(PUNICODE_STRING pNameW, PSHARED_FACE SharedFace,
     return Status;
 }
 
-static void FASTCALL
-FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
-                   LPCWSTR FullName, PFONTGDI FontGDI)
+static BOOL FASTCALL
+IntFillFamilyInfo(PFONTFAMILYINFO Info, PFONTGDI FontGDI)
 {
     ANSI_STRING StyleA;
     UNICODE_STRING StyleW;
@@ -3473,14 +4361,14 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     Otm = ExAllocatePoolWithTag(PagedPool, Size, GDITAG_TEXT);
     if (!Otm)
     {
-        return;
+        return FALSE;
     }
     ASSERT_FREETYPE_LOCK_HELD();
     Size = IntGetOutlineTextMetrics(FontGDI, Size, Otm, TRUE);
     if (!Size)
     {
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
-        return;
+        return FALSE;
     }
 
     Lf = &Info->EnumLogFontEx.elfLogFont;
@@ -3531,18 +4419,13 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
 
 
     /* face name */
-    if (!FaceName)
-        FaceName = (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFamilyName);
-
-    RtlStringCbCopyW(Lf->lfFaceName, sizeof(Lf->lfFaceName), FaceName);
+    RtlStringCbCopyW(Lf->lfFaceName, sizeof(Lf->lfFaceName),
+                     (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFamilyName));
 
     /* full name */
-    if (!FullName)
-        FullName = (WCHAR*)((ULONG_PTR) Otm + (ULONG_PTR)Otm->otmpFaceName);
-
     RtlStringCbCopyW(Info->EnumLogFontEx.elfFullName,
                      sizeof(Info->EnumLogFontEx.elfFullName),
-                     FullName);
+                     (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFaceName));
 
     RtlInitAnsiString(&StyleA, Face->style_name);
     StyleW.Buffer = Info->EnumLogFontEx.elfStyle;
@@ -3551,7 +4434,7 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     if (!NT_SUCCESS(status))
     {
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
-        return;
+        return FALSE;
     }
     Info->EnumLogFontEx.elfScript[0] = UNICODE_NULL;
 
@@ -3560,7 +4443,7 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
     if (!pOS2)
     {
         ExFreePoolWithTag(Otm, GDITAG_TEXT);
-        return;
+        return TRUE;
     }
 
     Ntm->ntmSizeEM = Otm->otmEMSquare;
@@ -3627,6 +4510,34 @@ FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
         }
     }
     Info->NewTextMetricEx.ntmFontSig = fs;
+    return TRUE;
+}
+
+static void FASTCALL
+FontFamilyFillInfo(PFONTFAMILYINFO Info, LPCWSTR FaceName,
+                   LPCWSTR FullName, PFONTGDI FontGDI)
+{
+    ASSERT_FREETYPE_LOCK_HELD();
+
+    /* The system fonts have it filled in when loaded, see FontInfoCache_AddFile */
+    if (FontGDI->FamilyInfo)
+        RtlCopyMemory(Info, FontGDI->FamilyInfo, sizeof(FONTFAMILYINFO));
+    else
+        IntFillFamilyInfo(Info, FontGDI);
+
+    if (FaceName)
+    {
+        RtlStringCbCopyW(Info->EnumLogFontEx.elfLogFont.lfFaceName,
+                         sizeof(Info->EnumLogFontEx.elfLogFont.lfFaceName),
+                         FaceName);
+    }
+
+    if (FullName)
+    {
+        RtlStringCbCopyW(Info->EnumLogFontEx.elfFullName,
+                         sizeof(Info->EnumLogFontEx.elfFullName),
+                         FullName);
+    }
 }
 
 static BOOLEAN FASTCALL
@@ -3734,7 +4645,9 @@ GetFontFamilyInfoForSubstitutes(const LOGFONTW *LogFont,
 
         /* search in global fonts */
         IntLockFreeType();
+        IntLockFontListShared();
         GetFontFamilyInfoForList(&lf, Info, pFromW->Buffer, pCount, MaxCount, &g_FontListHead);
+        IntUnLockFontList();
 
         /* search in private fonts */
         IntLockProcessPrivateFonts(Win32Process);
@@ -5401,30 +6314,27 @@ ftGdiGetFontData(
 
 #define GOT_PENALTY(name, value) Penalty += (value)
 
-// NOTE: See Table 1. of https://msdn.microsoft.com/en-us/library/ms969909.aspx
+/*
+ * The part of the penalty that does not depend on the font size. It only
+ * looks at the charset, pitch and family of the candidate and at its names,
+ * which are all known without loading the face.
+ */
 static UINT
-GetFontPenalty(const LOGFONTW *               LogFont,
-               const OUTLINETEXTMETRICW *     Otm,
-               const char *             style_name)
+GetFontBasePenalty(const LOGFONTW *     LogFont,
+                   BYTE                 CharSet,
+                   BYTE                 PitchAndFamily,
+                   LPCWSTR              FamilyName,
+                   LPCWSTR              FullName)
 {
     ULONG   Penalty = 0;
     BYTE    Byte;
-    LONG    Long;
-    BOOL    fNeedScaling = FALSE;
     const BYTE UserCharSet = CharSetFromLangID(gusLanguageID);
-    const TEXTMETRICW * TM = &Otm->otmTextMetrics;
-    WCHAR* ActualNameW;
 
-    ASSERT(Otm);
     ASSERT(LogFont);
 
-    /* FIXME: IntSizeSynth Penalty 20 */
-    /* FIXME: SmallPenalty Penalty 1 */
-    /* FIXME: FaceNameSubst Penalty 500 */
-
     Byte = LogFont->lfCharSet;
 
-    if (Byte != TM->tmCharSet)
+    if (Byte != CharSet)
     {
         if (Byte != DEFAULT_CHARSET && Byte != ANSI_CHARSET)
         {
@@ -5434,12 +6344,12 @@ GetFontPenalty(const LOGFONTW *               LogFont,
         }
         else
         {
-            if (UserCharSet != TM->tmCharSet)
+            if (UserCharSet != CharSet)
             {
                 /* UNDOCUMENTED: Not user language */
                 GOT_PENALTY("UNDOCUMENTED:NotUserLanguage", 100);
 
-                if (ANSI_CHARSET != TM->tmCharSet)
+                if (ANSI_CHARSET != CharSet)
                 {
                     /* UNDOCUMENTED: Not ANSI charset */
                     GOT_PENALTY("UNDOCUMENTED:NotAnsiCharSet", 100);
@@ -5455,8 +6365,8 @@ GetFontPenalty(const LOGFONTW *               LogFont,
             /* nothing to do */
             break;
         case OUT_DEVICE_PRECIS:
-            if (!(TM->tmPitchAndFamily & TMPF_DEVICE) ||
-                !(TM->tmPitchAndFamily & (TMPF_VECTOR | TMPF_TRUETYPE)))
+            if (!(PitchAndFamily & TMPF_DEVICE) ||
+                !(PitchAndFamily & (TMPF_VECTOR | TMPF_TRUETYPE)))
             {
                 /* OutputPrecision Penalty 19000 */
                 /* Requested OUT_STROKE_PRECIS, but the device can't do it
@@ -5465,7 +6375,7 @@ GetFontPenalty(const LOGFONTW *               LogFont,
             }
             break;
         default:
-            if (TM->tmPitchAndFamily & (TMPF_VECTOR | TMPF_TRUETYPE))
+            if (PitchAndFamily & (TMPF_VECTOR | TMPF_TRUETYPE))
             {
                 /* OutputPrecision Penalty 19000 */
                 /* Or OUT_STROKE_PRECIS not requested, and the candidate
@@ -5480,7 +6390,7 @@ GetFontPenalty(const LOGFONTW *               LogFont,
         Byte = VARIABLE_PITCH;
     if (Byte == FIXED_PITCH)
     {
-        if (TM->tmPitchAndFamily & _TMPF_VARIABLE_PITCH)
+        if (PitchAndFamily & _TMPF_VARIABLE_PITCH)
         {
             /* FixedPitch Penalty 15000 */
             /* Requested a fixed pitch font, but the candidate is a
@@ -5490,7 +6400,7 @@ GetFontPenalty(const LOGFONTW *               LogFont,
     }
     if (Byte == VARIABLE_PITCH)
     {
-        if (!(TM->tmPitchAndFamily & _TMPF_VARIABLE_PITCH))
+        if (!(PitchAndFamily & _TMPF_VARIABLE_PITCH))
         {
             /* PitchVariable Penalty 350 */
             /* Requested a variable pitch font, but the candidate is not a
@@ -5502,7 +6412,7 @@ GetFontPenalty(const LOGFONTW *               LogFont,
     Byte = (LogFont->lfPitchAndFamily & 0x0F);
     if (Byte == DEFAULT_PITCH)
     {
-        if (!(TM->tmPitchAndFamily & _TMPF_VARIABLE_PITCH))
+        if (!(PitchAndFamily & _TMPF_VARIABLE_PITCH))
         {
             /* DefaultPitchFixed Penalty 1 */
             /* Requested DEFAULT_PITCH, but the candidate is fixed pitch. */
@@ -5510,8 +6420,6 @@ GetFontPenalty(const LOGFONTW *               LogFont,
         }
     }
 
-    ActualNameW = (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFamilyName);
-
     if (LogFont->lfFaceName[0] != UNICODE_NULL)
     {
         BOOL Found = FALSE;
@@ -5519,13 +6427,12 @@ GetFontPenalty(const LOGFONTW *               LogFont,
         /* localized family name */
         if (!Found)
         {
-            Found = (_wcsicmp(LogFont->lfFaceName, ActualNameW) == 0);
+            Found = (_wcsicmp(LogFont->lfFaceName, FamilyName) == 0);
         }
         /* localized full name */
         if (!Found)
         {
-            ActualNameW = (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFaceName);
-            Found = (_wcsicmp(LogFont->lfFaceName, ActualNameW) == 0);
+            Found = (_wcsicmp(LogFont->lfFaceName, FullName) == 0);
         }
         if (!Found)
         {
@@ -5539,7 +6446,7 @@ GetFontPenalty(const LOGFONTW *               LogFont,
     Byte = (LogFont->lfPitchAndFamily & 0xF0);
     if (Byte != FF_DONTCARE)
     {
-        if (Byte != (TM->tmPitchAndFamily & 0xF0))
+        if (Byte != (PitchAndFamily & 0xF0))
         {
             /* Family Penalty 9000 */
             /* Requested a family, but the candidate's family is different. */
@@ -5547,13 +6454,40 @@ GetFontPenalty(const LOGFONTW *               LogFont,
         }
     }
 
-    if ((TM->tmPitchAndFamily & 0xF0) == FF_DONTCARE)
+    if ((PitchAndFamily & 0xF0) == FF_DONTCARE)
     {
         /* FamilyUnknown Penalty 8000 */
         /* Requested a family, but the candidate has no family. */
         GOT_PENALTY("FamilyUnknown", 8000);
     }
 
+    return Penalty;
+}
+
+// NOTE: See Table 1. of https://msdn.microsoft.com/en-us/library/ms969909.aspx
+static UINT
+GetFontPenalty(const LOGFONTW *               LogFont,
+               const OUTLINETEXTMETRICW *     Otm,
+               const char *             style_name)
+{
+    ULONG   Penalty;
+    LONG    Long;
+    BOOL    fNeedScaling = FALSE;
+    const TEXTMETRICW * TM = &Otm->otmTextMetrics;
+    WCHAR* ActualNameW;
+
+    ASSERT(Otm);
+    ASSERT(LogFont);
+
+    /* FIXME: IntSizeSynth Penalty 20 */
+    /* FIXME: SmallPenalty Penalty 1 */
+    /* FIXME: FaceNameSubst Penalty 500 */
+
+    ActualNameW = (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFamilyName);
+    Penalty = GetFontBasePenalty(LogFont, TM->tmCharSet, TM->tmPitchAndFamily,
+                                 ActualNameW,
+                                 (WCHAR*)((ULONG_PTR)Otm + (ULONG_PTR)Otm->otmpFaceName));
+
     /* Is the candidate a non-vector font? */
     if (!(TM->tmPitchAndFamily & (TMPF_TRUETYPE | TMPF_VECTOR)))
     {
@@ -5748,18 +6682,57 @@ GetFontPenalty(const LOGFONTW *               LogFont,
 
 #undef GOT_PENALTY
 
+/* Computes the penalty of a font for LogFont. *pOtm and *pOtmSize are
+   the metrics buffer, which is grown as needed */
+static BOOL
+IntGetFontMatchPenalty(PFONTGDI FontGDI, const LOGFONTW *LogFont,
+                       OUTLINETEXTMETRICW **pOtm, UINT *pOtmSize,
+                       ULONG *pPenalty)
+{
+    UINT OtmSize;
+
+    ASSERT_FREETYPE_LOCK_HELD();
+
+    if (!FontGDI->SharedFace->Face &&
+        !SharedFace_Load(FontGDI->SharedFace, FontGDI->Filename))
+    {
+        return FALSE;
+    }
+
+    /* get text metrics */
+    OtmSize = IntGetOutlineTextMetrics(FontGDI, 0, NULL, TRUE);
+    if (OtmSize > *pOtmSize || !*pOtm)
+    {
+        if (*pOtm)
+            ExFreePoolWithTag(*pOtm, GDITAG_TEXT);
+        *pOtm = ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT);
+        *pOtmSize = (*pOtm ? OtmSize : 0);
+    }
+    if (!*pOtm)
+        return FALSE;
+
+    IntRequestFontSize(NULL, FontGDI, LogFont->lfWidth, LogFont->lfHeight);
+
+    if (!IntGetOutlineTextMetrics(FontGDI, OtmSize, *pOtm, TRUE))
+        return FALSE;
+
+    *pPenalty = GetFontPenalty(LogFont, *pOtm, FontGDI->SharedFace->Face->style_name);
+    return TRUE;
+}
+
 static __inline VOID
 FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
                      const LOGFONTW *LogFont,
                      const PLIST_ENTRY Head)
 {
-    ULONG Penalty;
-    PLIST_ENTRY Entry;
+    ULONG Penalty, Hash, Threshold = MAXULONG;
+    PLIST_ENTRY Entry, Bucket;
     PFONT_ENTRY CurrentEntry;
+    PFONT_NAME_LINK Link;
     FONTGDI *FontGDI;
+    const FONTFAMILYINFO *Info;
     OUTLINETEXTMETRICW *Otm = NULL;
-    UINT OtmSize, OldOtmSize = 0;
-    FT_Face Face;
+    UINT OtmSize;
 
     ASSERT(FontObj);
     ASSERT(MatchPenalty);
@@ -5767,8 +6740,27 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
     ASSERT(Head);
 
     /* Start with a pretty big buffer */
-    OldOtmSize = 0x200;
-    Otm = ExAllocatePoolWithTag(PagedPool, OldOtmSize, GDITAG_TEXT);
+    OtmSize = 0x200;
+    Otm = ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT);
+
+    /* The fonts of the requested name usually make the best match. Their
+       penalty is what the other fonts have to beat */
+    if (Head == &g_FontListHead && LogFont->lfFaceName[0] != UNICODE_NULL)
+    {
+        ASSERT_FONT_LIST_LOCK_HELD();
+
+        Hash = IntHashFontName(LogFont->lfFaceName);
+        Bucket = &g_FontNameIndex[Hash % FONT_NAME_INDEX_SIZE];
+        for (Entry = Bucket->Flink; Entry != Bucket; Entry = Entry->Flink)
+        {
+            Link = CONTAINING_RECORD(Entry, FONT_NAME_LINK, ListEntry);
+            if (Link->Hash != Hash || _wcsicmp(Link->Name, LogFont->lfFaceName) != 0)
+                continue;
+
+            if (IntGetFontMatchPenalty(Link->Entry->Font, LogFont, &Otm, &OtmSize, &Penalty))
+                Threshold = min(Threshold, Penalty);
+        }
+    }
 
     /* get the FontObj of lowest penalty */
     for (Entry = Head->Flink; Entry != Head; Entry = Entry->Flink)
@@ -5777,37 +6769,29 @@ FindBestFontFromList(FONTOBJ **FontObj, ULONG *MatchPenalty,
 
         FontGDI = CurrentEntry->Font;
         ASSERT(FontGDI);
-        Face = FontGDI->SharedFace->Face;
 
-        /* get text metrics */
-        ASSERT_FREETYPE_LOCK_HELD();
-        OtmSize = IntGetOutlineTextMetrics(FontGDI, 0, NULL, TRUE);
-        if (OtmSize > OldOtmSize)
-        {
-            if (Otm)
-                ExFreePoolWithTag(Otm, GDITAG_TEXT);
-            Otm = ExAllocatePoolWithTag(PagedPool, OtmSize, GDITAG_TEXT);
+        /* Skip the fonts which cannot win whatever their size, without
+           loading or sizing them */
+        Info = FontGDI->FamilyInfo;
+        if (Info)
+        {
+            Penalty = GetFontBasePenalty(LogFont,
+                                         Info->NewTextMetricEx.ntmTm.tmCharSet,
+                                         Info->NewTextMetricEx.ntmTm.tmPitchAndFamily,
+                                         Info->EnumLogFontEx.elfLogFont.lfFaceName,
+                                         Info->EnumLogFontEx.elfFullName);
+            if (Penalty >= *MatchPenalty || Penalty > Threshold)
+                continue;
         }
 
         /* update FontObj if lowest penalty */
-        if (Otm)
-        {
-            ASSERT_FREETYPE_LOCK_HELD();
-            IntRequestFontSize(NULL, FontGDI, LogFont->lfWidth, LogFont->lfHeight);
-
-            ASSERT_FREETYPE_LOCK_HELD();
-            OtmSize = IntGetOutlineTextMetrics(FontGDI, OtmSize, Otm, TRUE);
-            if (!OtmSize)
-                continue;
-
-            OldOtmSize = OtmSize;
+        if (!IntGetFontMatchPenalty(FontGDI, LogFont, &Otm, &OtmSize, &Penalty))
+            continue;
 
-            Penalty = GetFontPenalty(LogFont, Otm, Face->style_name);
-            if (*MatchPenalty == MAXULONG || Penalty < *MatchPenalty)
-            {
-                *FontObj = GDIToObj(FontGDI, FONT);
-                *MatchPenalty = Penalty;
-            }
+        if (*MatchPenalty == MAXULONG || Penalty < *MatchPenalty)
+        {
+            *FontObj = GDIToObj(FontGDI, FONT);
+            *MatchPenalty = Penalty;
         }
     }
 
@@ -5908,9 +6892,13 @@ TextIntRealizeFont(HFONT FontHandle, PTEXTOBJ pTextObj)
     NTSTATUS Status = STATUS_SUCCESS;
     PTEXTOBJ TextObj;
     PPROCESSINFO Win32Process;
-    ULONG MatchPenalty;
+    ULONG MatchPenalty, Generation;
     LOGFONTW *pLogFont;
-    LOGFONTW SubstitutedLogFont;
+    LOGFONTW SubstitutedLogFont, LookupKey;
+    FONTOBJ *PrivateFont;
+    BOOL bUseCache;
+    DWORD dwHash;
+    SIZE_T cchFaceName;
 
     if (!pTextObj)
     {
@@ -5944,17 +6932,58 @@ TextIntRealizeFont(HFONT FontHandle, PTEXTOBJ pTextObj)
 
     Win32Process = PsGetCurrentProcessWin32Process();
 
-    /* Search private fonts */
-    IntLockFreeType();
+    /* The font realized before for the same LOGFONTW, unless the process
+       has fonts of its own which could match better */
+    LookupKey = SubstitutedLogFont;
+    for (cchFaceName = 0; cchFaceName < LF_FACESIZE; ++cchFaceName)
+    {
+        if (LookupKey.lfFaceName[cchFaceName] == UNICODE_NULL)
+            break;
+    }
+    RtlZeroMemory(&LookupKey.lfFaceName[cchFaceName],
+                  (LF_FACESIZE - cchFaceName) * sizeof(WCHAR));
+    dwHash = IntGetHash(&LookupKey, sizeof(LookupKey) / sizeof(DWORD));
+
     IntLockProcessPrivateFonts(Win32Process);
-    FindBestFontFromList(&TextObj->Font, &MatchPenalty, &SubstitutedLogFont,
-                         &Win32Process->PrivateFontListHead);
+    bUseCache = IsListEmpty(&Win32Process->PrivateFontListHead);
     IntUnLockProcessPrivateFonts(Win32Process);
 
-    /* Search system fonts */
-    FindBestFontFromList(&TextObj->Font, &MatchPenalty, &SubstitutedLogFont,
-                         &g_FontListHead);
-    IntUnLockFreeType();
+    Generation = 0;
+    if (bUseCache)
+    {
+        IntLockFontListShared();
+        TextObj->Font = FontLookupCache_Find(&LookupKey, dwHash);
+        Generation = g_FontListGeneration;
+        IntUnLockFontList();
+    }
+
+    if (NULL == TextObj->Font)
+    {
+        /* Search private fonts */
+        IntLockFreeType();
+        IntLockProcessPrivateFonts(Win32Process);
+        FindBestFontFromList(&TextObj->Font, &MatchPenalty, &SubstitutedLogFont,
+                             &Win32Process->PrivateFontListHead);
+        IntUnLockProcessPrivateFonts(Win32Process);
+        PrivateFont = TextObj->Font;
+
+        /* Search system fonts */
+        IntLockFontListShared();
+        FindBestFontFromList(&TextObj->Font, &MatchPenalty, &SubstitutedLogFont,
+                             &g_FontListHead);
+        IntUnLockFontList();
+        IntUnLockFreeType();
+
+        /* Don't remember a private font or a global font list which has
+           changed in the meantime */
+        if (bUseCache && TextObj->Font && TextObj->Font != PrivateFont)
+        {
+            IntLockFontListExclusive();
+            if (Generation == g_FontListGeneration)
+                FontLookupCache_Add(&LookupKey, dwHash, TextObj->Font);
+            IntUnLockFontList();
+        }
+    }
 
     if (NULL == TextObj->Font)
     {
@@ -6148,6 +7177,7 @@ IntGdiGetFontResourceInfo(
 
     /* Try to find the pathname in the global font list */
     IntLockFreeType();
+    IntLockFontListShared();
     for (ListEntry = g_FontListHead.Flink; ListEntry != &g_FontListHead;
          ListEntry = ListEntry->Flink)
     {
@@ -6181,6 +7211,7 @@ IntGdiGetFontResourceInfo(
                 break;
         }
     }
+    IntUnLockFontList();
     IntUnLockFreeType();
 
     /* Free the buffers */
@@ -6440,12 +7471,15 @@ IntGetFontFamilyInfo(HDC Dc,
 
     /* Enumerate font families in the global list */
     IntLockFreeType();
+    IntLockFontListShared();
     if (!GetFontFamilyInfoForList(SafeLogFont, SafeInfo, NULL, &AvailCount,
                                   InfoCount, &g_FontListHead))
     {
+        IntUnLockFontList();
         IntUnLockFreeType();
         return -1;
     }
+    IntUnLockFontList();
 
     /* Enumerate font families in the process local list */
     Win32Process = PsGetCurrentProcessWin32Process();
@@ -129,6 +129,16 @@ SOFTWARE.
 PREGION prgnDefault = NULL;
 HRGN    hrgnDefault = NULL;
 
+/* Rect buffers of up to REGION_POOL_RECTS rects come from a lookaside list,
+   which covers nearly all clip and visible regions. The size of a buffer is
+   always what rdh.nRgnSize says, which tells the two kinds apart. The rects
+   stay a plain RECTL array, GetRegionData and the clip code copy them out as
+   is, so a layout meant for vector compares would cost a conversion there. */
+#define REGION_POOL_RECTS 32
+#define REGION_POOL_SIZE  (REGION_POOL_RECTS * sizeof(RECTL))
+
+static PPAGED_LOOKASIDE_LIST gpRegionBufferLookasideList;
+
 // Internal Functions
 
 #if 1
@@ -404,6 +414,76 @@ typedef struct _SCANLINE_LISTBLOCK
 #define LARGE_COORDINATE  INT_MAX
 #define SMALL_COORDINATE  INT_MIN
 
+CODE_SEG("INIT")
+NTSTATUS
+NTAPI
+InitRegionImpl(VOID)
+{
+    gpRegionBufferLookasideList = ExAllocatePoolWithTag(NonPagedPool,
+                                                        sizeof(PAGED_LOOKASIDE_LIST),
+                                                        TAG_REGION);
+    if (gpRegionBufferLookasideList == NULL)
+        return STATUS_NO_MEMORY;
+
+    ExInitializePagedLookasideList(gpRegionBufferLookasideList,
+                                   NULL,
+                                   NULL,
+                                   0,
+                                   REGION_POOL_SIZE,
+                                   TAG_REGION,
+                                   64);
+    return STATUS_SUCCESS;
+}
+
+/* Allocates a rect buffer of at least cjSize bytes, *pcjBuffer receives
+   the size to keep in rdh.nRgnSize */
+static
+PRECTL
+REGION_AllocBuffer(
+    _In_ ULONG cjSize,
+    _Out_ PULONG pcjBuffer)
+{
+    PRECTL prcl;
+
+    if (cjSize <= REGION_POOL_SIZE)
+    {
+        prcl = ExAllocateFromPagedLookasideList(gpRegionBufferLookasideList);
+        *pcjBuffer = REGION_POOL_SIZE;
+    }
+    else
+    {
+        prcl = ExAllocatePoolWithTag(PagedPool, cjSize, TAG_REGION);
+        *pcjBuffer = cjSize;
+    }
+
+    if (prcl == NULL)
+        *pcjBuffer = 0;
+
+    return prcl;
+}
+
+static
+VOID
+REGION_FreeBuffer(
+    _In_ PRECTL prcl,
+    _In_ ULONG cjBuffer)
+{
+    if (cjBuffer == REGION_POOL_SIZE)
+        ExFreeToPagedLookasideList(gpRegionBufferLookasideList, prcl);
+    else
+        ExFreePoolWithTag(prcl, TAG_REGION);
+}
+
+/* Frees the rect buffer of a region, unless it is the built-in one */
+static
+VOID
+REGION_vFreeBuffer(
+    _Inout_ PREGION prgn)
+{
+    if ((prgn->Buffer != NULL) && (prgn->Buffer != &prgn->rdh.rcBound))
+        REGION_FreeBuffer(prgn->Buffer, prgn->rdh.nRgnSize);
+}
+
 static
 BOOL
 REGION_bGrowBufferSize(
@@ -432,7 +512,7 @@ REGION_bGrowBufferSize(
     }
 
     /* Allocate the new buffer */
-    pvBuffer = ExAllocatePoolWithTag(PagedPool, cjNewSize, TAG_REGION);
+    pvBuffer = REGION_AllocBuffer(cjNewSize, &cjNewSize);
     if (pvBuffer == NULL)
     {
         return FALSE;
@@ -442,10 +522,7 @@ REGION_bGrowBufferSize(
     COPY_RECTS(pvBuffer, prgn->Buffer, prgn->rdh.nCount);
 
     /* Free the old buffer */
-    if (prgn->Buffer != &prgn->rdh.rcBound)
-    {
-        ExFreePoolWithTag(prgn->Buffer, TAG_REGION);
-    }
+    REGION_vFreeBuffer(prgn);
 
     /* Set the new buffer */
     prgn->Buffer = pvBuffer;
@@ -585,21 +662,19 @@ REGION_CopyRegion(
         if (dst->rdh.nRgnSize < src->rdh.nCount * sizeof(RECT))
         {
             PRECTL temp;
+            ULONG cjBuffer;
 
             /* Allocate a new buffer */
-            temp = ExAllocatePoolWithTag(PagedPool,
-                                         src->rdh.nCount * sizeof(RECT),
-                                         TAG_REGION);
+            temp = REGION_AllocBuffer(src->rdh.nCount * sizeof(RECT), &cjBuffer);
             if (temp == NULL)
                 return FALSE;
 
             /* Free the old buffer */
-            if ((dst->Buffer != NULL) && (dst->Buffer != &dst->rdh.rcBound))
-                ExFreePoolWithTag(dst->Buffer, TAG_REGION);
+            REGION_vFreeBuffer(dst);
 
             /* Set the new buffer and the size */
             dst->Buffer = temp;
-            dst->rdh.nRgnSize = src->rdh.nCount * sizeof(RECT);
+            dst->rdh.nRgnSize = cjBuffer;
         }
 
         dst->rdh.nCount = src->rdh.nCount;
@@ -713,13 +788,12 @@ REGION_CropRegion(
     if ((rgnDst != rgnSrc) && (rgnDst->rdh.nRgnSize < nRgnSize))
     {
         PRECTL temp;
-        temp = ExAllocatePoolWithTag(PagedPool, nRgnSize, TAG_REGION);
+        temp = REGION_AllocBuffer(nRgnSize, &nRgnSize);
         if (temp == NULL)
             return ERROR;
 
         /* Free the old buffer */
-        if (rgnDst->Buffer && (rgnDst->Buffer != &rgnDst->rdh.rcBound))
-            ExFreePoolWithTag(rgnDst->Buffer, TAG_REGION);
+        REGION_vFreeBuffer(rgnDst);
 
         rgnDst->Buffer = temp;
         rgnDst->rdh.nCount = 0;
@@ -961,6 +1035,8 @@ REGION_RegionOp(
     INT ybot;                          /* Bottom of intersection */
     INT ytop;                          /* Top of intersection */
     RECTL *oldRects;                   /* Old rects for newReg */
+    ULONG cjOldRects;                  /* Size of the old rects */
+    ULONG cjNewRects;
     ULONG prevBand;                    /* Index of start of
                                         * Previous band in newReg */
     ULONG curBand;                     /* Index of start of current band in newReg */
@@ -983,6 +1059,7 @@ REGION_RegionOp(
      * note of its rects pointer (so that we can free them later), preserve its
      * extents and simply set numRects to zero. */
     oldRects = newReg->Buffer;
+    cjOldRects = newReg->rdh.nRgnSize;
     newReg->rdh.nCount = 0;
 
     /* Allocate a reasonable number of rectangles for the new region. The idea
@@ -990,15 +1067,23 @@ REGION_RegionOp(
      * reallocate and copy the array, which is time consuming, yet we don't
      * have to worry about using too much memory. I hope to be able to
      * nuke the Xrealloc() at the end of this function eventually. */
-    newReg->rdh.nRgnSize = max(reg1->rdh.nCount + 1, reg2->rdh.nCount) * 2 * sizeof(RECT);
+    cjNewRects = max(reg1->rdh.nCount + 1, reg2->rdh.nCount) * 2 * sizeof(RECT);
 
-    newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                           newReg->rdh.nRgnSize,
-                                           TAG_REGION);
-    if (newReg->Buffer == NULL)
+    if ((newReg != reg1) && (newReg != reg2) &&
+        (oldRects != &newReg->rdh.rcBound) && (cjOldRects >= cjNewRects))
     {
-        newReg->rdh.nRgnSize = 0;
-        return FALSE;
+        /* The old rects are not needed, build the result in place */
+        oldRects = NULL;
+    }
+    else
+    {
+        newReg->Buffer = REGION_AllocBuffer(cjNewRects, &newReg->rdh.nRgnSize);
+        if (newReg->Buffer == NULL)
+        {
+            newReg->Buffer = oldRects;
+            newReg->rdh.nRgnSize = cjOldRects;
+            return FALSE;
+        }
     }
 
     /* Initialize ybot and ytop.
@@ -1173,48 +1258,40 @@ REGION_RegionOp(
      * rectangles in the region. This never goes to 0, however...
      *
      * Only do this stuff if the number of rectangles allocated is more than
-     * twice the number of rectangles in the region (a simple optimization...). */
+     * twice the number of rectangles in the region (a simple optimization...).
+     * Pooled buffers are left alone, they cannot get any smaller. */
     if ((newReg->rdh.nRgnSize > (2 * newReg->rdh.nCount * sizeof(RECT))) &&
+        (newReg->rdh.nRgnSize > REGION_POOL_SIZE) &&
         (newReg->rdh.nCount > 2))
     {
-        if (REGION_NOT_EMPTY(newReg))
-        {
-            RECTL *prev_rects = newReg->Buffer;
-            newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                                   newReg->rdh.nCount * sizeof(RECT),
-                                                   TAG_REGION);
+        RECTL *prev_rects = newReg->Buffer;
+        ULONG cjBuffer;
 
-            if (newReg->Buffer == NULL)
-            {
-                newReg->Buffer = prev_rects;
-            }
-            else
-            {
-                newReg->rdh.nRgnSize = newReg->rdh.nCount*sizeof(RECT);
-                COPY_RECTS(newReg->Buffer, prev_rects, newReg->rdh.nCount);
-                if (prev_rects != &newReg->rdh.rcBound)
-                    ExFreePoolWithTag(prev_rects, TAG_REGION);
-            }
+        newReg->Buffer = REGION_AllocBuffer(newReg->rdh.nCount * sizeof(RECT), &cjBuffer);
+        if (newReg->Buffer == NULL)
+        {
+            newReg->Buffer = prev_rects;
         }
         else
         {
-            /* No point in doing the extra work involved in an Xrealloc if
-             * the region is empty */
-            newReg->rdh.nRgnSize = sizeof(RECT);
-            if (newReg->Buffer != &newReg->rdh.rcBound)
-                ExFreePoolWithTag(newReg->Buffer, TAG_REGION);
-
-            newReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                                   sizeof(RECT),
-                                                   TAG_REGION);
-            ASSERT(newReg->Buffer);
+            COPY_RECTS(newReg->Buffer, prev_rects, newReg->rdh.nCount);
+            REGION_FreeBuffer(prev_rects, newReg->rdh.nRgnSize);
+            newReg->rdh.nRgnSize = cjBuffer;
         }
     }
+    else if (!REGION_NOT_EMPTY(newReg) && (newReg->rdh.nRgnSize > REGION_POOL_SIZE))
+    {
+        /* No point in doing the extra work involved in an Xrealloc if
+         * the region is empty */
+        REGION_vFreeBuffer(newReg);
+        newReg->Buffer = &newReg->rdh.rcBound;
+        newReg->rdh.nRgnSize = sizeof(RECT);
+    }
 
     newReg->rdh.iType = RDH_RECTANGLES;
 
-    if (oldRects != &newReg->rdh.rcBound)
-        ExFreePoolWithTag(oldRects, TAG_REGION);
+    if ((oldRects != NULL) && (oldRects != &newReg->rdh.rcBound))
+        REGION_FreeBuffer(oldRects, cjOldRects);
     return TRUE;
 }
 
@@ -1286,6 +1363,112 @@ REGION_IntersectO(
     return TRUE;
 }
 
+/*!
+ * Returns the index of the first rect of the region reaching below y.
+ * Because of banding, the bottoms of the rects never decrease.
+ */
+static
+ULONG
+REGION_iFirstRectBelow(
+    _In_ PREGION prgn,
+    _In_ LONG y)
+{
+    ULONG iLow = 0, iHigh = prgn->rdh.nCount, iMid;
+
+    while (iLow < iHigh)
+    {
+        iMid = iLow + (iHigh - iLow) / 2;
+        if (prgn->Buffer[iMid].bottom <= y)
+            iLow = iMid + 1;
+        else
+            iHigh = iMid;
+    }
+
+    return iLow;
+}
+
+/*!
+ * Intersects a region with a rectangle. This only needs to clip the bands
+ * of the region within the rectangle, so it is done in a single pass
+ * without REGION_RegionOp. prgnDest may be prgnSrc.
+ */
+static
+BOOL
+REGION_bIntersectRect(
+    _Inout_ PREGION prgnDest,
+    _In_ PREGION prgnSrc,
+    _In_ const RECTL *prclClip)
+{
+    RECTL rcl = *prclClip; /* prclClip may be in prgnDest */
+    PRECTL prclSrc, prclDest;
+    ULONG iRect, iEnd, iBandEnd, cRects, prevBand, curBand;
+    LONG yBandTop, top, bottom, left, right;
+
+    if ((prgnSrc->rdh.nCount == 0) ||
+        (EXTENTCHECK(&rcl, &prgnSrc->rdh.rcBound) == 0))
+    {
+        EMPTY_REGION(prgnDest);
+        return TRUE;
+    }
+
+    /* Find the bands within the rectangle */
+    iRect = REGION_iFirstRectBelow(prgnSrc, rcl.top);
+    for (iEnd = iRect; iEnd < prgnSrc->rdh.nCount; iEnd++)
+    {
+        if (prgnSrc->Buffer[iEnd].top >= rcl.bottom)
+            break;
+    }
+
+    if (prgnDest != prgnSrc)
+    {
+        prgnDest->rdh.nCount = 0;
+        if (!REGION_bEnsureBufferSize(prgnDest, iEnd - iRect))
+            return FALSE;
+    }
+
+    /* Going in place is fine, the destination never gets ahead */
+    prclSrc = prgnSrc->Buffer;
+    prclDest = prgnDest->Buffer;
+    cRects = 0;
+    prevBand = 0;
+    while (iRect < iEnd)
+    {
+        yBandTop = prclSrc[iRect].top;
+        top = max(yBandTop, rcl.top);
+        bottom = min(prclSrc[iRect].bottom, rcl.bottom);
+        curBand = cRects;
+
+        for (iBandEnd = iRect;
+             (iBandEnd < iEnd) && (prclSrc[iBandEnd].top == yBandTop);
+             iBandEnd++)
+        {
+            left = max(prclSrc[iBandEnd].left, rcl.left);
+            right = min(prclSrc[iBandEnd].right, rcl.right);
+            if (left < right)
+            {
+                prclDest[cRects].left = left;
+                prclDest[cRects].top = top;
+                prclDest[cRects].right = right;
+                prclDest[cRects].bottom = bottom;
+                cRects++;
+            }
+        }
+
+        prgnDest->rdh.nCount = cRects;
+        if (cRects != curBand)
+        {
+            prevBand = REGION_Coalesce(prgnDest, prevBand, curBand);
+            cRects = prgnDest->rdh.nCount;
+        }
+
+        iRect = iBandEnd;
+    }
+
+    prgnDest->rdh.nCount = cRects;
+    REGION_SetExtents(prgnDest);
+    return TRUE;
+}
+
 /***********************************************************************
  * REGION_IntersectRegion
  */
@@ -1304,6 +1487,14 @@ REGION_IntersectRegion(
     {
         newReg->rdh.nCount = 0;
     }
+    else if (reg2->rdh.nCount == 1)
+    {
+        return REGION_bIntersectRect(newReg, reg1, &reg2->Buffer[0]);
+    }
+    else if (reg1->rdh.nCount == 1)
+    {
+        return REGION_bIntersectRect(newReg, reg2, &reg1->Buffer[0]);
+    }
     else
     {
         if (!REGION_RegionOp(newReg,
@@ -1920,14 +2111,11 @@ REGION_bMakeSimpleFrameRgn(
            the same, though. */
         prgn->rdh.nCount = i;
         NT_ASSERT(prgn->rdh.nCount > 1);
-        prgn->rdh.nRgnSize = prgn->rdh.nCount * sizeof(RECT);
         NT_ASSERT(prgn->Buffer == &prgn->rdh.rcBound);
-        prgn->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                            prgn->rdh.nRgnSize,
-                                            TAG_REGION);
+        prgn->Buffer = REGION_AllocBuffer(prgn->rdh.nCount * sizeof(RECT),
+                                          &prgn->rdh.nRgnSize);
         if (prgn->Buffer == NULL)
         {
-            prgn->rdh.nRgnSize = 0;
             return FALSE;
         }
 
@@ -2223,12 +2411,11 @@ REGION_AllocRgnWithHandle(
         /* Testing shows that > 95% of all regions have only 1 rect.
            Including that here saves us from having to do another allocation */
         pReg->Buffer = &pReg->rdh.rcBound;
+        pReg->rdh.nRgnSize = nReg * sizeof(RECT);
     }
     else
     {
-        pReg->Buffer = ExAllocatePoolWithTag(PagedPool,
-                                             nReg * sizeof(RECT),
-                                             TAG_REGION);
+        pReg->Buffer = REGION_AllocBuffer(nReg * sizeof(RECT), &pReg->rdh.nRgnSize);
         if (pReg->Buffer == NULL)
         {
             DPRINT1("Could not allocate region buffer\n");
@@ -2240,7 +2427,6 @@ REGION_AllocRgnWithHandle(
     EMPTY_REGION(pReg);
     pReg->rdh.dwSize = sizeof(RGNDATAHEADER);
     pReg->rdh.nCount = nReg;
-    pReg->rdh.nRgnSize = nReg * sizeof(RECT);
     pReg->prgnattr = &pReg->rgnattr;
 
     /* Initialize the region attribute */
@@ -2424,6 +2610,7 @@ IntSysCreateRectpRgn(
 
     /* Initialize it */
     prgn->Buffer = &prgn->rdh.rcBound;
+    prgn->rdh.nRgnSize = sizeof(RECT);
     prgn->prgnattr = &prgn->rgnattr;
     prgn->prgnattr->AttrFlags = ATTR_RGN_VALID;
     REGION_SetRectRgn(prgn, LeftRect, TopRect, RightRect, BottomRect);
@@ -2443,8 +2630,7 @@ REGION_vCleanup(PVOID ObjectBody)
     if (pRgn->prgnattr != &pRgn->rgnattr)
         GdiPoolFree(ppi->pPoolRgnAttr, pRgn->prgnattr);
 
-    if (pRgn->Buffer && pRgn->Buffer != &pRgn->rdh.rcBound)
-        ExFreePoolWithTag(pRgn->Buffer, TAG_REGION);
+    REGION_vFreeBuffer(pRgn);
 }
 
 VOID
@@ -2639,8 +2825,9 @@ REGION_RectInRegion(
     /* This is (just) a useful optimization */
     if ((Rgn->rdh.nCount > 0) && EXTENTCHECK(&Rgn->rdh.rcBound, &rc))
     {
-        for (pCurRect = Rgn->Buffer, pRectEnd = pCurRect +
-                                                Rgn->rdh.nCount; pCurRect < pRectEnd; pCurRect++)
+        /* Start with the first band that reaches the rectangle */
+        for (pCurRect = Rgn->Buffer + REGION_iFirstRectBelow(Rgn, rc.top),
+             pRectEnd = Rgn->Buffer + Rgn->rdh.nCount; pCurRect < pRectEnd; pCurRect++)
         {
             if (pCurRect->bottom <= rc.top)
                 continue;             /* Not far enough down yet */
@@ -3054,6 +3241,7 @@ REGION_PtsToRegion(
     INT i;
     RECTL *extents, *temp;
     INT numRects;
+    ULONG cjBuffer;
 
     extents = &reg->rdh.rcBound;
 
@@ -3065,7 +3253,7 @@ REGION_PtsToRegion(
         numRects = 1;
     }
 
-    temp = ExAllocatePoolWithTag(PagedPool, numRects * sizeof(RECT), TAG_REGION);
+    temp = REGION_AllocBuffer(numRects * sizeof(RECT), &cjBuffer);
     if (temp == NULL)
     {
         return 0;
@@ -3074,10 +3262,10 @@ REGION_PtsToRegion(
     if (reg->Buffer != NULL)
     {
         COPY_RECTS(temp, reg->Buffer, reg->rdh.nCount);
-        if (reg->Buffer != &reg->rdh.rcBound)
-            ExFreePoolWithTag(reg->Buffer, TAG_REGION);
+        REGION_vFreeBuffer(reg);
     }
     reg->Buffer = temp;
+    reg->rdh.nRgnSize = cjBuffer;
 
     reg->rdh.nCount = numRects;
     CurPtBlock = FirstPtBlock;
@@ -23,6 +23,11 @@ extern HRGN hrgnDefault;
 
 /* Functions ******************************************************************/
 
+CODE_SEG("INIT")
+NTSTATUS
+NTAPI
+InitRegionImpl(VOID);
+
 PREGION FASTCALL REGION_AllocRgnWithHandle(INT n);
 PREGION FASTCALL REGION_AllocUserRgnWithHandle(INT n);
 BOOL FASTCALL REGION_UnionRectWithRgn(PREGION rgn, const RECTL *rect);
@@ -3262,6 +3262,15 @@ NtUserSetTimer(
     UINT uElapse,
     TIMERPROC lpTimerFunc);
 
+UINT_PTR
+NTAPI
+NtUserSetCoalescableTimer(
+    HWND hWnd,
+    UINT_PTR nIDEvent,
+    UINT uElapse,
+    TIMERPROC lpTimerFunc,
+    ULONG uToleranceDelay);
+
 BOOL
 NTAPI
 NtUserSetWindowFNID(
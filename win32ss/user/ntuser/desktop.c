@@ -1659,6 +1659,7 @@ IntHideDesktop(PDESKTOP Desktop)
         return ERROR_INVALID_WINDOW_HANDLE;
     }
     DesktopWnd->style &= ~WS_VISIBLE;
+    VIS_InvalidateCache();
 
     return STATUS_SUCCESS;
 }
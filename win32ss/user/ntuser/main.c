@@ -493,6 +493,11 @@ InitThreadCallback(PETHREAD Thread)
     InitializeListHead(&ptiCurrent->WindowListHead);
     InitializeListHead(&ptiCurrent->W32CallbackListHead);
     InitializeListHead(&ptiCurrent->PostedMessagesListHead);
+    InitializeListHead(&ptiCurrent->TimerListHead);
+    for (i = 0; i < MSQ_WINDOW_BUCKETS; i++)
+    {
+        InitializeListHead(&ptiCurrent->PostedMessagesByWindow[i]);
+    }
     InitializeListHead(&ptiCurrent->SentMessagesListHead);
     InitializeListHead(&ptiCurrent->PtiLink);
     for (i = 0; i < NB_HOOKS; i++)
@@ -1042,6 +1047,7 @@ DriverEntry(
     DPRINT("Global Server Data -> %p\n", gpsi);
 
     NT_ROF(InitGdiHandleTable());
+    NT_ROF(InitRegionImpl());
     NT_ROF(InitPaletteImpl());
 
     /* Create stock objects, ie. precreated objects commonly
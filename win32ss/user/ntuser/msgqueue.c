@@ -512,35 +512,97 @@ MsqDecPaintCountQueue(PTHREADINFO pti)
 
 /*
     Post the move or update the message still pending to be processed.
-    Do not overload the queue with mouse move messages.
+    Do not overload the queue with mouse move messages, MsqPostMessage
+    folds it into a mouse move at the end of the queue.
  */
 VOID FASTCALL
 MsqPostMouseMove(PTHREADINFO pti, MSG* Msg, LONG_PTR ExtraInfo)
 {
+    MsqPostMessage(pti, Msg, TRUE, QS_MOUSEMOVE, 0, ExtraInfo);
+}
+
+static __inline PLIST_ENTRY
+MsqWindowBucket(PTHREADINFO pti, HWND hWnd)
+{
+    ULONG_PTR Handle = (ULONG_PTR)hWnd;
+
+    return &pti->PostedMessagesByWindow[(Handle ^ (Handle >> 16)) % MSQ_WINDOW_BUCKETS];
+}
+
+/*
+    Fold a mouse move into a mouse move still pending at the end of the
+    hardware queue, as nothing may come between them.
+ */
+static BOOL FASTCALL
+MsqCoalesceMouseMove(PTHREADINFO pti,
+                     MSG* Msg,
+                     BOOLEAN HardwareMessage,
+                     DWORD dwQEvent,
+                     LONG_PTR ExtraInfo)
+{
+    PUSER_MESSAGE_QUEUE MessageQueue = pti->MessageQueue;
     PUSER_MESSAGE Message;
     PLIST_ENTRY ListHead;
-    PUSER_MESSAGE_QUEUE MessageQueue = pti->MessageQueue;
 
-    ListHead = &MessageQueue->HardwareMessagesListHead;
+    if (dwQEvent || !HardwareMessage || Msg->message != WM_MOUSEMOVE)
+       return FALSE;
 
-    // Do nothing if empty.
-    if (!IsListEmpty(ListHead->Flink))
+    ListHead = &MessageQueue->HardwareMessagesListHead;
+    if (IsListEmpty(ListHead))
+       return FALSE;
+
+    Message = CONTAINING_RECORD(ListHead->Blink, USER_MESSAGE, ListEntry);
+    if (Message->Msg.message != WM_MOUSEMOVE ||
+        Message->Msg.hwnd != Msg->hwnd ||
+        Message->dwQEvent != 0 ||
+        MessageQueue->idSysPeek == (ULONG_PTR)Message)
     {
-       // Look at the end of the list,
-       Message = CONTAINING_RECORD(ListHead->Blink, USER_MESSAGE, ListEntry);
+       return FALSE;
+    }
 
-       // If the mouse move message is existing on the list,
-       if (Message->Msg.message == WM_MOUSEMOVE)
-       {
-          // Overwrite the message with updated data!
-          Message->Msg = *Msg;
+    // Overwrite the message with updated data!
+    Message->Msg = *Msg;
+    Message->ExtraInfo = ExtraInfo;
+
+    MsqWakeQueue(pti, QS_MOUSEMOVE, TRUE);
+    return TRUE;
+}
+
+/*
+    Post a WM_TIMER or WM_SYSTIMER for an expired timer. Timer messages
+    carry no more than their id, so one still pending for the same window
+    and timer stands for both, wherever it is in the posted queue.
+    Only messages posted here (with QS_ALLPOSTMESSAGE, which PostMessage
+    never uses) are merged, the ones an application posts itself are
+    always delivered.
+ */
+VOID FASTCALL
+MsqPostTimerMessage(PTHREADINFO pti, MSG* Msg)
+{
+    PUSER_MESSAGE Message;
+    PLIST_ENTRY ListHead, Entry;
+
+    ASSERT(Msg->message == WM_TIMER || Msg->message == WM_SYSTIMER);
 
-          MsqWakeQueue(pti, QS_MOUSEMOVE, TRUE);
+    ListHead = MsqWindowBucket(pti, Msg->hwnd);
+    for (Entry = ListHead->Blink; Entry != ListHead; Entry = Entry->Blink)
+    {
+       Message = CONTAINING_RECORD(Entry, USER_MESSAGE, WindowListEntry);
+       if (Message->Msg.hwnd == Msg->hwnd &&
+           Message->Msg.message == Msg->message &&
+           Message->Msg.wParam == Msg->wParam &&
+           Message->QS_Flags == (QS_POSTMESSAGE|QS_ALLPOSTMESSAGE) &&
+           Message->dwQEvent == 0)
+       {
+          // The queue bits are still set for it, only the data is new.
+          Message->Msg.lParam = Msg->lParam;
+          Message->Msg.time = Msg->time;
+          Message->Msg.pt = Msg->pt;
           return;
        }
     }
 
-    MsqPostMessage(pti, Msg, TRUE, QS_MOUSEMOVE, 0, ExtraInfo);
+    MsqPostMessage(pti, Msg, FALSE, (QS_POSTMESSAGE|QS_ALLPOSTMESSAGE), 0, 0);
 }
 
 /*
@@ -739,6 +801,7 @@ MsqCreateMessage(LPMSG Msg)
    }
 
    RtlZeroMemory(Message, sizeof(*Message));
+   InitializeListHead(&Message->WindowListEntry);
    RtlMoveMemory(&Message->Msg, Msg, sizeof(MSG));
    PostMsgCount++;
    return Message;
@@ -754,6 +817,7 @@ MsqDestroyMessage(PUSER_MESSAGE Message)
       return;
    }
    RemoveEntryList(&Message->ListEntry);
+   RemoveEntryList(&Message->WindowListEntry);
    Message->pti = NULL;
    ExFreeToPagedLookasideList(pgMessageLookasideList, Message);
    PostMsgCount--;
@@ -807,11 +871,12 @@ MsqRemoveWindowMessagesFromQueue(PWND Window)
    pti = Window->head.pti;
 
    /* remove the posted messages for this window */
-   CurrentEntry = pti->PostedMessagesListHead.Flink;
-   ListHead = &pti->PostedMessagesListHead;
+   ListHead = MsqWindowBucket(pti, UserHMGetHandle(Window));
+   CurrentEntry = ListHead->Flink;
    while (CurrentEntry != ListHead)
    {
-      PostedMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, ListEntry);
+      PostedMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, WindowListEntry);
+      CurrentEntry = CurrentEntry->Flink;
 
       if (PostedMessage->Msg.hwnd == UserHMGetHandle(Window))
       {
@@ -822,11 +887,6 @@ MsqRemoveWindowMessagesFromQueue(PWND Window)
          }
          ClearMsgBitsMask(pti, PostedMessage->QS_Flags);
          MsqDestroyMessage(PostedMessage);
-         CurrentEntry = pti->PostedMessagesListHead.Flink;
-      }
-      else
-      {
-         CurrentEntry = CurrentEntry->Flink;
       }
    }
 
@@ -1352,6 +1412,9 @@ MsqPostMessage(PTHREADINFO pti,
       return;
    }
 
+   if (MsqCoalesceMouseMove(pti, Msg, HardwareMessage, dwQEvent, ExtraInfo))
+      return;
+
    Message = MsqCreateMessage(Msg);
    if (!Message)
       return;
@@ -1367,6 +1430,7 @@ MsqPostMessage(PTHREADINFO pti,
    if (!HardwareMessage)
    {
        InsertTailList(&pti->PostedMessagesListHead, &Message->ListEntry);
+       InsertTailList(MsqWindowBucket(pti, Msg->hwnd), &Message->WindowListEntry);
    }
    else
    {
@@ -2064,18 +2128,30 @@ MsqPeekMessage(IN PTHREADINFO pti,
                   OUT PMSG Message)
 {
    PUSER_MESSAGE CurrentMessage;
-   PLIST_ENTRY ListHead;
+   PLIST_ENTRY ListHead, CurrentEntry;
    DWORD QS_Flags;
    BOOL Ret = FALSE;
 
-   ListHead = pti->PostedMessagesListHead.Flink;
+   if (IsListEmpty(&pti->PostedMessagesListHead)) return FALSE;
 
-   if (IsListEmpty(ListHead)) return FALSE;
+   /* A window filter only needs to look at the messages for that window */
+   if (Window)
+   {
+      ListHead = MsqWindowBucket(pti, Window == PWND_BOTTOM ? NULL : UserHMGetHandle(Window));
+   }
+   else
+   {
+      ListHead = &pti->PostedMessagesListHead;
+   }
 
-   while(ListHead != &pti->PostedMessagesListHead)
+   CurrentEntry = ListHead->Flink;
+   while(CurrentEntry != ListHead)
    {
-      CurrentMessage = CONTAINING_RECORD(ListHead, USER_MESSAGE, ListEntry);
-      ListHead = ListHead->Flink;
+      if (Window)
+         CurrentMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, WindowListEntry);
+      else
+         CurrentMessage = CONTAINING_RECORD(CurrentEntry, USER_MESSAGE, ListEntry);
+      CurrentEntry = CurrentEntry->Flink;
 /*
  MSDN:
  1: any window that belongs to the current thread, and any messages on the current thread's message queue whose hwnd value is NULL.
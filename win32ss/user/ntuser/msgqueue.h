@@ -8,6 +8,7 @@
 typedef struct _USER_MESSAGE
 {
   LIST_ENTRY ListEntry;
+  LIST_ENTRY WindowListEntry; // Posted messages only, PostedMessagesByWindow link
   MSG Msg;
   DWORD QS_Flags;
   LONG_PTR ExtraInfo;
@@ -135,6 +136,7 @@ NTSTATUS FASTCALL co_MsqSendMessage(PTHREADINFO ptirec,
 PUSER_MESSAGE FASTCALL MsqCreateMessage(LPMSG Msg);
 VOID FASTCALL MsqDestroyMessage(PUSER_MESSAGE Message);
 VOID FASTCALL MsqPostMessage(PTHREADINFO, MSG*, BOOLEAN, DWORD, DWORD, LONG_PTR);
+VOID FASTCALL MsqPostTimerMessage(PTHREADINFO, MSG*);
 VOID FASTCALL MsqPostQuitMessage(PTHREADINFO pti, ULONG ExitCode);
 BOOLEAN APIENTRY
 MsqPeekMessage(IN PTHREADINFO pti,
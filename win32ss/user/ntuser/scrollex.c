@@ -386,8 +386,10 @@ IntScrollWindowEx(
          RECTL_vOffsetRect(&rcChild, -ClientOrigin.x, -ClientOrigin.y);
 
          /* Adjust window positions */
+         VIS_InvalidateRect(&Child->rcWindow);
          RECTL_vOffsetRect(&Child->rcWindow, dx, dy);
          RECTL_vOffsetRect(&Child->rcClient, dx, dy);
+         VIS_InvalidateRect(&Child->rcWindow);
 
          if (!prcScroll || RECTL_bIntersectRect(&rcDummy, &rcChild, &rcScroll))
          {
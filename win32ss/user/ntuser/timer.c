@@ -13,8 +13,22 @@ DBG_DEFAULT_CHANNEL(UserTimer);
 
 /* GLOBALS *******************************************************************/
 
-static LIST_ENTRY TimersListHead;
-static LONG TimeLast = 0;
+/* All timers, hashed by window and id */
+#define TIMER_HASH_SIZE 64
+static LIST_ENTRY TimersHashTable[TIMER_HASH_SIZE];
+
+/* The queued timers, as a binary min-heap on their due time */
+static PTIMER *TimerHeap;
+static ULONG TimerHeapCount;
+static ULONG TimerHeapSize;
+/* Tick count the master timer is set for, valid when TimerArmed */
+static ULONG TimerArmedDeadline;
+static BOOLEAN TimerArmed;
+#define TIMER_HEAP_GROW   64
+#define TIMER_NOT_QUEUED  ((ULONG)-1)
+
+/* Tick counts wrap around, compare them by their difference */
+#define TimerDueBefore(a, b) ((LONG)((a) - (b)) < 0)
 
 /* Windows 2000 has room for 32768 window-less timers */
 /* These values give timer IDs [256,32767], same as on Windows */
@@ -50,10 +64,189 @@ ERESOURCE TimerLock;
 
 
 /* FUNCTIONS *****************************************************************/
+
+static
+PLIST_ENTRY
+FASTCALL
+TimerHashBucket(PWND Window, UINT_PTR nID)
+{
+  ULONG_PTR Key = (ULONG_PTR)Window ^ nID;
+
+  return &TimersHashTable[(Key ^ (Key >> 6)) % TIMER_HASH_SIZE];
+}
+
+static
+VOID
+FASTCALL
+TimerHeapSet(ULONG i, PTIMER pTmr)
+{
+  TimerHeap[i] = pTmr;
+  pTmr->iHeap = i;
+}
+
+static
+VOID
+FASTCALL
+TimerHeapUp(ULONG i)
+{
+  PTIMER pTmr = TimerHeap[i];
+
+  while (i > 0 && TimerDueBefore(pTmr->ulDueTime, TimerHeap[(i - 1) / 2]->ulDueTime))
+  {
+     TimerHeapSet(i, TimerHeap[(i - 1) / 2]);
+     i = (i - 1) / 2;
+  }
+  TimerHeapSet(i, pTmr);
+}
+
+static
+VOID
+FASTCALL
+TimerHeapDown(ULONG i)
+{
+  PTIMER pTmr = TimerHeap[i];
+  ULONG Child;
+
+  for (;;)
+  {
+     Child = 2 * i + 1;
+     if (Child >= TimerHeapCount)
+        break;
+     if (Child + 1 < TimerHeapCount &&
+         TimerDueBefore(TimerHeap[Child + 1]->ulDueTime, TimerHeap[Child]->ulDueTime))
+     {
+        Child++;
+     }
+     if (!TimerDueBefore(TimerHeap[Child]->ulDueTime, pTmr->ulDueTime))
+        break;
+     TimerHeapSet(i, TimerHeap[Child]);
+     i = Child;
+  }
+  TimerHeapSet(i, pTmr);
+}
+
+static
+VOID
+FASTCALL
+TimerHeapRemove(PTIMER pTmr)
+{
+  ULONG i = pTmr->iHeap;
+
+  if (i == TIMER_NOT_QUEUED)
+     return;
+
+  ASSERT(TimerHeap[i] == pTmr);
+  pTmr->iHeap = TIMER_NOT_QUEUED;
+
+  if (i != --TimerHeapCount)
+  {
+     TimerHeapSet(i, TimerHeap[TimerHeapCount]);
+     TimerHeapUp(i);
+     TimerHeapDown(TimerHeap[i]->iHeap);
+  }
+}
+
+/* Queues the timer to be due cmsRate from Time, or moves it there */
+static
+BOOL
+FASTCALL
+TimerQueue(PTIMER pTmr, ULONG Time)
+{
+  PTIMER *NewHeap;
+
+  pTmr->ulDueTime = Time + pTmr->cmsRate;
+
+  if (pTmr->iHeap != TIMER_NOT_QUEUED)
+  {
+     TimerHeapUp(pTmr->iHeap);
+     TimerHeapDown(pTmr->iHeap);
+     return TRUE;
+  }
+
+  if (TimerHeapCount == TimerHeapSize)
+  {
+     NewHeap = ExAllocatePoolWithTag(PagedPool,
+                                     (TimerHeapSize + TIMER_HEAP_GROW) * sizeof(PTIMER),
+                                     USERTAG_TIMER);
+     if (!NewHeap)
+        return FALSE;
+
+     if (TimerHeap)
+     {
+        RtlCopyMemory(NewHeap, TimerHeap, TimerHeapCount * sizeof(PTIMER));
+        ExFreePoolWithTag(TimerHeap, USERTAG_TIMER);
+     }
+     TimerHeap = NewHeap;
+     TimerHeapSize += TIMER_HEAP_GROW;
+  }
+
+  TimerHeapSet(TimerHeapCount, pTmr);
+  TimerHeapUp(TimerHeapCount++);
+  return TRUE;
+}
+
+/*
+ * Finds the earliest time at which a timer must fire, given that each one
+ * may fire as late as its tolerance allows. Subtrees due after the best
+ * deadline found so far cannot improve on it.
+ */
+static
+ULONG
+FASTCALL
+TimerEarliestDeadline(ULONG i, ULONG Deadline)
+{
+  PTIMER pTmr;
+
+  if (i >= TimerHeapCount)
+     return Deadline;
+
+  pTmr = TimerHeap[i];
+  if (!TimerDueBefore(pTmr->ulDueTime, Deadline))
+     return Deadline;
+
+  if (TimerDueBefore(pTmr->ulDueTime + pTmr->cmsTolerance, Deadline))
+     Deadline = pTmr->ulDueTime + pTmr->cmsTolerance;
+
+  Deadline = TimerEarliestDeadline(2 * i + 1, Deadline);
+  return TimerEarliestDeadline(2 * i + 2, Deadline);
+}
+
+/* Sets the master timer to the next deadline, every timer due by then fires with it */
+static
+VOID
+FASTCALL
+TimerArm(ULONG Time)
+{
+  LARGE_INTEGER DueTime;
+  ULONG Deadline;
+  LONG Delay;
+
+  ASSERT(MasterTimer != NULL);
+
+  if (TimerHeapCount == 0)
+  {
+     KeCancelTimer(MasterTimer);
+     TimerArmed = FALSE;
+     return;
+  }
+
+  Deadline = TimerHeap[0]->ulDueTime + TimerHeap[0]->cmsTolerance;
+  Deadline = TimerEarliestDeadline(0, Deadline);
+  TimerArmedDeadline = Deadline;
+  TimerArmed = TRUE;
+
+  Delay = (LONG)(Deadline - Time);
+  if (Delay < 1)
+     Delay = 1;
+
+  DueTime.QuadPart = Int32x32To64(Delay, -10000);
+  KeSetTimer(MasterTimer, DueTime, NULL);
+}
+
 static
 PTIMER
 FASTCALL
-CreateTimer(VOID)
+CreateTimer(PWND Window, UINT_PTR nID)
 {
   HANDLE Handle;
   PTIMER Ret = NULL;
@@ -62,7 +255,9 @@ CreateTimer(VOID)
   if (Ret)
   {
      UserHMSetHandle(Ret, Handle);
-     InsertTailList(&TimersListHead, &Ret->ptmrList);
+     Ret->iHeap = TIMER_NOT_QUEUED;
+     InitializeListHead(&Ret->ptmrThreadList);
+     InsertTailList(TimerHashBucket(Window, nID), &Ret->ptmrList);
   }
 
   return Ret;
@@ -78,6 +273,8 @@ RemoveTimer(PTIMER pTmr)
   {
      /* Set the flag, it will be removed when ready */
      RemoveEntryList(&pTmr->ptmrList);
+     RemoveEntryList(&pTmr->ptmrThreadList);
+     TimerHeapRemove(pTmr);
      if ((pTmr->pWnd == NULL) && (!(pTmr->flags & TMRF_SYSTEM))) // System timers are reusable.
      {
         ULONG ulBitmapIndex;
@@ -102,12 +299,13 @@ FindTimer(PWND Window,
           UINT_PTR nID,
           UINT flags)
 {
-  PLIST_ENTRY pLE;
+  PLIST_ENTRY pLE, ListHead;
   PTIMER pTmr, RetTmr = NULL;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  while (pLE != &TimersListHead)
+  ListHead = TimerHashBucket(Window, nID);
+  pLE = ListHead->Flink;
+  while (pLE != ListHead)
   {
     pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
 
@@ -130,24 +328,29 @@ PTIMER
 FASTCALL
 FindSystemTimer(PMSG pMsg)
 {
-  PLIST_ENTRY pLE;
-  PTIMER pTmr = NULL;
+  PLIST_ENTRY pLE, ListHead;
+  PTIMER pTmr, RetTmr = NULL;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  while (pLE != &TimersListHead)
+  /* System timers are keyed by their window and id too */
+  ListHead = TimerHashBucket(pMsg->hwnd ? ValidateHwndNoErr(pMsg->hwnd) : NULL, pMsg->wParam);
+  pLE = ListHead->Flink;
+  while (pLE != ListHead)
   {
     pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
 
     if ( pMsg->lParam == (LPARAM)pTmr->pfn &&
          (pTmr->flags & TMRF_SYSTEM) )
+    {
+       RetTmr = pTmr;
        break;
+    }
 
     pLE = pLE->Flink;
   }
   TimerLeave();
 
-  return pTmr;
+  return RetTmr;
 }
 
 BOOL
@@ -158,20 +361,24 @@ ValidateTimerCallback(PTHREADINFO pti,
   PLIST_ENTRY pLE;
   BOOL Ret = FALSE;
   PTIMER pTmr;
+  PTHREADINFO ptiTimer;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  while (pLE != &TimersListHead)
+  /* Only the timers of the threads of this process can match */
+  for (ptiTimer = pti->ppi->ptiList; ptiTimer && !Ret; ptiTimer = ptiTimer->ptiSibling)
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
-    if ( (lParam == (LPARAM)pTmr->pfn) &&
-        !(pTmr->flags & (TMRF_SYSTEM|TMRF_RIT)) &&
-         (pTmr->pti->ppi == pti->ppi) )
+    pLE = ptiTimer->TimerListHead.Flink;
+    while (pLE != &ptiTimer->TimerListHead)
     {
-       Ret = TRUE;
-       break;
+      pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrThreadList);
+      if ( (lParam == (LPARAM)pTmr->pfn) &&
+          !(pTmr->flags & (TMRF_SYSTEM|TMRF_RIT)) )
+      {
+         Ret = TRUE;
+         break;
+      }
+      pLE = pLE->Flink;
     }
-    pLE = pLE->Flink;
   }
   TimerLeave();
 
@@ -184,12 +391,24 @@ IntSetTimer( PWND Window,
                   UINT Elapse,
                   TIMERPROC TimerFunc,
                   INT Type)
+{
+  return IntSetCoalescableTimer(Window, IDEvent, Elapse, TimerFunc, Type, 0);
+}
+
+UINT_PTR FASTCALL
+IntSetCoalescableTimer( PWND Window,
+                        UINT_PTR IDEvent,
+                        UINT Elapse,
+                        TIMERPROC TimerFunc,
+                        INT Type,
+                        ULONG Tolerance)
 {
   PTIMER pTmr;
   UINT_PTR Ret = IDEvent;
   ULONG ulBitmapIndex;
-  LARGE_INTEGER DueTime;
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
+  ULONG Time;
+  BOOL NewTimer = FALSE;
+  TIMER OldTmr;
 
 #if 0
   /* Windows NT/2k/XP behaviour */
@@ -214,11 +433,17 @@ IntSetTimer( PWND Window,
      Elapse = USER_TIMER_MINIMUM; // 1024hz .9765625 ms, set to 10.0 ms (+/-)1 ms
   }
 
+  /* Not even a tolerance lets a timer go past the longest timer */
+  if (Tolerance > USER_TIMER_MAXIMUM - Elapse)
+     Tolerance = USER_TIMER_MAXIMUM - Elapse;
+
   /* Passing an IDEvent of 0 and the SetTimer returns 1.
      It will create the timer with an ID of 0 */
   if ((Window) && (IDEvent == 0))
      Ret = 1;
 
+  TimerEnterExclusive();
+
   pTmr = FindTimer(Window, IDEvent, Type);
 
   if ((!pTmr) && (Window == NULL) && (!(Type & TMRF_SYSTEM)))
@@ -230,6 +455,7 @@ IntSetTimer( PWND Window,
       if (ulBitmapIndex == ULONG_MAX)
       {
          IntUnlockWindowlessTimerBitmap();
+         TimerLeave();
          ERR("Unable to find a free window-less timer id\n");
          EngSetLastError(ERROR_NO_SYSTEM_RESOURCES);
          return 0;
@@ -244,8 +470,13 @@ IntSetTimer( PWND Window,
 
   if (!pTmr)
   {
-     pTmr = CreateTimer();
-     if (!pTmr) return 0;
+     pTmr = CreateTimer(Window, IDEvent);
+     if (!pTmr)
+     {
+        TimerLeave();
+        return 0;
+     }
+     NewTimer = TRUE;
 
      if (Window && (Type & TMRF_TIFROMWND))
         pTmr->pti = Window->head.pti->pEThread->Tcb.Win32Thread;
@@ -258,22 +489,49 @@ IntSetTimer( PWND Window,
      }
 
      pTmr->pWnd    = Window;
-     pTmr->cmsCountdown = Elapse;
      pTmr->cmsRate = Elapse;
      pTmr->pfn     = TimerFunc;
      pTmr->nID     = IDEvent;
      pTmr->flags   = Type|TMRF_INIT;
+
+     if (pTmr->pti)
+        InsertTailList(&pTmr->pti->TimerListHead, &pTmr->ptmrThreadList);
   }
   else
   {
-     pTmr->cmsCountdown = Elapse;
+     OldTmr = *pTmr;
      pTmr->cmsRate = Elapse;
+     pTmr->flags &= ~TMRF_WAITING;
   }
+  pTmr->cmsTolerance = Tolerance;
 
-  ASSERT(MasterTimer != NULL);
-  // Start the timer thread!
-  if (TimersListHead.Flink == TimersListHead.Blink) // There is only one timer
-     KeSetTimer(MasterTimer, DueTime, NULL);
+  Time = EngGetTickCount32();
+  if (!TimerQueue(pTmr, Time))
+  {
+     ERR("Unable to queue the timer\n");
+     if (NewTimer)
+        RemoveTimer(pTmr);
+     else
+     {
+        /* Leave the caller's timer as it was */
+        pTmr->cmsRate      = OldTmr.cmsRate;
+        pTmr->cmsTolerance = OldTmr.cmsTolerance;
+        pTmr->ulDueTime    = OldTmr.ulDueTime;
+        pTmr->flags        = OldTmr.flags;
+     }
+     TimerLeave();
+     EngSetLastError(ERROR_NOT_ENOUGH_MEMORY);
+     return 0;
+  }
+
+  // Move the timer thread up if this one must fire before it is set for.
+  if (!TimerArmed ||
+      TimerDueBefore(pTmr->ulDueTime + pTmr->cmsTolerance, TimerArmedDeadline))
+  {
+     TimerArm(Time);
+  }
+
+  TimerLeave();
 
   return Ret;
 }
@@ -409,12 +667,11 @@ PostTimerMessages(PWND Window)
   pti = PsGetCurrentThreadWin32Thread();
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
-  while(pLE != &TimersListHead)
+  pLE = pti->TimerListHead.Flink;
+  while(pLE != &pti->TimerListHead)
   {
-     pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+     pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrThreadList);
      if ( (pTmr->flags & TMRF_READY) &&
-          (pTmr->pti == pti) &&
           ((pTmr->pWnd == Window) || (Window == NULL)) )
         {
            Msg.hwnd    = (pTmr->pWnd ? UserHMGetHandle(pTmr->pWnd) : NULL);
@@ -425,17 +682,14 @@ PostTimerMessages(PWND Window)
            // Fix all wine win:test_GetMessagePos WM_TIMER tests. See CORE-10867.
            Msg.pt      = gpsi->ptCursor;
 
-           MsqPostMessage(pti, &Msg, FALSE, (QS_POSTMESSAGE|QS_ALLPOSTMESSAGE), 0, 0);
+           MsqPostTimerMessage(pti, &Msg);
            pTmr->flags &= ~TMRF_READY;
            ClearMsgBitsMask(pti, QS_TIMER);
            Hit = TRUE;
            // Now move this entry to the end of the list so it will not be
            // called again in the next msg loop.
-           if (pLE != &TimersListHead)
-           {
-              RemoveEntryList(&pTmr->ptmrList);
-              InsertTailList(&TimersListHead, &pTmr->ptmrList);
-           }
+           RemoveEntryList(&pTmr->ptmrThreadList);
+           InsertTailList(&pti->TimerListHead, &pTmr->ptmrThreadList);
            break;
         }
 
@@ -451,74 +705,57 @@ VOID
 FASTCALL
 ProcessTimers(VOID)
 {
-  LARGE_INTEGER DueTime;
-  LONG Time;
-  PLIST_ENTRY pLE;
+  ULONG Time;
   PTIMER pTmr;
   LONG TimerCount = 0;
 
   TimerEnterExclusive();
-  pLE = TimersListHead.Flink;
   Time = EngGetTickCount32();
 
-  DueTime.QuadPart = (LONGLONG)(-97656); // 1024hz .9765625 ms set to 10.0 ms
-
-  while(pLE != &TimersListHead)
+  /* Only the timers which are due, the heap keeps them up front */
+  while (TimerHeapCount > 0 && !TimerDueBefore(Time, TimerHeap[0]->ulDueTime))
   {
-    pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+    pTmr = TimerHeap[0];
     TimerCount++;
-    if (pTmr->flags & TMRF_WAITING)
-    {
-       pLE = pTmr->ptmrList.Flink;
-       pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
-       continue;
-    }
 
-    if (pTmr->flags & TMRF_INIT)
+    pTmr->flags &= ~TMRF_INIT;
+
+    ASSERT(pTmr->pti);
+    if ((!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP)))
     {
-       pTmr->flags &= ~TMRF_INIT; // Skip this run.
+       if (pTmr->flags & TMRF_ONESHOT)
+          pTmr->flags |= TMRF_WAITING;
     }
+
+    /* Requeue it before running it, the timer proc may kill it */
+    if (pTmr->flags & TMRF_WAITING)
+       TimerHeapRemove(pTmr);
     else
+       TimerQueue(pTmr, Time);
+
+    if ((!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP)))
     {
-       if (pTmr->cmsCountdown < 0)
+       if (pTmr->flags & TMRF_RIT)
        {
-          ASSERT(pTmr->pti);
-          if ((!(pTmr->flags & TMRF_READY)) && (!(pTmr->pti->TIF_flags & TIF_INCLEANUP)))
-          {
-             if (pTmr->flags & TMRF_ONESHOT)
-                pTmr->flags |= TMRF_WAITING;
-
-             if (pTmr->flags & TMRF_RIT)
-             {
-                // Hard coded call here, inside raw input thread.
-                pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
-             }
-             else
-             {
-                pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
-                // Set thread message queue for this timer.
-                if (pTmr->pti)
-                {  // Wakeup thread
-                   pTmr->pti->cTimersReady++;
-                   ASSERT(pTmr->pti->pEventQueueServer != NULL);
-                   MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
-                }
-             }
-          }
-          pTmr->cmsCountdown = pTmr->cmsRate;
+          // Hard coded call here, inside raw input thread.
+          pTmr->pfn(NULL, WM_SYSTIMER, pTmr->nID, (LPARAM)pTmr);
        }
        else
-          pTmr->cmsCountdown -= Time - TimeLast;
+       {
+          pTmr->flags |= TMRF_READY; // Set timer ready to be ran.
+          // Set thread message queue for this timer.
+          if (pTmr->pti)
+          {  // Wakeup thread
+             pTmr->pti->cTimersReady++;
+             ASSERT(pTmr->pti->pEventQueueServer != NULL);
+             MsqWakeQueue(pTmr->pti, QS_TIMER, TRUE);
+          }
+       }
     }
-
-    pLE = pLE->Flink;
   }
 
-  // Restart the timer thread!
-  ASSERT(MasterTimer != NULL);
-  KeSetTimer(MasterTimer, DueTime, NULL);
-
-  TimeLast = Time;
+  // Restart the timer thread for the next one due!
+  TimerArm(Time);
 
   TimerLeave();
   TRACE("TimerCount = %d\n", TimerCount);
@@ -535,12 +772,12 @@ DestroyTimersForWindow(PTHREADINFO pti, PWND Window)
       return FALSE;
 
    TimerEnterExclusive();
-   pLE = TimersListHead.Flink;
-   while(pLE != &TimersListHead)
+   pLE = pti->TimerListHead.Flink;
+   while(pLE != &pti->TimerListHead)
    {
-      pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
+      pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrThreadList);
       pLE = pLE->Flink; /* get next timer list entry before current timer is removed */
-      if ((pTmr) && (pTmr->pti == pti) && (pTmr->pWnd == Window))
+      if (pTmr->pWnd == Window)
       {
          TimersRemoved = RemoveTimer(pTmr);
       }
@@ -554,20 +791,17 @@ DestroyTimersForWindow(PTHREADINFO pti, PWND Window)
 BOOL FASTCALL
 DestroyTimersForThread(PTHREADINFO pti)
 {
-   PLIST_ENTRY pLE = TimersListHead.Flink;
+   PLIST_ENTRY pLE;
    PTIMER pTmr;
    BOOL TimersRemoved = FALSE;
 
    TimerEnterExclusive();
 
-   while(pLE != &TimersListHead)
+   while (!IsListEmpty(&pti->TimerListHead))
    {
-      pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrList);
-      pLE = pLE->Flink; /* get next timer list entry before current timer is removed */
-      if ((pTmr) && (pTmr->pti == pti))
-      {
-         TimersRemoved = RemoveTimer(pTmr);
-      }
+      pLE = pti->TimerListHead.Flink;
+      pTmr = CONTAINING_RECORD(pLE, TIMER, ptmrThreadList);
+      TimersRemoved = RemoveTimer(pTmr);
    }
 
    TimerLeave();
@@ -600,6 +834,7 @@ NTAPI
 InitTimerImpl(VOID)
 {
    ULONG BitmapBytes;
+   ULONG i;
 
    /* Allocate FAST_MUTEX from non paged pool */
    Mutex = ExAllocatePoolWithTag(NonPagedPool, sizeof(FAST_MUTEX), TAG_INTERNAL_SYNC);
@@ -625,7 +860,10 @@ InitTimerImpl(VOID)
    RtlClearAllBits(&WindowLessTimersBitMap);
 
    ExInitializeResourceLite(&TimerLock);
-   InitializeListHead(&TimersListHead);
+   for (i = 0; i < TIMER_HASH_SIZE; i++)
+   {
+      InitializeListHead(&TimersHashTable[i]);
+   }
 
    return STATUS_SUCCESS;
 }
@@ -655,6 +893,44 @@ NtUserSetTimer
    return ret;
 }
 
+UINT_PTR
+APIENTRY
+NtUserSetCoalescableTimer
+(
+   HWND hWnd,
+   UINT_PTR nIDEvent,
+   UINT uElapse,
+   TIMERPROC lpTimerFunc,
+   ULONG uToleranceDelay
+)
+{
+   PWND Window = NULL;
+   UINT_PTR ret = 0;
+
+   TRACE("Enter NtUserSetCoalescableTimer\n");
+   UserEnterExclusive();
+
+   if (uToleranceDelay == TIMERV_NO_COALESCING)
+   {
+      uToleranceDelay = 0;
+   }
+   else if (uToleranceDelay > TIMERV_COALESCING_MAX)
+   {
+      EngSetLastError(ERROR_INVALID_PARAMETER);
+      goto Exit;
+   }
+
+   if (hWnd) Window = UserGetWindowObject(hWnd);
+
+   ret = IntSetCoalescableTimer(Window, nIDEvent, uElapse, lpTimerFunc, TMRF_TIFROMWND, uToleranceDelay);
+
+Exit:
+   UserLeave();
+   TRACE("Leave NtUserSetCoalescableTimer, ret=%u\n", ret);
+
+   return ret;
+}
+
 
 BOOL
 APIENTRY
@@ -3,12 +3,15 @@
 typedef struct _TIMER
 {
   HEAD           head;
-  LIST_ENTRY     ptmrList;
+  LIST_ENTRY     ptmrList;       // Hashed by pWnd and nID
+  LIST_ENTRY     ptmrThreadList; // pti->TimerListHead
   PTHREADINFO    pti;
   PWND           pWnd;         // hWnd
   UINT_PTR       nID;          // Specifies a nonzero timer identifier.
-  INT            cmsCountdown; // uElapse
+  ULONG          ulDueTime;    // Tick count it is due at
+  ULONG          iHeap;        // Position in the due time heap
   INT            cmsRate;      // uElapse
+  ULONG          cmsTolerance; // uToleranceDelay, how late it may fire
   FLONG          flags;
   TIMERPROC      pfn;          // lpTimerFunc
 } TIMER, *PTIMER;
@@ -30,6 +33,13 @@ typedef struct _TIMER
 #define ID_EVENT_SYSTIMER_ANIMATEDFADE   (0xFFF6)
 #define ID_EVENT_SYSTIMER_INVALIDATEDCES (0xFFF5)
 
+#ifndef TIMERV_NO_COALESCING
+#define TIMERV_DEFAULT_COALESCING   0
+#define TIMERV_NO_COALESCING        0xFFFFFFFF
+#define TIMERV_COALESCING_MIN       1
+#define TIMERV_COALESCING_MAX       0x7FFFFFF5
+#endif
+
 extern PKTIMER MasterTimer;
 
 CODE_SEG("INIT") NTSTATUS NTAPI InitTimerImpl(VOID);
@@ -37,6 +47,7 @@ BOOL FASTCALL DestroyTimersForThread(PTHREADINFO pti);
 BOOL FASTCALL DestroyTimersForWindow(PTHREADINFO pti, PWND Window);
 BOOL FASTCALL IntKillTimer(PWND Window, UINT_PTR IDEvent, BOOL SystemTimer);
 UINT_PTR FASTCALL IntSetTimer(PWND Window, UINT_PTR IDEvent, UINT Elapse, TIMERPROC TimerFunc, INT Type);
+UINT_PTR FASTCALL IntSetCoalescableTimer(PWND Window, UINT_PTR IDEvent, UINT Elapse, TIMERPROC TimerFunc, INT Type, ULONG Tolerance);
 PTIMER FASTCALL FindSystemTimer(PMSG);
 BOOL FASTCALL ValidateTimerCallback(PTHREADINFO,LPARAM);
 VOID CALLBACK SystemTimerProc(HWND,UINT,UINT_PTR,DWORD);
@@ -9,8 +9,63 @@
 #include <win32k.h>
 DBG_DEFAULT_CHANNEL(UserWinpos);
 
-PREGION FASTCALL
-VIS_ComputeVisibleRegion(
+/*
+ * The visible regions computed last, by window and flags. A visible region
+ * only depends on what happens inside the window rectangle, so moving a
+ * window only throws away the entries of the windows it leaves or enters,
+ * and an entry of a window that moved itself (with its parent, say) no
+ * longer matches its rectangles. Other changes of the window layout
+ * (styles, window regions, destruction) bump the serial, which throws all
+ * of them away at once.
+ */
+#define VIS_CACHE_SIZE 64
+
+typedef struct _VIS_CACHE_ENTRY
+{
+   PWND Wnd;
+   ULONG Serial;
+   ULONG Flags;
+   RECTL rcWindow;
+   RECTL rcClient;
+   PREGION VisRgn;
+} VIS_CACHE_ENTRY, *PVIS_CACHE_ENTRY;
+
+static VIS_CACHE_ENTRY VisCache[VIS_CACHE_SIZE];
+static ULONG VisCacheSerial = 1;
+
+#define VIS_CACHE_CLIENTAREA   0x1
+#define VIS_CACHE_CLIPCHILDREN 0x2
+#define VIS_CACHE_CLIPSIBLINGS 0x4
+
+VOID FASTCALL
+VIS_InvalidateCache(VOID)
+{
+   VisCacheSerial++;
+}
+
+VOID FASTCALL
+VIS_InvalidateRect(const RECTL *prcl)
+{
+   PVIS_CACHE_ENTRY Entry;
+
+   if (RECTL_bIsEmptyRect(prcl))
+      return;
+
+   for (Entry = VisCache; Entry < VisCache + VIS_CACHE_SIZE; Entry++)
+   {
+      if (Entry->Wnd &&
+          Entry->rcWindow.left < prcl->right &&
+          Entry->rcWindow.right > prcl->left &&
+          Entry->rcWindow.top < prcl->bottom &&
+          Entry->rcWindow.bottom > prcl->top)
+      {
+         Entry->Wnd = NULL;
+      }
+   }
+}
+
+static PREGION FASTCALL
+VIS_ComputeVisibleRegionUncached(
    PWND Wnd,
    BOOLEAN ClientArea,
    BOOLEAN ClipChildren,
@@ -19,11 +74,6 @@ VIS_ComputeVisibleRegion(
    PREGION VisRgn, ClipRgn;
    PWND PreviousWindow, CurrentWindow, CurrentSibling;
 
-   if (!Wnd || !(Wnd->style & WS_VISIBLE))
-   {
-      return NULL;
-   }
-
    VisRgn = NULL;
 
    if (ClientArea)
@@ -141,6 +191,64 @@ VIS_ComputeVisibleRegion(
    return VisRgn;
 }
 
+PREGION FASTCALL
+VIS_ComputeVisibleRegion(
+   PWND Wnd,
+   BOOLEAN ClientArea,
+   BOOLEAN ClipChildren,
+   BOOLEAN ClipSiblings)
+{
+   PREGION VisRgn;
+   PVIS_CACHE_ENTRY Entry;
+   ULONG Flags;
+
+   if (!Wnd || !(Wnd->style & WS_VISIBLE))
+   {
+      return NULL;
+   }
+
+   Flags = (ClientArea ? VIS_CACHE_CLIENTAREA : 0) |
+           (ClipChildren ? VIS_CACHE_CLIPCHILDREN : 0) |
+           (ClipSiblings ? VIS_CACHE_CLIPSIBLINGS : 0);
+   Entry = &VisCache[(((ULONG_PTR)Wnd >> 4) ^ Flags) % VIS_CACHE_SIZE];
+
+   if (Entry->Wnd == Wnd &&
+       Entry->Flags == Flags &&
+       Entry->Serial == VisCacheSerial &&
+       RtlEqualMemory(&Entry->rcWindow, &Wnd->rcWindow, sizeof(RECTL)) &&
+       RtlEqualMemory(&Entry->rcClient, &Wnd->rcClient, sizeof(RECTL)))
+   {
+      VisRgn = IntSysCreateRectpRgn(0, 0, 0, 0);
+      if (VisRgn)
+         IntGdiCombineRgn(VisRgn, Entry->VisRgn, NULL, RGN_COPY);
+      return VisRgn;
+   }
+
+   VisRgn = VIS_ComputeVisibleRegionUncached(Wnd, ClientArea, ClipChildren, ClipSiblings);
+   if (!VisRgn)
+      return NULL;
+
+   /* Keep a copy, in place of whatever was there */
+   if (!Entry->VisRgn)
+      Entry->VisRgn = IntSysCreateRectpRgn(0, 0, 0, 0);
+
+   if (Entry->VisRgn &&
+       IntGdiCombineRgn(Entry->VisRgn, VisRgn, NULL, RGN_COPY) != ERROR)
+   {
+      Entry->Wnd = Wnd;
+      Entry->Flags = Flags;
+      Entry->Serial = VisCacheSerial;
+      Entry->rcWindow = Wnd->rcWindow;
+      Entry->rcClient = Wnd->rcClient;
+   }
+   else
+   {
+      Entry->Wnd = NULL;
+   }
+
+   return VisRgn;
+}
+
 VOID FASTCALL
 co_VIS_WindowLayoutChanged(
    PWND Wnd,
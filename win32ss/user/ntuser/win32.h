@@ -36,6 +36,9 @@
 
 #define QSIDCOUNTS 7
 
+/* Number of hash buckets indexing the posted messages by window */
+#define MSQ_WINDOW_BUCKETS 16
+
 typedef enum _QS_ROS_TYPES
 {
     QSRosKey = 0,
@@ -151,6 +154,10 @@ typedef struct _THREADINFO
     // Hard list QS_MOUSE|QS_KEY only
     // Accounting of queue bit sets, the rest are flags. QS_TIMER QS_PAINT counts are handled in thread information.
     DWORD nCntsQBits[QSIDCOUNTS]; // QS_KEY QS_MOUSEMOVE QS_MOUSEBUTTON QS_POSTMESSAGE QS_SENDMESSAGE QS_HOTKEY
+    // Posted messages again, hashed by window, so filtered peeks only visit their window's messages.
+    LIST_ENTRY PostedMessagesByWindow[MSQ_WINDOW_BUCKETS];
+    // Timers of this thread.
+    LIST_ENTRY TimerListHead;
 
     LIST_ENTRY WindowListHead;
     LIST_ENTRY W32CallbackListHead;
@@ -149,6 +149,7 @@ IntSetStyle( PWND pwnd, ULONG set_bits, ULONG clear_bits )
     styleNew = (pwnd->style | set_bits) & ~clear_bits;
     if (styleNew == styleOld) return styleNew;
     pwnd->style = styleNew;
+    VIS_InvalidateCache();
     if ((styleOld ^ styleNew) & WS_VISIBLE) // State Change.
     {
        if (styleOld & WS_VISIBLE) pwnd->head.pti->cVisWindows--;
@@ -595,6 +596,7 @@ LRESULT co_UserFreeWindow(PWND Window,
    Window->state2 |= WNDS2_INDESTROY;
    Window->style &= ~WS_VISIBLE;
    Window->head.pti->cVisWindows--;
+   VIS_InvalidateCache();
 
    /* remove the window already at this point from the thread window list so we
       don't get into trouble when destroying the thread windows while we're still
@@ -764,6 +766,7 @@ LRESULT co_UserFreeWindow(PWND Window,
       IntGdiSetRegionOwner(Window->hrgnClip, GDI_OBJ_HMGR_POWNED);
       GreDeleteObject(Window->hrgnClip);
       Window->hrgnClip = NULL;
+      VIS_InvalidateCache();
    }
    Window->head.pti->cWindows--;
 
@@ -956,6 +959,8 @@ IntLinkWindow(
         return;
     }
 
+    VIS_InvalidateCache();
+
     WndSetPrev(Wnd, WndInsertAfter);
     if (Wnd->spwndPrev)
     {
@@ -1248,6 +1253,7 @@ co_IntSetParent(PWND Wnd, PWND WndNewParent)
        !(Wnd->style & WS_CLIPSIBLINGS) )
    {
       Wnd->style |= WS_CLIPSIBLINGS;
+      VIS_InvalidateCache();
       DceResetActiveDCEs(Wnd);
    }
 
@@ -1359,6 +1365,8 @@ IntUnlinkWindow(PWND Wnd)
     ASSERT(Wnd != Wnd->spwndNext);
     ASSERT(Wnd != Wnd->spwndPrev);
 
+    VIS_InvalidateCache();
+
     if (Wnd->spwndNext)
         WndSetPrev(Wnd->spwndNext, Wnd->spwndPrev);
 
@@ -3915,6 +3923,7 @@ co_IntSetWindowLongPtr(HWND hWnd, DWORD Index, LONG_PTR NewValue, BOOL Ansi, ULO
             }
 
             Window->ExStyle = (DWORD)Style.styleNew;
+            VIS_InvalidateCache();
 
             co_IntSendMessage(hWnd, WM_STYLECHANGED, GWL_EXSTYLE, (LPARAM) &Style);
             break;
@@ -3968,6 +3977,7 @@ co_IntSetWindowLongPtr(HWND hWnd, DWORD Index, LONG_PTR NewValue, BOOL Ansi, ULO
                DceResetActiveDCEs( Window );
             }
             Window->style = (DWORD)Style.styleNew;
+            VIS_InvalidateCache();
 
             if (!bAlter)
                 co_IntSendMessage(hWnd, WM_STYLECHANGED, GWL_STYLE, (LPARAM) &Style);
@@ -264,6 +264,7 @@ SelectWindowRgn(PWND Window, HRGN hRgnClip)
         IntGdiSetRegionOwner(Window->hrgnClip, GDI_OBJ_HMGR_POWNED);
         GreDeleteObject(Window->hrgnClip);
         Window->hrgnClip = NULL;       
+        VIS_InvalidateCache();
     }
 
     if (hRgnClip > HRGN_WINDOW)
@@ -276,6 +277,7 @@ SelectWindowRgn(PWND Window, HRGN hRgnClip)
         IntGdiSetRegionOwner(hRgnClip, GDI_OBJ_HMGR_PUBLIC);
 
         Window->hrgnClip = hRgnClip;
+        VIS_InvalidateCache();
     }
 }
 
@@ -1958,6 +1960,14 @@ co_WinPosSetWindowPos(
    Window->rcWindow = NewWindowRect;
    Window->rcClient = NewClientRect;
 
+   /* Only the windows it left or entered see it differently */
+   if (!RtlEqualMemory(&OldWindowRect, &NewWindowRect, sizeof(RECTL)) ||
+       !RtlEqualMemory(&OldClientRect, &NewClientRect, sizeof(RECTL)))
+   {
+      VIS_InvalidateRect(&OldWindowRect);
+      VIS_InvalidateRect(&NewWindowRect);
+   }
+
    /* erase parent when hiding or resizing child */
    if (WinPos.flags & SWP_HIDEWINDOW)
    {
@@ -1972,6 +1982,7 @@ co_WinPosSetWindowPos(
 
       Window->style &= ~WS_VISIBLE; //IntSetStyle( Window, 0, WS_VISIBLE );
       Window->head.pti->cVisWindows--;
+      VIS_InvalidateCache();
       IntNotifyWinEvent(EVENT_OBJECT_HIDE, Window, OBJID_WINDOW, CHILDID_SELF, WEF_SETBYWNDPTI);
    }
    else if (WinPos.flags & SWP_SHOWWINDOW)
@@ -1999,6 +2010,7 @@ co_WinPosSetWindowPos(
 
       Window->style |= WS_VISIBLE; //IntSetStyle( Window, WS_VISIBLE, 0 );
       Window->head.pti->cVisWindows++;
+      VIS_InvalidateCache();
       IntNotifyWinEvent(EVENT_OBJECT_SHOW, Window, OBJID_WINDOW, CHILDID_SELF, WEF_SETBYWNDPTI);
    }
    else
@@ -114,6 +114,12 @@ SetTimer(HWND hWnd, UINT_PTR IDEvent, UINT Period, TIMERPROC TimerFunc)
     return NtUserSetTimer(hWnd, IDEvent, Period, TimerFunc);
 }
 
+EXTINLINE UINT_PTR WINAPI
+SetCoalescableTimer(HWND hWnd, UINT_PTR IDEvent, UINT Period, TIMERPROC TimerFunc, ULONG ToleranceDelay)
+{
+    return NtUserSetCoalescableTimer(hWnd, IDEvent, Period, TimerFunc, ToleranceDelay);
+}
+
 EXTINLINE BOOL WINAPI
 CloseWindowStation(HWINSTA hWinSta)
 {
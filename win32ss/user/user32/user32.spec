@@ -601,6 +601,7 @@
 592 stdcall SetClassWord(long long long) ; Direct call NtUserSetClassWord
 593 stdcall SetClipboardData(long long)
 594 stdcall SetClipboardViewer(long) NtUserSetClipboardViewer
+@ stdcall -version=0x602+ SetCoalescableTimer(ptr ptr long ptr long) NtUserSetCoalescableTimer
 595 stdcall SetConsoleReserveKeys(long long) NtUserSetConsoleReserveKeys
 596 stdcall SetCursor(long) NtUserSetCursor
 597 stdcall SetCursorContents(ptr ptr) NtUserSetCursorContents
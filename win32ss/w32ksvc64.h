@@ -688,3 +688,4 @@
     SVC_(UserSetDbgTagCount, 1)	//
     SVC_(UserSetRipFlags, 1)	//
     SVC_(UserSetScrollBarInfo, 3)	//
+    SVC_(UserSetCoalescableTimer, 5)	//